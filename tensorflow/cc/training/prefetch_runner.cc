@@ -14,9 +14,65 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/cc/training/prefetch_runner.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/default/logging.h"
 
 namespace tensorflow {
+
+namespace {
+
+// Average wait of takes above which consumers are considered starving.
+constexpr int64 kStarvingTakeWaitMicros = 100;
+// Number of consecutive intervals with a full buffer to remove a thread.
+constexpr int64 kFullIntervalsToShrink = 2;
+constexpr int64 kDefaultAutotuneIntervalMillis = 1000;
+
+}  // namespace
+
+/*------------------------- PrefetchThreadsAutotuner -------------------------*/
+
+PrefetchThreadsAutotuner::PrefetchThreadsAutotuner(int64 min_threads,
+                                                   int64 max_threads)
+    : min_threads_(min_threads),
+      max_threads_(max_threads),
+      num_threads_(max_threads),
+      last_num_takes_(0),
+      last_take_wait_micros_(0),
+      num_full_intervals_(0) {}
+
+int64 PrefetchThreadsAutotuner::RecordStats(int64 size, int64 capacity,
+                                            int64 num_takes,
+                                            int64 take_wait_micros) {
+  int64 takes = num_takes - last_num_takes_;
+  int64 wait_micros = take_wait_micros - last_take_wait_micros_;
+  last_num_takes_ = num_takes;
+  last_take_wait_micros_ = take_wait_micros;
+  if (takes <= 0) {
+    // Consumers are idle, nothing to learn from.
+    return num_threads_;
+  }
+
+  if (size >= capacity) {
+    if (++num_full_intervals_ >= kFullIntervalsToShrink &&
+        num_threads_ > min_threads_) {
+      --num_threads_;
+      num_full_intervals_ = 0;
+    }
+    return num_threads_;
+  }
+
+  num_full_intervals_ = 0;
+  if (wait_micros / takes > kStarvingTakeWaitMicros &&
+      num_threads_ < max_threads_) {
+    ++num_threads_;
+  }
+  return num_threads_;
+}
+
 /*----------------------------- PrefetchRunner -------------------------------*/
 
 PrefetchRunner::PrefetchRunner(std::string graph_key, std::string runner_name,
@@ -28,7 +84,10 @@ PrefetchRunner::PrefetchRunner(std::string graph_key, std::string runner_name,
       coord_(coord),
       params_(params),
       thread_nums_(0),
-      is_running_(false) {}
+      active_thread_nums_(0),
+      is_closed_(false),
+      is_running_(false),
+      force_stop_(false) {}
 
 PrefetchRunner::~PrefetchRunner() {
   Join();
@@ -50,6 +109,7 @@ void PrefetchRunner::Start() {
   {
     mutex_lock l(mu_);
     thread_nums_ = params_.fetch_ops().size();
+    active_thread_nums_ = thread_nums_;
   }
 
   thread_pool_.resize(thread_nums_);
@@ -59,6 +119,9 @@ void PrefetchRunner::Start() {
   if (coord_)
     cancel_thread_.reset(new std::thread(&PrefetchRunner::Stop, this));
 
+  if (!params_.stats_op().empty() && thread_pool_.size() > 1)
+    autotune_thread_.reset(new std::thread(&PrefetchRunner::Autotune, this));
+
   is_running_ = true;
 }
 
@@ -68,6 +131,13 @@ void PrefetchRunner::Stop() {
 
   sess_->Run({}, {}, {params_.cancel_op()}, nullptr);
   is_running_ = false;
+
+  {
+    mutex_lock l(mu_);
+    force_stop_ = true;
+  }
+  active_cv_.notify_all();
+  autotune_cv_.notify_all();
 }
 
 Status PrefetchRunner::Join() {
@@ -80,6 +150,10 @@ Status PrefetchRunner::Join() {
     cancel_thread_->join();
   }
 
+  if (autotune_thread_ != nullptr && autotune_thread_->joinable()) {
+    autotune_thread_->join();
+  }
+
   return Status::OK();
 }
 
@@ -109,7 +183,8 @@ void PrefetchRunner::Run(size_t index) {
   gen_val.reserve(feed_in_tensors.size());
   gen_inputs.reserve(feed_in_tensors.size());
   while (true) {
-    if (TF_PREDICT_FALSE(coord_ && coord_->ShouldStop())) {
+    if (TF_PREDICT_FALSE((coord_ && coord_->ShouldStop()) ||
+                         !WaitUntilActive(index))) {
       mutex_lock l (mu_);
       thread_nums_--;
       return;
@@ -141,6 +216,59 @@ void PrefetchRunner::Run(size_t index) {
   }
 }
 
+bool PrefetchRunner::WaitUntilActive(size_t index) {
+  mutex_lock l(mu_);
+  while (index >= active_thread_nums_ && !force_stop_) {
+    active_cv_.wait(l);
+  }
+  return !force_stop_;
+}
+
+void PrefetchRunner::Autotune() {
+  int64 interval_millis = params_.autotune_interval_millis() > 0
+                              ? params_.autotune_interval_millis()
+                              : kDefaultAutotuneIntervalMillis;
+  int64 min_threads = std::max(params_.min_threads(), 1);
+  PrefetchThreadsAutotuner autotuner(
+      std::min<int64>(min_threads, thread_pool_.size()), thread_pool_.size());
+  std::vector<std::string> stats_tensors;
+  for (int i = 0; i < 4; i++)
+    stats_tensors.emplace_back(strings::StrCat(params_.stats_op(), ":", i));
+
+  std::vector<Tensor> stats;
+  while (true) {
+    {
+      mutex_lock l(mu_);
+      autotune_cv_.wait_for(l, std::chrono::milliseconds(interval_millis));
+      if (force_stop_ || is_closed_)
+        return;
+    }
+
+    stats.clear();
+    Status s = sess_->Run({}, stats_tensors, {}, &stats);
+    if (TF_PREDICT_FALSE(!s.ok())) {
+      LOG(WARNING) << "PrefetchRunner <" << name_
+                   << "> Autotuning was stopped: " << s.error_message();
+      return;
+    }
+
+    int64 num_threads = autotuner.RecordStats(
+        stats[0].scalar<int32>()(), stats[1].scalar<int32>()(),
+        stats[2].scalar<int64>()(), stats[3].scalar<int64>()());
+    {
+      mutex_lock l(mu_);
+      if (force_stop_ || is_closed_)
+        return;
+      if (static_cast<size_t>(num_threads) == active_thread_nums_)
+        continue;
+      VLOG(1) << "PrefetchRunner <" << name_ << "> Number of running threads "
+              << active_thread_nums_ << " -> " << num_threads;
+      active_thread_nums_ = static_cast<size_t>(num_threads);
+    }
+    active_cv_.notify_all();
+  }
+}
+
 /// Only Status Code is in `ignored_exceptions`, return `true`,
 /// otherwise return `false`.
 bool PrefetchRunner::CheckRunErrorStatus(Status& s) {
@@ -176,7 +304,12 @@ void PrefetchRunner::DealWithClosedError() {
     thread_nums_--;
     if (thread_nums_ == 0)
       sess_->Run({}, {}, {params_.close_op()}, nullptr);
+    // Resumes paused threads so that they also reach the end.
+    is_closed_ = true;
+    active_thread_nums_ = thread_pool_.size();
   }
+  active_cv_.notify_all();
+  autotune_cv_.notify_all();
 }
 
 void PrefetchRunner::DealWithIgnoredError(Status& s) {
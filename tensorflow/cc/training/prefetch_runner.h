@@ -27,10 +27,35 @@ limitations under the License.
 #include "tensorflow/cc/training/coordinator.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/public/session.h"
 
 namespace tensorflow {
 
+/// PrefetchThreadsAutotuner decides the number of running prefetching threads
+/// from statistics of the data buffer. It adds a thread while takes are
+/// waiting for samples on a buffer that is not full, and removes a thread
+/// while the buffer stays full.
+class PrefetchThreadsAutotuner {
+ public:
+  PrefetchThreadsAutotuner(int64 min_threads, int64 max_threads);
+
+  /// Records cumulative statistics of the buffer and returns the number of
+  /// threads to run.
+  int64 RecordStats(int64 size, int64 capacity, int64 num_takes,
+                    int64 take_wait_micros);
+
+  int64 num_threads() const { return num_threads_; }
+
+ private:
+  const int64 min_threads_;
+  const int64 max_threads_;
+  int64 num_threads_;
+  int64 last_num_takes_;
+  int64 last_take_wait_micros_;
+  int64 num_full_intervals_;
+};
+
 /// PrefetchRunner class is responsible for prefetching tensor by repeating
 /// running given ops.
 class PrefetchRunner : public RunnerInterface {
@@ -71,14 +96,27 @@ class PrefetchRunner : public RunnerInterface {
 
   mutex mu_;
   size_t thread_nums_ GUARDED_BY(mu_);
+  /// Threads with index not less than it are paused.
+  size_t active_thread_nums_ GUARDED_BY(mu_);
+  bool is_closed_ GUARDED_BY(mu_);
+  condition_variable active_cv_;
+  condition_variable autotune_cv_;
   std::atomic<bool> is_running_;
   std::atomic<bool> force_stop_;
   std::vector<std::unique_ptr<std::thread>> thread_pool_;
   std::unique_ptr<std::thread> cancel_thread_;
+  std::unique_ptr<std::thread> autotune_thread_;
 
   /// Run prefetch subgraph.
   void Run(size_t index);
 
+  /// Blocks while the thread is paused. Returns `false` if the runner is
+  /// stopped.
+  bool WaitUntilActive(size_t index);
+
+  /// Adjusts number of active threads by statistics of the data buffer.
+  void Autotune();
+
   /// Check the return status of Session run, return `true` if execution can
   /// continue, otherwise return `false`.
   bool CheckRunErrorStatus(Status &s);
@@ -0,0 +1,66 @@
+/* Copyright 2023 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/cc/training/prefetch_runner.h"
+
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(PrefetchThreadsAutotunerTest, StartsWithMaxThreads) {
+  PrefetchThreadsAutotuner autotuner(1, 4);
+  EXPECT_EQ(4, autotuner.num_threads());
+}
+
+TEST(PrefetchThreadsAutotunerTest, ShrinksWhileBufferIsFull) {
+  PrefetchThreadsAutotuner autotuner(2, 4);
+  EXPECT_EQ(4, autotuner.RecordStats(8, 8, 100, 0));
+  EXPECT_EQ(3, autotuner.RecordStats(8, 8, 200, 0));
+  EXPECT_EQ(3, autotuner.RecordStats(8, 8, 300, 0));
+  EXPECT_EQ(2, autotuner.RecordStats(8, 8, 400, 0));
+  // Never below min threads.
+  EXPECT_EQ(2, autotuner.RecordStats(8, 8, 500, 0));
+  EXPECT_EQ(2, autotuner.RecordStats(8, 8, 600, 0));
+}
+
+TEST(PrefetchThreadsAutotunerTest, GrowsWhileConsumersWait) {
+  PrefetchThreadsAutotuner autotuner(1, 3);
+  EXPECT_EQ(3, autotuner.RecordStats(8, 8, 100, 0));
+  EXPECT_EQ(2, autotuner.RecordStats(8, 8, 200, 0));
+  // 1ms wait per take on an empty buffer.
+  EXPECT_EQ(3, autotuner.RecordStats(0, 8, 300, 100000));
+  // Never above max threads.
+  EXPECT_EQ(3, autotuner.RecordStats(0, 8, 400, 200000));
+}
+
+TEST(PrefetchThreadsAutotunerTest, KeepsThreadsWhenConsumersIdle) {
+  PrefetchThreadsAutotuner autotuner(1, 4);
+  EXPECT_EQ(4, autotuner.RecordStats(8, 8, 0, 0));
+  EXPECT_EQ(4, autotuner.RecordStats(8, 8, 0, 0));
+  EXPECT_EQ(4, autotuner.RecordStats(8, 8, 0, 0));
+}
+
+TEST(PrefetchThreadsAutotunerTest, KeepsThreadsWithoutWaiting) {
+  PrefetchThreadsAutotuner autotuner(1, 4);
+  EXPECT_EQ(4, autotuner.RecordStats(8, 8, 100, 0));
+  // Partially filled buffer without waiting resets the shrinking.
+  EXPECT_EQ(4, autotuner.RecordStats(4, 8, 200, 10));
+  EXPECT_EQ(4, autotuner.RecordStats(8, 8, 300, 10));
+  EXPECT_EQ(3, autotuner.RecordStats(8, 8, 400, 10));
+}
+
+}  // namespace
+}  // namespace tensorflow
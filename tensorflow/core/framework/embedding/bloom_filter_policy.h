@@ -68,7 +68,7 @@ class BloomFilterPolicy : public FilterPolicy<K, V, EV> {
     Status s = ev_->LookupKey(key, &value_ptr);
     if (s.ok()) {
       V* mem_val = ev_->LookupOrCreateEmb(value_ptr, default_value_ptr);
-      memcpy(val, mem_val, sizeof(V) * ev_->ValueLen());
+      ev_->CopyEmbedding(value_ptr, val, mem_val);
     } else {
       memcpy(val, default_value_no_permission, sizeof(V) * ev_->ValueLen());
     }
@@ -179,7 +179,7 @@ class BloomFilterPolicy : public FilterPolicy<K, V, EV> {
     if (GetBloomFreq(key) >= config_.filter_freq) {
       TF_CHECK_OK(ev_->LookupOrCreateKey(key, value_ptr));
       V* mem_val = ev_->LookupOrCreateEmb(*value_ptr, default_value_ptr);
-      memcpy(val, mem_val, sizeof(V) * ev_->ValueLen());
+      ev_->CopyEmbedding(*value_ptr, val, mem_val);
     } else {
       AddFreq(key, count);
       memcpy(val, default_value_no_permission, sizeof(V) * ev_->ValueLen());
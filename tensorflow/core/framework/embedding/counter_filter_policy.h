@@ -37,7 +37,7 @@ class CounterFilterPolicy : public FilterPolicy<K, V, EV> {
     Status s = ev_->LookupKey(key, &value_ptr);
     if (s.ok() && GetFreq(key, value_ptr) >= config_.filter_freq) {
       V* mem_val = ev_->LookupOrCreateEmb(value_ptr, default_value_ptr);
-      memcpy(val, mem_val, sizeof(V) * ev_->ValueLen());
+      ev_->CopyEmbedding(value_ptr, val, mem_val);
     } else {
       memcpy(val, default_value_no_permission, sizeof(V) * ev_->ValueLen());
     }
@@ -95,7 +95,7 @@ class CounterFilterPolicy : public FilterPolicy<K, V, EV> {
     TF_CHECK_OK(ev_->LookupOrCreateKey(key, value_ptr));
     if (GetFreq(key, *value_ptr) >= config_.filter_freq) {
       V* mem_val = ev_->LookupOrCreateEmb(*value_ptr, default_value_ptr);
-      memcpy(val, mem_val, sizeof(V) * ev_->ValueLen());
+      ev_->CopyEmbedding(*value_ptr, val, mem_val);
     } else {
       memcpy(val, default_value_no_permission, sizeof(V) * ev_->ValueLen());
     }
@@ -37,6 +37,7 @@ limitations under the License.
 #include "tensorflow/core/framework/embedding/storage.h"
 #include "tensorflow/core/framework/embedding/storage_factory.h"
 #include "tensorflow/core/framework/typed_allocator.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 using CPUDevice = Eigen::ThreadPoolDevice;
@@ -85,6 +86,9 @@ class EmbeddingVar : public ResourceBase {
     } else {
       update_version_fn_ = [](ValuePtr<V>* value_ptr, int64 gs) {};
     }
+    // In row lock mode the apply ops do not take mu_, each row update is
+    // guarded by the seqlock of its ValuePtr instead.
+    TF_CHECK_OK(ReadBoolFromEnvVar("TF_EV_ROW_LOCK", false, &row_lock_));
   }
 
   Status Init(const Tensor& default_tensor, int64 default_value_dim) {
@@ -304,16 +308,16 @@ class EmbeddingVar : public ResourceBase {
       for (int64 i = start; i < limit; ++i) {
         bool is_admit = filter_->is_admit(keys[i], value_ptrs[i]);
         add_freq_fn_(value_ptrs[i], 1, emb_config_.filter_freq);
-        V* value = nullptr;
         if (is_admit) {
           V* default_v =
               default_value_ +
                   (keys[i] % emb_config_.default_value_dim) * value_len_;
-          value = LookupOrCreateEmb(value_ptrs[i], default_v);
+          V* value = LookupOrCreateEmb(value_ptrs[i], default_v);
+          CopyEmbedding(value_ptrs[i], output + i * value_len_, value);
         } else {
-          value = default_value_no_permission_;
+          memcpy(output + i * value_len_, default_value_no_permission_,
+                 sizeof(V) * value_len_);
         }
-        memcpy(output + i * value_len_, value, sizeof(V) * value_len_);
       }
     };
     auto worker_threads = context.worker_threads;
@@ -554,6 +558,32 @@ class EmbeddingVar : public ResourceBase {
     return emb_config_.steps_to_live;
   }
 
+  bool IsRowLock() const {
+    return row_lock_;
+  }
+
+  // Copies the embedding `src` of `value_ptr` to `dst`. In row lock mode
+  // the copy is retried until no update of the row overlapped it.
+  void CopyEmbedding(ValuePtr<V>* value_ptr, V* dst, const V* src) {
+    if (!row_lock_) {
+      memcpy(dst, src, sizeof(V) * value_len_);
+      return;
+    }
+    uint32 stamp;
+    do {
+      stamp = value_ptr->ReadBegin();
+      memcpy(dst, src, sizeof(V) * value_len_);
+    } while (value_ptr->ReadRetry(stamp));
+  }
+
+  bool IsSaveVersion() const {
+    return emb_config_.is_save_version();
+  }
+
+  LayoutType GetLayoutType() {
+    return storage_->GetLayoutType();
+  }
+
   bool IsMultiLevel() {
     return storage_->IsMultiLevel();
   }
@@ -851,6 +881,7 @@ class EmbeddingVar : public ResourceBase {
   FilterPolicy<K, V, EmbeddingVar<K, V>>* filter_;
   std::function<void(ValuePtr<V>*, int64, int64)> add_freq_fn_;
   std::function<void(ValuePtr<V>*, int64)> update_version_fn_;
+  bool row_lock_ = false;
 
   TF_DISALLOW_COPY_AND_ASSIGN(EmbeddingVar);
 };
@@ -47,6 +47,10 @@ class GlobalStepShrinkPolicy : public ShrinkPolicy<K, V> {
   void FilterToDelete(int64 global_step,
                       std::vector<K>& key_list,
                       std::vector<ValuePtr<V>*>& value_list) {
+    // The step in the ValuePtr header is the last step a row was used in.
+    // KvResourceSparseApplyLazyAdam reads the same field as the last update
+    // of the row, stamping a row that was never updated only makes it decay
+    // moments that are still zero.
     for (int64 i = 0; i < key_list.size(); ++i) {
       int64 version = value_list[i]->GetStep();
       if (version == -1) {
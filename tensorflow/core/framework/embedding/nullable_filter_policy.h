@@ -43,7 +43,7 @@ class NullableFilterPolicy : public FilterPolicy<K, V, EV> {
     Status s = ev_->LookupKey(key, &value_ptr);
     if (s.ok()) {
       V* mem_val = ev_->LookupOrCreateEmb(value_ptr, default_value_ptr);
-      memcpy(val, mem_val, sizeof(V) * ev_->ValueLen());
+      ev_->CopyEmbedding(value_ptr, val, mem_val);
     } else {
       memcpy(val, default_value_ptr,
              sizeof(V) * ev_->ValueLen());
@@ -119,7 +119,7 @@ class NullableFilterPolicy : public FilterPolicy<K, V, EV> {
                       const V* default_value_no_permission) override {
     TF_CHECK_OK(ev_->LookupOrCreateKey(key, value_ptr));
     V* mem_val = ev_->LookupOrCreateEmb(*value_ptr, default_value_ptr);
-    memcpy(val, mem_val, sizeof(V) * ev_->ValueLen());
+    ev_->CopyEmbedding(*value_ptr, val, mem_val);
   }
 
   Status LookupOrCreateKey(K key, ValuePtr<V>** val,
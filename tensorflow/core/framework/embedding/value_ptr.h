@@ -254,6 +254,21 @@ class ValuePtr {
     return false;
   }
 
+  // Per-row seqlock, used when the EmbeddingVar is in row lock mode.
+  // Readers copy the row between ReadBegin() and ReadRetry() and start over
+  // when ReadRetry() returns true, writers update the row between
+  // WriteBegin() and WriteEnd(). Subclasses without a stamp never retry.
+  virtual uint32 ReadBegin() {
+    return 0;
+  }
+
+  virtual bool ReadRetry(uint32 stamp) {
+    return false;
+  }
+
+  virtual void WriteBegin() {}
+
+  virtual void WriteEnd() {}
 };
 
 template <class V>
@@ -328,9 +343,42 @@ class LooseValuePtr : public ValuePtr<V> {
     return ptr_;
   }
 
+  // An odd stamp means that a writer is updating the row.
+  virtual uint32 ReadBegin() {
+    uint32 stamp = seq_.load(std::memory_order_acquire);
+    while (stamp & 1) {
+      stamp = seq_.load(std::memory_order_acquire);
+    }
+    return stamp;
+  }
+
+  virtual bool ReadRetry(uint32 stamp) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return seq_.load(std::memory_order_relaxed) != stamp;
+  }
+
+  virtual void WriteBegin() {
+    // Writers of the same row exclude each other, otherwise two concurrent
+    // writers would make the stamp even again.
+    for (;;) {
+      uint32 stamp = seq_.load(std::memory_order_relaxed);
+      if (!(stamp & 1) && seq_.compare_exchange_weak(stamp, stamp + 1,
+              std::memory_order_acquire, std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  virtual void WriteEnd() {
+    seq_.fetch_add(1, std::memory_order_release);
+  }
+
  protected:
   void* ptr_;
   std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
+  // Fits in the padding after flag_, it does not grow the object.
+  std::atomic<uint32> seq_{0};
 };
 
 template <class V>
@@ -20,7 +20,7 @@ limitations under the License.
 
 namespace tensorflow {
 
-class BloomFilterAdmitStrategy : public HashTableAdmitStrategy {
+class BloomFilterAdmitStrategy : public SlicedAdmitStrategy {
  public:
   BloomFilterAdmitStrategy(int64 minimum_frequency,
                            int64 num_hash_func,
@@ -31,9 +31,9 @@ class BloomFilterAdmitStrategy : public HashTableAdmitStrategy {
   virtual ~BloomFilterAdmitStrategy();
   bool Admit(int64 key) override;
   bool Admit(int64 key, int64 freq) override;
-  std::vector<int8> Snapshot();
+  std::vector<int8> Snapshot() override;
   void Restore(int64 src_beg, int64 src_length, int64 dst_beg,
-               int64 dst_length, const std::vector<int8>& src);
+               int64 dst_length, const std::vector<int8>& src) override;
  private:
   void GenerateSeeds();
   bool AdmitInternal(int64 key, int64 counting);
@@ -0,0 +1,194 @@
+/* Copyright 2022 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/hash_table/decayed_count_strategy.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace tensorflow {
+
+namespace {
+
+// Counters are rebased once increments are scaled by more than e^20.
+constexpr double kMaxLogScale = 20.0;
+
+inline uint64 Mix(uint64 h) {
+  h ^= h >> 23;
+  h *= 0x2127599bf4325c37ULL;
+  h ^= h >> 47;
+  return h;
+}
+
+// FastHash64 of an 8-byte key, branch free so that the batch loop
+// vectorizes.
+inline uint64 HashKey(uint64 key, uint64 seed) {
+  const uint64 m = 0x880355f21e6d1965ULL;
+  uint64 h = seed ^ (sizeof(int64) * m);
+  h ^= Mix(key);
+  h *= m;
+  return Mix(h);
+}
+
+}  // namespace
+
+DecayedCountAdmitStrategy::DecayedCountAdmitStrategy(float threshold,
+                                                     float half_life,
+                                                     int64 num_hash_func,
+                                                     const TensorShape& shape,
+                                                     int64 slice_offset,
+                                                     int64 max_slice_size,
+                                                     Env* env)
+  : threshold_(threshold),
+    decay_rate_(half_life > 0 ? std::log(2.0) / half_life : 0.0),
+    num_hash_func_(num_hash_func),
+    shape_(shape),
+    slice_offset_(slice_offset),
+    max_slice_size_(max_slice_size),
+    segment_size_(shape.dim_size(1)),
+    counters_(shape.num_elements(), 0.0f),
+    env_(env) {
+  CHECK(num_hash_func_ > 0) << "num_hash_func should be larger than zero";
+  CHECK(segment_size_ < (1LL << 32)) << "segment too large: " << segment_size_;
+  for (int64 i = 0; i < num_hash_func_; ++i) {
+    seeds_.push_back((i + 1) * 0x9e3779b97f4a7c15ULL);
+  }
+  landmark_ = Now();
+  LOG(INFO) << "segment size: " << segment_size_
+      << ", slice: " << shape_.dim_size(0)
+      << ", slice_offset: " << slice_offset_
+      << ", max_slice_size: " << max_slice_size_
+      << ", threshold: " << threshold_
+      << ", half_life: " << half_life;
+}
+
+bool DecayedCountAdmitStrategy::Admit(int64 key) {
+  bool admit;
+  AdmitBatch(&key, nullptr, 1, &admit);
+  return admit;
+}
+
+bool DecayedCountAdmitStrategy::Admit(int64 key, int64 freq) {
+  bool admit;
+  AdmitBatch(&key, &freq, 1, &admit);
+  return admit;
+}
+
+void DecayedCountAdmitStrategy::Hash(
+    const int64* keys, int64 size, int64* index) {
+  std::vector<int64> rows(size);
+  for (int64 i = 0; i < size; ++i) {
+    rows[i] = ((uint64)keys[i] % max_slice_size_ - slice_offset_) *
+        segment_size_;
+    CHECK(rows[i] >= 0 && rows[i] < shape_.num_elements())
+        << "invalid key slice: key=" << keys[i] << ",max_slice_size="
+        << max_slice_size_ << ",slice_offset=" << slice_offset_;
+  }
+  // multiply-shift instead of modulo keeps the inner loop vectorizable
+  uint64 segment = segment_size_;
+  for (int64 j = 0; j < num_hash_func_; ++j) {
+    uint64 seed = seeds_[j];
+    int64* out = index + j * size;
+    for (int64 i = 0; i < size; ++i) {
+      uint64 h = HashKey(keys[i], seed);
+      out[i] = rows[i] + (int64)(((h >> 32) * segment) >> 32);
+    }
+  }
+}
+
+void DecayedCountAdmitStrategy::AdmitBatch(
+    const int64* keys, const int64* freqs, int64 size, bool* admit) {
+  std::vector<int64> index(size * num_hash_func_);
+  Hash(keys, size, index.data());
+  double now = Now();
+  mutex_lock lock(mu_);
+  float scale = Scale(now);
+  float bar = threshold_ * scale;
+  for (int64 i = 0; i < size; ++i) {
+    int64 freq = freqs == nullptr ? 1 : freqs[i];
+    CHECK(freq > 0) << "counting should be larger than zero";
+    float inc = freq * scale;
+    float count = std::numeric_limits<float>::max();
+    for (int64 j = 0; j < num_hash_func_; ++j) {
+      float& counter = counters_[index[j * size + i]];
+      counter += inc;
+      count = std::min(count, counter);
+    }
+    admit[i] = count >= bar;
+  }
+}
+
+float DecayedCountAdmitStrategy::Count(int64 key) {
+  std::vector<int64> index(num_hash_func_);
+  Hash(&key, 1, index.data());
+  double now = Now();
+  mutex_lock lock(mu_);
+  float scale = Scale(now);
+  float count = std::numeric_limits<float>::max();
+  for (int64 j = 0; j < num_hash_func_; ++j) {
+    count = std::min(count, counters_[index[j]]);
+  }
+  return count / scale;
+}
+
+float DecayedCountAdmitStrategy::Scale(double now) {
+  if ((now - landmark_) * decay_rate_ > kMaxLogScale) {
+    Rebase(now);
+  }
+  return std::exp((now - landmark_) * decay_rate_);
+}
+
+void DecayedCountAdmitStrategy::Rebase(double now) {
+  float decay = std::exp((landmark_ - now) * decay_rate_);
+  for (auto&& counter : counters_) {
+    counter *= decay;
+  }
+  landmark_ = now;
+}
+
+std::vector<int8> DecayedCountAdmitStrategy::Snapshot() {
+  double now = Now();
+  mutex_lock lock(mu_);
+  // saved counters are decayed to the save time, which becomes the
+  // landmark on restore
+  Rebase(now);
+  std::vector<int8> ret(counters_.size() * sizeof(float));
+  std::memcpy(ret.data(), counters_.data(), ret.size());
+  return ret;
+}
+
+void DecayedCountAdmitStrategy::Restore(int64 src_beg, int64 src_length,
+                                        int64 dst_beg, int64 dst_length,
+                                        const std::vector<int8>& src) {
+  CHECK(!(src_beg >= dst_beg + dst_length || dst_beg >= src_beg + src_length))
+      << "Cannot restore from this slice: src_beg=" << src_beg
+      << ", src_length=" << src_length << ", dst_beg=" << dst_beg
+      << ", dst_length=" << dst_length;
+  double now = Now();
+  mutex_lock lock(mu_);
+  Rebase(now);
+  int64 beg = std::max(src_beg, dst_beg);
+  int64 len = std::min(src_beg + src_length, dst_beg + dst_length) - beg;
+  int64 src_start = beg - src_beg;
+  int64 dst_start = beg - dst_beg;
+  CHECK((src_start + len) * segment_size_ * (int64)sizeof(float) <=
+        (int64)src.size()) << "Checkpoint's slice is too small";
+  std::memcpy(counters_.data() + dst_start * segment_size_,
+              src.data() + src_start * segment_size_ * sizeof(float),
+              len * segment_size_ * sizeof(float));
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,77 @@
+/* Copyright 2022 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_FRAMEWORK_HASH_TABLE_DECAYED_COUNT_STRATEGY_H_
+#define TENSORFLOW_FRAMEWORK_HASH_TABLE_DECAYED_COUNT_STRATEGY_H_
+
+#include "tensorflow/core/framework/hash_table/hash_table.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+
+// Admits a key once its frequency, decayed exponentially with the given
+// half-life in seconds, reaches threshold. The frequencies are kept in a
+// count-min sketch of float counters, so that ids which stop showing up are
+// forgotten instead of saturating the filter.
+//
+// Counters are stored relative to a landmark time (forward decay): an
+// increment at time t is scaled up by 2^((t - landmark) / half_life) rather
+// than decaying every counter on every tick, and the counters are rebased
+// when the scale grows large.
+class DecayedCountAdmitStrategy : public SlicedAdmitStrategy {
+ public:
+  DecayedCountAdmitStrategy(float threshold,
+                            float half_life,
+                            int64 num_hash_func,
+                            const TensorShape& shape,
+                            int64 slice_offset = 0,
+                            int64 max_slice_size = 1,
+                            Env* env = Env::Default());
+  bool Admit(int64 key) override;
+  bool Admit(int64 key, int64 freq) override;
+  void AdmitBatch(const int64* keys, const int64* freqs, int64 size,
+                  bool* admit) override;
+  // Decayed frequency of key at the current time.
+  float Count(int64 key);
+  std::vector<int8> Snapshot() override;
+  void Restore(int64 src_beg, int64 src_length, int64 dst_beg,
+               int64 dst_length, const std::vector<int8>& src) override;
+
+ private:
+  // Writes the counter offsets of keys to index, key-major per hash func.
+  void Hash(const int64* keys, int64 size, int64* index);
+  double Now() { return env_->NowMicros() / 1e6; }
+  // Scale of an increment at now. Requires mu_.
+  float Scale(double now);
+  // Decays all counters to now and moves the landmark there. Requires mu_.
+  void Rebase(double now);
+
+  float threshold_;
+  double decay_rate_;
+  int64 num_hash_func_;
+  TensorShape shape_;
+  int64 slice_offset_;
+  int64 max_slice_size_;
+  int64 segment_size_;
+  std::vector<uint64> seeds_;
+  std::vector<float> counters_;
+  double landmark_;
+  Env* env_;
+  mutex mu_;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_FRAMEWORK_HASH_TABLE_DECAYED_COUNT_STRATEGY_H_
@@ -0,0 +1,91 @@
+/* Copyright 2022 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/hash_table/decayed_count_strategy.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+
+namespace {
+
+class FakeClockEnv : public EnvWrapper {
+ public:
+  FakeClockEnv() : EnvWrapper(Env::Default()) {}
+  uint64 NowMicros() const override { return now_; }
+  void AdvanceSeconds(int64 seconds) { now_ += seconds * 1000000; }
+
+ private:
+  uint64 now_ = 1000000;
+};
+
+}  // namespace
+
+TEST(DecayedCountAdmitStrategy, Simple) {
+  FakeClockEnv env;
+  int64 key = -123;
+  DecayedCountAdmitStrategy dc(3, 10, 3, {1, 1024}, 0, 1, &env);
+  EXPECT_FALSE(dc.Admit(key));
+  EXPECT_FALSE(dc.Admit(key));
+  EXPECT_TRUE(dc.Admit(key));
+  EXPECT_NEAR(3.0, dc.Count(key), 1e-4);
+
+  // one half-life later the key needs to be seen again
+  env.AdvanceSeconds(10);
+  EXPECT_NEAR(1.5, dc.Count(key), 1e-4);
+  EXPECT_FALSE(dc.Admit(key));
+  EXPECT_TRUE(dc.Admit(key));
+
+  // long past the rebase point old ids are forgotten
+  env.AdvanceSeconds(1000);
+  EXPECT_NEAR(0.0, dc.Count(key), 1e-4);
+  EXPECT_FALSE(dc.Admit(key, 2));
+  EXPECT_TRUE(dc.Admit(key, 1));
+}
+
+TEST(DecayedCountAdmitStrategy, Batch) {
+  FakeClockEnv env;
+  std::vector<int64> keys = { 101, 202, -3003, -11111111, 99999999, 101 };
+  std::vector<int64> freqs = { 1, 2, 3, 4, 5, 1 };
+  DecayedCountAdmitStrategy dc(3, 10, 3, {1, 1024}, 0, 1, &env);
+  bool admit[6];
+  dc.AdmitBatch(keys.data(), freqs.data(), keys.size(), admit);
+  EXPECT_FALSE(admit[0]);
+  EXPECT_FALSE(admit[1]);
+  EXPECT_TRUE(admit[2]);
+  EXPECT_TRUE(admit[3]);
+  EXPECT_TRUE(admit[4]);
+  EXPECT_FALSE(admit[5]);
+  dc.AdmitBatch(keys.data(), nullptr, keys.size(), admit);
+  EXPECT_TRUE(admit[0]);
+  EXPECT_TRUE(admit[1]);
+}
+
+TEST(DecayedCountAdmitStrategy, SnapshotAndRestore) {
+  FakeClockEnv env;
+  int64 key = 12345;
+  DecayedCountAdmitStrategy dc(3, 10, 3, {2, 1024}, 0, 2, &env);
+  dc.Admit(key, 4);
+  env.AdvanceSeconds(10);
+  std::vector<int8> snapshot = dc.Snapshot();
+
+  // time between save and restore does not count
+  env.AdvanceSeconds(100);
+  DecayedCountAdmitStrategy restored(3, 10, 3, {2, 1024}, 0, 2, &env);
+  restored.Restore(0, 2, 0, 2, snapshot);
+  EXPECT_NEAR(2.0, restored.Count(key), 1e-4);
+  EXPECT_TRUE(restored.Admit(key));
+}
+
+}  // namespace tensorflow
@@ -20,8 +20,11 @@ limitations under the License.
 #include <unordered_set>
 
 #include "tensorflow/core/framework/hash_table/status_collector.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/util/env_var.h"
 
 namespace {
@@ -68,47 +71,76 @@ void HashTable::IdsContainer::Clear() {
   region_list_.clear();
 }
 
-void HashTable::IdsAllocator::GetIds(int64 count, IdsContainer* ids) {
+void HashTable::IdsAllocator::SetNuma(
+    std::shared_ptr<NumaBlockMap> block_map) {
+  block_map_ = std::move(block_map);
+  free_list_.resize(block_map_->num_nodes());
+  counter_.resize(block_map_->num_nodes(), 0);
+  block_end_.resize(block_map_->num_nodes(), 0);
+}
+
+void HashTable::IdsAllocator::AddRegion(
+    int64 count, int node, IdsContainer* ids) {
+  if (block_map_ == nullptr) {
+    ids->region_list_.emplace_back();
+    ids->region_list_.back().start = counter_[0];
+    counter_[0] += count;
+    ids->region_list_.back().end = counter_[0];
+    return;
+  }
+  // ids of a node are only contiguous inside one block
+  while (count > 0) {
+    if (counter_[node] == block_end_[node]) {
+      block_map_->SetNode(next_block_, node);
+      counter_[node] = next_block_ * block_map_->block();
+      block_end_[node] = counter_[node] + block_map_->block();
+      ++next_block_;
+    }
+    int64 len = std::min(count, block_end_[node] - counter_[node]);
+    ids->region_list_.emplace_back();
+    ids->region_list_.back().start = counter_[node];
+    ids->region_list_.back().end = counter_[node] + len;
+    counter_[node] += len;
+    count -= len;
+  }
+}
+
+void HashTable::IdsAllocator::GetIds(
+    int64 count, IdsContainer* ids, int node) {
   count -= ids->Size();
   if (count <= 0) return;
-  if (free_list_.empty()) {
-    ids->region_list_.emplace_back();
-    ids->region_list_.back().start = counter_;
-    counter_ += count;
-    ids->region_list_.back().end = counter_;
+  auto&& free_list = free_list_[node];
+  if (free_list.empty()) {
+    AddRegion(count, node, ids);
     return;
   }
-  int64 from_list = count <= free_list_.size() ? count : free_list_.size();
+  int64 from_list = count <= free_list.size() ? count : free_list.size();
   ids->id_list_.insert(ids->id_list_.end(),
-      free_list_.begin(), free_list_.begin() + from_list);
-  free_list_.erase(free_list_.begin(), free_list_.begin() + from_list);
+      free_list.begin(), free_list.begin() + from_list);
+  free_list.erase(free_list.begin(), free_list.begin() + from_list);
 
   int64 left = count - from_list;
   if (left <= 0) return;
-  ids->region_list_.emplace_back();
-  ids->region_list_.back().start = counter_;
-  counter_ += left;
-  ids->region_list_.back().end = counter_;
-}
-
-void HashTable::IdsAllocator::GetId(int64* id) {
-  if (free_list_.empty()) {
-    *id = counter_++;
-    return;
-  }
-  *id = free_list_.front();
-  free_list_.pop_front();
+  AddRegion(left, node, ids);
 }
 
 void HashTable::IdsAllocator::Clear() {
-  free_list_.clear();
-  counter_ = 0;
+  for (auto&& free_list : free_list_) {
+    free_list.clear();
+  }
+  std::fill(counter_.begin(), counter_.end(), 0);
+  std::fill(block_end_.begin(), block_end_.end(), 0);
+  next_block_ = 0;
+  if (block_map_ != nullptr) {
+    block_map_->Clear();
+  }
 }
 
 HashTable::HashTable(int num_worker_threads, bool concurrent_read,
     int slice_size, int id_block_size)
   : slice_size_(slice_size), id_block_size_(id_block_size),
-    size_(slice_size), concurrent_read_(concurrent_read) {
+    size_(slice_size), concurrent_read_(concurrent_read),
+    prealloc_target_(0) {
   num_tables_ = num_worker_threads;
   LOG(INFO) << "HashTable table splits: " << num_tables_;
   table_locks_.resize(num_tables_);
@@ -124,11 +156,48 @@ HashTable::HashTable(int num_worker_threads, bool concurrent_read,
     tables_.back().set_empty_key(kPreseverdEmptyKey);
     tables_.back().set_deleted_key(kPreseverdEmptyKey + 1);
   }
+  TF_CHECK_OK(ReadInt64FromEnvVar("TF_HASH_TABLE_PREALLOC_WATERMARK", 0,
+                                  &prealloc_watermark_));
+  if (prealloc_watermark_ < 0 || prealloc_watermark_ >= 100) {
+    LOG(WARNING) << "Invalid TF_HASH_TABLE_PREALLOC_WATERMARK: "
+                 << prealloc_watermark_ << ", preallocation disabled.";
+    prealloc_watermark_ = 0;
+  }
+  if (prealloc_watermark_ > 0) {
+    LOG(INFO) << "HashTable preallocates segments above "
+              << prealloc_watermark_ << "% of its size";
+    prealloc_pool_.reset(new thread::ThreadPool(
+        Env::Default(), "hash_table_prealloc", 1));
+  }
+  bool numa_mode;
+  TF_CHECK_OK(ReadBoolFromEnvVar("TF_HASH_TABLE_NUMA", false, &numa_mode));
+  numa_nodes_ = 0;
+  if (numa_mode) {
+    numa_nodes_ = port::NUMAEnabled() ? port::NUMANumNodes() : 1;
+    LOG(INFO) << "HashTable NUMA mode on " << numa_nodes_ << " node(s)";
+    numa_counters_.reset(new NumaCounter[numa_nodes_]);
+    if (numa_nodes_ > 1) {
+      numa_block_map_ =
+          std::make_shared<NumaBlockMap>(numa_nodes_, slice_size_);
+      ids_allocator_.SetNuma(numa_block_map_);
+      int threads_per_node = std::max(1, num_tables_ / numa_nodes_);
+      for (int i = 0; i < numa_nodes_; ++i) {
+        ThreadOptions thread_options;
+        thread_options.numa_node = i;
+        numa_pools_.emplace_back(new thread::ThreadPool(
+            Env::Default(), thread_options,
+            strings::StrCat("hash_table_numa_", i), threads_per_node));
+      }
+    }
+  }
 }
 
 void HashTable::AddTensible(
     TensibleVariable* tensor, std::function<void(Status)> done) {
   tensor->Ref();
+  if (numa_nodes_ > 1) {
+    tensor->SetNumaPlacement(numa_block_map_);
+  }
   AddTask([this, done, tensor] {
     tensor->Resize(size_, [this, tensor, done] (Status st) {
       if (st.ok()) {
@@ -141,6 +210,8 @@ void HashTable::AddTensible(
 }
 
 HashTable::~HashTable() {
+  prealloc_pool_.reset();
+  numa_pools_.clear();
   for (auto tensor : tensors_) {
     tensor->Unref();
   }
@@ -237,8 +308,9 @@ void HashTable::GetIds(
       while (counter--) {
         int64 table_idx = start_idx % num_tables_;
         ++start_idx;
-        (*runner)([this, keys, freqs, ids, size, partitions,
-            partition_threads, table_idx, admit_strategy, done_stc]{
+        RunOnTableNode(table_idx, runner, [this, keys, freqs, ids, size,
+            partitions, partition_threads, table_idx, admit_strategy,
+            done_stc]{
           GetIdsSimple(keys, freqs, ids, size, partitions,
               partition_threads, table_idx, admit_strategy,
               done_stc->AddStatusFunc());
@@ -304,12 +376,14 @@ void HashTable::GetIdsSimpleForConcurrentRead(
   int64 new_id_size = 0;
   int64 sizex = 0;
   int64 cur_idx;
+  int64 num_keys = 0;
   {
     tf_shared_lock rlock(table_locks_[table_idx]);
     for (int64 i = 0; i < partition_threads; ++i) {
       int64 next_idx = *(partitions + table_idx);
       partitions += num_tables_;
       while(next_idx != -1) {
+        ++num_keys;
         cur_idx = next_idx;
         next_idx = ids[next_idx];
         auto iter = tables_[table_idx].find(keys[cur_idx]);
@@ -336,7 +410,8 @@ void HashTable::GetIdsSimpleForConcurrentRead(
     mutex_lock wlock(table_locks_[table_idx]);
     {
       mutex_lock lock(update_mu_);
-      ids_allocator_.GetIds(new_id_size, &ids_container_[table_idx]);
+      ids_allocator_.GetIds(new_id_size, &ids_container_[table_idx],
+                            TableNode(table_idx));
     }
     while (new_id_list != -1) {
       cur_idx = new_id_list;
@@ -352,8 +427,10 @@ void HashTable::GetIdsSimpleForConcurrentRead(
       sizex = std::max(sizex, ids[cur_idx]);
     }
   }
+  MaybePrealloc(sizex);
+  auto record_done = RecordNumaAccess(table_idx, sizex, num_keys, done);
   sizex = (sizex / slice_size_ + 1) * slice_size_;
-  Resize(sizex, done);
+  Resize(sizex, record_done);
 }
 
 void HashTable::GetIdsSimpleForExclusiveAccess(
@@ -364,12 +441,14 @@ void HashTable::GetIdsSimpleForExclusiveAccess(
   // do find
   int64 sizex = 0;
   int64 cur_idx;
+  int64 num_keys = 0;
   {
     mutex_lock lock(table_locks_[table_idx]);
     for (int64 i = 0; i < partition_threads; ++i) {
       int64 next_idx = *(partitions + table_idx);
       partitions += num_tables_;
       while(next_idx != -1) {
+        ++num_keys;
         cur_idx = next_idx;
         next_idx = ids[next_idx];
         auto iter = tables_[table_idx].find(keys[cur_idx]);
@@ -389,7 +468,8 @@ void HashTable::GetIdsSimpleForExclusiveAccess(
         // do alloc ids
         if (!ids_container_[table_idx].GetNext(&ids[cur_idx])) {
           mutex_lock lock(update_mu_);
-          ids_allocator_.GetIds(kPreAllocIds, &ids_container_[table_idx]);
+          ids_allocator_.GetIds(kPreAllocIds, &ids_container_[table_idx],
+                                TableNode(table_idx));
           CHECK(ids_container_[table_idx].GetNext(&ids[cur_idx]));
         }
         tables_[table_idx][keys[cur_idx]] = ids[cur_idx];
@@ -398,8 +478,10 @@ void HashTable::GetIdsSimpleForExclusiveAccess(
     }
   }
 
+  MaybePrealloc(sizex);
+  auto record_done = RecordNumaAccess(table_idx, sizex, num_keys, done);
   sizex = (sizex / slice_size_ + 1) * slice_size_;
-  Resize(sizex, done);
+  Resize(sizex, record_done);
 }
 
 void HashTable::Resize(int64 size, std::function<void(Status)> done) {
@@ -408,27 +490,112 @@ void HashTable::Resize(int64 size, std::function<void(Status)> done) {
     return;
   }
   AddTask([size, done, this] {
-    if (size_ >= size) {
-      done(Status::OK());
-      RunNext();
+    ResizeTensors(size, done);
+  });
+}
+
+void HashTable::ResizeTensors(int64 size, std::function<void(Status)> done) {
+  if (size_ >= size) {
+    done(Status::OK());
+    RunNext();
+    return;
+  }
+  StatusCollector* stc = new StatusCollector(tensors_.size(),
+  [this, size, done] (Status st) {
+    if (st.ok()) {
+      size_ = std::max(size_.load(), size);
+    }
+    done(st);
+    RunNext();
+  });
+  for (auto tensor : tensors_) {
+    tensor->Resize(size, [stc] (Status st) {
+      stc->AddStatus(st);
+    });
+  }
+  stc->Start();
+}
+
+void HashTable::MaybePrealloc(int64 max_id) {
+  if (prealloc_watermark_ == 0) {
+    return;
+  }
+  // Resize tasks grow size_ concurrently, compare against a single load.
+  const int64 size = size_.load(std::memory_order_acquire);
+  if ((max_id + 1) * 100 <= size * prealloc_watermark_) {
+    return;
+  }
+  // Grow so that max_id sits at the watermark again.
+  int64 target = (max_id + 1) * 100 / prealloc_watermark_;
+  target = (target / slice_size_ + 1) * slice_size_;
+  int64 scheduled = prealloc_target_.load();
+  do {
+    if (scheduled >= target) {
       return;
-    } else {
-      StatusCollector* stc = new StatusCollector(tensors_.size(),
-      [this, size, done] (Status st) {
-        if (st.ok()) {
-          size_ = std::max(size_.load(), size);
-        }
-        done(st);
+    }
+  } while (!prealloc_target_.compare_exchange_weak(scheduled, target));
+  PreallocStep();
+}
+
+void HashTable::PreallocStep() {
+  prealloc_pool_->Schedule([this] {
+    AddBackgroundTask([this] {
+      const int64 target = prealloc_target_.load();
+      if (size_ >= target) {
         RunNext();
+        return;
+      }
+      // A Resize from GetIds queued meanwhile waits for one slice at most.
+      const int64 size = std::min(target, size_.load() + slice_size_);
+      ResizeTensors(size, [this, size] (Status st) {
+        if (!st.ok()) {
+          LOG(WARNING) << "HashTable preallocation to " << size
+                       << " failed: " << st.ToString();
+          return;
+        }
+        PreallocStep();
       });
-      for (auto tensor : tensors_) {
-        tensor->Resize(size, [stc] (Status st) {
-          stc->AddStatus(st);
-        });
+    });
+  });
+}
+
+std::function<void(Status)> HashTable::RecordNumaAccess(
+    int64 table_idx, int64 id, int64 count, std::function<void(Status)> done) {
+  if (numa_nodes_ == 0 || count == 0) {
+    return done;
+  }
+  static thread_local int thread_node = port::NUMAGetThreadNodeAffinity();
+  const int node = thread_node;
+  return [this, table_idx, id, count, node, done] (Status st) {
+    if (st.ok()) {
+      NumaCounter& counter = numa_counters_[TableNode(table_idx)];
+      if (numa_nodes_ == 1 || numa_block_map_->MemNodeOf(id) == node) {
+        counter.local_hits += count;
+      } else {
+        counter.remote_hits += count;
       }
-      stc->Start();
     }
-  });
+    done(st);
+  };
+}
+
+std::vector<HashTable::NumaStats> HashTable::GetNumaStats() const {
+  std::vector<NumaStats> stats(numa_nodes_);
+  for (int i = 0; i < numa_nodes_; ++i) {
+    stats[i].local_hits = numa_counters_[i].local_hits;
+    stats[i].remote_hits = numa_counters_[i].remote_hits;
+  }
+  return stats;
+}
+
+void HashTable::RunOnTableNode(
+    int64 table_idx, std::function<void(std::function<void()>)>* runner,
+    std::function<void()> fn) {
+  if (numa_pools_.empty()) {
+    (*runner)(std::move(fn));
+  } else {
+    numa_pools_[TableNode(table_idx)]->Schedule(std::move(fn));
+  }
 }
 
 void HashTable::AddTask(std::function<void()> task) {
@@ -443,11 +610,31 @@ void HashTable::AddTask(std::function<void()> task) {
   }
 }
 
+void HashTable::AddBackgroundTask(std::function<void()> task) {
+  bool run;
+  {
+    mutex_lock lock(task_mu_);
+    run = tasks_.empty();
+    if (run) {
+      tasks_.push(task);
+    } else {
+      background_tasks_.push(task);
+    }
+  }
+  if (run) {
+    task();
+  }
+}
+
 void HashTable::RunNext() {
   std::function<void()> task;
   {
     mutex_lock lock(task_mu_);
     tasks_.pop();
+    if (tasks_.empty() && !background_tasks_.empty()) {
+      tasks_.push(background_tasks_.front());
+      background_tasks_.pop();
+    }
     if (!tasks_.empty()) {
       task = tasks_.front();
     }
@@ -462,6 +649,9 @@ void HashTable::ClearAllTask() {
   while (!tasks_.empty()) {
     tasks_.pop();
   }
+  while (!background_tasks_.empty()) {
+    background_tasks_.pop();
+  }
 }
 
 void HashTable::DeleteKeys(
@@ -513,6 +703,7 @@ void HashTable::Clear(const std::function<void(Status)>& done) {
         ids_container_[i].Clear();
       }
       size_ = 0;
+      prealloc_target_ = 0;
     }
     done(Status::OK());
     ClearAllTask();
@@ -549,24 +740,111 @@ void HashTable::Snapshot(std::vector<int64>* keys,
   }
 }
 
+template <typename Fn>
+void HashTable::ParallelSnapshot(
+    const std::function<void(std::function<void()>)>& runner, Fn fn,
+    std::vector<std::pair<int64, int64>>* output) {
+  int64 size = size_;
+  std::vector<std::vector<std::pair<int64, int64>>> parts(num_tables_);
+  BlockingCounter counter(num_tables_);
+  for (int64 i = 0; i < num_tables_; ++i) {
+    runner([this, i, size, &fn, &parts, &counter] {
+      {
+        tf_shared_lock lock(table_locks_[i]);
+        auto&& table = tables_[i];
+        auto&& part = parts[i];
+        part.reserve(table.size());
+        std::pair<int64, int64> item;
+        for (auto iter = table.begin(); iter != table.end(); ++iter) {
+          if (iter->second < size && fn(iter->first, iter->second, &item)) {
+            part.push_back(item);
+          }
+        }
+      }
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  size_t total = output->size();
+  for (auto&& part : parts) {
+    total += part.size();
+  }
+  output->reserve(total);
+  for (auto&& part : parts) {
+    output->insert(output->end(), part.begin(), part.end());
+    std::vector<std::pair<int64, int64>>().swap(part);
+  }
+}
+
+std::vector<std::pair<int64, int64>> HashTable::Snapshot(
+    const std::function<void(std::function<void()>)>& runner) {
+  std::vector<std::pair<int64, int64>> ret;
+  ParallelSnapshot(runner,
+      [](int64 key, int64 id, std::pair<int64, int64>* item) {
+        *item = std::make_pair(key, id);
+        return true;
+      }, &ret);
+  return ret;
+}
+
 int64 HashTable::GetIdsWithoutResize(int64* keys, int64* ids, int64 size) {
-  mutex_lock lock(update_mu_);
+  // Group the keys by table, so that every table is locked once and
+  // concurrent restores of different slices only meet on update_mu_.
+  std::vector<std::vector<int64>> table_keys(num_tables_);
   for (int64 i = 0; i < size; i++) {
-    int64 table_idx = KeyToTableIdx(keys + i);
-    auto iter = tables_[table_idx].find(keys[i]);
-    if (iter != tables_[table_idx].end() && iter->second != kNotAdmitted) {
-      ids[i] = iter->second;
-    } else {
-      int64 new_id;
-      ids_allocator_.GetId(&new_id);
-      size_++;
-      tables_[table_idx][keys[i]] = new_id;
-      ids[i] = new_id;
+    table_keys[KeyToTableIdx(keys + i)].push_back(i);
+  }
+  int64 max_id = -1;
+  std::vector<int64> missing;
+  for (int64 table_idx = 0; table_idx < num_tables_; ++table_idx) {
+    if (table_keys[table_idx].empty()) {
+      continue;
+    }
+    auto&& table = tables_[table_idx];
+    mutex_lock lock(table_locks_[table_idx]);
+    missing.clear();
+    for (int64 i : table_keys[table_idx]) {
+      auto iter = table.find(keys[i]);
+      if (iter != table.end() && iter->second != kNotAdmitted) {
+        ids[i] = iter->second;
+      } else {
+        missing.push_back(i);
+      }
+    }
+    if (missing.empty()) {
+      continue;
+    }
+    {
+      mutex_lock lock(update_mu_);
+      ids_allocator_.GetIds(missing.size(), &ids_container_[table_idx],
+                            TableNode(table_idx));
+    }
+    for (int64 i : missing) {
+      // a key may occur twice in one call
+      auto iter = table.find(keys[i]);
+      if (iter != table.end() && iter->second != kNotAdmitted) {
+        ids[i] = iter->second;
+        continue;
+      }
+      CHECK(ids_container_[table_idx].GetNext(&ids[i]));
+      table[keys[i]] = ids[i];
+      max_id = std::max(max_id, ids[i]);
     }
   }
+  int64 cur = size_;
+  while (max_id + 1 > cur && !size_.compare_exchange_weak(cur, max_id + 1)) {
+  }
   return size_;
 }
 
+void HashTable::Reserve(int64 size) {
+  int64 per_table = size / num_tables_ + 1;
+  for (int64 i = 0; i < num_tables_; ++i) {
+    mutex_lock lock(table_locks_[i]);
+    tables_[i].resize(tables_[i].size() + per_table);
+  }
+}
+
 namespace {
 constexpr int64 kIndexLen = 52;
 constexpr int64 kIndexBase = 0xFFFFFFFFFFFFF;
@@ -617,6 +895,23 @@ Status CoalescedHashTable::ChildSnapshot(
   return Status::OK();
 }
 
+Status CoalescedHashTable::ChildSnapshot(
+    const string& name,
+    const std::function<void(std::function<void()>)>& runner,
+    std::vector<std::pair<int64, int64>>* output) {
+  string child_name = ChildName(name);
+  int64 index = index_map_[child_name];
+  ParallelSnapshot(runner,
+      [index](int64 key, int64 id, std::pair<int64, int64>* item) {
+        if (!Match(key, index)) {
+          return false;
+        }
+        *item = std::make_pair(Decode(key), id);
+        return true;
+      }, output);
+  return Status::OK();
+}
+
 std::function<void(int64*,size_t)> CoalescedHashTable::MakeReviserFn(
     const string& name) {
   string child_name = ChildName(name);
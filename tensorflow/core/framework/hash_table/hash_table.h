@@ -28,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/framework/hash_table/tensible_variable.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/platform/mutex.h"
 
 namespace tensorflow {
@@ -37,6 +38,22 @@ class HashTableAdmitStrategy {
   virtual ~HashTableAdmitStrategy() {}
   virtual bool Admit(int64 key) = 0;
   virtual bool Admit(int64 key, int64 freq) { return Admit(key); }
+  // Admits keys[i] seen freqs[i] times, or once if freqs is null.
+  virtual void AdmitBatch(const int64* keys, const int64* freqs, int64 size,
+                          bool* admit) {
+    for (int64 i = 0; i < size; ++i) {
+      admit[i] = freqs == nullptr ? Admit(keys[i]) : Admit(keys[i], freqs[i]);
+    }
+  }
+};
+
+// An admit strategy whose state is a [slice, segment] buffer partitioned
+// like the hash table, which is saved and restored slice by slice.
+class SlicedAdmitStrategy : public HashTableAdmitStrategy {
+ public:
+  virtual std::vector<int8> Snapshot() = 0;
+  virtual void Restore(int64 src_beg, int64 src_length, int64 dst_beg,
+                       int64 dst_length, const std::vector<int8>& src) = 0;
 };
 
 class HashTable {
@@ -57,11 +74,26 @@ class HashTable {
       int64* keys, int64* ids, int64 size,
       const std::function<void(Status)>& done);
   std::vector<std::pair<int64, int64>> Snapshot();
+  // Snapshots the tables in parallel on runner, each under its own lock.
+  std::vector<std::pair<int64, int64>> Snapshot(
+      const std::function<void(std::function<void()>)>& runner);
   void Snapshot(std::vector<int64>* keys, std::vector<int64>* ids);
   int64 GetIdsWithoutResize(int64* keys, int64* ids, int64 size);
+  // Grows the tables to hold size more keys without rehashing.
+  void Reserve(int64 size);
 
   int64 Size() { return size_; }
 
+  struct NumaStats {
+    int64 local_hits;
+    int64 remote_hits;
+  };
+  // Number of NUMA nodes the table is spread over, 0 when NUMA mode is off.
+  int NumaNodes() const { return numa_nodes_; }
+  // Keys looked up per node, split by whether the looking up thread ran on
+  // the node the memory of their ids was measured on.
+  std::vector<NumaStats> GetNumaStats() const;
+
   void Clear(const std::function<void(Status)>& done);
 
   const std::vector<TensibleVariable*>& Tensibles() { return tensors_; }
@@ -90,8 +122,38 @@ class HashTable {
       HashTableAdmitStrategy* admit_strategy,
       std::function<void(Status)> done);
   void Resize(int64 size, std::function<void(Status)> done);
+  // Grows all tensors to size from within a task, then runs the next task.
+  void ResizeTensors(int64 size, std::function<void(Status)> done);
+  // Grows the table in the background once max_id crosses the watermark, so
+  // that later GetIds calls find their ids already backed by segments.
+  void MaybePrealloc(int64 max_id);
+  // Grows the table by one slice towards prealloc_target_ as a background
+  // task, and schedules the next slice until the target is reached.
+  void PreallocStep();
+  // Wraps done to count count keys of table_idx looked up by the calling
+  // thread, once Resize has placed the memory of their ids. The ids of a
+  // table come from blocks claimed by its node, so the memory of id stands
+  // for all of them.
+  std::function<void(Status)> RecordNumaAccess(
+      int64 table_idx, int64 id, int64 count,
+      std::function<void(Status)> done);
+  // Runs fn on a worker of the node owning table_idx if there is one.
+  void RunOnTableNode(int64 table_idx,
+                      std::function<void(std::function<void()>)>* runner,
+                      std::function<void()> fn);
+  inline int TableNode(int64 table_idx) const {
+    return numa_nodes_ <= 1 ? 0 : table_idx % numa_nodes_;
+  }
+  // Collects fn(key, id, &output) over all tables, one runner task per
+  // table. fn returns false to skip an entry.
+  template <typename Fn>
+  void ParallelSnapshot(
+      const std::function<void(std::function<void()>)>& runner, Fn fn,
+      std::vector<std::pair<int64, int64>>* output);
 
   void AddTask(std::function<void()> task);
+  // Runs task once no task is queued, tasks added meanwhile run first.
+  void AddBackgroundTask(std::function<void()> task);
   void RunNext();
   void ClearAllTask();
 
@@ -136,27 +198,56 @@ class HashTable {
 
   class IdsAllocator {
    public:
-    void GetIds(int64 count, IdsContainer* ids);
-    inline void GetId(int64* id);
+    IdsAllocator() : free_list_(1), counter_(1, 0), block_end_(1, 0) {}
+    // Hands out ids to num_nodes in blocks claimed from the single id space,
+    // the owner of every block is recorded in block_map.
+    void SetNuma(std::shared_ptr<NumaBlockMap> block_map);
+    void GetIds(int64 count, IdsContainer* ids, int node = 0);
     inline void FreeId(int64 id) {
-      free_list_.push_back(id);
+      free_list_[NodeOf(id)].push_back(id);
+    }
+    inline int NodeOf(int64 id) const {
+      return block_map_ == nullptr ? 0 : std::max(0, block_map_->NodeOf(id));
     }
     void Clear();
 
    private:
-    std::deque<int64> free_list_;
-    std::atomic<int64> counter_ = {0};
+    void AddRegion(int64 count, int node, IdsContainer* ids);
+
+    std::shared_ptr<NumaBlockMap> block_map_;
+    std::vector<std::deque<int64>> free_list_;
+    // Next id and end of the block each node hands out from. Without NUMA
+    // there is a single unbounded stream.
+    std::vector<int64> counter_;
+    std::vector<int64> block_end_;
+    int64 next_block_ = 0;
   };
   mutex update_mu_;
   IdsAllocator ids_allocator_;
 
   mutex task_mu_;
   std::queue<std::function<void()>> tasks_;
+  std::queue<std::function<void()>> background_tasks_;
   std::atomic<int64> size_;
 
   std::vector<TensibleVariable*> tensors_;
 
   const bool concurrent_read_;
+
+  // Percentage of size_ above which segments are preallocated, 0 disables.
+  int64 prealloc_watermark_;
+  std::atomic<int64> prealloc_target_;
+  std::unique_ptr<thread::ThreadPool> prealloc_pool_;
+
+  int numa_nodes_;
+  struct NumaCounter {
+    std::atomic<int64> local_hits{0};
+    std::atomic<int64> remote_hits{0};
+  };
+  std::unique_ptr<NumaCounter[]> numa_counters_;
+  // Owner node of every block of ids, null unless spread over 2+ nodes.
+  std::shared_ptr<NumaBlockMap> numa_block_map_;
+  std::vector<std::unique_ptr<thread::ThreadPool>> numa_pools_;
 };
 
 class CoalescedHashTable : public HashTable {
@@ -176,6 +267,10 @@ class CoalescedHashTable : public HashTable {
   Status ValidChild(const string& name);
   Status ChildSnapshot(const string& name,
                        std::vector<std::pair<int64, int64>>* output);
+  Status ChildSnapshot(
+      const string& name,
+      const std::function<void(std::function<void()>)>& runner,
+      std::vector<std::pair<int64, int64>>* output);
   std::function<void(int64*,size_t)> MakeReviserFn(const string& name);
   void ClearChildren(const std::vector<string>& table_names,
                      const std::function<void(Status)>& done);
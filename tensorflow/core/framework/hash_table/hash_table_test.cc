@@ -13,12 +13,20 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+#include <set>
 #include <utility>
 
 #include "tensorflow/core/framework/hash_table/hash_table.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 #include "gmock/gmock.h"
 
@@ -31,6 +39,19 @@ class MockProducer {
   MOCK_METHOD0(Produce, std::pair<Status, Tensor>());
 };
 
+TensibleVariable* NewZeroTensible(int64 segment_size, int64 dim) {
+  TensorGenerator* generator = new TensorGenerator(
+  [segment_size, dim](TensorGenerator::Consumer consumer) {
+    Tensor t(DT_FLOAT, TensorShape({segment_size, dim}));
+    t.flat<float>().setZero();
+    consumer(Status::OK(), t);
+  });
+  TensibleVariable* tv = new TensibleVariable(
+      generator, TensorShape({segment_size, dim}), DT_FLOAT);
+  generator->Unref();
+  return tv;
+}
+
 }
 
 TEST(HashTable, Simple) {
@@ -96,6 +117,165 @@ TEST(HashTable, Simple) {
   }
 }
 
+TEST(HashTable, PreallocAboveWatermark) {
+  setenv("TF_HASH_TABLE_PREALLOC_WATERMARK", "50", 1);
+  TensorGenerator* generator = new TensorGenerator(
+  [](TensorGenerator::Consumer consumer) {
+    Tensor t(DT_INT64, TensorShape({5, 2}));
+    t.flat<int64>().setZero();
+    consumer(Status::OK(), t);
+  });
+  Status rst_status;
+  auto consumer = [&](Status st) {
+    rst_status = st;
+  };
+  TensibleVariable* tv = new TensibleVariable(
+      generator, TensorShape({5, 2}), DT_INT64);
+  generator->Unref();
+  {
+    HashTable ht(2, true, 7, 3);
+    unsetenv("TF_HASH_TABLE_PREALLOC_WATERMARK");
+    ht.AddTensible(tv, consumer);
+    TF_ASSERT_OK(rst_status);
+    EXPECT_EQ(7, ht.Size());
+
+    // 3 ids stay below half of the table, nothing is preallocated.
+    int64 keys[7] = {100, 101, 102, 103, 104, 105, 106};
+    int64 ids[7];
+    ht.GetIds(keys, nullptr, ids, 3, nullptr, nullptr, consumer, false);
+    TF_ASSERT_OK(rst_status);
+    EXPECT_EQ(7, ht.Size());
+
+    // 7 ids cross the watermark, the table grows ahead of the next lookup.
+    ht.GetIds(keys, nullptr, ids, 7, nullptr, nullptr, consumer, false);
+    TF_ASSERT_OK(rst_status);
+    for (int i = 0; i < 1000 && ht.Size() < 21; i++) {
+      Env::Default()->SleepForMicroseconds(1000);
+    }
+    EXPECT_EQ(21, ht.Size());
+    EXPECT_EQ(25, tv->Size());
+    for (int i = 0; i < 7; i++) {
+      EXPECT_EQ(0, tv->GetSlice<int64>(ids[i])[0]);
+    }
+  }
+  tv->Unref();
+}
+
+TEST(HashTable, NumaStats) {
+  setenv("TF_HASH_TABLE_NUMA", "1", 1);
+  HashTable ht(4, true, 8, 3);
+  unsetenv("TF_HASH_TABLE_NUMA");
+  EXPECT_LE(1, ht.NumaNodes());
+  TensibleVariable* tv = NewZeroTensible(8, 2);
+  Status rst_status;
+  auto consumer = [&](Status st) {
+    rst_status = st;
+  };
+  ht.AddTensible(tv, consumer);
+  TF_ASSERT_OK(rst_status);
+  tv->Unref();
+
+  int64 keys[8] = {100, 101, 102, 103, 104, 105, 100, 101};
+  int64 ids[8];
+  ht.GetIds(keys, nullptr, ids, 8, nullptr, nullptr, consumer, false);
+  TF_ASSERT_OK(rst_status);
+  EXPECT_EQ(ids[0], ids[6]);
+  EXPECT_EQ(ids[1], ids[7]);
+  for (int i = 0; i < 8; i++) {
+    EXPECT_LT(ids[i], tv->Size());
+  }
+
+  int64 hits = 0;
+  for (auto&& stats : ht.GetNumaStats()) {
+    hits += stats.local_hits + stats.remote_hits;
+  }
+  EXPECT_EQ(8, hits);
+}
+
+TEST(HashTable, RestoreAndParallelSnapshot) {
+  HashTable ht(4, false, 8, 3);
+  ht.Reserve(20);
+  int64 keys[24], ids[24];
+  for (int i = 0; i < 20; i++) {
+    keys[i] = i * 7 + 1;
+  }
+  for (int i = 20; i < 24; i++) {
+    keys[i] = keys[i - 20];
+  }
+  EXPECT_EQ(20, ht.GetIdsWithoutResize(keys, ids, 24));
+  std::set<int64> distinct(ids, ids + 20);
+  EXPECT_EQ(20, distinct.size());
+  EXPECT_EQ(0, *distinct.begin());
+  EXPECT_EQ(19, *distinct.rbegin());
+  for (int i = 20; i < 24; i++) {
+    EXPECT_EQ(ids[i - 20], ids[i]);
+  }
+
+  thread::ThreadPool pool(Env::Default(), "snapshot", 4);
+  auto runner = [&pool](std::function<void()> fn) {
+    pool.Schedule(std::move(fn));
+  };
+  auto expected = ht.Snapshot();
+  auto actual = ht.Snapshot(runner);
+  std::sort(expected.begin(), expected.end());
+  std::sort(actual.begin(), actual.end());
+  EXPECT_EQ(20, actual.size());
+  EXPECT_EQ(expected, actual);
+}
+
+static void BM_HashTableGetIdsAndRead(int iters, int numa) {
+  testing::StopTiming();
+  constexpr int kBatch = 1 << 17;
+  constexpr int kDim = 16;
+  setenv("TF_HASH_TABLE_NUMA", numa ? "1" : "0", 1);
+  HashTable ht(8, true, 1 << 16, 1 << 13);
+  unsetenv("TF_HASH_TABLE_NUMA");
+  TensibleVariable* tv = NewZeroTensible(1 << 16, kDim);
+  Status st;
+  ht.AddTensible(tv, [&st](Status s) { st = s; });
+  TF_CHECK_OK(st);
+
+  thread::ThreadPool pool(Env::Default(), "bm_hash_table", 8);
+  std::function<void(std::function<void()>)> runner =
+      [&pool](std::function<void()> fn) { pool.Schedule(std::move(fn)); };
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+  std::vector<int64> keys(kBatch);
+  std::vector<int64> ids(kBatch);
+  std::vector<float> sum(kDim);
+  testing::StartTiming();
+  for (int i = 0; i < iters; ++i) {
+    for (auto&& key : keys) {
+      key = rnd.Uniform64(1 << 20);
+    }
+    BlockingCounter counter(1);
+    ht.GetIds(keys.data(), nullptr, ids.data(), kBatch, nullptr, &runner,
+              [&st, &counter](Status s) { st = s; counter.DecrementCount(); });
+    counter.Wait();
+    for (auto id : ids) {
+      const float* row = tv->GetSlice<float>(id);
+      for (int j = 0; j < kDim; ++j) {
+        sum[j] += row[j];
+      }
+    }
+  }
+  testing::StopTiming();
+  TF_CHECK_OK(st);
+  int64 local = 0, remote = 0;
+  for (auto&& stats : ht.GetNumaStats()) {
+    local += stats.local_hits;
+    remote += stats.remote_hits;
+  }
+  if (local + remote > 0) {
+    testing::SetLabel(strings::StrCat(
+        ht.NumaNodes(), " node(s), local ratio ",
+        static_cast<double>(local) / (local + remote)));
+  }
+  testing::ItemsProcessed(static_cast<int64>(iters) * kBatch);
+  tv->Unref();
+}
+BENCHMARK(BM_HashTableGetIdsAndRead)->Arg(0)->Arg(1);
+
 }  // namespace tensorflow
 
 
@@ -14,12 +14,73 @@ limitations under the License.
 ==============================================================================*/
 
 #include "tensorflow/core/framework/hash_table/tensible_variable.h"
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/hash_table/status_collector.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/numa.h"
 
 #include <future>
+#include <unordered_map>
 
 namespace tensorflow {
 
+namespace {
+
+// Allocates memory bound to a NUMA node. Unlike cpu_allocator(node), it
+// does not depend on ProcessState having NUMA allocators enabled.
+class NumaNodeAllocator : public Allocator {
+ public:
+  explicit NumaNodeAllocator(int node)
+      : node_(node), name_(strings::StrCat("numa_node_", node)) {}
+
+  string Name() override { return name_; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    void* ptr = port::NUMAMalloc(node_, num_bytes, static_cast<int>(alignment));
+    if (ptr != nullptr) {
+      mutex_lock lock(mu_);
+      sizes_[ptr] = num_bytes;
+    }
+    return ptr;
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    size_t num_bytes;
+    {
+      mutex_lock lock(mu_);
+      auto iter = sizes_.find(ptr);
+      num_bytes = iter->second;
+      sizes_.erase(iter);
+    }
+    port::NUMAFree(ptr, num_bytes);
+  }
+
+ private:
+  const int node_;
+  const string name_;
+  mutex mu_;
+  // NUMAFree needs the size of every allocation.
+  std::unordered_map<void*, size_t> sizes_ GUARDED_BY(mu_);
+};
+
+// Allocator bound to node, the default CPU allocator for nodes the
+// platform does not know about.
+Allocator* NumaAllocator(int node) {
+  static std::vector<Allocator*>* allocators = [] {
+    auto* allocators = new std::vector<Allocator*>;
+    for (int i = 0; i < port::NUMANumNodes(); i++) {
+      allocators->push_back(new NumaNodeAllocator(i));
+    }
+    return allocators;
+  }();
+  if (node < 0 || node >= static_cast<int>(allocators->size())) {
+    return cpu_allocator();
+  }
+  return (*allocators)[node];
+}
+
+}  // namespace
+
 TensibleVariable::TensibleVariable(
     TensorGenerator* generator, const TensorShape& shape, DataType dtype)
     : generator_(generator), shape_(shape), dtype_(dtype) {
@@ -31,10 +92,18 @@ TensibleVariable::TensibleVariable(
   eigen_slice_shape_[0] = slice_size_;
   slice_size_ *= DataTypeSize(dtype);
   segment_size_ = shape_.dim_size(0);
+  segment_shift_ = -1;
+  segment_mask_ = segment_size_ - 1;
+  if (segment_size_ > 0 && (segment_size_ & segment_mask_) == 0) {
+    segment_shift_ = 0;
+    while ((int64{1} << segment_shift_) < segment_size_) {
+      ++segment_shift_;
+    }
+  }
   all_ptr_vec_.emplace_back();
   all_ptr_vec_.back().size = kPtrStartSize;
   all_ptr_vec_.back().ptr.reset(new char*[kPtrStartSize]);
-  ptrs_ = all_ptr_vec_.back().ptr.get();
+  ptrs_.store(all_ptr_vec_.back().ptr.get(), std::memory_order_release);
   generator_->Ref();
 }
 
@@ -44,14 +113,23 @@ TensibleVariable::~TensibleVariable() {
 
 void TensibleVariable::Resize(
     int64 size, const std::function<void(Status)>& done) {
-  if (size <= size_) {
+  int64_t segment_count;
+  {
+    // Read size_ once under the lock its writers hold, so that a segment
+    // published meanwhile does not skew the count.
+    mutex_lock lock(structure_update_mu_);
+    const int64 cur_size = size_.load();
+    segment_count =
+        size <= cur_size ? 0 : (size - cur_size - 1) / segment_size_ + 1;
+  }
+  if (segment_count == 0) {
     done(Status::OK());
     return;
   }
-  int64_t segment_count = (size - size_ - 1) / segment_size_ + 1;
   StatusCollector* stc = new StatusCollector(segment_count, [this, done](Status st) {
     if (st.ok()) {
-      ptrs_ = all_ptr_vec_.back().ptr.get();
+      mutex_lock lock(structure_update_mu_);
+      ptrs_.store(all_ptr_vec_.back().ptr.get(), std::memory_order_release);
       size_ = tensors_.size() * segment_size_;
     }
     done(st);
@@ -73,7 +151,7 @@ void TensibleVariable::Resize(
               "Tensor Generator generate dtype error ",
               tensor.dtype(), " vs ", dtype_);
         }
-        tensors_.push_back(tensor);
+        tensors_.push_back(PlaceSegment(tensor, tensors_.size()));
         if (all_ptr_vec_.back().size < tensors_.size()) {
           all_ptr_vec_.emplace_back();
           auto&& old_spec = all_ptr_vec_[all_ptr_vec_.size() - 2];
@@ -84,7 +162,7 @@ void TensibleVariable::Resize(
               old_spec.size * sizeof(char*));
         }
         all_ptr_vec_.back().ptr[tensors_.size() - 1] =
-          const_cast<char*>(tensor.tensor_data().data());
+          const_cast<char*>(tensors_.back().tensor_data().data());
         return Status::OK();
       };
       stc->AddStatus(fn());
@@ -97,7 +175,17 @@ void TensibleVariable::ZeroCostResize(int64 size) {
   mutex_lock lock(structure_update_mu_);
   size_t segment_count = (size + segment_size_ - 1) / segment_size_;
   while (tensors_.size() < segment_count) {
-    tensors_.emplace_back(dtype_, shape_);
+    int node = SegmentNode(tensors_.size());
+    if (node >= 0) {
+      tensors_.emplace_back(NumaAllocator(node), dtype_, shape_);
+      // Pages are only placed once touched, so touch them before measuring.
+      char* data = const_cast<char*>(tensors_.back().tensor_data().data());
+      memset(data, 0, tensors_.back().TotalBytes());
+      numa_block_map_->SetMemNode((tensors_.size() - 1) * segment_size_,
+                                  port::NUMAGetMemAffinity(data));
+    } else {
+      tensors_.emplace_back(dtype_, shape_);
+    }
     if (all_ptr_vec_.back().size < tensors_.size()) {
       all_ptr_vec_.emplace_back();
       auto&& old_spec = all_ptr_vec_[all_ptr_vec_.size() - 2];
@@ -110,8 +198,42 @@ void TensibleVariable::ZeroCostResize(int64 size) {
     all_ptr_vec_.back().ptr[tensors_.size() - 1] =
       const_cast<char*>(tensors_.back().tensor_data().data());
   }
+  ptrs_.store(all_ptr_vec_.back().ptr.get(), std::memory_order_release);
   size_ = tensors_.size() * segment_size_;
-  ptrs_ = all_ptr_vec_.back().ptr.get();
+}
+
+int TensibleVariable::SegmentNode(int64 index) const {
+  if (numa_block_map_ == nullptr) {
+    return -1;
+  }
+  return numa_block_map_->NodeOf(index * segment_size_);
+}
+
+Tensor TensibleVariable::PlaceSegment(const Tensor& tensor, int64 index) {
+  int node = SegmentNode(index);
+  if (node < 0) {
+    return tensor;
+  }
+  int mem_node = port::NUMAGetMemAffinity(tensor.tensor_data().data());
+  if (mem_node == node) {
+    numa_block_map_->SetMemNode(index * segment_size_, mem_node);
+    return tensor;
+  }
+  Tensor placed(NumaAllocator(node), dtype_, shape_);
+  memcpy(const_cast<char*>(placed.tensor_data().data()),
+      tensor.tensor_data().data(), tensor.TotalBytes());
+  // The memory may still be elsewhere when the platform cannot bind it.
+  numa_block_map_->SetMemNode(
+      index * segment_size_,
+      port::NUMAGetMemAffinity(placed.tensor_data().data()));
+  return placed;
+}
+
+int TensibleVariable::NumaNode(int64 id) const {
+  if (id >= size_) {
+    return port::kNUMANoAffinity;
+  }
+  return port::NUMAGetMemAffinity(GetSlice(id));
 }
 
 void TensibleVariable::Pad(
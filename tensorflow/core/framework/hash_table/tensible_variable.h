@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_FRAMEWORK_HASH_TABLE_TENSIBLE_VARIABLE_H_
 #define TENSORFLOW_CORE_FRAMEWORK_HASH_TABLE_TENSIBLE_VARIABLE_H_
 
+#include <atomic>
 #include <vector>
 #include <deque>
 #include <memory>
@@ -26,6 +27,66 @@ limitations under the License.
 
 namespace tensorflow {
 
+// Owner NUMA node of every block of ids. Nodes claim blocks one at a time
+// from a single id space, so ids stay dense whatever the load of each node.
+class NumaBlockMap {
+ public:
+  NumaBlockMap(int num_nodes, int64 block)
+      : num_nodes_(num_nodes), block_(block) {}
+
+  int num_nodes() const { return num_nodes_; }
+  int64 block() const { return block_; }
+
+  void SetNode(int64 block_index, int node) {
+    mutex_lock lock(mu_);
+    if (static_cast<int64>(nodes_.size()) <= block_index) {
+      nodes_.resize(block_index + 1, -1);
+    }
+    nodes_[block_index] = node;
+  }
+
+  // Node owning the block of id, -1 if the block is not claimed yet.
+  int NodeOf(int64 id) const {
+    tf_shared_lock lock(mu_);
+    int64 block_index = id / block_;
+    return block_index < static_cast<int64>(nodes_.size())
+               ? nodes_[block_index]
+               : -1;
+  }
+
+  // Records the node the memory of the block of id was measured on.
+  void SetMemNode(int64 id, int node) {
+    mutex_lock lock(mu_);
+    int64 block_index = id / block_;
+    if (static_cast<int64>(mem_nodes_.size()) <= block_index) {
+      mem_nodes_.resize(block_index + 1, -1);
+    }
+    mem_nodes_[block_index] = node;
+  }
+
+  // Node the memory of the block of id is on, -1 if not measured.
+  int MemNodeOf(int64 id) const {
+    tf_shared_lock lock(mu_);
+    int64 block_index = id / block_;
+    return block_index < static_cast<int64>(mem_nodes_.size())
+               ? mem_nodes_[block_index]
+               : -1;
+  }
+
+  void Clear() {
+    mutex_lock lock(mu_);
+    nodes_.clear();
+    mem_nodes_.clear();
+  }
+
+ private:
+  const int num_nodes_;
+  const int64 block_;
+  mutable mutex mu_;
+  std::vector<int8> nodes_ GUARDED_BY(mu_);
+  std::vector<int8> mem_nodes_ GUARDED_BY(mu_);
+};
+
 class TensibleVariable : public core::RefCounted {
  public:
   TensibleVariable(
@@ -39,8 +100,13 @@ class TensibleVariable : public core::RefCounted {
   int64 SliceSize() const { return slice_size_; }
   template<typename T = void>
   T* GetSlice(int64_t id) const {
+    char** ptrs = ptrs_.load(std::memory_order_acquire);
+    if (segment_shift_ >= 0) {
+      return reinterpret_cast<T*>
+        (ptrs[id >> segment_shift_] + (id & segment_mask_) * slice_size_);
+    }
     return reinterpret_cast<T*>
-      (ptrs_[id / segment_size_] + (id % segment_size_) * slice_size_);
+      (ptrs[id / segment_size_] + (id % segment_size_) * slice_size_);
   }
 
   void LockUpdate() {
@@ -65,8 +131,26 @@ class TensibleVariable : public core::RefCounted {
   TensorGenerator* GetGenerator() const {
     return generator_;
   }
+
+  // Places segment memory on the NUMA node owning its ids in block_map, and
+  // records in block_map the node the memory ends up on. Only segments
+  // created afterwards are placed, segments of blocks not claimed yet are
+  // left where they are allocated.
+  void SetNumaPlacement(std::shared_ptr<NumaBlockMap> block_map) {
+    mutex_lock lock(structure_update_mu_);
+    numa_block_map_ = std::move(block_map);
+  }
+
+  // NUMA node of the memory holding id, kNUMANoAffinity if not placed.
+  int NumaNode(int64 id) const;
   
  private:
+  // NUMA node to place segment index on, -1 for no placement.
+  int SegmentNode(int64 index) const
+      EXCLUSIVE_LOCKS_REQUIRED(structure_update_mu_);
+  Tensor PlaceSegment(const Tensor& tensor, int64 index)
+      EXCLUSIVE_LOCKS_REQUIRED(structure_update_mu_);
+
   TensorGenerator* generator_;
   TensorShape shape_;
   DataType dtype_;
@@ -74,10 +158,14 @@ class TensibleVariable : public core::RefCounted {
 
   Eigen::array<Eigen::DenseIndex, 1> eigen_slice_shape_;
   int64 segment_size_;
+  // Set when segment_size_ is a power of two, -1 otherwise.
+  int segment_shift_;
+  int64 segment_mask_;
   int64 slice_size_;
   std::atomic<int64> size_;
 
   mutex structure_update_mu_;
+  std::shared_ptr<NumaBlockMap> numa_block_map_;
 
   std::vector<Tensor> tensors_;
 
@@ -87,7 +175,10 @@ class TensibleVariable : public core::RefCounted {
   };
   std::vector<PtrSpec> all_ptr_vec_;
 
-  char** ptrs_;
+  // Published segment pointer array. Arrays replaced by a grown one are kept
+  // in all_ptr_vec_ until destruction, so GetSlice never waits for Resize and
+  // a reader holding a stale array still sees valid segments below size_.
+  std::atomic<char**> ptrs_;
 
   mutex update_mu_;
 
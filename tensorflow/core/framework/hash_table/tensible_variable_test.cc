@@ -13,11 +13,13 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <memory>
 #include <utility>
 
 #include "tensorflow/core/framework/hash_table/tensible_variable.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/test.h"
 
 #include "gmock/gmock.h"
@@ -93,6 +95,94 @@ TEST(TensibleVariable, Simple) {
   tv->Unref();
 }
 
+TEST(TensibleVariable, PowerOfTwoSegment) {
+  int64 produced = 0;
+  TensorGenerator* generator = new TensorGenerator(
+  [&produced](TensorGenerator::Consumer consumer) {
+    Tensor t(DT_INT64, TensorShape({4, 2}));
+    auto f = t.flat<int64>();
+    for (int j = 0; j < 8; j++) {
+      f(j) = produced * 8 + j;
+    }
+    produced++;
+    consumer(Status::OK(), t);
+  });
+  Status rst_status;
+  auto consumer = [&](Status st) {
+    rst_status = st;
+  };
+  TensibleVariable* tv = new TensibleVariable(
+      generator, TensorShape({4, 2}), DT_INT64);
+  generator->Unref();
+
+  tv->Resize(10, consumer);
+  TF_EXPECT_OK(rst_status);
+  EXPECT_EQ(12, tv->Size());
+  for (int i = 0; i < 12; i++) {
+    EXPECT_EQ(i * 2 + 0, tv->GetSlice<int64>(i)[0]);
+    EXPECT_EQ(i * 2 + 1, tv->GetSlice<int64>(i)[1]);
+  }
+
+  tv->Unref();
+}
+
+TEST(NumaBlockMap, ClaimedBlocks) {
+  NumaBlockMap block_map(2, 4);
+  // node 1 claims the first block, node 0 the second one
+  block_map.SetNode(0, 1);
+  block_map.SetNode(1, 0);
+  EXPECT_EQ(1, block_map.NodeOf(0));
+  EXPECT_EQ(1, block_map.NodeOf(3));
+  EXPECT_EQ(0, block_map.NodeOf(4));
+  EXPECT_EQ(0, block_map.NodeOf(7));
+  EXPECT_EQ(-1, block_map.NodeOf(8));
+  block_map.SetMemNode(5, 0);
+  EXPECT_EQ(-1, block_map.MemNodeOf(0));
+  EXPECT_EQ(0, block_map.MemNodeOf(4));
+  block_map.Clear();
+  EXPECT_EQ(-1, block_map.NodeOf(0));
+  EXPECT_EQ(-1, block_map.MemNodeOf(4));
+}
+
+TEST(TensibleVariable, NumaPlacementKeepsValues) {
+  int produced = 0;
+  TensorGenerator* generator = new TensorGenerator(
+  [&](TensorGenerator::Consumer consumer) {
+    Tensor t(DT_INT64, TensorShape({4, 2}));
+    auto f = t.flat<int64>();
+    for (int j = 0; j < 8; j++) {
+      f(j) = produced * 8 + j;
+    }
+    produced++;
+    consumer(Status::OK(), t);
+  });
+  Status rst_status;
+  auto consumer = [&](Status st) {
+    rst_status = st;
+  };
+  TensibleVariable* tv = new TensibleVariable(
+      generator, TensorShape({4, 2}), DT_INT64);
+  generator->Unref();
+  auto block_map = std::make_shared<NumaBlockMap>(1, 4);
+  block_map->SetNode(0, 0);
+  block_map->SetNode(1, 0);
+  tv->SetNumaPlacement(block_map);
+
+  // the third segment has no owner yet and is left unplaced
+  tv->Resize(10, consumer);
+  TF_EXPECT_OK(rst_status);
+  EXPECT_EQ(12, tv->Size());
+  for (int i = 0; i < 12; i++) {
+    EXPECT_EQ(i * 2 + 0, tv->GetSlice<int64>(i)[0]);
+    EXPECT_EQ(i * 2 + 1, tv->GetSlice<int64>(i)[1]);
+  }
+  // the node of placed memory is measured rather than assumed
+  EXPECT_EQ(port::NUMAGetMemAffinity(tv->GetSlice(0)), block_map->MemNodeOf(0));
+  EXPECT_EQ(port::NUMAGetMemAffinity(tv->GetSlice(4)), block_map->MemNodeOf(4));
+
+  tv->Unref();
+}
+
 }  // namespace
 
 }  // namespace tensorflow
@@ -0,0 +1,493 @@
+/* Copyright 2023 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "tensorflow/cc/training/prefetch_runner.h"
+#include "tensorflow/core/common_runtime/optimization_registry.h"
+#include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/graph/graph_constructor.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/device_name_utils.h"
+
+namespace tensorflow {
+
+namespace {
+
+const char* const kAsyncEmbeddingName = "async_embedding_stage";
+
+// Three hours, same as the Python AsyncEmbeddingStage.
+const int kTimeoutMillis = 1000 * 60 * 60 * 3;
+
+bool IsVariableOp(const Node* n) {
+  static const std::unordered_set<std::string> ops = {
+      "Variable", "VariableV2", "VarHandleOp", "KvVarHandleOp", "HashTableV2"};
+  return ops.count(n->type_string()) != 0;
+}
+
+bool IsVariableInitializedOp(const Node* n) {
+  static const std::unordered_set<std::string> ops = {
+      "IsVariableInitialized", "VarIsInitializedOp", "KvVarIsInitializedOp"};
+  return ops.count(n->type_string()) != 0;
+}
+
+bool IsEmbeddingLookupOp(const Node* n) {
+  return n->type_string() == "KvResourceGather" ||
+         n->type_string() == "KvResourceGatherV1";
+}
+
+bool IsSaverOp(const Node* n) {
+  return n->type_string() == "SaveV2";
+}
+
+bool HasNoInput(const Node* n) {
+  for (const Edge* e : n->in_edges()) {
+    if (e->src()->IsOp())
+      return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+// Pipelines embedding lookups one step ahead of the dense compute, which is
+// the graph rewrite of the Python AsyncEmbeddingStage done at session
+// creation, so that it is available without Python and on large graphs.
+//
+// Nodes depending on variable initialization, control flow, or inputs not
+// used by the embedding lookups are active, i.e. they have to run in the
+// training step. All other nodes, which are the IO and the embedding lookup
+// subgraph, run in a PrefetchRunner and hand their results to the active
+// nodes through a TensorBuffer.
+class AsyncEmbeddingStagePass : public GraphOptimizationPass {
+ public:
+  Status Run(const GraphOptimizationPassOptions& options) override {
+    if (options.session_options == nullptr)
+      return Status::OK();
+
+    const auto& optimizer_options =
+        options.session_options->config.graph_options().optimizer_options();
+    if (optimizer_options.do_async_embedding() &&
+        optimizer_options.async_embedding_options().use_graph_pass())
+      LOG(INFO) << "Run AsyncEmbeddingStage Optimization";
+    else
+      return Status::OK();
+
+    Graph* graph = options.graph->get();
+    if (graph == nullptr)
+      return errors::Internal("a graph should be available.");
+    std::unique_ptr<Graph> new_graph(new Graph(OpRegistry::Global()));
+    CopyGraph(*graph, new_graph.get());
+
+    TF_RETURN_IF_ERROR(AsyncEmbeddingStageGraph(
+        new_graph, optimizer_options.async_embedding_options()));
+
+    options.graph->swap(new_graph);
+    return Status::OK();
+  }
+
+ private:
+  Status AsyncEmbeddingStageGraph(std::unique_ptr<Graph>& g,
+                                  const AsyncEmbeddingOptions& options) {
+    std::unordered_set<const Node*> boundary_nodes;
+    GetBoundaryNodes(g, options, boundary_nodes);
+    if (boundary_nodes.empty()) {
+      LOG(WARNING) << "AsyncEmbeddingStage: No embedding lookup found, "
+                      "AsyncEmbeddingStage is disabled.";
+      return Status::OK();
+    }
+
+    std::unordered_set<const Node*> start_nodes;
+    bool is_io_staged = false;
+    GetStartNodes(g, boundary_nodes, start_nodes, is_io_staged);
+    if (!is_io_staged) {
+      LOG(WARNING) << "AsyncEmbeddingStage: IO is not staged, "
+                      "AsyncEmbeddingStage is disabled. Enable SmartStage or "
+                      "use the 'tf.staged' interface";
+      return Status::OK();
+    }
+
+    std::unordered_set<const Node*> active_nodes;
+    MarkActiveNodes(start_nodes, active_nodes);
+
+    std::vector<const Edge*> stage_edges;
+    std::vector<const Edge*> control_edges;
+    GetStageEdges(g, active_nodes, stage_edges, control_edges);
+    if (stage_edges.empty()) {
+      LOG(WARNING) << "AsyncEmbeddingStage: Nothing to stage, "
+                      "AsyncEmbeddingStage is disabled.";
+      return Status::OK();
+    }
+
+    return AddStageNodeToGraph(g, stage_edges, control_edges, options);
+  }
+
+  // The embedding lookup outputs, i.e. the nodes listed in the options, or
+  // the consumers of every KvResourceGather when none is listed.
+  void GetBoundaryNodes(const std::unique_ptr<Graph>& g,
+                        const AsyncEmbeddingOptions& options,
+                        std::unordered_set<const Node*>& boundary_nodes) {
+    std::unordered_set<std::string> names(options.boundary_nodes().begin(),
+                                          options.boundary_nodes().end());
+    for (const Node* n : g->op_nodes()) {
+      if (!names.empty()) {
+        if (names.count(n->name()) != 0)
+          boundary_nodes.insert(n);
+        continue;
+      }
+      if (!IsEmbeddingLookupOp(n))
+        continue;
+      for (const Edge* e : n->out_edges()) {
+        if (!e->IsControlEdge() && e->dst()->IsOp())
+          boundary_nodes.insert(e->dst());
+      }
+    }
+  }
+
+  // Active nodes are reached from the outermost boundary nodes, and from the
+  // control flow nodes, the nodes without inputs and the variable
+  // initialization checks that the boundary nodes do not depend on.
+  void GetStartNodes(const std::unique_ptr<Graph>& g,
+                     const std::unordered_set<const Node*>& boundary_nodes,
+                     std::unordered_set<const Node*>& start_nodes,
+                     bool& is_io_staged) {
+    start_nodes = boundary_nodes;
+    is_io_staged = false;
+
+    std::unordered_set<const Node*> visited;
+    for (const Node* boundary_node : boundary_nodes) {
+      std::vector<const Node*> stack;
+      stack.push_back(boundary_node);
+      while (!stack.empty()) {
+        const Node* n = stack.back();
+        stack.pop_back();
+        if (n->IsUnstage())
+          is_io_staged = true;
+        // a boundary node feeding another one is not a start node
+        if (n != boundary_node && boundary_nodes.count(n) != 0)
+          start_nodes.erase(n);
+        if (!visited.insert(n).second)
+          continue;
+        for (const Edge* e : n->in_edges()) {
+          if (e->src()->IsOp())
+            stack.push_back(e->src());
+        }
+      }
+    }
+
+    for (const Node* n : g->op_nodes()) {
+      if ((n->IsControlFlow() || HasNoInput(n)) && visited.count(n) == 0)
+        start_nodes.insert(n);
+      else if (IsVariableInitializedOp(n))
+        start_nodes.insert(n);
+    }
+  }
+
+  void MarkActiveNodes(const std::unordered_set<const Node*>& start_nodes,
+                       std::unordered_set<const Node*>& active_nodes) {
+    std::queue<const Node*> queue;
+    for (const Node* n : start_nodes) {
+      queue.push(n);
+    }
+    while (!queue.empty()) {
+      const Node* n = queue.front();
+      queue.pop();
+      if (!active_nodes.insert(n).second)
+        continue;
+      for (const Edge* e : n->out_edges()) {
+        if (e->dst()->IsOp() && active_nodes.count(e->dst()) == 0)
+          queue.push(e->dst());
+      }
+    }
+  }
+
+  // Edges from inactive nodes to active nodes. Variables are read in the
+  // training step, and the saver reads the current values directly.
+  void GetStageEdges(const std::unique_ptr<Graph>& g,
+                     const std::unordered_set<const Node*>& active_nodes,
+                     std::vector<const Edge*>& stage_edges,
+                     std::vector<const Edge*>& control_edges) {
+    for (const Node* n : g->op_nodes()) {
+      if (active_nodes.count(n) == 0 || IsSaverOp(n))
+        continue;
+      for (const Edge* e : n->in_edges()) {
+        const Node* src = e->src();
+        if (!src->IsOp() || active_nodes.count(src) != 0)
+          continue;
+        if (e->IsControlEdge())
+          control_edges.push_back(e);
+        else if (!IsVariableOp(src))
+          stage_edges.push_back(e);
+      }
+    }
+  }
+
+  // The lookups run at most `capacity + threads_num` steps ahead, both are
+  // reduced to stay within the staleness bound.
+  void GetStageParams(const AsyncEmbeddingOptions& options, int& threads_num,
+                      int& capacity) {
+    threads_num = std::max(1, options.threads_num());
+    capacity = std::max(1, options.capacity());
+    if (options.staleness() <= 0)
+      return;
+    threads_num = std::max(1, std::min(threads_num, options.staleness() - 1));
+    capacity = std::max(1, std::min(capacity,
+                                     options.staleness() - threads_num));
+    if (threads_num + capacity > options.staleness())
+      LOG(WARNING) << "AsyncEmbeddingStage: Lookups may run "
+                   << threads_num + capacity << " steps ahead, staleness "
+                   << options.staleness() << " is too small.";
+  }
+
+  // Places a node on the CPU, keeping its job, replica and task.
+  void SetCpuDevice(Node* n) {
+    DeviceNameUtils::ParsedName parsed;
+    if (!DeviceNameUtils::ParseFullName(n->requested_device(), &parsed))
+      parsed = DeviceNameUtils::ParsedName();
+    parsed.has_type = true;
+    parsed.type = DEVICE_CPU;
+    parsed.has_id = true;
+    parsed.id = 0;
+    n->set_requested_device(DeviceNameUtils::ParsedNameToString(parsed));
+  }
+
+  // The IO and embedding lookup subgraph runs on the CPU.
+  void PlaceStageSubgraphOnCpu(Node* stage_node) {
+    std::unordered_set<Node*> visited;
+    std::vector<Node*> stack;
+    stack.push_back(stage_node);
+    while (!stack.empty()) {
+      Node* n = stack.back();
+      stack.pop_back();
+      if (!visited.insert(n).second)
+        continue;
+      SetCpuDevice(n);
+      for (const Edge* e : n->in_edges()) {
+        if (e->src()->IsOp())
+          stack.push_back(e->src());
+      }
+    }
+  }
+
+  Status AddNode(std::unique_ptr<Graph>& g, const NodeDef& node_def,
+                 Node*& node) {
+    Status s;
+    node = g->AddNode(node_def, &s);
+    return s;
+  }
+
+  Status AddStageNodeToGraph(std::unique_ptr<Graph>& g,
+                             const std::vector<const Edge*>& stage_edges,
+                             const std::vector<const Edge*>& control_edges,
+                             const AsyncEmbeddingOptions& options) {
+    int threads_num;
+    int capacity;
+    GetStageParams(options, threads_num, capacity);
+    LOG(INFO) << "AsyncEmbeddingStage: thread num: " << threads_num
+              << ", capacity: " << capacity;
+
+    int index = 0;
+    std::map<std::string, int> edge_map;
+    std::vector<DataType> type_vec;
+    std::vector<NodeDefBuilder::NodeOut> src_list;
+    std::vector<const Edge*> edge_to_stage;
+    std::vector<std::pair<const Edge*, int>> edge_to_unstage;
+    for (const Edge* e : stage_edges) {
+      std::string name = e->src()->name() + ":" +
+                         std::to_string(e->src_output());
+      if (edge_map.count(name) == 0) {
+        DataType dtype = BaseType(e->src()->output_type(e->src_output()));
+        type_vec.push_back(dtype);
+        src_list.emplace_back(e->src()->name(), e->src_output(), dtype);
+        edge_to_stage.push_back(e);
+        edge_map[name] = index++;
+      }
+      edge_to_unstage.emplace_back(e, edge_map[name]);
+    }
+
+    // Node names are unique in the graph, and the buffer is shared by name
+    // within the process, so it is made unique among all rewritten graphs.
+    const std::string prefix = g->NewName(kAsyncEmbeddingName);
+    static std::atomic<int64> buffer_count(0);
+    const std::string shared_name =
+        strings::StrCat(prefix, "_", buffer_count.fetch_add(1));
+    NodeDef stage_node_def;
+    TF_RETURN_IF_ERROR(NodeDefBuilder(prefix + "/TensorBufferPut",
+                                      "TensorBufferPut")
+                           .Input(src_list)
+                           .Attr("shared_capacity", capacity)
+                           .Attr("shared_name", shared_name)
+                           .Attr("timeout_millis", kTimeoutMillis)
+                           .Finalize(&stage_node_def));
+    Node* stage_node;
+    TF_RETURN_IF_ERROR(AddNode(g, stage_node_def, stage_node));
+
+    NodeDef unstage_node_def;
+    TF_RETURN_IF_ERROR(NodeDefBuilder(prefix + "/TensorBufferTake",
+                                      "TensorBufferTake")
+                           .Attr("dtypes", DataTypeSlice(type_vec))
+                           .Attr("shared_capacity", capacity)
+                           .Attr("shared_name", shared_name)
+                           .Attr("shared_threads", 1)
+                           .Finalize(&unstage_node_def));
+    Node* unstage_node;
+    TF_RETURN_IF_ERROR(AddNode(g, unstage_node_def, unstage_node));
+
+    for (int i = 0; i < edge_to_stage.size(); ++i) {
+      const Edge* e = edge_to_stage[i];
+      g->AddEdge(e->src(), e->src_output(), stage_node, i);
+    }
+    for (const auto& it : edge_to_unstage) {
+      const Edge* e = it.first;
+      TF_RETURN_IF_ERROR(
+          g->UpdateEdge(unstage_node, it.second, e->dst(), e->dst_input()));
+    }
+
+    // Control dependencies on the staged nodes become dependencies on the
+    // TensorBufferTake, and the staged nodes run before the TensorBufferPut.
+    std::unordered_set<Node*> control_srcs;
+    std::unordered_set<Node*> control_dsts;
+    for (const Edge* e : control_edges) {
+      control_srcs.insert(e->src());
+      control_dsts.insert(e->dst());
+      g->RemoveEdge(e);
+    }
+    for (Node* n : control_srcs) {
+      g->AddControlEdge(n, stage_node);
+    }
+    for (Node* n : control_dsts) {
+      g->AddControlEdge(unstage_node, n);
+    }
+
+    std::string cancel_node_name;
+    std::string resume_node_name;
+    std::string close_node_name;
+    TF_RETURN_IF_ERROR(GenerateStageControlNodes(
+        g, prefix, shared_name, capacity, cancel_node_name, resume_node_name,
+        close_node_name));
+
+    PlaceStageSubgraphOnCpu(stage_node);
+    SetCpuDevice(unstage_node);
+
+    CreatePrefetchRunner(options, prefix, threads_num, stage_node->name(),
+                         cancel_node_name, resume_node_name, close_node_name);
+
+    LOG(INFO) << "AsyncEmbeddingStage: Staged " << src_list.size()
+              << " tensors consumed by " << edge_to_unstage.size()
+              << " edges.";
+
+    return CheckGraphCircle(stage_node, unstage_node);
+  }
+
+  Status GenerateStageControlNodes(std::unique_ptr<Graph>& g,
+                                   const std::string& prefix,
+                                   const std::string& shared_name,
+                                   int capacity,
+                                   std::string& cancel_node_name,
+                                   std::string& resume_node_name,
+                                   std::string& close_node_name) {
+    Node* node;
+
+    NodeDef cancel_node_def;
+    cancel_node_name = prefix + "/TensorBufferCancel";
+    TF_RETURN_IF_ERROR(NodeDefBuilder(cancel_node_name, "TensorBufferCancel")
+                           .Attr("shared_name", shared_name)
+                           .Attr("shared_capacity", capacity)
+                           .Finalize(&cancel_node_def));
+    TF_RETURN_IF_ERROR(AddNode(g, cancel_node_def, node));
+    SetCpuDevice(node);
+
+    NodeDef resume_node_def;
+    resume_node_name = prefix + "/TensorBufferResume";
+    TF_RETURN_IF_ERROR(NodeDefBuilder(resume_node_name, "TensorBufferCancel")
+                           .Attr("is_cancelled", false)
+                           .Attr("shared_name", shared_name)
+                           .Attr("shared_capacity", capacity)
+                           .Finalize(&resume_node_def));
+    TF_RETURN_IF_ERROR(AddNode(g, resume_node_def, node));
+    SetCpuDevice(node);
+
+    NodeDef close_node_def;
+    close_node_name = prefix + "/TensorBufferClose";
+    TF_RETURN_IF_ERROR(NodeDefBuilder(close_node_name, "TensorBufferClose")
+                           .Attr("shared_name", shared_name)
+                           .Attr("shared_capacity", capacity)
+                           .Finalize(&close_node_def));
+    TF_RETURN_IF_ERROR(AddNode(g, close_node_def, node));
+    SetCpuDevice(node);
+
+    return Status::OK();
+  }
+
+  void CreatePrefetchRunner(const AsyncEmbeddingOptions& options,
+                            const std::string& prefix, int threads_num,
+                            const std::string& fetch_op,
+                            const std::string& cancel_op,
+                            const std::string& resume_op,
+                            const std::string& close_op) {
+    PrefetchRunnerOptions runner_options;
+    for (int i = 0; i < threads_num; i++)
+      runner_options.add_fetch_ops(fetch_op);
+    runner_options.set_cancel_op(cancel_op);
+    runner_options.set_resume_op(resume_op);
+    runner_options.set_close_op(close_op);
+    runner_options.add_closed_exceptions(error::OUT_OF_RANGE);
+    runner_options.mutable_run_options()->set_use_stage_subgraph_thread_pool(
+        options.use_stage_subgraph_thread_pool());
+    runner_options.mutable_run_options()->set_stage_subgraph_thread_pool_id(
+        options.stage_subgraph_thread_pool_id());
+
+    auto prefetch_runner_mgr = PrefetchRunnerMgr::singleton();
+    prefetch_runner_mgr->RegisterPrefetchRunner(
+        options.graph_key(), prefix + "_prefetch_runner",
+        runner_options);
+  }
+
+  Status CheckGraphCircle(Node* stage_node, Node* unstage_node) {
+    std::unordered_set<const Node*> accessed;
+    std::queue<const Node*> queue;
+    queue.push(unstage_node);
+
+    while (!queue.empty()) {
+      const Node* node = queue.front();
+      queue.pop();
+
+      if (accessed.count(node) != 0)
+        continue;
+
+      accessed.insert(node);
+
+      if (node == stage_node)
+        return errors::Internal(
+            "there is a cycle in the graph after async embedding stage.");
+
+      for (const Edge* e : node->out_edges())
+        queue.push(e->dst());
+    }
+    return Status::OK();
+  }
+};
+
+// After SmartStage, which may provide the staged IO this pass requires.
+REGISTER_OPTIMIZATION(OptimizationPassRegistry::PRE_PLACEMENT, 26,
+                      AsyncEmbeddingStagePass);
+
+} // end of namespace tensorflow
@@ -193,6 +193,7 @@ class Node {
            type_string() == "KvResourceSparseApplyAdagradDecay" ||
            type_string() == "KvResourceSparseApplyAdam" ||
            type_string() == "KvResourceSparseApplyAdamAsync" ||
+           type_string() == "KvResourceSparseApplyLazyAdam" ||
            type_string() == "KvResourceSparseApplyFtrl" ||
            type_string() == "KvResourceSparseApplyFtrlV2" ||
            type_string() == "KvResourceSparseApplyGradientDescent" ||
@@ -201,6 +202,7 @@ class Node {
            type_string() == "KvResourceSparseApplyAdagradDecayWithCounts" ||
            type_string() == "KvResourceSparseApplyAdamWithCounts" ||
            type_string() == "KvResourceSparseApplyAdamAsyncWithCounts" ||
+           type_string() == "KvResourceSparseApplyLazyAdamWithCounts" ||
            type_string() == "KvResourceSparseApplyFtrlWithCounts" ||
            type_string() == "KvResourceSparseApplyFtrlV2WithCounts" ||
            type_string() == "KvResourceSparseApplyGradientDescentWithCounts" ||
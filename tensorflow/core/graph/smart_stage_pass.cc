@@ -13,6 +13,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <queue>
@@ -21,7 +22,11 @@ limitations under the License.
 #include "tensorflow/cc/training/prefetch_runner.h"
 #include "tensorflow/core/common_runtime/optimization_registry.h"
 #include "tensorflow/core/framework/node_def_builder.h"
+#include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/graph_constructor.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow/core/public/session_options.h"
 #include "tensorflow/core/util/env_var.h"
 
@@ -184,9 +189,12 @@ class SmartStagePass : public GraphOptimizationPass {
     MarkComputeGraph(g, compute_graph_nodes);
 
     std::vector<const Edge*> stage_edges;
-    GetStageEdges(g, start_nodes, compute_graph_nodes, stage_edges);
+    std::unordered_set<const Node*> stage_graph_nodes;
+    GetStageEdges(g, start_nodes, compute_graph_nodes, stage_edges,
+                  stage_graph_nodes);
+    Node* new_unstage_node;
     Status s = AddStageNodeToGraph(g, stage_node, unstage_node, stage_edges,
-                                   SmartStageOptions());
+                                   SmartStageOptions(), new_unstage_node);
     return s;
   }
 
@@ -201,12 +209,189 @@ class SmartStagePass : public GraphOptimizationPass {
     MarkComputeGraph(g, compute_graph_nodes);
 
     std::vector<const Edge*> stage_edges;
-    GetStageEdges(g, start_nodes, compute_graph_nodes, stage_edges);
+    std::unordered_set<const Node*> stage_graph_nodes;
+    GetStageEdges(g, start_nodes, compute_graph_nodes, stage_edges,
+                  stage_graph_nodes);
+
+    if (options.num_stages() > 1) {
+      return MultiStageGraph(g, stage_graph_nodes, compute_graph_nodes,
+                             options);
+    }
 
-    Status s = AddStageNodeToGraph(g, nullptr, nullptr, stage_edges, options);
+    Node* new_unstage_node;
+    Status s = AddStageNodeToGraph(g, nullptr, nullptr, stage_edges, options,
+                                   new_unstage_node);
     return s;
   }
 
+  // Loads per-node compute costs in microseconds from a RunMetadata collected
+  // during warm-up steps. The cost graph built by the CostModelManager
+  // (`build_cost_model`) is preferred, otherwise the step stats of a traced
+  // run are averaged per node.
+  Status LoadNodeCosts(const std::string& path,
+                       std::unordered_map<std::string, int64>& node_costs) {
+    RunMetadata run_metadata;
+    TF_RETURN_IF_ERROR(ReadBinaryProto(Env::Default(), path, &run_metadata));
+    for (const auto& node : run_metadata.cost_graph().node()) {
+      node_costs[node.name()] += node.compute_cost();
+    }
+    if (!node_costs.empty())
+      return Status::OK();
+
+    std::unordered_map<std::string, int64> counts;
+    for (const auto& dev_stats : run_metadata.step_stats().dev_stats()) {
+      for (const auto& node_stats : dev_stats.node_stats()) {
+        node_costs[node_stats.node_name()] +=
+            node_stats.op_end_rel_micros() - node_stats.op_start_rel_micros();
+        counts[node_stats.node_name()]++;
+      }
+    }
+    for (auto& it : node_costs) {
+      it.second /= counts[it.first];
+    }
+    if (node_costs.empty())
+      return errors::InvalidArgument("no cost graph or step stats in ", path);
+    return Status::OK();
+  }
+
+  // Assigns every node of the stage subgraph to one of
+  // `options.num_stages()` pipeline stages, cutting the critical path of the
+  // subgraph into pieces of equal cost. Empty stages are dropped, so the
+  // number of stages actually used is returned.
+  int AssignStages(const std::unique_ptr<Graph>& g,
+                   const std::unordered_set<const Node*>& stage_graph_nodes,
+                   const std::unordered_map<std::string, int64>& node_costs,
+                   int num_stages,
+                   std::unordered_map<const Node*, int>& node_stage,
+                   std::vector<int64>& stage_costs) {
+    std::vector<Node*> order;
+    GetReversePostOrder(*g, &order);
+
+    std::unordered_map<const Node*, int64> cost;
+    std::unordered_map<const Node*, int64> finish;
+    int64 total = 0;
+    for (const Node* n : order) {
+      if (stage_graph_nodes.count(n) == 0)
+        continue;
+      int64 c = 1;
+      if (!node_costs.empty()) {
+        auto it = node_costs.find(n->name());
+        c = it == node_costs.end() ? 0 : std::max(it->second, int64{0});
+      }
+      int64 start = 0;
+      for (const Edge* e : n->in_edges()) {
+        if (finish.count(e->src()) != 0)
+          start = std::max(start, finish[e->src()]);
+      }
+      cost[n] = c;
+      finish[n] = start + c;
+      total = std::max(total, finish[n]);
+    }
+
+    // A node belongs to the stage holding the midpoint of its execution, which
+    // never puts a consumer in an earlier stage than its producer.
+    std::map<int, int> used_stages;
+    for (const auto& it : finish) {
+      int stage = 0;
+      if (total > 0) {
+        int64 mid = 2 * it.second - cost[it.first];
+        stage = std::min<int64>(num_stages - 1, mid * num_stages / (2 * total));
+      }
+      node_stage[it.first] = stage;
+      used_stages[stage] = 0;
+    }
+    int index = 0;
+    for (auto& it : used_stages) {
+      it.second = index++;
+    }
+    stage_costs.assign(used_stages.size(), 0);
+    for (auto& it : node_stage) {
+      it.second = used_stages[it.second];
+      stage_costs[it.second] += cost[it.first];
+    }
+    return used_stages.size();
+  }
+
+  // Splits the stage subgraph into a pipeline of stages, e.g. IO, feature
+  // preprocessing and the rest of the input pipeline. Every stage boundary
+  // is a TensorBuffer with its own capacity, filled by its own
+  // PrefetchRunner from the buffer of the previous stage, so that the stages
+  // run overlapped with each other and with the compute graph.
+  Status MultiStageGraph(
+      std::unique_ptr<Graph>& g,
+      const std::unordered_set<const Node*>& stage_graph_nodes,
+      const std::unordered_set<const Node*>& compute_graph_nodes,
+      const SmartStageOptions& options) {
+    std::unordered_map<std::string, int64> node_costs;
+    if (!options.cost_profile().empty()) {
+      Status s = LoadNodeCosts(options.cost_profile(), node_costs);
+      if (!s.ok()) {
+        LOG(WARNING) << "SmartStage: Failed to load cost profile, all nodes "
+                        "are assumed to cost the same: " << s;
+        node_costs.clear();
+      }
+    }
+
+    std::unordered_map<const Node*, int> node_stage;
+    std::vector<int64> stage_costs;
+    int num_stages = AssignStages(g, stage_graph_nodes, node_costs,
+                                  options.num_stages(), node_stage,
+                                  stage_costs);
+
+    std::string name_prefix = "prefetch";
+    if (!options.name().empty())
+      name_prefix = options.name();
+
+    // Boundary b feeds stage b from the stages before it, the last boundary
+    // feeds the compute graph.
+    for (int b = 1; b <= num_stages; ++b) {
+      std::vector<const Edge*> stage_edges;
+      for (Node* n : g->op_nodes()) {
+        auto src = node_stage.find(n);
+        if (src == node_stage.end() || src->second >= b)
+          continue;
+        for (const Edge* e : n->out_edges()) {
+          auto dst = node_stage.find(e->dst());
+          if (compute_graph_nodes.count(e->dst()) != 0 ||
+              (dst != node_stage.end() && dst->second >= b))
+            stage_edges.push_back(e);
+        }
+      }
+
+      SmartStageOptions stage_options = options;
+      if (b < num_stages)
+        stage_options.set_name(strings::StrCat(name_prefix, "/stage_", b));
+      if (b <= options.stage_capacities_size() &&
+          options.stage_capacities(b - 1) > 0)
+        stage_options.set_capacity(options.stage_capacities(b - 1));
+
+      Node* new_unstage_node;
+      TF_RETURN_IF_ERROR(AddStageNodeToGraph(g, nullptr, nullptr, stage_edges,
+                                             stage_options, new_unstage_node));
+      node_stage[new_unstage_node] = b;
+
+      LOG(INFO) << "SmartStage: Cut point " << b << " `"
+                << new_unstage_node->name() << "` buffers "
+                << new_unstage_node->num_outputs() << " tensors with capacity "
+                << stage_options.capacity() << ", stage " << b - 1
+                << " costs " << stage_costs[b - 1]
+                << (node_costs.empty() ? " nodes" : " us");
+    }
+
+    int64 serial = 0;
+    int64 pipelined = 0;
+    for (int64 c : stage_costs) {
+      serial += c;
+      pipelined = std::max(pipelined, c);
+    }
+    LOG(INFO) << "SmartStage: Split the stage subgraph into " << num_stages
+              << " stages" << (node_costs.empty() ? "" : " by measured costs")
+              << ", overlap "
+              << (serial > 0 ? 1.0 - static_cast<double>(pipelined) / serial
+                             : 0.0);
+    return Status::OK();
+  }
+
   void MarkComputeGraph(const std::unique_ptr<Graph>& g,
                         std::unordered_set<const Node*>& compute_graph_nodes) {
     // get target nodes.
@@ -239,13 +424,13 @@ class SmartStagePass : public GraphOptimizationPass {
   void GetStageEdges(const std::unique_ptr<Graph>& g,
                      const std::unordered_set<const Node*>& start_nodes,
                      const std::unordered_set<const Node*>& compute_graph_nodes,
-                     std::vector<const Edge*>& stage_edges) {
+                     std::vector<const Edge*>& stage_edges,
+                     std::unordered_set<const Node*>& has_visit_node) {
     std::queue<const Node*> queue;
     for (const Node* n : start_nodes) {
       queue.push(n);
     }
 
-    std::unordered_set<const Node*> has_visit_node;
     while (!queue.empty()) {
       const Node* n = queue.front();
       queue.pop();
@@ -420,7 +605,8 @@ class SmartStagePass : public GraphOptimizationPass {
                              Node* stage_node,
                              Node* unstage_node,
                              std::vector<const Edge*>& stage_edges,
-                             const SmartStageOptions& options) {
+                             const SmartStageOptions& options,
+                             Node*& new_unstage_node) {
     int index = 0;
     std::map<std::string, int64> edge_map;
     std::vector<DataType> type_vec;
@@ -451,7 +637,6 @@ class SmartStagePass : public GraphOptimizationPass {
     TF_RETURN_IF_ERROR(GenerateStageNode(g, stage_node, src_list, options,
                                          new_stage_node, stage_node_name));
 
-    Node* new_unstage_node;
     std::string unstage_node_name;
     TF_RETURN_IF_ERROR(GenerateUnStageNode(g, unstage_node, type_vec, options,
                                            new_unstage_node,
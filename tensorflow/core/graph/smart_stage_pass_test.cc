@@ -0,0 +1,213 @@
+/* Copyright 2023 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/optimization_registry.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+class SmartStagePassTest : public ::testing::Test {
+ protected:
+  // Builds `IteratorGetNext -> a -> b -> c -> loss`, where `loss` also reads
+  // the placeholder `w` and thus belongs to the compute graph, while
+  // `get_next`, `a`, `b` and `c` form the stage subgraph.
+  void SetUp() override {
+    graph_.reset(new Graph(OpRegistry::Global()));
+    Graph* g = graph_.get();
+    const DataTypeVector types = {DT_FLOAT};
+    const std::vector<PartialTensorShape> shapes = {PartialTensorShape({})};
+
+    Node* iterator;
+    TF_ASSERT_OK(NodeBuilder("iterator", "IteratorV2")
+                     .Attr("shared_name", "iterator")
+                     .Attr("container", "")
+                     .Attr("output_types", types)
+                     .Attr("output_shapes", shapes)
+                     .Finalize(g, &iterator));
+    Node* get_next;
+    TF_ASSERT_OK(NodeBuilder("get_next", "IteratorGetNext")
+                     .Input(iterator)
+                     .Attr("output_types", types)
+                     .Attr("output_shapes", shapes)
+                     .Finalize(g, &get_next));
+    Node* prev = get_next;
+    for (const string& name : {"a", "b", "c"}) {
+      TF_ASSERT_OK(NodeBuilder(name, "Square")
+                       .Input(prev)
+                       .Attr("T", DT_FLOAT)
+                       .Finalize(g, &prev));
+    }
+    Node* w;
+    TF_ASSERT_OK(NodeBuilder("w", "Placeholder")
+                     .Attr("dtype", DT_FLOAT)
+                     .Finalize(g, &w));
+    Node* loss;
+    TF_ASSERT_OK(NodeBuilder("loss", "Mul")
+                     .Input(prev)
+                     .Input(w)
+                     .Attr("T", DT_FLOAT)
+                     .Finalize(g, &loss));
+  }
+
+  SmartStageOptions* MutableSmartStageOptions() {
+    auto* optimizer_options = session_options_.config.mutable_graph_options()
+                                  ->mutable_optimizer_options();
+    optimizer_options->set_do_smart_stage(true);
+    auto* smart_stage_options =
+        optimizer_options->mutable_smart_stage_options();
+    smart_stage_options->set_capacity(5);
+    smart_stage_options->set_num_threads(1);
+    smart_stage_options->set_timeout_millis(1000);
+    smart_stage_options->set_graph_key(
+        ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    return smart_stage_options;
+  }
+
+  Status Rewrite() {
+    GraphOptimizationPassOptions options;
+    options.session_options = &session_options_;
+    options.graph = &graph_;
+    return OptimizationPassRegistry::Global()->RunGrouping(
+        OptimizationPassRegistry::PRE_PLACEMENT, options);
+  }
+
+  Node* FindNode(const string& name) {
+    for (Node* n : graph_->op_nodes()) {
+      if (n->name() == name) return n;
+    }
+    return nullptr;
+  }
+
+  // Returns the name of the node feeding input `index` of node `name`.
+  string InputName(const string& name, int index) {
+    Node* n = FindNode(name);
+    if (n == nullptr) return "";
+    const Node* in;
+    if (!n->input_node(index, &in).ok()) return "";
+    return in->name();
+  }
+
+  int64 Capacity(const string& name) {
+    Node* n = FindNode(name);
+    if (n == nullptr) return -1;
+    return n->def().attr().at("shared_capacity").i();
+  }
+
+  SessionOptions session_options_;
+  std::unique_ptr<Graph> graph_;
+};
+
+TEST_F(SmartStagePassTest, UniformCostCut) {
+  MutableSmartStageOptions()->set_num_stages(2);
+  TF_ASSERT_OK(Rewrite());
+
+  // Without a cost profile every node costs the same, so the critical path
+  // `get_next, a, b, c` is cut in the middle.
+  EXPECT_EQ("a", InputName("prefetch/stage_1/TensorBufferPut", 0));
+  EXPECT_EQ("prefetch/stage_1/TensorBufferTake", InputName("b", 0));
+  EXPECT_EQ("c", InputName("prefetch/TensorBufferPut", 0));
+  EXPECT_EQ("prefetch/TensorBufferTake", InputName("loss", 0));
+  EXPECT_EQ("w", InputName("loss", 1));
+}
+
+TEST_F(SmartStagePassTest, CostProfileCut) {
+  RunMetadata run_metadata;
+  for (const auto& it : std::vector<std::pair<string, int64>>{
+           {"get_next", 1}, {"a", 1}, {"b", 1}, {"c", 97}}) {
+    auto* node = run_metadata.mutable_cost_graph()->add_node();
+    node->set_name(it.first);
+    node->set_compute_cost(it.second);
+  }
+  const string path = io::JoinPath(testing::TmpDir(), "cost_profile.pb");
+  TF_ASSERT_OK(WriteBinaryProto(Env::Default(), path, run_metadata));
+
+  SmartStageOptions* options = MutableSmartStageOptions();
+  options->set_num_stages(2);
+  options->set_cost_profile(path);
+  TF_ASSERT_OK(Rewrite());
+
+  // `c` dominates the measured cost and gets a stage of its own.
+  EXPECT_EQ("b", InputName("prefetch/stage_1/TensorBufferPut", 0));
+  EXPECT_EQ("prefetch/stage_1/TensorBufferTake", InputName("c", 0));
+  EXPECT_EQ("c", InputName("prefetch/TensorBufferPut", 0));
+  EXPECT_EQ("prefetch/TensorBufferTake", InputName("loss", 0));
+}
+
+TEST_F(SmartStagePassTest, BufferChain) {
+  SmartStageOptions* options = MutableSmartStageOptions();
+  options->set_num_stages(3);
+  options->add_stage_capacities(2);
+  options->add_stage_capacities(3);
+  options->add_stage_capacities(4);
+  TF_ASSERT_OK(Rewrite());
+
+  // Each stage reads the buffer filled by the stage before it, and the last
+  // buffer feeds the compute graph.
+  EXPECT_EQ("get_next", InputName("prefetch/stage_1/TensorBufferPut", 0));
+  EXPECT_EQ("prefetch/stage_1/TensorBufferTake", InputName("a", 0));
+  EXPECT_EQ("a", InputName("b", 0));
+  EXPECT_EQ("b", InputName("prefetch/stage_2/TensorBufferPut", 0));
+  EXPECT_EQ("prefetch/stage_2/TensorBufferTake", InputName("c", 0));
+  EXPECT_EQ("c", InputName("prefetch/TensorBufferPut", 0));
+  EXPECT_EQ("prefetch/TensorBufferTake", InputName("loss", 0));
+
+  EXPECT_EQ(2, Capacity("prefetch/stage_1/TensorBufferTake"));
+  EXPECT_EQ(3, Capacity("prefetch/stage_2/TensorBufferTake"));
+  EXPECT_EQ(4, Capacity("prefetch/TensorBufferTake"));
+  EXPECT_EQ(4, Capacity("prefetch/TensorBufferPut"));
+}
+
+TEST_F(SmartStagePassTest, FewerStageCapacities) {
+  SmartStageOptions* options = MutableSmartStageOptions();
+  options->set_num_stages(2);
+  options->add_stage_capacities(3);
+  TF_ASSERT_OK(Rewrite());
+
+  // Boundaries without a capacity of their own fall back to `capacity`.
+  EXPECT_EQ(3, Capacity("prefetch/stage_1/TensorBufferTake"));
+  EXPECT_EQ(5, Capacity("prefetch/TensorBufferTake"));
+}
+
+TEST_F(SmartStagePassTest, MoreStageCapacities) {
+  SmartStageOptions* options = MutableSmartStageOptions();
+  options->set_num_stages(2);
+  options->add_stage_capacities(3);
+  options->add_stage_capacities(0);
+  options->add_stage_capacities(8);
+  TF_ASSERT_OK(Rewrite());
+
+  // A non-positive capacity falls back to `capacity` and capacities beyond
+  // the last boundary are ignored.
+  EXPECT_EQ(3, Capacity("prefetch/stage_1/TensorBufferTake"));
+  EXPECT_EQ(5, Capacity("prefetch/TensorBufferTake"));
+  EXPECT_EQ(nullptr, FindNode("prefetch/stage_2/TensorBufferTake"));
+}
+
+}  // namespace
+}  // namespace tensorflow
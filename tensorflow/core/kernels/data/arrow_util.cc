@@ -23,6 +23,7 @@ limitations under the License.
 #include <unistd.h>
 
 #include "arrow/array.h"
+#include "arrow/buffer.h"
 #include "arrow/util/thread_pool.h"
 #include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/kernels/data/eigen.h"
@@ -96,6 +97,9 @@ int SetArrowCpuThreadPoolCapacityFromEnv() {
 }
 
 #if DEEPREC_ARROW_ZEROCOPY
+// Shares a (sliced) Arrow buffer with tensors. The Arrow buffer, and the
+// parent buffer it was sliced from, are released when the last tensor
+// referencing it is destroyed.
 class ArrowPrimitiveTensorBuffer : public TensorBuffer {
  public:
   ArrowPrimitiveTensorBuffer() = delete;
@@ -121,32 +125,44 @@ class ArrowPrimitiveTensorBuffer : public TensorBuffer {
 };
 #endif
 
+// Makes a 1-D tensor from `length` elements of `arrow_buffer` starting at
+// element `offset`, which are the array offset and length of arrays sliced
+// by Arrow. The buffer is shared with the tensor if possible.
 ::arrow::Status MakeTensorFromArrowBuffer(
     DataType dtype, const std::shared_ptr<::arrow::Buffer>& arrow_buffer,
-    Tensor* tensor) {
-  const TensorShape shape = {arrow_buffer->size() / DataTypeSize(dtype)};
+    const int64 offset, const int64 length, Tensor* tensor) {
+  const TensorShape shape = {length};
+  if (TF_PREDICT_FALSE(length == 0)) {
+    *tensor = Tensor(dtype, shape);
+    return ::arrow::Status::OK();
+  }
+
+  const int64 type_size = DataTypeSize(dtype);
+  if (TF_PREDICT_FALSE(!arrow_buffer ||
+                       arrow_buffer->size() < (offset + length) * type_size)) {
+    return ::arrow::Status::Invalid("Arrow buffer is smaller than array");
+  }
+  const uint8_t* data = arrow_buffer->data() + offset * type_size;
 
 #if DEEPREC_ARROW_ZEROCOPY
   // NOTE: Alignment is 64 in Arrow 4.x, same to EIGEN_MAX_ALIGN_BYTES. See:
   // https://github.com/apache/arrow/blob/apache-arrow-4.0.1/cpp/src/arrow/memory_pool.cc#L97
-  if (TF_PREDICT_FALSE(!CHECK_EIGEN_ALIGN(arrow_buffer->data()))) {
-    *tensor = Tensor(dtype, shape);
-    std::memcpy(const_cast<char*>(tensor->tensor_data().data()),
-                arrow_buffer->data(), arrow_buffer->size());
+  // Slices starting in the middle of a buffer might be unaligned, and are
+  // copied below.
+  if (TF_PREDICT_TRUE(CHECK_EIGEN_ALIGN(data))) {
+    ArrowPrimitiveTensorBuffer* tensor_buffer =
+        new ArrowPrimitiveTensorBuffer(::arrow::SliceBuffer(
+            arrow_buffer, offset * type_size, length * type_size));
+    core::ScopedUnref unref(tensor_buffer);
+    *tensor = Tensor(dtype, shape, tensor_buffer);
     return ::arrow::Status::OK();
   }
+#endif
 
-  ArrowPrimitiveTensorBuffer* tensor_buffer =
-      new ArrowPrimitiveTensorBuffer(arrow_buffer);
-  core::ScopedUnref unref(tensor_buffer);
-  *tensor = Tensor(dtype, shape, tensor_buffer);
-  return ::arrow::Status::OK();
-#else
   *tensor = Tensor(dtype, shape);
-  std::memcpy(const_cast<char*>(tensor->tensor_data().data()),
-              arrow_buffer->data(), arrow_buffer->size());
+  std::memcpy(const_cast<char*>(tensor->tensor_data().data()), data,
+              length * type_size);
   return ::arrow::Status::OK();
-#endif
 }
 
 ::arrow::Status MakeStringTensorFromArrowArray(
@@ -170,19 +186,23 @@ class ArrowPrimitiveTensorBuffer : public TensorBuffer {
 }
 
 // Primitive Arrow arrays have validity and value buffers.
-#define RAGGED_TENSOR_BUILDER_PRIMITIVE_VISIT(ARRAY_CLASS)                    \
-  ::arrow::Status Visit(const ARRAY_CLASS& array) override {                  \
-    if (TF_PREDICT_FALSE(ragged_rank_ != 0)) {                                \
-      return ::arrow::Status::Invalid("Inconsistent ragged rank");            \
-    }                                                                         \
-    Tensor tensor;                                                            \
-    auto st =                                                                 \
-        MakeTensorFromArrowBuffer(dtype_, array.data()->buffers[1], &tensor); \
-    if (!st.ok()) {                                                           \
-      return st;                                                              \
-    }                                                                         \
-    ragged_tensor_.push_front(std::move(tensor));                             \
-    return ::arrow::Status::OK();                                             \
+#define RAGGED_TENSOR_BUILDER_PRIMITIVE_VISIT(ARRAY_CLASS)                \
+  ::arrow::Status Visit(const ARRAY_CLASS& array) override {              \
+    if (TF_PREDICT_FALSE(ragged_rank_ != 0)) {                            \
+      return ::arrow::Status::Invalid("Inconsistent ragged rank");        \
+    }                                                                     \
+    if (TF_PREDICT_FALSE(array.null_count() != 0)) {                      \
+      return ::arrow::Status::Invalid("Null elements not supported");     \
+    }                                                                     \
+    Tensor tensor;                                                        \
+    auto st = MakeTensorFromArrowBuffer(dtype_, array.values(),           \
+                                        array.offset(), array.length(),   \
+                                        &tensor);                         \
+    if (!st.ok()) {                                                       \
+      return st;                                                          \
+    }                                                                     \
+    ragged_tensor_.push_front(std::move(tensor));                         \
+    return ::arrow::Status::OK();                                         \
   }
 
 #define RAGGED_TENSOR_BUILDER_STRING_VISIT(ARRAY_CLASS)            \
@@ -215,16 +235,36 @@ class RaggedTensorBuilder : public ::arrow::ArrayVisitor {
     return ::arrow::Status::OK();
   }
 
+  // List Arrow arrays have validity and offsets buffers, and a child array
+  // for values. Offsets are used as row splits directly if they start from
+  // zero, otherwise (e.g. sliced arrays) they are rebased.
   ::arrow::Status Visit(const ::arrow::ListArray& array) override {
     --ragged_rank_;
+    const int64 num_rows = array.length();
+    const int32 first_offset = num_rows > 0 ? array.value_offset(0) : 0;
+    const int32 last_offset = num_rows > 0 ? array.value_offset(num_rows) : 0;
     Tensor tensor;
-    auto st =
-        MakeTensorFromArrowBuffer(DT_INT32, array.value_offsets(), &tensor);
-    if (!st.ok()) {
-      return st;
+    if (first_offset == 0) {
+      auto st = MakeTensorFromArrowBuffer(DT_INT32, array.value_offsets(),
+                                          array.offset(), num_rows + 1,
+                                          &tensor);
+      if (!st.ok()) {
+        return st;
+      }
+    } else {
+      tensor = Tensor(DT_INT32, TensorShape({num_rows + 1}));
+      auto row_splits = tensor.vec<int32>();
+      for (int64 i = 0; i <= num_rows; ++i) {
+        row_splits(i) = array.value_offset(i) - first_offset;
+      }
     }
     ragged_tensor_.push_front(std::move(tensor));
-    return array.values()->Accept(this);
+    if (first_offset == 0 && last_offset == array.values()->length()) {
+      return array.values()->Accept(this);
+    }
+    return array.values()
+        ->Slice(first_offset, last_offset - first_offset)
+        ->Accept(this);
   }
 
   RAGGED_TENSOR_BUILDER_PRIMITIVE_VISIT(::arrow::Int8Array);
@@ -290,10 +330,6 @@ Status MakeTensorsFromArrowArray(
     return errors::Internal("Arrow array with null values not supported");
   }
 
-  if (TF_PREDICT_FALSE(arrow_array->data()->offset != 0)) {
-    return errors::Internal("Arrow array has zero non-offset not supported");
-  }
-
   RaggedTensorBuilder builder(dtype, ragged_rank);
   TF_RETURN_IF_ARROW_ERROR(builder.Build(arrow_array, output_tensors));
   return Status::OK();
@@ -333,13 +369,17 @@ int GetArrowFileBufferSizeFromEnv() {
 
 ::arrow::Status OpenParquetReader(
     std::unique_ptr<::parquet::arrow::FileReader>* reader,
-    const std::shared_ptr<::arrow::io::RandomAccessFile>& file) {
+    const std::shared_ptr<::arrow::io::RandomAccessFile>& file,
+    const bool pre_buffer) {
   auto config = ::parquet::ReaderProperties();
   config.enable_buffered_stream();
   config.set_buffer_size(GetArrowFileBufferSizeFromEnv());
+  auto arrow_config = ::parquet::ArrowReaderProperties();
+  arrow_config.set_pre_buffer(pre_buffer);
   ARROW_RETURN_NOT_OK(::parquet::arrow::FileReader::Make(
       ::arrow::default_memory_pool(),
-      ::parquet::ParquetFileReader::Open(file, config), reader));
+      ::parquet::ParquetFileReader::Open(file, config), arrow_config,
+      reader));
   // If ARROW_NUM_THREADS > 0, specified number of threads will be used.
   // If ARROW_NUM_THREADS = 0, no threads will be used.
   // If ARROW_NUM_THREADS < 0, all threads will be used.
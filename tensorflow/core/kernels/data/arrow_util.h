@@ -57,9 +57,12 @@ int GetArrowFileBufferSizeFromEnv();
     std::shared_ptr<::arrow::io::RandomAccessFile>* file,
     const std::string& filename);
 
+// If pre_buffer is true, column chunks of a row group are coalesced and
+// read ahead of decoding.
 ::arrow::Status OpenParquetReader(
     std::unique_ptr<::parquet::arrow::FileReader>* reader,
-    const std::shared_ptr<::arrow::io::RandomAccessFile>& file);
+    const std::shared_ptr<::arrow::io::RandomAccessFile>& file,
+    const bool pre_buffer = false);
 
 ::arrow::Status GetParquetDataFrameFields(
     std::vector<std::string>* field_names,
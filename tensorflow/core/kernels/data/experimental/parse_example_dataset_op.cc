@@ -142,6 +142,7 @@ class ParseExampleDatasetOp : public UnaryDatasetOpKernel {
          it++) {
       it->second = i++;
     }
+    OP_REQUIRES_OK(ctx, example::FeatureNameIndex::Build(config, &config.index));
 
     *output =
         new Dataset(ctx, input, dense_defaults, sparse_keys_, dense_keys_,
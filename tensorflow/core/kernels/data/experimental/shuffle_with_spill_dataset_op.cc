@@ -0,0 +1,845 @@
+/* Copyright 2023 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <vector>
+
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/stats_aggregator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/kernels/data/name_utils.h"
+#include "tensorflow/core/kernels/data/random_seed_ops.h"
+#include "tensorflow/core/kernels/data/stats_utils.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/random/random_distributions.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+// See documentation in ../../ops/experimental_dataset_ops.cc for a high-level
+// description of the following op.
+
+constexpr char kDatasetType[] = "ShuffleWithSpill";
+constexpr char kBufferSize[] = "buffer_size";
+constexpr char kMemoryBudget[] = "memory_budget";
+constexpr char kSpillDirectory[] = "spill_directory";
+constexpr char kSeed[] = "seed";
+constexpr char kSeed2[] = "seed2";
+
+constexpr char kNumRandomSamples[] = "num_random_samples";
+constexpr char kDSNumRandomSamples[] = "ds_num_random_samples";
+constexpr char kEndOfInputSequence[] = "end_of_input_sequence";
+constexpr char kBuffer[] = "buffer";
+constexpr char kRun[] = "run";
+constexpr char kNumRuns[] = "num_runs";
+constexpr char kSize[] = "size";
+constexpr char kRandomSeedGenerator[] = "RandomSeedGenerator";
+constexpr char kTFData[] = "tf_data";
+constexpr char kReadaheadBytes[] = "readahead_bytes";
+
+// Readahead of spilled runs takes at most 1 / kReadaheadFraction of the
+// memory budget, elements in memory take the rest.
+constexpr int64 kReadaheadFraction = 4;
+
+// Runs are merged into one when there are more than this many, which bounds
+// the number of open spill files.
+constexpr size_t kMaxRuns = 16;
+
+int64 ElementBytes(const std::vector<Tensor>& element) {
+  int64 bytes = 0;
+  for (const Tensor& t : element) {
+    bytes += t.TotalBytes();
+  }
+  return bytes;
+}
+
+// Reads an element of `num_components` tensors from records of a spill file.
+Status ReadSpilledElement(io::RecordReader* reader, uint64* offset,
+                   size_t num_components, std::vector<Tensor>* element) {
+  element->clear();
+  element->reserve(num_components);
+  string record;
+  for (size_t i = 0; i < num_components; ++i) {
+    TF_RETURN_IF_ERROR(reader->ReadRecord(offset, &record));
+    TensorProto proto;
+    if (!proto.ParseFromString(record)) {
+      return errors::DataLoss("Could not parse spilled tensor at offset ",
+                              *offset);
+    }
+    element->emplace_back();
+    if (!element->back().FromProto(cpu_allocator(), proto)) {
+      return errors::DataLoss("Could not decode spilled tensor at offset ",
+                              *offset);
+    }
+  }
+  return Status::OK();
+}
+
+class ShuffleWithSpillDatasetOp : public UnaryDatasetOpKernel {
+ public:
+  explicit ShuffleWithSpillDatasetOp(OpKernelConstruction* ctx)
+      : UnaryDatasetOpKernel(ctx) {}
+
+ protected:
+  void MakeDataset(OpKernelContext* ctx, DatasetBase* input,
+                   DatasetBase** output) override {
+    int64 buffer_size = 0;
+    OP_REQUIRES_OK(ctx,
+                   ParseScalarArgument<int64>(ctx, kBufferSize, &buffer_size));
+    OP_REQUIRES(
+        ctx, buffer_size > 0,
+        errors::InvalidArgument("buffer_size must be greater than zero."));
+
+    int64 memory_budget = 0;
+    OP_REQUIRES_OK(
+        ctx, ParseScalarArgument<int64>(ctx, kMemoryBudget, &memory_budget));
+    OP_REQUIRES(
+        ctx, memory_budget > 0,
+        errors::InvalidArgument("memory_budget must be greater than zero."));
+
+    string spill_directory;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<string>(ctx, kSpillDirectory,
+                                                    &spill_directory));
+
+    int64 seed;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<int64>(ctx, kSeed, &seed));
+
+    int64 seed2;
+    OP_REQUIRES_OK(ctx, ParseScalarArgument<int64>(ctx, kSeed2, &seed2));
+
+    // By TensorFlow convention, passing 0 for both seeds indicates
+    // that the shuffling should be seeded non-deterministically.
+    if (seed == 0 && seed2 == 0) {
+      seed = random::New64();
+      seed2 = random::New64();
+    }
+
+    *output = new Dataset(ctx, input, buffer_size, memory_budget,
+                          spill_directory, seed, seed2);
+  }
+
+ private:
+  class Dataset : public DatasetBase {
+   public:
+    Dataset(OpKernelContext* ctx, const DatasetBase* input, int64 buffer_size,
+            int64 memory_budget, const string& spill_directory, int64 seed,
+            int64 seed2)
+        : DatasetBase(DatasetContext(ctx)),
+          input_(input),
+          buffer_size_(buffer_size),
+          memory_budget_(memory_budget),
+          spill_directory_(spill_directory),
+          seed_(seed),
+          seed2_(seed2) {
+      input_->Ref();
+    }
+
+    ~Dataset() override { input_->Unref(); }
+
+    std::unique_ptr<IteratorBase> MakeIteratorInternal(
+        const string& prefix) const override {
+      return absl::make_unique<Iterator>(Iterator::Params{
+          this, name_utils::IteratorPrefix(kDatasetType, prefix)});
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      return input_->output_dtypes();
+    }
+
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      return input_->output_shapes();
+    }
+
+    string DebugString() const override {
+      name_utils::DatasetDebugStringParams params;
+      params.set_args(buffer_size_, memory_budget_, seed_, seed2_);
+      return name_utils::DatasetDebugString(kDatasetType, params);
+    }
+
+    int64 Cardinality() const override { return input_->Cardinality(); }
+
+    Status CheckExternalState() const override {
+      return input_->CheckExternalState();
+    }
+
+   protected:
+    Status AsGraphDefInternal(SerializationContext* ctx,
+                              DatasetGraphDefBuilder* b,
+                              Node** output) const override {
+      Node* input_graph_node = nullptr;
+      TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph_node));
+      Node* buffer_size = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(buffer_size_, &buffer_size));
+      Node* memory_budget = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(memory_budget_, &memory_budget));
+      Node* spill_directory = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(spill_directory_, &spill_directory));
+      Node* seed = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(seed_, &seed));
+      Node* seed2 = nullptr;
+      TF_RETURN_IF_ERROR(b->AddScalar(seed2_, &seed2));
+      TF_RETURN_IF_ERROR(b->AddDataset(
+          this,
+          {input_graph_node, buffer_size, memory_budget, spill_directory, seed,
+           seed2},
+          output));
+      return Status::OK();
+    }
+
+   private:
+    // Shuffles elements like `ShuffleDataset`, while elements held in memory
+    // are bounded by `memory_budget_` bytes. When elements in memory exceed
+    // the budget, they are shuffled and written to a spill file as a run.
+    // Each output is picked uniformly at random from all buffered elements,
+    // i.e. elements in memory and remaining elements of runs. Since a run is
+    // already shuffled, picking from a run takes its next element, which a
+    // background thread reads ahead within the readahead budget. Elements
+    // that do not fit in the budget are read on demand.
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      explicit Iterator(const Params& params)
+          : DatasetIterator<Dataset>(params),
+            seed_(params.dataset->seed_),
+            seed2_(params.dataset->seed2_),
+            parent_generator_(seed_, seed2_),
+            generator_(&parent_generator_) {}
+
+      ~Iterator() override {
+        {
+          mutex_lock l(mu_);
+          cancelled_ = true;
+          cond_var_.notify_all();
+        }
+        readahead_thread_.reset();
+        if (seed_generator_ != nullptr) {
+          seed_generator_->Unref();
+        }
+        for (auto& run : runs_) {
+          env_->DeleteFile(run->filename).IgnoreError();
+        }
+      }
+
+      Status Initialize(IteratorContext* ctx) override {
+        env_ = ctx->env();
+        // Like `ShuffleDataset` with `reshuffle_each_iteration`, iterators
+        // created by repetitions of the dataset take seeds from a shared
+        // generator.
+        ResourceMgr* mgr = ctx->resource_mgr();
+        const string name = strings::StrCat(
+            prefix(), name_utils::kDelimiter, dataset()->type_string(),
+            name_utils::kDelimiter, kRandomSeedGenerator);
+        const int64 dataset_seed = dataset()->seed_;
+        const int64 dataset_seed2 = dataset()->seed2_;
+        TF_RETURN_IF_ERROR(mgr->LookupOrCreate<RandomSeedGenerator>(
+            kTFData, name, &seed_generator_,
+            [dataset_seed, dataset_seed2](RandomSeedGenerator** generator) {
+              *generator = new RandomSeedGenerator(dataset_seed, dataset_seed2);
+              return Status::OK();
+            }));
+        mutex_lock l(mu_);
+        seed_generator_->GenerateRandomSeeds(&seed_, &seed2_);
+        ResetRngs();
+        return dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_);
+      }
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        mutex_lock l(mu_);
+        while (input_impl_ &&
+               num_buffered_elements() < dataset()->buffer_size_) {
+          std::vector<Tensor> input_element;
+          bool end_of_input_sequence = false;
+          TF_RETURN_IF_ERROR(input_impl_->GetNext(ctx, &input_element,
+                                                  &end_of_input_sequence));
+          if (end_of_input_sequence) {
+            input_impl_.reset();
+            break;
+          }
+          TF_RETURN_IF_ERROR(AddElement(ctx, std::move(input_element), &l));
+        }
+
+        const auto& stats_aggregator = ctx->stats_aggregator();
+        if (stats_aggregator) {
+          stats_aggregator->AddToHistogram(
+              strings::StrCat(dataset()->node_name(), stats_utils::kDelimiter,
+                              kReadaheadBytes),
+              {static_cast<double>(ReadaheadBytes())}, num_elements());
+        }
+
+        const int64 n = num_buffered_elements();
+        if (n == 0) {
+          DCHECK(input_impl_ == nullptr);
+          *end_of_sequence = true;
+          return Status::OK();
+        }
+        *end_of_sequence = false;
+        int64 index = RandomIndex(n);
+        if (index < static_cast<int64>(buffer_.size())) {
+          *out_tensors = std::move(buffer_[index].element);
+          memory_bytes_ -= buffer_[index].bytes;
+          std::swap(buffer_[index], buffer_.back());
+          buffer_.pop_back();
+          return Status::OK();
+        }
+        index -= buffer_.size();
+        size_t r = 0;
+        while (index >= runs_[r]->size()) {
+          index -= runs_[r]->size();
+          ++r;
+        }
+        return TakeFromRun(r, out_tensors, &l);
+      }
+
+     protected:
+      std::shared_ptr<model::Node> CreateNode(
+          IteratorContext* ctx, model::Node::Args args) const override {
+        return model::MakeKnownRatioNode(std::move(args),
+                                         /*ratio=*/1);
+      }
+
+      Status SaveInternal(IteratorStateWriter* writer) override {
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(full_name(kDSNumRandomSamples),
+                                seed_generator_->num_random_samples()));
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kNumRandomSamples),
+                                               num_random_samples_));
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kSeed), seed_));
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kSeed2), seed2_));
+        if (!input_impl_) {
+          TF_RETURN_IF_ERROR(
+              writer->WriteScalar(full_name(kEndOfInputSequence), ""));
+        } else {
+          TF_RETURN_IF_ERROR(SaveInput(writer, input_impl_));
+        }
+
+        // Elements in memory are saved in place, and remaining elements of
+        // each run are saved in order, so that a restored iterator produces
+        // the same elements in the same order.
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            full_name(strings::StrCat(kBuffer, "_", kSize)), buffer_.size()));
+        for (size_t i = 0; i < buffer_.size(); ++i) {
+          TF_RETURN_IF_ERROR(WriteElement(
+              writer, strings::StrCat(kBuffer, "_", i), buffer_[i].element));
+        }
+        WaitForReadahead(&l);
+        TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kNumRuns),
+                                               runs_.size()));
+        for (size_t r = 0; r < runs_.size(); ++r) {
+          Run* run = runs_[r].get();
+          TF_RETURN_IF_ERROR(run->status);
+          const string run_prefix = strings::StrCat(kRun, "_", r);
+          TF_RETURN_IF_ERROR(writer->WriteScalar(
+              full_name(strings::StrCat(run_prefix, "_", kSize)), run->size()));
+          int64 j = 0;
+          for (const auto& element : run->readahead) {
+            TF_RETURN_IF_ERROR(WriteElement(
+                writer, strings::StrCat(run_prefix, "_", j++), element));
+          }
+          std::unique_ptr<RandomAccessFile> file;
+          TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(run->filename, &file));
+          io::RecordReader reader(file.get());
+          uint64 offset = run->offset;
+          std::vector<Tensor> element;
+          for (int64 k = 0; k < run->num_unread; ++k) {
+            TF_RETURN_IF_ERROR(ReadSpilledElement(
+                &reader, &offset, dataset()->output_dtypes().size(), &element));
+            TF_RETURN_IF_ERROR(WriteElement(
+                writer, strings::StrCat(run_prefix, "_", j++), element));
+          }
+        }
+        return Status::OK();
+      }
+
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        int64 ds_num_random_samples;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kDSNumRandomSamples),
+                                              &ds_num_random_samples));
+        seed_generator_->set_num_random_samples(ds_num_random_samples);
+        seed_generator_->Reset();
+
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kNumRandomSamples),
+                                              &num_random_samples_));
+        TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kSeed), &seed_));
+        TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kSeed2), &seed2_));
+        ResetRngs();
+        if (!reader->Contains(full_name(kEndOfInputSequence))) {
+          TF_RETURN_IF_ERROR(
+              dataset()->input_->MakeIterator(ctx, prefix(), &input_impl_));
+          TF_RETURN_IF_ERROR(RestoreInput(ctx, reader, input_impl_));
+        } else {
+          input_impl_.reset();
+        }
+
+        WaitForReadahead(&l);
+        for (auto& run : runs_) {
+          env_->DeleteFile(run->filename).IgnoreError();
+        }
+        runs_.clear();
+        buffer_.clear();
+        memory_bytes_ = 0;
+
+        int64 buffer_size;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(
+            full_name(strings::StrCat(kBuffer, "_", kSize)), &buffer_size));
+        for (int64 i = 0; i < buffer_size; ++i) {
+          BufferedElement buffered;
+          TF_RETURN_IF_ERROR(ReadElement(
+              reader, strings::StrCat(kBuffer, "_", i), &buffered.element));
+          buffered.bytes = ElementBytes(buffered.element);
+          memory_bytes_ += buffered.bytes;
+          buffer_.push_back(std::move(buffered));
+        }
+        // Runs are written back to new spill files element by element, which
+        // keeps memory bounded while restoring.
+        int64 num_runs;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kNumRuns), &num_runs));
+        for (int64 r = 0; r < num_runs; ++r) {
+          const string run_prefix = strings::StrCat(kRun, "_", r);
+          int64 run_size;
+          TF_RETURN_IF_ERROR(reader->ReadScalar(
+              full_name(strings::StrCat(run_prefix, "_", kSize)), &run_size));
+          std::unique_ptr<WritableFile> file;
+          std::unique_ptr<io::RecordWriter> writer;
+          string filename;
+          TF_RETURN_IF_ERROR(NewRunFile(&filename, &file, &writer));
+          std::vector<Tensor> element;
+          int64 max_element_bytes = 0;
+          for (int64 j = 0; j < run_size; ++j) {
+            TF_RETURN_IF_ERROR(ReadElement(
+                reader, strings::StrCat(run_prefix, "_", j), &element));
+            max_element_bytes =
+                std::max(max_element_bytes, ElementBytes(element));
+            TF_RETURN_IF_ERROR(WriteRecords(writer.get(), element));
+          }
+          TF_RETURN_IF_ERROR(AddRun(ctx, filename, std::move(file),
+                                    std::move(writer), run_size,
+                                    max_element_bytes));
+        }
+        return Status::OK();
+      }
+
+     private:
+      struct BufferedElement {
+        std::vector<Tensor> element;
+        int64 bytes = 0;
+      };
+
+      // Shuffled elements spilled to a file, read ahead in order.
+      struct Run {
+        string filename;
+        std::unique_ptr<RandomAccessFile> file;
+        std::unique_ptr<io::RecordReader> reader;
+        // Offset of the first element not read ahead yet.
+        uint64 offset = 0;
+        int64 num_unread = 0;
+        std::deque<std::vector<Tensor>> readahead;
+        int64 readahead_bytes = 0;
+        // Bytes of the largest element, so that readahead never reads past
+        // its budget.
+        int64 max_element_bytes = 0;
+        // Set while the background thread reads ahead outside the lock.
+        bool reading = false;
+        Status status;
+
+        int64 size() const { return num_unread + readahead.size(); }
+      };
+
+      int64 num_buffered_elements() const EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        int64 n = buffer_.size();
+        for (const auto& run : runs_) {
+          n += run->size();
+        }
+        return n;
+      }
+
+      int64 ReadaheadBytes() const EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        int64 bytes = 0;
+        for (const auto& run : runs_) {
+          bytes += run->readahead_bytes;
+        }
+        return bytes;
+      }
+
+      void ResetRngs() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        parent_generator_ = random::PhiloxRandom(seed_, seed2_);
+        generator_ = random::SingleSampleAdapter<random::PhiloxRandom>(
+            &parent_generator_);
+        generator_.Skip(num_random_samples_);
+      }
+
+      random::SingleSampleAdapter<random::PhiloxRandom>::ResultType Random()
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        num_random_samples_++;
+        return generator_();
+      }
+
+      int64 RandomIndex(int64 n) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        uint64 r = Random();
+        if (n > std::numeric_limits<uint32>::max()) {
+          r = (r << 32) | Random();
+        }
+        return r % n;
+      }
+
+      Status AddElement(IteratorContext* ctx, std::vector<Tensor>&& element,
+                        mutex_lock* l) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        BufferedElement buffered;
+        buffered.bytes = ElementBytes(element);
+        buffered.element = std::move(element);
+        memory_bytes_ += buffered.bytes;
+        buffer_.push_back(std::move(buffered));
+        if (memory_bytes_ >
+            dataset()->memory_budget_ -
+                dataset()->memory_budget_ / kReadaheadFraction) {
+          return Spill(ctx, l);
+        }
+        return Status::OK();
+      }
+
+      // Shuffles all elements in memory and writes them as a new run.
+      Status Spill(IteratorContext* ctx, mutex_lock* l)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        for (size_t i = buffer_.size(); i > 1; --i) {
+          std::swap(buffer_[i - 1], buffer_[RandomIndex(i)]);
+        }
+        std::unique_ptr<WritableFile> file;
+        std::unique_ptr<io::RecordWriter> writer;
+        string filename;
+        TF_RETURN_IF_ERROR(NewRunFile(&filename, &file, &writer));
+        int64 max_element_bytes = 0;
+        for (const auto& buffered : buffer_) {
+          max_element_bytes = std::max(max_element_bytes, buffered.bytes);
+          TF_RETURN_IF_ERROR(WriteRecords(writer.get(), buffered.element));
+        }
+        VLOG(1) << "Spilled " << buffer_.size() << " elements of "
+                << memory_bytes_ << " bytes to " << filename;
+        const int64 num_spilled = buffer_.size();
+        buffer_.clear();
+        memory_bytes_ = 0;
+        TF_RETURN_IF_ERROR(AddRun(ctx, filename, std::move(file),
+                                  std::move(writer), num_spilled,
+                                  max_element_bytes));
+        if (runs_.size() > kMaxRuns) {
+          return MergeRuns(ctx, l);
+        }
+        return Status::OK();
+      }
+
+      // Merges all runs into a single run. Each merged element is taken from
+      // a run with probability proportional to its remaining elements, so the
+      // merged run is shuffled as uniformly as the runs are.
+      Status MergeRuns(IteratorContext* ctx, mutex_lock* l)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        WaitForReadahead(l);
+        int64 n = 0;
+        for (const auto& run : runs_) {
+          TF_RETURN_IF_ERROR(run->status);
+          n += run->size();
+        }
+        std::unique_ptr<WritableFile> file;
+        std::unique_ptr<io::RecordWriter> writer;
+        string filename;
+        TF_RETURN_IF_ERROR(NewRunFile(&filename, &file, &writer));
+        const int64 num_merged = n;
+        int64 max_element_bytes = 0;
+        std::vector<Tensor> element;
+        for (; n > 0; --n) {
+          int64 index = RandomIndex(n);
+          size_t r = 0;
+          while (index >= runs_[r]->size()) {
+            index -= runs_[r]->size();
+            ++r;
+          }
+          Run* run = runs_[r].get();
+          if (!run->readahead.empty()) {
+            element = std::move(run->readahead.front());
+            run->readahead.pop_front();
+            run->readahead_bytes -= ElementBytes(element);
+          } else {
+            TF_RETURN_IF_ERROR(ReadFromRun(run, &element));
+          }
+          max_element_bytes =
+              std::max(max_element_bytes, ElementBytes(element));
+          TF_RETURN_IF_ERROR(WriteRecords(writer.get(), element));
+        }
+        VLOG(1) << "Merged " << runs_.size() << " runs of " << num_merged
+                << " elements to " << filename;
+        for (auto& run : runs_) {
+          env_->DeleteFile(run->filename).IgnoreError();
+        }
+        runs_.clear();
+        return AddRun(ctx, filename, std::move(file), std::move(writer),
+                      num_merged, max_element_bytes);
+      }
+
+      Status NewRunFile(string* filename, std::unique_ptr<WritableFile>* file,
+                        std::unique_ptr<io::RecordWriter>* writer)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (dataset()->spill_directory_.empty()) {
+          if (!env_->LocalTempFilename(filename)) {
+            return errors::Unavailable(
+                "Could not create a local temporary file to spill to.");
+          }
+        } else {
+          *filename = io::JoinPath(
+              dataset()->spill_directory_,
+              strings::StrCat("shuffle_spill_", random::New64(), ".tfrecord"));
+        }
+        TF_RETURN_IF_ERROR(env_->NewWritableFile(*filename, file));
+        writer->reset(new io::RecordWriter(file->get()));
+        return Status::OK();
+      }
+
+      Status WriteRecords(io::RecordWriter* writer,
+                          const std::vector<Tensor>& element) {
+        for (const Tensor& t : element) {
+          TensorProto proto;
+          t.AsProtoTensorContent(&proto);
+          TF_RETURN_IF_ERROR(writer->WriteRecord(proto.SerializeAsString()));
+        }
+        return Status::OK();
+      }
+
+      Status AddRun(IteratorContext* ctx, const string& filename,
+                    std::unique_ptr<WritableFile> file,
+                    std::unique_ptr<io::RecordWriter> writer,
+                    int64 num_elements, int64 max_element_bytes)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        TF_RETURN_IF_ERROR(writer->Close());
+        TF_RETURN_IF_ERROR(file->Close());
+        std::unique_ptr<Run> run(new Run);
+        run->filename = filename;
+        run->num_unread = num_elements;
+        run->max_element_bytes = max_element_bytes;
+        TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(filename, &run->file));
+        run->reader.reset(new io::RecordReader(run->file.get()));
+        runs_.push_back(std::move(run));
+        if (!readahead_thread_) {
+          readahead_thread_ = ctx->StartThread(
+              "tf_data_shuffle_readahead", [this]() { ReadaheadThread(); });
+        }
+        cond_var_.notify_all();
+        return Status::OK();
+      }
+
+      // Takes the next element of run `r`. The element is read on demand if
+      // it has not been read ahead.
+      Status TakeFromRun(size_t r, std::vector<Tensor>* out_tensors,
+                         mutex_lock* l) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        Run* run = runs_[r].get();
+        while (run->reading) {
+          cond_var_.wait(*l);
+        }
+        if (!run->readahead.empty()) {
+          *out_tensors = std::move(run->readahead.front());
+          run->readahead.pop_front();
+          run->readahead_bytes -= ElementBytes(*out_tensors);
+        } else {
+          TF_RETURN_IF_ERROR(run->status);
+          TF_RETURN_IF_ERROR(ReadFromRun(run, out_tensors));
+        }
+        if (run->size() == 0) {
+          env_->DeleteFile(run->filename).IgnoreError();
+          runs_.erase(runs_.begin() + r);
+        }
+        cond_var_.notify_all();
+        return Status::OK();
+      }
+
+      // Reads the next element of `run` that has not been read ahead.
+      Status ReadFromRun(Run* run, std::vector<Tensor>* element)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        Status s = ReadSpilledElement(run->reader.get(), &run->offset,
+                                      dataset()->output_dtypes().size(),
+                                      element);
+        if (!s.ok()) {
+          run->status = errors::DataLoss("Failed to read spill file ",
+                                         run->filename, ": ",
+                                         s.error_message());
+          return run->status;
+        }
+        --run->num_unread;
+        return Status::OK();
+      }
+
+      // Waits until the background thread reads ahead no run.
+      void WaitForReadahead(mutex_lock* l) EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        while (std::any_of(runs_.begin(), runs_.end(),
+                           [](const std::unique_ptr<Run>& run) {
+                             return run->reading;
+                           })) {
+          cond_var_.wait(*l);
+        }
+      }
+
+      // Returns the run most in need of readahead and the bytes it may read
+      // ahead, or null if no run has room for its largest element. Each run
+      // gets an equal share of the readahead budget.
+      Run* NextRunToRead(int64* readahead_budget)
+          EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (runs_.empty()) {
+          return nullptr;
+        }
+        const int64 total_budget =
+            dataset()->memory_budget_ / kReadaheadFraction;
+        const int64 run_budget = total_budget / runs_.size();
+        const int64 total_free = total_budget - ReadaheadBytes();
+        Run* result = nullptr;
+        for (auto& run : runs_) {
+          const int64 free =
+              std::min(run_budget - run->readahead_bytes, total_free);
+          if (run->reading || !run->status.ok() || run->num_unread == 0 ||
+              free < run->max_element_bytes) {
+            continue;
+          }
+          if (result == nullptr ||
+              run->readahead.size() < result->readahead.size()) {
+            result = run.get();
+            *readahead_budget = free;
+          }
+        }
+        return result;
+      }
+
+      void ReadaheadThread() {
+        const size_t num_components = dataset()->output_dtypes().size();
+        while (true) {
+          Run* run = nullptr;
+          int64 readahead_budget = 0;
+          int64 max_element_bytes;
+          int64 num_to_read;
+          uint64 offset;
+          {
+            mutex_lock l(mu_);
+            while (!cancelled_ &&
+                   (run = NextRunToRead(&readahead_budget)) == nullptr) {
+              cond_var_.wait(l);
+            }
+            if (cancelled_) {
+              return;
+            }
+            run->reading = true;
+            max_element_bytes = run->max_element_bytes;
+            num_to_read = run->num_unread;
+            offset = run->offset;
+          }
+
+          // Reads at least one element, and never past the readahead budget.
+          std::vector<std::vector<Tensor>> elements;
+          int64 bytes = 0;
+          Status s;
+          while (bytes + max_element_bytes <= readahead_budget &&
+                 static_cast<int64>(elements.size()) < num_to_read) {
+            std::vector<Tensor> element;
+            s = ReadSpilledElement(run->reader.get(), &offset, num_components,
+                                   &element);
+            if (!s.ok()) {
+              break;
+            }
+            bytes += ElementBytes(element);
+            elements.push_back(std::move(element));
+          }
+
+          mutex_lock l(mu_);
+          run->reading = false;
+          run->offset = offset;
+          run->num_unread -= elements.size();
+          run->readahead_bytes += bytes;
+          for (auto& element : elements) {
+            run->readahead.push_back(std::move(element));
+          }
+          if (!s.ok()) {
+            run->status = errors::DataLoss("Failed to read spill file ",
+                                           run->filename, ": ",
+                                           s.error_message());
+          }
+          cond_var_.notify_all();
+        }
+      }
+
+      Status WriteElement(IteratorStateWriter* writer, const string& prefix,
+                          const std::vector<Tensor>& element) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            full_name(strings::StrCat(prefix, "_", kSize)), element.size()));
+        for (size_t k = 0; k < element.size(); ++k) {
+          TF_RETURN_IF_ERROR(writer->WriteTensor(
+              full_name(strings::StrCat(prefix, "_", k)), element[k]));
+        }
+        return Status::OK();
+      }
+
+      Status ReadElement(IteratorStateReader* reader, const string& prefix,
+                         std::vector<Tensor>* element) {
+        int64 size;
+        TF_RETURN_IF_ERROR(reader->ReadScalar(
+            full_name(strings::StrCat(prefix, "_", kSize)), &size));
+        element->resize(size);
+        for (int64 k = 0; k < size; ++k) {
+          TF_RETURN_IF_ERROR(reader->ReadTensor(
+              full_name(strings::StrCat(prefix, "_", k)), &(*element)[k]));
+        }
+        return Status::OK();
+      }
+
+      mutex mu_;
+      condition_variable cond_var_;
+      Env* env_ = nullptr;
+      RandomSeedGenerator* seed_generator_ = nullptr;
+      int64 seed_ GUARDED_BY(mu_);
+      int64 seed2_ GUARDED_BY(mu_);
+      random::PhiloxRandom parent_generator_ GUARDED_BY(mu_);
+      random::SingleSampleAdapter<random::PhiloxRandom> generator_
+          GUARDED_BY(mu_);
+      int64 num_random_samples_ GUARDED_BY(mu_) = 0;
+      std::unique_ptr<IteratorBase> input_impl_ GUARDED_BY(mu_);
+      std::vector<BufferedElement> buffer_ GUARDED_BY(mu_);
+      int64 memory_bytes_ GUARDED_BY(mu_) = 0;
+      std::vector<std::unique_ptr<Run>> runs_ GUARDED_BY(mu_);
+      bool cancelled_ GUARDED_BY(mu_) = false;
+      std::unique_ptr<Thread> readahead_thread_;
+    };
+
+    const DatasetBase* const input_;
+    const int64 buffer_size_;
+    const int64 memory_budget_;
+    const string spill_directory_;
+    const int64 seed_;
+    const int64 seed2_;
+  };
+};
+
+REGISTER_KERNEL_BUILDER(Name("ShuffleWithSpillDataset").Device(DEVICE_CPU),
+                        ShuffleWithSpillDatasetOp);
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
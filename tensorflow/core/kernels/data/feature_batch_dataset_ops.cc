@@ -0,0 +1,330 @@
+/* Copyright 2023 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/feature_batch_dataset_ops.h"
+
+#include "tensorflow/core/framework/function_handle_cache.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/data/dataset_utils.h"
+#include "tensorflow/core/platform/file_system.h"
+
+namespace tensorflow {
+namespace data {
+
+#define PARSE_SCALAR tensorflow::data::ParseScalarArgument
+
+class FeatureBatchDatasetOp::Dataset : public DatasetBase {
+ public:
+  Dataset(OpKernelContext* ctx, const string& filename,
+          const std::vector<string>& field_names,
+          const DataTypeVector& field_dtypes,
+          const std::vector<int32>& field_ragged_ranks,
+          const int64 partition_count, const int64 partition_index,
+          const bool use_mmap)
+      : DatasetBase(DatasetContext(ctx)),
+        filename_(filename),
+        field_names_(field_names),
+        field_dtypes_(field_dtypes),
+        field_ragged_ranks_(field_ragged_ranks),
+        partition_count_(partition_count),
+        partition_index_(partition_index),
+        use_mmap_(use_mmap) {
+    for (size_t i = 0; i < field_names_.size(); ++i) {
+      output_dtypes_.push_back(field_dtypes_[i]);
+      for (int32 j = 0; j < field_ragged_ranks_[i]; ++j) {
+        output_dtypes_.push_back(DT_INT32);
+      }
+    }
+    output_shapes_.resize(output_dtypes_.size(), PartialTensorShape({-1}));
+  }
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override;
+
+  const DataTypeVector& output_dtypes() const override {
+    return output_dtypes_;
+  }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return output_shapes_;
+  }
+
+  string DebugString() const override {
+    return "FeatureBatchDatasetOp::Dataset";
+  }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* filename = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(filename_, &filename));
+    AttrValue field_names;
+    b->BuildAttrValue(field_names_, &field_names);
+    AttrValue field_dtypes;
+    b->BuildAttrValue(field_dtypes_, &field_dtypes);
+    AttrValue field_ragged_ranks;
+    b->BuildAttrValue(field_ragged_ranks_, &field_ragged_ranks);
+    AttrValue partition_count;
+    b->BuildAttrValue(partition_count_, &partition_count);
+    AttrValue partition_index;
+    b->BuildAttrValue(partition_index_, &partition_index);
+    AttrValue use_mmap;
+    b->BuildAttrValue(use_mmap_, &use_mmap);
+    TF_RETURN_IF_ERROR(
+        b->AddDataset(this, {{0, filename}}, {},
+                      {{"field_names", field_names},
+                       {"field_dtypes", field_dtypes},
+                       {"field_ragged_ranks", field_ragged_ranks},
+                       {"partition_count", partition_count},
+                       {"partition_index", partition_index},
+                       {"use_mmap", use_mmap}},
+                      output));
+    return Status::OK();
+  }
+
+ private:
+  class Iterator;
+  const string filename_;
+  const std::vector<string> field_names_;
+  const DataTypeVector field_dtypes_;
+  const std::vector<int32> field_ragged_ranks_;
+  const int64 partition_count_;
+  const int64 partition_index_;
+  const bool use_mmap_;
+  DataTypeVector output_dtypes_;
+  std::vector<PartialTensorShape> output_shapes_;
+};
+
+class FeatureBatchDatasetOp::Dataset::Iterator
+    : public DatasetIterator<FeatureBatchDatasetOp::Dataset> {
+ public:
+  explicit Iterator(const Params& params)
+      : DatasetIterator<FeatureBatchDatasetOp::Dataset>(params),
+        next_block_(params.dataset->partition_index_) {}
+
+  Status Initialize(IteratorContext* ctx) override {
+    reader_ = absl::make_unique<FeatureBatchReader>(dataset()->filename_,
+                                                    dataset()->use_mmap_);
+    TF_RETURN_IF_ERROR(reader_->Open(ctx->env()));
+    return reader_->LookupFeatures(
+        dataset()->field_names_, dataset()->field_dtypes_,
+        dataset()->field_ragged_ranks_, &features_);
+  }
+
+  Status GetNextInternal(IteratorContext* ctx, std::vector<Tensor>* out_tensors,
+                         bool* end_of_sequence) override {
+    mutex_lock l(mu_);
+    if (next_block_ >= reader_->num_blocks()) {
+      *end_of_sequence = true;
+      return Status::OK();
+    }
+    TF_RETURN_IF_ERROR(reader_->Read(next_block_, features_, out_tensors));
+    next_block_ += dataset()->partition_count_;
+    *end_of_sequence = false;
+    return Status::OK();
+  }
+
+ protected:
+  Status SaveInternal(IteratorStateWriter* writer) override {
+    mutex_lock l(mu_);
+    return writer->WriteScalar(full_name("next_block"), next_block_);
+  }
+
+  Status RestoreInternal(IteratorContext* ctx,
+                         IteratorStateReader* reader) override {
+    mutex_lock l(mu_);
+    return reader->ReadScalar(full_name("next_block"), &next_block_);
+  }
+
+ private:
+  mutex mu_;
+  std::unique_ptr<FeatureBatchReader> reader_;
+  std::vector<int> features_;
+  int64 next_block_ GUARDED_BY(mu_);
+};
+
+std::unique_ptr<IteratorBase>
+FeatureBatchDatasetOp::Dataset::MakeIteratorInternal(
+    const string& prefix) const {
+  return std::unique_ptr<IteratorBase>(
+      new Iterator({this, strings::StrCat(prefix, "::FeatureBatch")}));
+}
+
+FeatureBatchDatasetOp::FeatureBatchDatasetOp(OpKernelConstruction* ctx)
+    : DatasetOpKernel(ctx),
+      partition_count_(1),
+      partition_index_(0),
+      use_mmap_(false) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr("field_names", &field_names_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr("field_dtypes", &field_dtypes_));
+  OP_REQUIRES_OK(ctx,
+                 ctx->GetAttr("field_ragged_ranks", &field_ragged_ranks_));
+  OP_REQUIRES(ctx,
+              field_names_.size() == field_dtypes_.size() &&
+                  field_names_.size() == field_ragged_ranks_.size(),
+              errors::InvalidArgument(
+                  "Numbers of field names, dtypes and ragged ranks must be "
+                  "same"));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr("partition_count", &partition_count_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr("partition_index", &partition_index_));
+  OP_REQUIRES(ctx,
+              partition_index_ >= 0 && partition_index_ < partition_count_,
+              errors::InvalidArgument("partition_index must be in [0, ",
+                                      partition_count_, ")"));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr("use_mmap", &use_mmap_));
+}
+
+void FeatureBatchDatasetOp::MakeDataset(OpKernelContext* ctx,
+                                        DatasetBase** output) {
+  string filename;
+  OP_REQUIRES_OK(ctx, PARSE_SCALAR(ctx, "filename", &filename));
+  *output = new Dataset(ctx, filename, field_names_, field_dtypes_,
+                        field_ragged_ranks_, partition_count_,
+                        partition_index_, use_mmap_);
+}
+
+namespace {
+
+// Writes batches from a dataset to a feature batch file, see
+// `FeatureBatchWriter` for the format.
+class DatasetToFeatureBatchOp : public AsyncOpKernel {
+ public:
+  explicit DatasetToFeatureBatchOp(OpKernelConstruction* ctx)
+      : AsyncOpKernel(ctx),
+        background_worker_(ctx->env(), "tf_data_to_feature_batch") {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("field_names", &field_names_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("field_dtypes", &field_dtypes_));
+    OP_REQUIRES_OK(ctx,
+                   ctx->GetAttr("field_ragged_ranks", &field_ragged_ranks_));
+    OP_REQUIRES(ctx,
+                field_names_.size() == field_dtypes_.size() &&
+                    field_names_.size() == field_ragged_ranks_.size(),
+                errors::InvalidArgument(
+                    "Numbers of field names, dtypes and ragged ranks must be "
+                    "same"));
+  }
+
+  void ComputeAsync(OpKernelContext* ctx, DoneCallback done) override {
+    // The call to `iterator->GetNext()` may block and depend on an inter-op
+    // thread pool thread, so we issue the call using a background thread.
+    background_worker_.Schedule(std::bind(
+        [this, ctx](std::function<void()>& done) {
+          string filename;
+          OP_REQUIRES_OK_ASYNC(ctx, PARSE_SCALAR(ctx, "filename", &filename),
+                               done);
+
+          DatasetBase* dataset;
+          OP_REQUIRES_OK_ASYNC(
+              ctx, GetDatasetFromVariantTensor(ctx->input(0), &dataset), done);
+          DataTypeVector expected_dtypes;
+          for (size_t i = 0; i < field_names_.size(); ++i) {
+            expected_dtypes.push_back(field_dtypes_[i]);
+            for (int32 j = 0; j < field_ragged_ranks_[i]; ++j) {
+              expected_dtypes.push_back(DT_INT32);
+            }
+          }
+          OP_REQUIRES_ASYNC(
+              ctx, dataset->output_dtypes() == expected_dtypes,
+              errors::InvalidArgument(
+                  "Dataset of ", DataTypeVectorString(dataset->output_dtypes()),
+                  " does not match fields of ",
+                  DataTypeVectorString(expected_dtypes)),
+              done);
+
+          std::unique_ptr<WritableFile> file;
+          OP_REQUIRES_OK_ASYNC(
+              ctx, ctx->env()->NewWritableFile(filename, &file), done);
+          FeatureBatchWriter writer(file.get(), field_names_, field_dtypes_,
+                                    field_ragged_ranks_);
+
+          IteratorContext::Params params(ctx);
+          FunctionHandleCache function_handle_cache(params.flr);
+          params.function_handle_cache = &function_handle_cache;
+          ResourceMgr resource_mgr;
+          params.resource_mgr = &resource_mgr;
+          CancellationManager cancellation_manager;
+          params.cancellation_manager = &cancellation_manager;
+          std::function<void()> deregister_fn;
+          OP_REQUIRES_OK_ASYNC(ctx,
+                               ConnectCancellationManagers(
+                                   ctx->cancellation_manager(),
+                                   params.cancellation_manager, &deregister_fn),
+                               done);
+
+          // Update the `done` callback to deregister the cancellation callback.
+          done = std::bind(
+              [](const std::function<void()>& done,
+                 const std::function<void()>& deregister_fn) {
+                deregister_fn();
+                done();
+              },
+              std::move(done), std::move(deregister_fn));
+
+          IteratorContext iter_ctx(std::move(params));
+          std::unique_ptr<IteratorBase> iterator;
+          OP_REQUIRES_OK_ASYNC(
+              ctx,
+              dataset->MakeIterator(&iter_ctx, "DatasetToFeatureBatchIterator",
+                                    &iterator),
+              done);
+
+          // Update the `done` callback to destroy the iterator before calling
+          // the actual callback to avoid destruction races.
+          IteratorBase* raw_iterator = iterator.release();
+          done = std::bind(
+              [raw_iterator](const std::function<void()>& done) {
+                delete raw_iterator;
+                done();
+              },
+              std::move(done));
+
+          std::vector<Tensor> components;
+          bool end_of_sequence;
+          do {
+            OP_REQUIRES_OK_ASYNC(
+                ctx,
+                raw_iterator->GetNext(&iter_ctx, &components, &end_of_sequence),
+                done);
+            if (!end_of_sequence) {
+              OP_REQUIRES_OK_ASYNC(ctx, writer.Write(components), done);
+            }
+            components.clear();
+          } while (!end_of_sequence);
+          OP_REQUIRES_OK_ASYNC(ctx, writer.Close(), done);
+          done();
+        },
+        std::move(done)));
+  }
+
+ private:
+  BackgroundWorker background_worker_;
+  std::vector<string> field_names_;
+  DataTypeVector field_dtypes_;
+  std::vector<int32> field_ragged_ranks_;
+};
+
+}  // namespace
+
+REGISTER_KERNEL_BUILDER(Name("FeatureBatchDataset").Device(DEVICE_CPU),
+                        FeatureBatchDatasetOp);
+REGISTER_KERNEL_BUILDER(Name("DatasetToFeatureBatch").Device(DEVICE_CPU),
+                        DatasetToFeatureBatchOp);
+
+WHITELIST_STATEFUL_OP_FOR_DATASET_FUNCTIONS("FeatureBatchDataset");
+
+}  // namespace data
+}  // namespace tensorflow
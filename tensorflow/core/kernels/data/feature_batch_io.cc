@@ -0,0 +1,510 @@
+/* Copyright 2023 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/feature_batch_io.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/lib/core/coding.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/raw_coding.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/byte_order.h"
+
+namespace tensorflow {
+namespace data {
+
+namespace {
+
+constexpr char kMagic[] = "DRFB";
+constexpr size_t kMagicSize = 4;
+constexpr uint32 kVersion = 1;
+constexpr uint64 kAlignment = 64;
+constexpr size_t kColumnEntrySize = 24;
+
+uint64 AlignUp(const uint64 pos) {
+  return (pos + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+bool IsSupportedDataType(DataType dtype) {
+  return dtype == DT_STRING || DataTypeCanUseMemcpy(dtype);
+}
+
+// Size of a column in bytes.
+uint64 ColumnSize(const Tensor& tensor) {
+  if (tensor.dtype() != DT_STRING) {
+    return tensor.TotalBytes();
+  }
+  uint64 size = (tensor.NumElements() + 1) * sizeof(int64);
+  auto strings = tensor.flat<tstring>();
+  for (int64 i = 0; i < strings.size(); ++i) {
+    size += strings(i).size();
+  }
+  return size;
+}
+
+// Shares memory mapped columns with tensors.
+class MappedTensorBuffer : public TensorBuffer {
+ public:
+  MappedTensorBuffer(const std::shared_ptr<ReadOnlyMemoryRegion>& region,
+                     const char* data, const size_t size)
+      : TensorBuffer(const_cast<char*>(data)), region_(region), size_(size) {}
+
+  size_t size() const override { return size_; }
+
+  TensorBuffer* root_buffer() override { return this; }
+
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name(cpu_allocator()->Name());
+  }
+
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  const size_t size_;
+};
+
+}  // namespace
+
+FeatureBatchWriter::FeatureBatchWriter(WritableFile* file,
+                                       const std::vector<string>& names,
+                                       const DataTypeVector& dtypes,
+                                       const std::vector<int32>& ragged_ranks)
+    : file_(file),
+      names_(names),
+      dtypes_(dtypes),
+      ragged_ranks_(ragged_ranks),
+      pos_(0) {}
+
+Status FeatureBatchWriter::Append(StringPiece data) {
+  TF_RETURN_IF_ERROR(file_->Append(data));
+  pos_ += data.size();
+  return Status::OK();
+}
+
+Status FeatureBatchWriter::WriteHeader() {
+  if (TF_PREDICT_FALSE(!port::kLittleEndian)) {
+    return errors::Unimplemented(
+        "Feature batch files are only supported on little-endian hosts");
+  }
+  if (TF_PREDICT_FALSE(names_.size() != dtypes_.size() ||
+                       names_.size() != ragged_ranks_.size())) {
+    return errors::InvalidArgument(
+        "Numbers of feature names, dtypes and ragged ranks must be same");
+  }
+  string header(kMagic, kMagicSize);
+  core::PutFixed32(&header, kVersion);
+  core::PutFixed32(&header, names_.size());
+  for (size_t i = 0; i < names_.size(); ++i) {
+    if (TF_PREDICT_FALSE(!IsSupportedDataType(dtypes_[i]))) {
+      return errors::InvalidArgument("Feature ", names_[i], " has dtype ",
+                                     DataTypeString(dtypes_[i]),
+                                     " not supported");
+    }
+    if (TF_PREDICT_FALSE(ragged_ranks_[i] < 0)) {
+      return errors::InvalidArgument("Feature ", names_[i],
+                                     " has negative ragged rank");
+    }
+    core::PutFixed32(&header, names_[i].size());
+    header.append(names_[i]);
+    core::PutFixed32(&header, dtypes_[i]);
+    core::PutFixed32(&header, ragged_ranks_[i]);
+  }
+  return Append(header);
+}
+
+Status FeatureBatchWriter::Write(const std::vector<Tensor>& components) {
+  if (pos_ == 0) {
+    TF_RETURN_IF_ERROR(WriteHeader());
+  }
+
+  // Validates the batch.
+  size_t num_columns = 0;
+  for (size_t i = 0; i < names_.size(); ++i) {
+    num_columns += ragged_ranks_[i] + 1;
+  }
+  if (TF_PREDICT_FALSE(components.size() != num_columns)) {
+    return errors::InvalidArgument("Expected ", num_columns,
+                                   " components in a batch, got ",
+                                   components.size());
+  }
+  int64 num_rows = -1;
+  size_t column = 0;
+  for (size_t i = 0; i < names_.size(); ++i) {
+    const Tensor& values = components[column];
+    if (TF_PREDICT_FALSE(values.dtype() != dtypes_[i] ||
+                         values.dims() != 1)) {
+      return errors::InvalidArgument(
+          "Values of feature ", names_[i], " must be a 1-D ",
+          DataTypeString(dtypes_[i]), " tensor, got ",
+          DataTypeString(values.dtype()), values.shape().DebugString());
+    }
+    int64 feature_rows = values.NumElements();
+    for (int32 r = ragged_ranks_[i]; r >= 1; --r) {
+      const Tensor& splits = components[column + r];
+      if (TF_PREDICT_FALSE(splits.dtype() != DT_INT32 || splits.dims() != 1 ||
+                           splits.NumElements() < 1)) {
+        return errors::InvalidArgument(
+            "Row splits of feature ", names_[i],
+            " must be non-empty 1-D int32 tensors");
+      }
+      auto splits_vec = splits.vec<int32>();
+      if (TF_PREDICT_FALSE(splits_vec(0) != 0 ||
+                           splits_vec(splits_vec.size() - 1) !=
+                               feature_rows)) {
+        return errors::InvalidArgument("Row splits of feature ", names_[i],
+                                       " are inconsistent with its values");
+      }
+      feature_rows = splits_vec.size() - 1;
+    }
+    if (num_rows < 0) {
+      num_rows = feature_rows;
+    } else if (TF_PREDICT_FALSE(num_rows != feature_rows)) {
+      return errors::InvalidArgument("Feature ", names_[i], " has ",
+                                     feature_rows, " rows, expected ",
+                                     num_rows);
+    }
+    column += ragged_ranks_[i] + 1;
+  }
+
+  // Writes the column directory followed by columns.
+  block_offsets_.push_back(pos_);
+  string directory;
+  core::PutFixed64(&directory, num_rows < 0 ? 0 : num_rows);
+  core::PutFixed64(&directory, num_columns);
+  uint64 offset = AlignUp(pos_ + 16 + num_columns * kColumnEntrySize);
+  for (const Tensor& c : components) {
+    const uint64 size = ColumnSize(c);
+    core::PutFixed64(&directory, offset);
+    core::PutFixed64(&directory, size);
+    core::PutFixed64(&directory, c.NumElements());
+    offset = AlignUp(offset + size);
+  }
+  TF_RETURN_IF_ERROR(Append(directory));
+
+  const string padding(kAlignment, '\0');
+  for (const Tensor& c : components) {
+    TF_RETURN_IF_ERROR(
+        Append(StringPiece(padding.data(), AlignUp(pos_) - pos_)));
+    if (c.dtype() != DT_STRING) {
+      TF_RETURN_IF_ERROR(Append(c.tensor_data()));
+      continue;
+    }
+    auto strings = c.flat<tstring>();
+    string offsets;
+    int64 string_offset = 0;
+    core::PutFixed64(&offsets, string_offset);
+    for (int64 j = 0; j < strings.size(); ++j) {
+      string_offset += strings(j).size();
+      core::PutFixed64(&offsets, string_offset);
+    }
+    TF_RETURN_IF_ERROR(Append(offsets));
+    for (int64 j = 0; j < strings.size(); ++j) {
+      TF_RETURN_IF_ERROR(Append(strings(j)));
+    }
+  }
+  return Status::OK();
+}
+
+Status FeatureBatchWriter::Close() {
+  if (pos_ == 0) {
+    TF_RETURN_IF_ERROR(WriteHeader());
+  }
+  string footer;
+  for (const uint64 block_offset : block_offsets_) {
+    core::PutFixed64(&footer, block_offset);
+  }
+  core::PutFixed64(&footer, block_offsets_.size());
+  footer.append(kMagic, kMagicSize);
+  TF_RETURN_IF_ERROR(Append(footer));
+  return file_->Close();
+}
+
+FeatureBatchReader::FeatureBatchReader(const string& filename,
+                                       const bool use_mmap)
+    : filename_(filename),
+      use_mmap_(use_mmap),
+      file_size_(0),
+      footer_offset_(0),
+      buffer_offset_(0),
+      last_index_(-1) {}
+
+constexpr uint64 FeatureBatchReader::kReadaheadSize;
+
+Status FeatureBatchReader::ReadAt(const uint64 offset, const size_t n,
+                                  StringPiece* result, string* scratch) {
+  if (TF_PREDICT_FALSE(offset + n > file_size_)) {
+    return errors::DataLoss("Unexpected end of ", filename_);
+  }
+  if (region_) {
+    *result = StringPiece(
+        static_cast<const char*>(region_->data()) + offset, n);
+    return Status::OK();
+  }
+  if (offset >= buffer_offset_ &&
+      offset + n <= buffer_offset_ + buffer_.size()) {
+    *result = StringPiece(buffer_.data() + offset - buffer_offset_, n);
+    return Status::OK();
+  }
+  scratch->resize(n);
+  TF_RETURN_IF_ERROR(file_->Read(offset, n, result, &(*scratch)[0]));
+  if (TF_PREDICT_FALSE(result->size() != n)) {
+    return errors::DataLoss("Unexpected end of ", filename_);
+  }
+  return Status::OK();
+}
+
+Status FeatureBatchReader::Open(Env* env) {
+  if (TF_PREDICT_FALSE(!port::kLittleEndian)) {
+    return errors::Unimplemented(
+        "Feature batch files are only supported on little-endian hosts");
+  }
+  TF_RETURN_IF_ERROR(env->GetFileSize(filename_, &file_size_));
+  if (use_mmap_) {
+    std::unique_ptr<ReadOnlyMemoryRegion> region;
+    Status s = env->NewReadOnlyMemoryRegionFromFile(filename_, &region);
+    if (s.ok()) {
+      region_ = std::move(region);
+    } else {
+      LOG(WARNING) << "Failed to memory map " << filename_
+                   << ", read it instead: " << s;
+    }
+  }
+  if (!region_) {
+    TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename_, &file_));
+  }
+
+  StringPiece data;
+  string scratch;
+  TF_RETURN_IF_ERROR(ReadAt(0, kMagicSize + 8, &data, &scratch));
+  if (TF_PREDICT_FALSE(data.substr(0, kMagicSize) !=
+                       StringPiece(kMagic, kMagicSize))) {
+    return errors::DataLoss(filename_, " is not a feature batch file");
+  }
+  const uint32 version = core::DecodeFixed32(data.data() + kMagicSize);
+  if (TF_PREDICT_FALSE(version != kVersion)) {
+    return errors::Unimplemented("Version ", version, " of ", filename_,
+                                 " not supported");
+  }
+  const uint32 num_features = core::DecodeFixed32(data.data() + kMagicSize + 4);
+  uint64 pos = kMagicSize + 8;
+  int64 num_columns = 0;
+  for (uint32 i = 0; i < num_features; ++i) {
+    TF_RETURN_IF_ERROR(ReadAt(pos, 4, &data, &scratch));
+    const uint32 name_size = core::DecodeFixed32(data.data());
+    TF_RETURN_IF_ERROR(ReadAt(pos + 4, name_size + 8, &data, &scratch));
+    names_.emplace_back(data.data(), name_size);
+    dtypes_.push_back(
+        static_cast<DataType>(core::DecodeFixed32(data.data() + name_size)));
+    ragged_ranks_.push_back(core::DecodeFixed32(data.data() + name_size + 4));
+    first_columns_.push_back(num_columns);
+    num_columns += ragged_ranks_.back() + 1;
+    pos += name_size + 12;
+  }
+
+  if (TF_PREDICT_FALSE(file_size_ < pos + kMagicSize + 8)) {
+    return errors::DataLoss("Unexpected end of ", filename_);
+  }
+  TF_RETURN_IF_ERROR(
+      ReadAt(file_size_ - kMagicSize - 8, kMagicSize + 8, &data, &scratch));
+  if (TF_PREDICT_FALSE(data.substr(8) != StringPiece(kMagic, kMagicSize))) {
+    return errors::DataLoss(filename_, " is truncated");
+  }
+  const uint64 num_blocks = core::DecodeFixed64(data.data());
+  if (TF_PREDICT_FALSE(num_blocks * 8 + kMagicSize + 8 > file_size_ - pos)) {
+    return errors::DataLoss(filename_, " has a corrupted footer");
+  }
+  TF_RETURN_IF_ERROR(ReadAt(file_size_ - kMagicSize - 8 - num_blocks * 8,
+                            num_blocks * 8, &data, &scratch));
+  block_offsets_.resize(num_blocks);
+  for (uint64 i = 0; i < num_blocks; ++i) {
+    block_offsets_[i] = core::DecodeFixed64(data.data() + 8 * i);
+  }
+  footer_offset_ = file_size_ - kMagicSize - 8 - num_blocks * 8;
+  return Status::OK();
+}
+
+uint64 FeatureBatchReader::BlockEnd(const int64 index) const {
+  return index + 1 < num_blocks() ? block_offsets_[index + 1] : footer_offset_;
+}
+
+Status FeatureBatchReader::Readahead(const int64 index) {
+  const uint64 begin = block_offsets_[index];
+  uint64 end = BlockEnd(index);
+  if (TF_PREDICT_FALSE(begin > end || end > footer_offset_)) {
+    return errors::DataLoss("Corrupted block ", index, " in ", filename_);
+  }
+  const bool sequential = last_index_ >= 0 && index == last_index_ + 1;
+  last_index_ = index;
+  if (begin >= buffer_offset_ && end <= buffer_offset_ + buffer_.size()) {
+    return Status::OK();
+  }
+  // Reads the following whole blocks too, since they are read next.
+  for (int64 next = index + 1;
+       sequential && next < num_blocks() && end - begin < kReadaheadSize;
+       ++next) {
+    const uint64 next_end = BlockEnd(next);
+    if (TF_PREDICT_FALSE(next_end < end || next_end > footer_offset_)) {
+      break;
+    }
+    end = next_end;
+  }
+  buffer_offset_ = begin;
+  buffer_.resize(end - begin);
+  if (buffer_.empty()) {
+    return Status::OK();
+  }
+  StringPiece result;
+  Status s = file_->Read(begin, buffer_.size(), &result, &buffer_[0]);
+  if (TF_PREDICT_FALSE(!s.ok() || result.size() != buffer_.size())) {
+    buffer_.clear();
+    return s.ok() ? errors::DataLoss("Unexpected end of ", filename_) : s;
+  }
+  if (result.data() != buffer_.data()) {
+    std::memcpy(&buffer_[0], result.data(), result.size());
+  }
+  return Status::OK();
+}
+
+Status FeatureBatchReader::LookupFeatures(
+    const std::vector<string>& names, const DataTypeVector& dtypes,
+    const std::vector<int32>& ragged_ranks, std::vector<int>* features) const {
+  features->clear();
+  for (size_t i = 0; i < names.size(); ++i) {
+    auto it = std::find(names_.begin(), names_.end(), names[i]);
+    if (TF_PREDICT_FALSE(it == names_.end())) {
+      return errors::NotFound("Feature ", names[i], " not found in ",
+                              filename_);
+    }
+    const int feature = it - names_.begin();
+    if (TF_PREDICT_FALSE(dtypes[i] != dtypes_[feature] ||
+                         ragged_ranks[i] != ragged_ranks_[feature])) {
+      return errors::InvalidArgument(
+          "Feature ", names[i], " is ", DataTypeString(dtypes_[feature]),
+          " with ragged rank ", ragged_ranks_[feature], " in ", filename_,
+          ", but ", DataTypeString(dtypes[i]), " with ragged rank ",
+          ragged_ranks[i], " is expected");
+    }
+    features->push_back(feature);
+  }
+  return Status::OK();
+}
+
+Status FeatureBatchReader::ReadColumn(DataType dtype, const uint64 offset,
+                                      const uint64 size, const uint64 length,
+                                      Tensor* tensor) {
+  if (dtype == DT_STRING) {
+    StringPiece data;
+    string scratch;
+    TF_RETURN_IF_ERROR(ReadAt(offset, size, &data, &scratch));
+    const uint64 bytes_offset = (length + 1) * sizeof(int64);
+    if (TF_PREDICT_FALSE(size < bytes_offset)) {
+      return errors::DataLoss("Corrupted string column in ", filename_);
+    }
+    *tensor = Tensor(DT_STRING, TensorShape({static_cast<int64>(length)}));
+    auto strings = tensor->flat<tstring>();
+    uint64 start = core::DecodeFixed64(data.data());
+    for (uint64 i = 0; i < length; ++i) {
+      const uint64 limit = core::DecodeFixed64(data.data() + 8 * (i + 1));
+      if (TF_PREDICT_FALSE(limit < start || bytes_offset + limit > size)) {
+        return errors::DataLoss("Corrupted string column in ", filename_);
+      }
+      strings(i).assign(data.data() + bytes_offset + start, limit - start);
+      start = limit;
+    }
+    return Status::OK();
+  }
+
+  if (TF_PREDICT_FALSE(size != length * DataTypeSize(dtype) ||
+                       offset + size > file_size_)) {
+    return errors::DataLoss("Corrupted ", DataTypeString(dtype),
+                            " column in ", filename_);
+  }
+  const TensorShape shape({static_cast<int64>(length)});
+  if (region_ && size > 0) {
+    // Columns are aligned in file, and mapped at page boundary.
+    MappedTensorBuffer* buffer = new MappedTensorBuffer(
+        region_, static_cast<const char*>(region_->data()) + offset, size);
+    core::ScopedUnref unref(buffer);
+    *tensor = Tensor(dtype, shape, buffer);
+    return Status::OK();
+  }
+  *tensor = Tensor(dtype, shape);
+  if (size == 0) {
+    return Status::OK();
+  }
+  char* dst = const_cast<char*>(tensor->tensor_data().data());
+  if (offset >= buffer_offset_ &&
+      offset + size <= buffer_offset_ + buffer_.size()) {
+    std::memcpy(dst, buffer_.data() + offset - buffer_offset_, size);
+    return Status::OK();
+  }
+  StringPiece result;
+  TF_RETURN_IF_ERROR(file_->Read(offset, size, &result, dst));
+  if (TF_PREDICT_FALSE(result.size() != size)) {
+    return errors::DataLoss("Unexpected end of ", filename_);
+  }
+  if (result.data() != dst) {
+    std::memcpy(dst, result.data(), size);
+  }
+  return Status::OK();
+}
+
+Status FeatureBatchReader::Read(const int64 index,
+                                const std::vector<int>& features,
+                                std::vector<Tensor>* out_tensors) {
+  if (TF_PREDICT_FALSE(index < 0 || index >= num_blocks())) {
+    return errors::OutOfRange("No more blocks in ", filename_);
+  }
+  if (!region_) {
+    TF_RETURN_IF_ERROR(Readahead(index));
+  }
+  const uint64 block_offset = block_offsets_[index];
+  StringPiece data;
+  string scratch;
+  TF_RETURN_IF_ERROR(ReadAt(block_offset, 16, &data, &scratch));
+  const uint64 num_columns = core::DecodeFixed64(data.data() + 8);
+  if (TF_PREDICT_FALSE(num_columns * kColumnEntrySize > file_size_)) {
+    return errors::DataLoss("Corrupted block ", index, " in ", filename_);
+  }
+  string directory_scratch;
+  StringPiece directory;
+  TF_RETURN_IF_ERROR(ReadAt(block_offset + 16, num_columns * kColumnEntrySize,
+                            &directory, &directory_scratch));
+
+  for (const int feature : features) {
+    for (int32 r = 0; r <= ragged_ranks_[feature]; ++r) {
+      const uint64 column = first_columns_[feature] + r;
+      if (TF_PREDICT_FALSE(column >= num_columns)) {
+        return errors::DataLoss("Corrupted block ", index, " in ", filename_);
+      }
+      const char* entry = directory.data() + column * kColumnEntrySize;
+      Tensor tensor;
+      TF_RETURN_IF_ERROR(ReadColumn(
+          r == 0 ? dtypes_[feature] : DT_INT32, core::DecodeFixed64(entry),
+          core::DecodeFixed64(entry + 8), core::DecodeFixed64(entry + 16),
+          &tensor));
+      out_tensors->push_back(std::move(tensor));
+    }
+  }
+  return Status::OK();
+}
+
+}  // namespace data
+}  // namespace tensorflow
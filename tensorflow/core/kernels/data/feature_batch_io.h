@@ -0,0 +1,129 @@
+/* Copyright 2023 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_FEATURE_BATCH_IO_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_FEATURE_BATCH_IO_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/file_system.h"
+
+namespace tensorflow {
+namespace data {
+
+// A feature batch file stores batches of samples column by column, so
+// that batches are read back as tensors without parsing:
+//
+//   file   := header block* footer
+//   header := "DRFB" version:u32 num_features:u32
+//             (name_size:u32 name dtype:u32 ragged_rank:u32)*
+//   block  := num_rows:u64 num_columns:u64 (offset:u64 size:u64 length:u64)*
+//             (padding column)*
+//   footer := block_offset:u64* num_blocks:u64 "DRFB"
+//
+// Integers are little-endian. A feature has ragged_rank + 1 columns in a
+// block: the values, followed by int32 row splits from outer to inner
+// dimension. Columns start at 64 bytes aligned file offsets, and hold
+// values in host (little-endian) byte order. A string column holds
+// length + 1 int64 offsets followed by the concatenated bytes.
+class FeatureBatchWriter {
+ public:
+  FeatureBatchWriter(WritableFile* file, const std::vector<string>& names,
+                     const DataTypeVector& dtypes,
+                     const std::vector<int32>& ragged_ranks);
+
+  // Writes a batch as a block. `components` holds the values and row splits
+  // of each feature.
+  Status Write(const std::vector<Tensor>& components);
+
+  // Writes the footer and closes the file.
+  Status Close();
+
+ private:
+  Status WriteHeader();
+  Status Append(StringPiece data);
+
+  WritableFile* file_;
+  const std::vector<string> names_;
+  const DataTypeVector dtypes_;
+  const std::vector<int32> ragged_ranks_;
+  uint64 pos_;
+  std::vector<uint64> block_offsets_;
+};
+
+class FeatureBatchReader {
+ public:
+  // Memory maps the file if `use_mmap` is true and the file system supports
+  // it, then columns are shared with output tensors instead of being read.
+  // Otherwise a block is read at once, along with the following blocks up to
+  // kReadaheadSize bytes when blocks are read sequentially.
+  FeatureBatchReader(const string& filename, const bool use_mmap);
+
+  Status Open(Env* env);
+
+  const std::vector<string>& names() const { return names_; }
+  const DataTypeVector& dtypes() const { return dtypes_; }
+  const std::vector<int32>& ragged_ranks() const { return ragged_ranks_; }
+  int64 num_blocks() const { return block_offsets_.size(); }
+
+  // Finds the features with specified names, dtypes and ragged ranks.
+  Status LookupFeatures(const std::vector<string>& names,
+                        const DataTypeVector& dtypes,
+                        const std::vector<int32>& ragged_ranks,
+                        std::vector<int>* features) const;
+
+  // Reads values and row splits of `features` in block `index`.
+  Status Read(const int64 index, const std::vector<int>& features,
+              std::vector<Tensor>* out_tensors);
+
+ private:
+  // Bytes read ahead of sequentially read blocks without mmap.
+  static constexpr uint64 kReadaheadSize = 4 << 20;
+
+  Status ReadAt(const uint64 offset, const size_t n, StringPiece* result,
+                string* scratch);
+  // Reads block `index` into buffer_ unless it is buffered already.
+  Status Readahead(const int64 index);
+  uint64 BlockEnd(const int64 index) const;
+  Status ReadColumn(DataType dtype, const uint64 offset, const uint64 size,
+                    const uint64 length, Tensor* tensor);
+
+  const string filename_;
+  const bool use_mmap_;
+  std::unique_ptr<RandomAccessFile> file_;
+  std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  uint64 file_size_;
+  std::vector<string> names_;
+  DataTypeVector dtypes_;
+  std::vector<int32> ragged_ranks_;
+  std::vector<int64> first_columns_;
+  std::vector<uint64> block_offsets_;
+  // Offset of the footer, where the last block ends.
+  uint64 footer_offset_;
+  // Bytes of the file from buffer_offset_ read without mmap.
+  string buffer_;
+  uint64 buffer_offset_;
+  int64 last_index_;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_FEATURE_BATCH_IO_H_
@@ -14,17 +14,153 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/parquet_batch_reader.h"
 
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <numeric>
 #include <string>
 #include <vector>
 
+#include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
+#include "arrow/table.h"
+#include "arrow/util/future.h"
+#include "arrow/util/iterator.h"
+#include "arrow/util/thread_pool.h"
+#include "parquet/file_reader.h"
+#include "parquet/metadata.h"
+#include "parquet/statistics.h"
 #include "tensorflow/core/kernels/data/arrow_util.h"
+#include "tensorflow/core/lib/strings/numbers.h"
 
 namespace tensorflow {
 namespace data {
 
+namespace {
+
+const char* const kRowGroupFilterOps[] = {"==", "!=", "<=", ">=", "<", ">"};
+
+// Predicate `<column> <op> <value>` on a flat column, which is evaluated
+// against statistics of row groups.
+struct RowGroupFilter {
+  string column;
+  int column_index;
+  string op;
+  string value;
+};
+
+Status ParseRowGroupFilter(const string& filter, RowGroupFilter* output) {
+  for (const char* op : kRowGroupFilterOps) {
+    size_t pos = filter.find(op);
+    if (pos == string::npos) {
+      continue;
+    }
+    output->column = string(absl::StripAsciiWhitespace(filter.substr(0, pos)));
+    output->op = op;
+    output->value = string(
+        absl::StripAsciiWhitespace(filter.substr(pos + strlen(op))));
+    if (!output->column.empty() && !output->value.empty()) {
+      return Status::OK();
+    }
+    break;
+  }
+  return errors::InvalidArgument(
+      "Row group filter `", filter, "` should be `<column> <op> <value>`",
+      " where op is one of ==, !=, <, <=, >, >=");
+}
+
+// Returns false iff no value within [min, max] satisfies `op value`.
+template <typename T>
+bool MayMatch(const T& min, const T& max, const string& op, const T& value) {
+  if (op == "==") {
+    return !(value < min) && !(max < value);
+  }
+  if (op == "!=") {
+    return min < value || value < max;
+  }
+  if (op == "<") {
+    return min < value;
+  }
+  if (op == "<=") {
+    return !(value < min);
+  }
+  if (op == ">") {
+    return value < max;
+  }
+  if (op == ">=") {
+    return !(max < value);
+  }
+  return true;
+}
+
+Status MayMatch(const ::parquet::Statistics& stats,
+                const RowGroupFilter& filter, bool* may_match) {
+  *may_match = true;
+  if (!stats.HasMinMax()) {
+    return Status::OK();
+  }
+  const auto sort_order = stats.descr()->sort_order();
+  switch (stats.physical_type()) {
+    case ::parquet::Type::INT32:
+    case ::parquet::Type::INT64: {
+      if (sort_order != ::parquet::SortOrder::SIGNED) {
+        return Status::OK();
+      }
+      int64 value;
+      if (TF_PREDICT_FALSE(!strings::safe_strto64(filter.value, &value))) {
+        return errors::InvalidArgument("Value of row group filter on ",
+                                       filter.column, " must be an integer");
+      }
+      if (stats.physical_type() == ::parquet::Type::INT32) {
+        auto& typed = static_cast<const ::parquet::Int32Statistics&>(stats);
+        *may_match = MayMatch<int64>(typed.min(), typed.max(), filter.op,
+                                     value);
+      } else {
+        auto& typed = static_cast<const ::parquet::Int64Statistics&>(stats);
+        *may_match = MayMatch<int64>(typed.min(), typed.max(), filter.op,
+                                     value);
+      }
+      return Status::OK();
+    }
+    case ::parquet::Type::FLOAT:
+    case ::parquet::Type::DOUBLE: {
+      double value;
+      if (TF_PREDICT_FALSE(!strings::safe_strtod(filter.value, &value))) {
+        return errors::InvalidArgument("Value of row group filter on ",
+                                       filter.column, " must be a number");
+      }
+      if (stats.physical_type() == ::parquet::Type::FLOAT) {
+        auto& typed = static_cast<const ::parquet::FloatStatistics&>(stats);
+        *may_match = MayMatch<double>(typed.min(), typed.max(), filter.op,
+                                      value);
+      } else {
+        auto& typed = static_cast<const ::parquet::DoubleStatistics&>(stats);
+        *may_match = MayMatch<double>(typed.min(), typed.max(), filter.op,
+                                      value);
+      }
+      return Status::OK();
+    }
+    case ::parquet::Type::BYTE_ARRAY: {
+      if (sort_order != ::parquet::SortOrder::UNSIGNED) {
+        return Status::OK();
+      }
+      auto& typed = static_cast<const ::parquet::ByteArrayStatistics&>(stats);
+      string min(reinterpret_cast<const char*>(typed.min().ptr),
+                 typed.min().len);
+      string max(reinterpret_cast<const char*>(typed.max().ptr),
+                 typed.max().len);
+      *may_match = MayMatch<string>(min, max, filter.op, filter.value);
+      return Status::OK();
+    }
+    default:
+      return Status::OK();
+  }
+}
+
+}  // namespace
+
 class ParquetBatchReader::Impl {
  public:
   Impl(const string& filename, const int64 batch_size,
@@ -32,7 +168,9 @@ class ParquetBatchReader::Impl {
        const DataTypeVector& field_dtypes,
        const std::vector<int32>& field_ragged_ranks,
        const int64 partition_count, const int64 partition_index,
-       const bool drop_remainder)
+       const bool drop_remainder, const int64 num_parallel_row_groups,
+       const bool pre_buffer, const std::vector<string>& row_group_filters,
+       const int64 row_group_start, const int64 row_group_end)
       : filename_(filename),
         batch_size_(batch_size),
         field_names_(field_names),
@@ -40,10 +178,18 @@ class ParquetBatchReader::Impl {
         field_ragged_ranks_(field_ragged_ranks),
         partition_count_(partition_count),
         partition_index_(partition_index),
-        drop_remainder_(drop_remainder) {}
+        drop_remainder_(drop_remainder),
+        num_parallel_row_groups_(num_parallel_row_groups),
+        pre_buffer_(pre_buffer),
+        row_group_filters_(row_group_filters),
+        row_group_start_(row_group_start),
+        row_group_end_(row_group_end),
+        is_open_(false),
+        is_exhausted_(false),
+        pending_rows_(0) {}
 
   Status Open() {
-    if (TF_PREDICT_TRUE(batch_reader_)) {
+    if (TF_PREDICT_TRUE(is_open_)) {
       return Status::OK();
     }
     if (TF_PREDICT_FALSE(partition_index_ >= partition_count_)) {
@@ -55,15 +201,21 @@ class ParquetBatchReader::Impl {
       return errors::InvalidArgument("Partition index ", partition_index_,
                                      "must be greater than 0");
     }
+    if (TF_PREDICT_FALSE(row_group_start_ < 0 ||
+                         (row_group_end_ >= 0 &&
+                          row_group_end_ < row_group_start_))) {
+      return errors::InvalidArgument("Invalid row groups [", row_group_start_,
+                                     ", ", row_group_end_, ") of ",
+                                     filename_);
+    }
 
     std::shared_ptr<::arrow::io::RandomAccessFile> file;
     TF_RETURN_IF_ARROW_ERROR(ArrowUtil::OpenArrowFile(&file, filename_));
-    TF_RETURN_IF_ARROW_ERROR(ArrowUtil::OpenParquetReader(&reader_, file));
+    std::unique_ptr<::parquet::arrow::FileReader> reader;
+    TF_RETURN_IF_ARROW_ERROR(
+        ArrowUtil::OpenParquetReader(&reader, file, pre_buffer_));
+    reader_ = std::move(reader);
 
-    int num_row_groups = reader_->num_row_groups();
-    for (int g = partition_index_; g < num_row_groups; g += partition_count_) {
-      row_group_indices_.push_back(g);
-    }
     std::shared_ptr<::arrow::Schema> schema;
     TF_RETURN_IF_ARROW_ERROR(reader_->GetSchema(&schema));
     if (TF_PREDICT_FALSE(!schema->HasDistinctFieldNames())) {
@@ -97,17 +249,52 @@ class ParquetBatchReader::Impl {
             actual_ragged_rank, ", which should be ", expected_ragged_rank);
       }
     }
+
+    std::vector<RowGroupFilter> filters;
+    TF_RETURN_IF_ERROR(ParseRowGroupFilters(&filters));
+    int num_row_groups = reader_->num_row_groups();
+    if (row_group_end_ >= 0) {
+      num_row_groups = std::min<int64>(num_row_groups, row_group_end_);
+    }
+    int num_skipped_row_groups = 0;
+    // Row groups of [row_group_start_, row_group_end_) are partitioned.
+    for (int g = static_cast<int>(row_group_start_ + partition_index_);
+         g < num_row_groups; g += partition_count_) {
+      bool may_match = true;
+      TF_RETURN_IF_ERROR(RowGroupMayMatch(g, filters, &may_match));
+      if (may_match) {
+        row_group_indices_.push_back(g);
+      } else {
+        ++num_skipped_row_groups;
+      }
+    }
+    if (num_skipped_row_groups > 0) {
+      VLOG(1) << "Skipped " << num_skipped_row_groups << " row groups of "
+              << filename_ << " by row group filters";
+    }
     reader_->set_batch_size(batch_size_);
 
-    TF_RETURN_IF_ARROW_ERROR(reader_->GetRecordBatchReader(
-        row_group_indices_, column_indices_, &batch_reader_));
+    if (row_group_indices_.empty()) {
+      is_exhausted_ = true;
+    } else if (num_parallel_row_groups_ > 0) {
+      TF_CHECKED_ARROW_ASSIGN(
+          generator_,
+          reader_->GetRecordBatchGenerator(
+              reader_, row_group_indices_, column_indices_,
+              ::arrow::internal::GetCpuThreadPool(),
+              static_cast<int>(num_parallel_row_groups_)));
+    } else {
+      TF_RETURN_IF_ARROW_ERROR(reader_->GetRecordBatchReader(
+          row_group_indices_, column_indices_, &batch_reader_));
+    }
+    is_open_ = true;
     return Status::OK();
   }
 
   Status Read(std::vector<Tensor>* output_tensors) {
     // Read next batch from parquet file.
     std::shared_ptr<::arrow::RecordBatch> batch;
-    TF_RETURN_IF_ARROW_ERROR(batch_reader_->ReadNext(&batch));
+    TF_RETURN_IF_ERROR(ReadNext(&batch));
     if (TF_PREDICT_FALSE(!batch)) {
       return errors::OutOfRange("Reached end of parquet file ", filename_);
     }
@@ -127,6 +314,96 @@ class ParquetBatchReader::Impl {
   }
 
  private:
+  Status ParseRowGroupFilters(std::vector<RowGroupFilter>* filters) {
+    const auto* parquet_schema = reader_->parquet_reader()->metadata()->schema();
+    for (const auto& filter_str : row_group_filters_) {
+      RowGroupFilter filter;
+      TF_RETURN_IF_ERROR(ParseRowGroupFilter(filter_str, &filter));
+      filter.column_index = parquet_schema->ColumnIndex(filter.column);
+      if (TF_PREDICT_FALSE(filter.column_index < 0)) {
+        return errors::NotFound("No flat column called `", filter.column,
+                                "` found in ", filename_,
+                                " for row group filter");
+      }
+      filters->push_back(std::move(filter));
+    }
+    return Status::OK();
+  }
+
+  // Checks statistics of the row group, and returns false in may_match if
+  // no row in it satisfies all filters.
+  Status RowGroupMayMatch(int row_group,
+                          const std::vector<RowGroupFilter>& filters,
+                          bool* may_match) {
+    *may_match = true;
+    if (filters.empty()) {
+      return Status::OK();
+    }
+    auto metadata = reader_->parquet_reader()->metadata()->RowGroup(row_group);
+    for (const auto& filter : filters) {
+      auto column_chunk = metadata->ColumnChunk(filter.column_index);
+      if (!column_chunk->is_stats_set()) {
+        continue;
+      }
+      auto stats = column_chunk->statistics();
+      if (!stats) {
+        continue;
+      }
+      TF_RETURN_IF_ERROR(MayMatch(*stats, filter, may_match));
+      if (!*may_match) {
+        return Status::OK();
+      }
+    }
+    return Status::OK();
+  }
+
+  Status ReadNext(std::shared_ptr<::arrow::RecordBatch>* batch) {
+    if (TF_PREDICT_FALSE(is_exhausted_ && pending_.empty())) {
+      batch->reset();
+      return Status::OK();
+    }
+    if (!generator_) {
+      TF_RETURN_IF_ARROW_ERROR(batch_reader_->ReadNext(batch));
+      return Status::OK();
+    }
+
+    // Batches from the generator are sliced within each row group, so that
+    // the last batch of a row group is merged with the next row group.
+    while (!is_exhausted_ && pending_rows_ < batch_size_) {
+      auto future = generator_();
+      std::shared_ptr<::arrow::RecordBatch> next;
+      TF_CHECKED_ARROW_ASSIGN(next, future.result());
+      if (::arrow::IsIterationEnd(next)) {
+        is_exhausted_ = true;
+        break;
+      }
+      pending_rows_ += next->num_rows();
+      pending_.push_back(std::move(next));
+    }
+    if (pending_.empty()) {
+      batch->reset();
+      return Status::OK();
+    }
+    if (pending_.front()->num_rows() < batch_size_ && pending_.size() > 1) {
+      std::shared_ptr<::arrow::Table> table;
+      TF_CHECKED_ARROW_ASSIGN(
+          table, ::arrow::Table::FromRecordBatches(
+                     ::arrow::RecordBatchVector(pending_.begin(),
+                                                pending_.end())));
+      TF_CHECKED_ARROW_ASSIGN(
+          table, table->CombineChunks(::arrow::default_memory_pool()));
+      ::arrow::TableBatchReader table_reader(*table);
+      table_reader.set_chunksize(batch_size_);
+      ::arrow::RecordBatchVector batches;
+      TF_RETURN_IF_ARROW_ERROR(table_reader.ReadAll(&batches));
+      pending_.assign(batches.begin(), batches.end());
+    }
+    *batch = std::move(pending_.front());
+    pending_.pop_front();
+    pending_rows_ -= (*batch)->num_rows();
+    return Status::OK();
+  }
+
   const string filename_;
   const int64 batch_size_;
   std::vector<string> field_names_;
@@ -135,8 +412,20 @@ class ParquetBatchReader::Impl {
   int64 partition_count_;
   int64 partition_index_;
   bool drop_remainder_;
-  std::unique_ptr<::parquet::arrow::FileReader> reader_;
+  int64 num_parallel_row_groups_;
+  bool pre_buffer_;
+  std::vector<string> row_group_filters_;
+  int64 row_group_start_;
+  int64 row_group_end_;
+  bool is_open_;
+  bool is_exhausted_;
+  std::shared_ptr<::parquet::arrow::FileReader> reader_;
   std::unique_ptr<::arrow::RecordBatchReader> batch_reader_;
+  // Decodes up to num_parallel_row_groups_ row groups ahead concurrently.
+  std::function<::arrow::Future<std::shared_ptr<::arrow::RecordBatch>>()>
+      generator_;
+  std::deque<std::shared_ptr<::arrow::RecordBatch>> pending_;
+  int64 pending_rows_;
   std::vector<int> row_group_indices_;
   std::vector<int> column_indices_;
 };
@@ -145,10 +434,15 @@ ParquetBatchReader::ParquetBatchReader(
     const string& filename, const int64 batch_size,
     const std::vector<string>& field_names, const DataTypeVector& field_dtypes,
     const std::vector<int32>& field_ragged_ranks, const int64 partition_count,
-    const int64 partition_index, const bool drop_remainder)
+    const int64 partition_index, const bool drop_remainder,
+    const int64 num_parallel_row_groups, const bool pre_buffer,
+    const std::vector<string>& row_group_filters, const int64 row_group_start,
+    const int64 row_group_end)
     : pimpl_(new ParquetBatchReader::Impl(
           filename, batch_size, field_names, field_dtypes, field_ragged_ranks,
-          partition_count, partition_index, drop_remainder)) {}
+          partition_count, partition_index, drop_remainder,
+          num_parallel_row_groups, pre_buffer, row_group_filters,
+          row_group_start, row_group_end)) {}
 
 Status ParquetBatchReader::Open() { return pimpl_->Open(); }
 
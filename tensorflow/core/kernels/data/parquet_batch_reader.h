@@ -31,7 +31,12 @@ class ParquetBatchReader {
                      const DataTypeVector& field_dtypes,
                      const std::vector<int32>& field_ragged_ranks,
                      const int64 partition_count, const int64 partition_index,
-                     const bool drop_remainder);
+                     const bool drop_remainder,
+                     const int64 num_parallel_row_groups = 0,
+                     const bool pre_buffer = false,
+                     const std::vector<string>& row_group_filters = {},
+                     const int64 row_group_start = 0,
+                     const int64 row_group_end = -1);
 
   Status Open();
 
@@ -38,7 +38,10 @@ class ParquetTabularDatasetOp::Dataset : public DatasetBase {
           const DataTypeVector& field_dtypes,
           const std::vector<int32>& field_ragged_ranks,
           const int64 partition_count, const int64 partition_index,
-          const bool drop_remainder)
+          const bool drop_remainder, const int64 num_parallel_row_groups,
+          const bool pre_buffer, const std::vector<string>& row_group_filters,
+          const int op_version, const int64 row_group_start,
+          const int64 row_group_end)
       : DatasetBase(DatasetContext(ctx)),
         filename_(std::move(filename)),
         batch_size_(batch_size),
@@ -47,7 +50,13 @@ class ParquetTabularDatasetOp::Dataset : public DatasetBase {
         field_ragged_ranks_(std::move(field_ragged_ranks)),
         partition_count_(partition_count),
         partition_index_(partition_index),
-        drop_remainder_(drop_remainder) {
+        drop_remainder_(drop_remainder),
+        num_parallel_row_groups_(num_parallel_row_groups),
+        pre_buffer_(pre_buffer),
+        row_group_filters_(row_group_filters),
+        op_version_(op_version),
+        row_group_start_(row_group_start),
+        row_group_end_(row_group_end) {
     int64 num_outputs = field_names.size();
     for (int64 i = 0; i < field_names.size(); ++i) {
       output_dtypes_.push_back(std::move(field_dtypes[i]));
@@ -64,7 +73,8 @@ class ParquetTabularDatasetOp::Dataset : public DatasetBase {
     reader_ = absl::make_unique<ParquetBatchReader>(
         filename_, batch_size_, field_names_, field_dtypes_,
         field_ragged_ranks_, partition_count_, partition_index_,
-        drop_remainder_);
+        drop_remainder_, num_parallel_row_groups_, pre_buffer_,
+        row_group_filters_, row_group_start_, row_group_end_);
   }
 
   Status Open() {
@@ -107,14 +117,33 @@ class ParquetTabularDatasetOp::Dataset : public DatasetBase {
     b->BuildAttrValue(partition_index_, &partition_index);
     AttrValue drop_remainder;
     b->BuildAttrValue(drop_remainder_, &drop_remainder);
+    AttrValue num_parallel_row_groups;
+    b->BuildAttrValue(num_parallel_row_groups_, &num_parallel_row_groups);
+    AttrValue pre_buffer;
+    b->BuildAttrValue(pre_buffer_, &pre_buffer);
+    AttrValue row_group_filters;
+    b->BuildAttrValue(row_group_filters_, &row_group_filters);
+    std::vector<std::pair<size_t, Node*>> inputs = {{0, filename},
+                                                    {1, batch_size}};
+    if (op_version_ == 2) {
+      Node* row_group_start;
+      TF_RETURN_IF_ERROR(b->AddScalar(row_group_start_, &row_group_start));
+      Node* row_group_end;
+      TF_RETURN_IF_ERROR(b->AddScalar(row_group_end_, &row_group_end));
+      inputs.emplace_back(2, row_group_start);
+      inputs.emplace_back(3, row_group_end);
+    }
     TF_RETURN_IF_ERROR(
-        b->AddDataset(this, {{0, filename}, {1, batch_size}}, {},
+        b->AddDataset(this, inputs, {},
                       {{"field_names", field_names},
                        {"field_dtypes", field_dtypes},
                        {"field_ragged_ranks", field_ragged_ranks},
                        {"partition_count", partition_count},
                        {"partition_index", partition_index},
-                       {"drop_remainder", drop_remainder}},
+                       {"drop_remainder", drop_remainder},
+                       {"num_parallel_row_groups", num_parallel_row_groups},
+                       {"pre_buffer", pre_buffer},
+                       {"row_group_filters", row_group_filters}},
                       output));
     return Status::OK();
   }
@@ -129,6 +158,12 @@ class ParquetTabularDatasetOp::Dataset : public DatasetBase {
   const int64 partition_count_;
   const int64 partition_index_;
   const bool drop_remainder_;
+  const int64 num_parallel_row_groups_;
+  const bool pre_buffer_;
+  const std::vector<string> row_group_filters_;
+  const int op_version_;
+  const int64 row_group_start_;
+  const int64 row_group_end_;
   DataTypeVector output_dtypes_;
   std::vector<PartialTensorShape> output_shapes_;
   std::unique_ptr<ParquetBatchReader> reader_;
@@ -179,9 +214,12 @@ ParquetTabularDatasetOp::Dataset::MakeIteratorInternal(
 
 ParquetTabularDatasetOp::ParquetTabularDatasetOp(OpKernelConstruction* ctx)
     : DatasetOpKernel(ctx),
+      op_version_(ctx->def().op() == "ParquetTabularDatasetV2" ? 2 : 1),
       partition_count_(1),
       partition_index_(0),
-      drop_remainder_(false) {
+      drop_remainder_(false),
+      num_parallel_row_groups_(0),
+      pre_buffer_(false) {
   OP_REQUIRES_OK(ctx, ctx->GetAttr("field_names", &field_names_));
   OP_REQUIRES_OK(ctx, ctx->GetAttr("field_dtypes", &field_dtypes_));
   OP_REQUIRES_OK(ctx,
@@ -189,6 +227,11 @@ ParquetTabularDatasetOp::ParquetTabularDatasetOp(OpKernelConstruction* ctx)
   OP_REQUIRES_OK(ctx, ctx->GetAttr("partition_count", &partition_count_));
   OP_REQUIRES_OK(ctx, ctx->GetAttr("partition_index", &partition_index_));
   OP_REQUIRES_OK(ctx, ctx->GetAttr("drop_remainder", &drop_remainder_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr("num_parallel_row_groups",
+                                   &num_parallel_row_groups_));
+  OP_REQUIRES_OK(ctx, ctx->GetAttr("pre_buffer", &pre_buffer_));
+  OP_REQUIRES_OK(ctx,
+                 ctx->GetAttr("row_group_filters", &row_group_filters_));
 }
 
 void ParquetTabularDatasetOp::MakeDataset(OpKernelContext* ctx,
@@ -201,9 +244,19 @@ void ParquetTabularDatasetOp::MakeDataset(OpKernelContext* ctx,
   OP_REQUIRES(ctx, batch_size > 0,
               errors::InvalidArgument("batch_size must be greater than zero."));
 
+  int64 row_group_start = 0;
+  int64 row_group_end = -1;
+  if (op_version_ == 2) {
+    OP_REQUIRES_OK(ctx,
+                   PARSE_SCALAR(ctx, "row_group_start", &row_group_start));
+    OP_REQUIRES_OK(ctx, PARSE_SCALAR(ctx, "row_group_end", &row_group_end));
+  }
+
   Dataset* ds = new Dataset(
       ctx, filename, batch_size, field_names_, field_dtypes_,
-      field_ragged_ranks_, partition_count_, partition_index_, drop_remainder_);
+      field_ragged_ranks_, partition_count_, partition_index_, drop_remainder_,
+      num_parallel_row_groups_, pre_buffer_, row_group_filters_, op_version_,
+      row_group_start, row_group_end);
   OP_REQUIRES_OK(ctx, ds->Open());
   *output = ds;
 }
@@ -213,5 +266,10 @@ REGISTER_KERNEL_BUILDER(Name("ParquetTabularDatasetV1").Device(DEVICE_CPU),
 
 WHITELIST_STATEFUL_OP_FOR_DATASET_FUNCTIONS("ParquetTabularDatasetV1");
 
+REGISTER_KERNEL_BUILDER(Name("ParquetTabularDatasetV2").Device(DEVICE_CPU),
+                        ParquetTabularDatasetOp);
+
+WHITELIST_STATEFUL_OP_FOR_DATASET_FUNCTIONS("ParquetTabularDatasetV2");
+
 }  // namespace data
 }  // namespace tensorflow
@@ -29,12 +29,17 @@ class ParquetTabularDatasetOp : public DatasetOpKernel {
 
  private:
   class Dataset;
+  // ParquetTabularDatasetV2 reads a range of row groups.
+  const int op_version_;
   std::vector<string> field_names_;
   DataTypeVector field_dtypes_;
   std::vector<int32> field_ragged_ranks_;
   int64 partition_count_;
   int64 partition_index_;
   bool drop_remainder_;
+  int64 num_parallel_row_groups_;
+  bool pre_buffer_;
+  std::vector<string> row_group_filters_;
 };
 
 }  // namespace data
@@ -17,16 +17,20 @@ limitations under the License.
 #include <deque>
 
 #include "tensorflow/core/common_runtime/metrics.h"
+#include "tensorflow/core/common_runtime/pool_allocator.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/stats_aggregator.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/dataset_utils.h"
 #include "tensorflow/core/kernels/data/name_utils.h"
 #include "tensorflow/core/kernels/data/stats_utils.h"
+#include "tensorflow/core/lib/core/bits.h"
 #include "tensorflow/core/lib/core/error_codes.pb.h"
+#include "tensorflow/core/lib/core/refcount.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
+#include "tensorflow/core/platform/numa.h"
 
 namespace tensorflow {
 namespace data {
@@ -41,6 +45,7 @@ namespace data {
 /* static */ constexpr const char* const PrefetchDatasetOp::kOutputShapes;
 /* static */ constexpr const char* const PrefetchDatasetOp::kSlackPeriod;
 /* static */ constexpr const char* const PrefetchDatasetOp::kLegacyAutotune;
+/* static */ constexpr const char* const PrefetchDatasetOp::kUseArena;
 
 // Determines the fraction of slack time by which to delay prefetching of data.
 constexpr double kSleepFactor = 0.2;
@@ -49,16 +54,71 @@ constexpr char kStatus[] = "status";
 constexpr char kSizeSuffix[] = ".size";
 constexpr char kCodeSuffix[] = ".code";
 constexpr char kErrorMessageSuffix[] = ".error_message";
+// Initial number of free slabs kept by an arena, which grows on demand.
+constexpr size_t kArenaPoolSize = 16;
+// Number of slab sizes between two powers of 2.
+constexpr int kArenaSizeClassesLog2 = 3;
+
+namespace {
+
+// Rounds up to one of 2^kArenaSizeClassesLog2 sizes between two powers of 2,
+// so that a slab wastes at most 1 / 2^kArenaSizeClassesLog2 of its size.
+class SizeClassRounder : public RoundUpInterface {
+ public:
+  size_t RoundUp(size_t num_bytes) override {
+    const int shift =
+        std::max(Log2Floor64(num_bytes) - kArenaSizeClassesLog2,
+                 Log2Floor64(Allocator::kAllocatorAlignment));
+    const size_t step = 1uLL << shift;
+    return (num_bytes + step - 1) & ~(step - 1);
+  }
+};
+
+// Allocates host buffers of elements from slabs recycled by a pool, so that
+// a prefetch iterator in steady state neither calls malloc nor touches new
+// pages. Each buffer holds a reference to the arena, which is freed once the
+// iterator and all buffers are released.
+class PrefetchArena : public Allocator, public core::RefCounted {
+ public:
+  PrefetchArena()
+      : pool_(kArenaPoolSize, /*auto_resize=*/true,
+              new BasicCPUAllocator(port::kNUMANoAffinity, {}, {}),
+              new SizeClassRounder, "prefetch_arena") {}
+
+  string Name() override { return "prefetch_arena"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    void* ptr = pool_.AllocateRaw(alignment, num_bytes);
+    if (ptr != nullptr) {
+      Ref();
+    }
+    return ptr;
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    if (ptr == nullptr) {
+      return;
+    }
+    pool_.DeallocateRaw(ptr);
+    Unref();
+  }
+
+ private:
+  PoolAllocator pool_;
+};
+
+}  // namespace
 
 class PrefetchDatasetOp::Dataset : public DatasetBase {
  public:
   Dataset(OpKernelContext* ctx, const DatasetBase* input, int64 buffer_size,
-          int64 slack_period, bool legacy_autotune)
+          int64 slack_period, bool legacy_autotune, bool use_arena)
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
         buffer_size_(buffer_size),
         slack_period_(slack_period),
-        legacy_autotune_(legacy_autotune) {
+        legacy_autotune_(legacy_autotune),
+        use_arena_(use_arena) {
     input_->Ref();
   }
 
@@ -98,9 +158,13 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     TF_RETURN_IF_ERROR(b->AddScalar(buffer_size_, &buffer_size));
     AttrValue slack_period_attr;
     b->BuildAttrValue(slack_period_, &slack_period_attr);
+    AttrValue use_arena_attr;
+    b->BuildAttrValue(use_arena_, &use_arena_attr);
     TF_RETURN_IF_ERROR(b->AddDataset(
         this, {input_graph_node, buffer_size},
-        {std::make_pair(kSlackPeriod, slack_period_attr)}, output));
+        {std::make_pair(kSlackPeriod, slack_period_attr),
+         std::make_pair(kUseArena, use_arena_attr)},
+        output));
     return Status::OK();
   }
 
@@ -118,6 +182,9 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
               legacy_autotune_ ? 0 : params.dataset->buffer_size_, mu_,
               cond_var_)) {
       slack_us_ = 0;
+      if (params.dataset->use_arena_) {
+        arena_.reset(new PrefetchArena);
+      }
     }
 
     ~Iterator() override {
@@ -357,8 +424,19 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     Status EnsurePrefetchThreadStarted(IteratorContext* ctx)
         EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
       if (!prefetch_thread_) {
+        IteratorContext::Params params(ctx);
+        if (arena_) {
+          // Buffers of elements produced by the input, e.g. batches, are
+          // allocated from the arena, except for pinned memory.
+          PrefetchArena* arena = arena_.get();
+          auto allocator_getter = params.allocator_getter;
+          params.allocator_getter = [arena, allocator_getter](
+                                        AllocatorAttributes attrs) {
+            return attrs.gpu_compatible() ? allocator_getter(attrs) : arena;
+          };
+        }
         std::shared_ptr<IteratorContext> new_ctx =
-            std::make_shared<IteratorContext>(*ctx);
+            std::make_shared<IteratorContext>(std::move(params));
         prefetch_thread_ = ctx->StartThread(
             "tf_data_prefetch", [this, new_ctx]() { PrefetchThread(new_ctx); });
       }
@@ -475,6 +553,8 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     const std::shared_ptr<condition_variable> cond_var_;
     PrefetchAutotuner auto_tuner_ GUARDED_BY(*mu_);
     std::deque<BufferElement> buffer_ GUARDED_BY(*mu_);
+    // Released after the prefetch thread is joined.
+    core::RefCountPtr<PrefetchArena> arena_;
     std::unique_ptr<Thread> prefetch_thread_ GUARDED_BY(*mu_);
     bool cancelled_ GUARDED_BY(*mu_) = false;
     bool prefetch_thread_finished_ GUARDED_BY(*mu_) = false;
@@ -497,6 +577,9 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
 
   // Determines whether legacy autotuning should be used.
   const bool legacy_autotune_ = true;
+
+  // Determines whether elements are produced into recycled slabs.
+  const bool use_arena_;
 };
 
 PrefetchDatasetOp::PrefetchDatasetOp(OpKernelConstruction* ctx)
@@ -507,6 +590,11 @@ PrefetchDatasetOp::PrefetchDatasetOp(OpKernelConstruction* ctx)
   if (ctx->HasAttr(kLegacyAutotune)) {
     OP_REQUIRES_OK(ctx, ctx->GetAttr(kLegacyAutotune, &legacy_autotune_));
   }
+  if (ctx->HasAttr(kUseArena)) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr(kUseArena, &use_arena_));
+  }
+  // Slabs are host memory.
+  use_arena_ = use_arena_ && ctx->device_type() == DeviceType(DEVICE_CPU);
 }
 
 void PrefetchDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
@@ -523,8 +611,8 @@ void PrefetchDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
     metrics::RecordTFDataAutotune(kDatasetType);
   }
 
-  *output =
-      new Dataset(ctx, input, buffer_size, slack_period_, legacy_autotune_);
+  *output = new Dataset(ctx, input, buffer_size, slack_period_,
+                        legacy_autotune_, use_arena_);
 }
 
 namespace {
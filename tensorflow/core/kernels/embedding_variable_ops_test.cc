@@ -1,3 +1,4 @@
+#include <atomic>
 #include <thread>
 
 #include "tensorflow/core/framework/op.h"
@@ -1753,6 +1754,57 @@ TEST(EmbeddingVariableTest, TestInsertAndGetSnapshot) {
   }
 }
 
+TEST(EmbeddingVariableTest, TestRowLockConsistentLookup) {
+  setenv("TF_EV_ROW_LOCK", "true", 1);
+  int value_size = 64;
+  Tensor value(DT_FLOAT, TensorShape({value_size}));
+  test::FillValues<float>(&value, std::vector<float>(value_size, 0.0));
+  auto storage = embedding::StorageFactory::Create<int64, float>(
+      embedding::StorageConfig(), cpu_allocator(), "EmbeddingVar");
+  auto var = new EmbeddingVar<int64, float>("EmbeddingVar",
+      storage, EmbeddingConfig(), cpu_allocator());
+  var->Init(value, 1);
+  ASSERT_TRUE(var->IsRowLock());
+
+  ValuePtr<float>* value_ptr = nullptr;
+  TF_CHECK_OK(var->LookupOrCreateKey(0, &value_ptr));
+  auto row = var->flat(value_ptr, 0);
+
+  int64 write_loops = 100000;
+  std::atomic<bool> done(false);
+  std::thread writer([value_ptr, &row, &done, write_loops, value_size]() {
+    for (int64 i = 1; i <= write_loops; i++) {
+      value_ptr->WriteBegin();
+      for (int j = 0; j < value_size; j++) {
+        row(j) = i;
+      }
+      value_ptr->WriteEnd();
+    }
+    done = true;
+  });
+  std::vector<std::thread> readers(4);
+  for (auto& reader : readers) {
+    reader = std::thread([var, &done, value_size]() {
+      std::vector<float> val(value_size);
+      while (!done) {
+        TF_CHECK_OK(var->Lookup(0, val.data(), nullptr));
+        for (int j = 1; j < value_size; j++) {
+          ASSERT_EQ(val[0], val[j]);
+        }
+      }
+    });
+  }
+  writer.join();
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  std::vector<float> val(value_size);
+  TF_CHECK_OK(var->Lookup(0, val.data(), nullptr));
+  ASSERT_EQ(val[0], static_cast<float>(write_loops));
+  var->Unref();
+  unsetenv("TF_EV_ROW_LOCK");
+}
+
 } // namespace
 } // namespace embedding
 } // namespace tensorflow
@@ -26,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 #include "tensorflow/core/util/example_proto_helper.h"
@@ -131,6 +132,7 @@ class ParseExampleOp : public OpKernel {
     for (int d = 0; d < attrs_.num_sparse; ++d) {
       config.sparse.push_back({sparse_keys_t[d], attrs_.sparse_types[d]});
     }
+    OP_REQUIRES_OK(ctx, GetFeatureNameIndex(config, &config.index));
 
     auto serialized_t = serialized->flat<string>();
     auto names_t = names->flat<string>();
@@ -163,6 +165,28 @@ class ParseExampleOp : public OpKernel {
 
  protected:
   ParseExampleAttrs attrs_;
+
+ private:
+  // Keys are inputs but almost always constants, so the index built for last
+  // keys is reused until keys change.
+  Status GetFeatureNameIndex(
+      const example::FastParseExampleConfig& config,
+      std::shared_ptr<const example::FeatureNameIndex>* index) {
+    {
+      mutex_lock l(mu_);
+      *index = index_;
+    }
+    if (*index != nullptr && (*index)->Matches(config)) {
+      return Status::OK();
+    }
+    TF_RETURN_IF_ERROR(example::FeatureNameIndex::Build(config, index));
+    mutex_lock l(mu_);
+    index_ = *index;
+    return Status::OK();
+  }
+
+  mutex mu_;
+  std::shared_ptr<const example::FeatureNameIndex> index_ GUARDED_BY(mu_);
 };
 
 REGISTER_KERNEL_BUILDER(Name("ParseExample").Device(DEVICE_CPU),
@@ -172,6 +196,16 @@ class ParseSingleExampleOp : public OpKernel {
  public:
   explicit ParseSingleExampleOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
     OP_REQUIRES_OK(ctx, attrs_.Init(ctx));
+    example::FastParseExampleConfig config;
+    for (size_t d = 0; d < attrs_.dense_keys.size(); ++d) {
+      config.dense.emplace_back();
+      config.dense.back().feature_name = attrs_.dense_keys[d];
+    }
+    for (size_t d = 0; d < attrs_.sparse_keys.size(); ++d) {
+      config.sparse.emplace_back();
+      config.sparse.back().feature_name = attrs_.sparse_keys[d];
+    }
+    OP_REQUIRES_OK(ctx, example::FeatureNameIndex::Build(config, &index_));
   }
 
   void Compute(OpKernelContext* ctx) override {
@@ -222,7 +256,6 @@ class ParseSingleExampleOp : public OpKernel {
 
     example::Result result;
 
-    // TODO(mrry): Build the configuration once and cache it.
     example::FastParseExampleConfig config;
     for (int d = 0; d < attrs_.dense_keys.size(); ++d) {
       config.dense.push_back({attrs_.dense_keys[d], attrs_.dense_types[d],
@@ -233,6 +266,7 @@ class ParseSingleExampleOp : public OpKernel {
     for (int d = 0; d < attrs_.sparse_keys.size(); ++d) {
       config.sparse.push_back({attrs_.sparse_keys[d], attrs_.sparse_types[d]});
     }
+    config.index = index_;
 
     const string& serialized_proto = serialized->scalar<tstring>()();
 
@@ -259,6 +293,9 @@ class ParseSingleExampleOp : public OpKernel {
 
  protected:
   ParseSingleExampleAttrs attrs_;
+
+ private:
+  std::shared_ptr<const example::FeatureNameIndex> index_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("ParseSingleExample").Device(DEVICE_CPU),
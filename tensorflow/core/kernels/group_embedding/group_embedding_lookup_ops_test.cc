@@ -8,8 +8,13 @@
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/kernels/group_embedding/group_embedding_work_queue.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session.h"
@@ -1077,4 +1082,108 @@ TEST_F(GroupEmbeddingVariableBackWardOpTest,
 //   Run<int64, float, MeanAndMaxNorm100>(DEVICE::CPU);
 // }
 
+TEST(GroupEmbeddingWorkQueueTest, SkewedTablesCoveredOnce) {
+  thread::ThreadPool pool(Env::Default(), "group_embedding_test", 4);
+  // Table 0 holds 10x more rows than the others.
+  std::vector<int64> num_rows = {10000, 1000, 1000, 1000};
+  std::vector<std::vector<std::atomic<int>>> visits(num_rows.size());
+  std::vector<std::function<void(int64, int64)>> fns;
+  for (size_t t = 0; t < num_rows.size(); ++t) {
+    visits[t] = std::vector<std::atomic<int>>(num_rows[t]);
+    for (auto& v : visits[t]) v = 0;
+    fns.push_back([&visits, t](int64 begin, int64 end) {
+      for (int64 r = begin; r < end; ++r) visits[t][r]++;
+    });
+  }
+  DeviceBase::CpuWorkerThreads worker_threads;
+  worker_threads.num_threads = 4;
+  worker_threads.workers = &pool;
+  RunGroupEmbeddingTasks(
+      &worker_threads, num_rows,
+      [](int t, int64 r) -> int64 { return r * 16; }, fns);
+  for (size_t t = 0; t < num_rows.size(); ++t) {
+    for (int64 r = 0; r < num_rows[t]; ++r) {
+      EXPECT_EQ(1, visits[t][r].load());
+    }
+  }
+}
+
+// Group lookup where the first table pools `skew` times more ids per
+// sample than the others, the case the work-stealing queue balances.
+static void BM_GroupVariableLookupSkewed(int iters, int skew, int nth) {
+  testing::StopTiming();
+  Graph* g = new Graph(OpRegistry::Global());
+  const int num_lookups = 8;
+  const int batch_size = 1024;
+  const int dimension = 16;
+  const int64 vocab_size = 100000;
+  random::PhiloxRandom philox(301, 17);
+  random::SimplePhilox rnd(&philox);
+
+  std::vector<NodeBuilder::NodeOut> variables, values, indices, weights,
+      shapes;
+  int64 total_ids = 0;
+  for (int t = 0; t < num_lookups; ++t) {
+    const int ids_per_sample = t == 0 ? 4 * skew : 4;
+    const int64 nnz = static_cast<int64>(batch_size) * ids_per_sample;
+    total_ids += nnz;
+    Tensor variable(DT_FLOAT, TensorShape({vocab_size, dimension}));
+    variable.flat<float>().setRandom();
+    Tensor sp_values(DT_INT64, TensorShape({nnz}));
+    Tensor sp_indices(DT_INT64, TensorShape({nnz, 2}));
+    Tensor sp_weights(DT_FLOAT, TensorShape({nnz}));
+    auto sp_values_flat = sp_values.flat<int64>();
+    auto sp_indices_mat = sp_indices.matrix<int64>();
+    for (int64 k = 0; k < nnz; ++k) {
+      sp_values_flat(k) = rnd.Uniform64(vocab_size);
+      sp_indices_mat(k, 0) = k / ids_per_sample;
+      sp_indices_mat(k, 1) = k % ids_per_sample;
+    }
+    sp_weights.flat<float>().setConstant(1.0f);
+    Tensor dense_shape(DT_INT64, TensorShape({2}));
+    test::FillValues<int64>(&dense_shape, {batch_size, ids_per_sample});
+    variables.emplace_back(test::graph::Constant(g, variable));
+    values.emplace_back(test::graph::Constant(g, sp_values));
+    indices.emplace_back(test::graph::Constant(g, sp_indices));
+    weights.emplace_back(test::graph::Constant(g, sp_weights));
+    shapes.emplace_back(test::graph::Constant(g, dense_shape));
+  }
+  Tensor default_value(DT_FLOAT, TensorShape({}));
+  default_value.scalar<float>()() = 0.0f;
+
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), "GroupVariableLookup")
+                  .Input(variables)
+                  .Input(values)
+                  .Input(indices)
+                  .Input(weights)
+                  .Input(shapes)
+                  .Input(test::graph::Constant(g, default_value))
+                  .Attr("dtype", DT_FLOAT)
+                  .Attr("Tkeys", DT_INT64)
+                  .Attr("combiner", "mean")
+                  .Attr("dimension", dimension)
+                  .Attr("num_lookups", num_lookups)
+                  .Attr("ignore_weights", false)
+                  .Finalize(g, &node));
+
+  testing::UseRealTime();
+  testing::ItemsProcessed(static_cast<int64>(iters) * total_ids);
+  SessionOptions opts;
+  opts.config.set_intra_op_parallelism_threads(nth);
+  testing::StartTiming();
+  test::Benchmark("cpu", g, &opts).Run(iters);
+}
+
+#define BM_GroupVariableLookupSkewed(SKEW, NTH)                            \
+  static void BM_GroupVariableLookupSkewed_##SKEW##_##NTH(int iters) {     \
+    BM_GroupVariableLookupSkewed(iters, SKEW, NTH);                        \
+  }                                                                        \
+  BENCHMARK(BM_GroupVariableLookupSkewed_##SKEW##_##NTH);
+
+BM_GroupVariableLookupSkewed(1, 8);
+BM_GroupVariableLookupSkewed(10, 8);
+BM_GroupVariableLookupSkewed(1, 16);
+BM_GroupVariableLookupSkewed(10, 16);
+
 }  // namespace tensorflow
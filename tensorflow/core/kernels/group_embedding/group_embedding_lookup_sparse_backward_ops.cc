@@ -14,7 +14,7 @@ limitations under the License.
 
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
-#include "tensorflow/core/util/work_sharder.h"
+#include "tensorflow/core/kernels/group_embedding/group_embedding_work_queue.h"
 
 namespace tensorflow {
 
@@ -31,13 +31,15 @@ class GroupEmbeddingVarLookupGradCpuOp : public OpKernel {
 
   void Compute(OpKernelContext* ctx) override {
     auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
-
+    std::vector<int64> unique_nnzs(num_lookups_);
+    std::vector<std::function<void(int64, int64)>> combiners(num_lookups_);
     for (int i = 0; i < num_lookups_; ++i) {
       const Tensor grads_tensor = ctx->input(i);
       auto* grads = grads_tensor.flat<TValue>().data();
       const Tensor unique_keys_tensor = ctx->input(2 * num_lookups_ + i);
       auto* unique_keys = unique_keys_tensor.flat<TKey>().data();
       int unique_nnz = unique_keys_tensor.NumElements();
+      unique_nnzs[i] = unique_nnz;
 
       const Tensor sp_indices_tensor = ctx->input(3 * num_lookups_ + i);
       auto* sp_indices = sp_indices_tensor.flat<int64>().data();
@@ -51,9 +53,8 @@ class GroupEmbeddingVarLookupGradCpuOp : public OpKernel {
                                                &grads_sp_values_tensor));
       auto* grads_sp_values = grads_sp_values_tensor->flat<TValue>().data();
 
-      int slice_bytes = unique_nnz * dimension_ * 1000;
       if (combiner_ == "mean") {
-        auto embedding_var_grad_combiner = [this, &grads_sp_values, sp_indices,
+        auto embedding_var_grad_combiner = [this, grads_sp_values, sp_indices,
                                             grads, batch_nums](int64 start,
                                                                int64 end) {
           for (int64 i = start; i < end; ++i) {
@@ -84,11 +85,9 @@ class GroupEmbeddingVarLookupGradCpuOp : public OpKernel {
             // #endif
           }
         };
-        Shard(worker_threads->num_threads, worker_threads->workers, unique_nnz,
-              slice_bytes /*cost*/,
-              embedding_var_grad_combiner);  // Parallel on batch
+        combiners[i] = embedding_var_grad_combiner;
       } else if (combiner_ == "sum") {
-        auto embedding_var_grad_combiner = [this, &grads_sp_values, sp_indices,
+        auto embedding_var_grad_combiner = [this, grads_sp_values, sp_indices,
                                             grads, batch_nums](int64 start,
                                                                int64 end) {
           for (int64 i = start; i < end; ++i) {
@@ -98,10 +97,9 @@ class GroupEmbeddingVarLookupGradCpuOp : public OpKernel {
                    sizeof(TValue) * dimension_);
           }
         };
-        Shard(worker_threads->num_threads, worker_threads->workers, unique_nnz,
-              slice_bytes /*cost*/, embedding_var_grad_combiner);
+        combiners[i] = embedding_var_grad_combiner;
       } else {
-        auto embedding_var_grad_combiner = [this, &grads_sp_values, sp_indices,
+        auto embedding_var_grad_combiner = [this, grads_sp_values, sp_indices,
                                             grads, batch_nums](int64 start,
                                                                int64 end) {
           for (int64 i = start; i < end; ++i) {
@@ -130,11 +128,16 @@ class GroupEmbeddingVarLookupGradCpuOp : public OpKernel {
 // #endif
           }
         };
-        Shard(worker_threads->num_threads, worker_threads->workers, unique_nnz,
-              slice_bytes /*cost*/,
-              embedding_var_grad_combiner);
+        combiners[i] = embedding_var_grad_combiner;
       }
     }
+    // Every unique key costs one row of `dimension_`, so all lookups of the
+    // group are cut into tasks of the same number of rows.
+    const int64 dimension = dimension_;
+    RunGroupEmbeddingTasks(
+        worker_threads, unique_nnzs,
+        [dimension](int t, int64 r) -> int64 { return r * dimension; },
+        combiners);
   }
 
  private:
@@ -168,6 +171,8 @@ class GroupVariableLookupGradCpuOp : public OpKernel {
 
   void Compute(OpKernelContext* ctx) override {
     auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+    std::vector<int64> unique_nnzs(num_lookups_);
+    std::vector<std::function<void(int64, int64)>> combiners(num_lookups_);
     for (int i = 0; i < num_lookups_; ++i) {
       const Tensor grads_tensor = ctx->input(i);
       auto* grads = grads_tensor.flat<TValue>().data();
@@ -175,6 +180,7 @@ class GroupVariableLookupGradCpuOp : public OpKernel {
       const Tensor unique_keys_tensor = ctx->input(2 * num_lookups_ + i);
       auto* unique_keys = unique_keys_tensor.flat<TKey>().data();
       int unique_nnz = unique_keys_tensor.NumElements();
+      unique_nnzs[i] = unique_nnz;
 
       const Tensor sp_indices_tensor = ctx->input(3 * num_lookups_ + i);
       auto* sp_indices = sp_indices_tensor.flat<int64>().data();
@@ -188,9 +194,8 @@ class GroupVariableLookupGradCpuOp : public OpKernel {
                                                &grads_sp_values_tensor));
       TValue* grads_sp_values = grads_sp_values_tensor->flat<TValue>().data();
 
-      int slice_bytes = unique_nnz * dimension_ * 1000;
       if (combiner_ == "mean") {
-        auto embedding_var_grad_combiner = [this, &grads_sp_values, sp_indices,
+        auto embedding_var_grad_combiner = [this, grads_sp_values, sp_indices,
                                             grads, batch_nums](int64 start,
                                                                int64 end) {
           for (int64 i = start; i < end; ++i) {
@@ -203,11 +208,9 @@ class GroupVariableLookupGradCpuOp : public OpKernel {
             }
           }
         };
-        Shard(worker_threads->num_threads, worker_threads->workers, unique_nnz,
-              slice_bytes /*cost*/,
-              embedding_var_grad_combiner);  // Parallel on batch
+        combiners[i] = embedding_var_grad_combiner;
       } else if (combiner_ == "sum") {
-        auto embedding_var_grad_combiner = [this, &grads_sp_values, sp_indices,
+        auto embedding_var_grad_combiner = [this, grads_sp_values, sp_indices,
                                             grads, batch_nums](int64 start,
                                                                int64 end) {
           for (int64 i = start; i < end; ++i) {
@@ -217,11 +220,9 @@ class GroupVariableLookupGradCpuOp : public OpKernel {
                    sizeof(TValue) * dimension_);
           }
         };
-        Shard(worker_threads->num_threads, worker_threads->workers, unique_nnz,
-              slice_bytes /*cost*/,
-              embedding_var_grad_combiner);  // Parallel on batch
+        combiners[i] = embedding_var_grad_combiner;
       } else {
-        auto embedding_var_grad_combiner = [this, &grads_sp_values, sp_indices,
+        auto embedding_var_grad_combiner = [this, grads_sp_values, sp_indices,
                                             grads, batch_nums](int64 start,
                                                                int64 end) {
           for (int64 i = start; i < end; ++i) {
@@ -234,11 +235,16 @@ class GroupVariableLookupGradCpuOp : public OpKernel {
             }
           }
         };
-        Shard(worker_threads->num_threads, worker_threads->workers, unique_nnz,
-              slice_bytes /*cost*/,
-              embedding_var_grad_combiner);  // Parallel on batch
+        combiners[i] = embedding_var_grad_combiner;
       }
     }
+    // Every unique key costs one row of `dimension_`, so all lookups of the
+    // group are cut into tasks of the same number of rows.
+    const int64 dimension = dimension_;
+    RunGroupEmbeddingTasks(
+        worker_threads, unique_nnzs,
+        [dimension](int t, int64 r) -> int64 { return r * dimension; },
+        combiners);
   }
 
  private:
@@ -13,6 +13,7 @@ limitations under the License.
 #define EIGEN_USE_THREADS
 
 #include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/kernels/group_embedding/group_embedding_work_queue.h"
 #include "tensorflow/core/kernels/training_op_helpers.h"
 #include "tensorflow/core/kernels/unique_ali_op_util.h"
 
@@ -43,6 +44,26 @@ class GroupLookupBaseCpuOp : public OpKernel {
   }
 
  protected:
+  // Runs `combiners[t]` over the segments of every lookup `t`. The
+  // (table, segment) space is cut into tasks of about the same number of
+  // pooled ids, which are balanced across the worker threads by a
+  // work-stealing queue instead of sharding each table on its own.
+  void RunCombiners(
+      OpKernelContext* ctx, const std::vector<const int*>& batch_nums,
+      const std::vector<int64>& batch_sizes,
+      const std::vector<std::function<void(int64, int64)>>& combiners) {
+    auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+    const int dimension = m_dimension;
+    // A segment costs its pooled ids plus the write of the output row.
+    // `batch_nums` holds the running count of ids, so the cost of the
+    // first `r` segments is read off without a pass over the segments.
+    auto cum_cost = [&batch_nums, dimension](int t, int64 r) -> int64 {
+      const int64 ids = r == 0 ? 0 : batch_nums[t][r - 1];
+      return (ids + r) * dimension;
+    };
+    RunGroupEmbeddingTasks(worker_threads, batch_sizes, cum_cost, combiners);
+  }
+
   // float max_norm_;
   int m_num_lookup;
   int m_dimension;
@@ -51,7 +51,11 @@ class GroupEmbeddingVariableLookupCpuOp
       step 2: doing unique value gather
       step 3: assign unique embedding to batch result and pooling
     */
-    auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+    std::vector<Tensor> unique_embeddings(m_num_lookup);
+    std::vector<std::vector<TValue>> default_weights_list(m_num_lookup);
+    std::vector<const int *> batch_nums_list(m_num_lookup);
+    std::vector<int64> batch_sizes(m_num_lookup);
+    std::vector<std::function<void(int64, int64)>> combiners(m_num_lookup);
 
     for (int i = 0; i < m_num_lookup; ++i) {
       EmbeddingVar<TKey, TValue> *embedding_var = nullptr;
@@ -110,9 +114,11 @@ class GroupEmbeddingVariableLookupCpuOp
       for (int k = 1; k < batch_size; ++k) {
         batch_nums[k] += batch_nums[k - 1];
       }
+      batch_nums_list[i] = batch_nums;
+      batch_sizes[i] = batch_size;
 
       // Stage 2
-      Tensor unique_embedding;
+      Tensor &unique_embedding = unique_embeddings[i];
       unique_shape.AppendShape({static_cast<int64>(m_dimension)});
       AllocatorAttributes attr;
       attr.set_on_host(true);
@@ -129,7 +135,8 @@ class GroupEmbeddingVariableLookupCpuOp
         embedding_var->UpdateCache(unique_tensor, unique_counter, true/*called_by_gather*/);
       }
 
-      std::vector<TValue> default_weights(nnz, 1.0);
+      std::vector<TValue> &default_weights = default_weights_list[i];
+      default_weights.assign(nnz, 1.0);
       TValue *sp_weights = default_weights.data();
       if (!this->m_ignore_weights) {
         const Tensor &sp_weights_tensor =
@@ -154,10 +161,9 @@ class GroupEmbeddingVariableLookupCpuOp
                                                &gather_embedding_tensor));
       auto gather_embedding = gather_embedding_tensor->flat<TValue>().data();
 
-      int slice_bytes = nnz / batch_size * m_dimension * 1000;
       // todo: clean these redundant code
       if (this->m_combiner == "mean") {
-        auto embedding_var_mean_combiner = [this, &gather_embedding, batch_nums,
+        auto embedding_var_mean_combiner = [this, gather_embedding, batch_nums,
                                             unique_idx, unique,
                                             unique_embedding_data, sp_weights](
                                                int64 start, int64 end) {
@@ -223,10 +229,9 @@ class GroupEmbeddingVariableLookupCpuOp
 #endif
           }
         };
-        Shard(worker_threads->num_threads, worker_threads->workers, batch_size,
-              slice_bytes /*cost*/, embedding_var_mean_combiner);
+        combiners[i] = embedding_var_mean_combiner;
       } else if (this->m_combiner == "sum") {
-        auto embedding_var_sum_combiner = [this, &gather_embedding, batch_nums,
+        auto embedding_var_sum_combiner = [this, gather_embedding, batch_nums,
                                            unique_idx, unique,
                                            unique_embedding_data,
                                            sp_weights](int64 start, int64 end) {
@@ -280,10 +285,9 @@ class GroupEmbeddingVariableLookupCpuOp
 #endif
           }
         };
-        Shard(worker_threads->num_threads, worker_threads->workers, batch_size,
-              slice_bytes /*cost*/, embedding_var_sum_combiner);
+        combiners[i] = embedding_var_sum_combiner;
       } else {
-        auto embedding_var_sqrtn_combiner = [this, &gather_embedding,
+        auto embedding_var_sqrtn_combiner = [this, gather_embedding,
                                              batch_nums, unique_idx, unique,
                                              unique_embedding_data, sp_weights](
                                                 int64 start, int64 end) {
@@ -359,10 +363,12 @@ class GroupEmbeddingVariableLookupCpuOp
 #endif
           }
         };
-        Shard(worker_threads->num_threads, worker_threads->workers, batch_size,
-              slice_bytes /*cost*/, embedding_var_sqrtn_combiner);
+        combiners[i] = embedding_var_sqrtn_combiner;
       }
     }
+    // Stage 3 of all lookups runs on one work-stealing queue, so that
+    // threads done with a small table help with the larger ones.
+    this->RunCombiners(ctx, batch_nums_list, batch_sizes, combiners);
   }
 };
 
@@ -386,7 +392,11 @@ class GroupVariableLookupCpuOp : public GroupLookupBaseCpuOp<TKey, TValue> {
       : GroupLookupBaseCpuOp<TKey, TValue>(c) {}
 
   void Compute(OpKernelContext *ctx) override {
-    auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+    std::vector<std::vector<TValue>> default_weights_list(m_num_lookup);
+    std::vector<const int *> batch_nums_list(m_num_lookup);
+    std::vector<int64> batch_sizes(m_num_lookup);
+    std::vector<std::function<void(int64, int64)>> combiners(m_num_lookup);
+
     for (int i = 0; i < m_num_lookup; ++i) {
       const Tensor &emb_variable_tensor = ctx->input(i);
       const Tensor &sp_values_tensor = ctx->input(m_num_lookup + i);
@@ -416,6 +426,8 @@ class GroupVariableLookupCpuOp : public GroupLookupBaseCpuOp<TKey, TValue> {
       for (int k = 1; k < batch_size; ++k) {
         batch_nums[k] += batch_nums[k - 1];
       }
+      batch_nums_list[i] = batch_nums;
+      batch_sizes[i] = batch_size;
 
       TensorShape emb_vectors_tensor_shape;
       // Special case for sequence categorical column output
@@ -448,7 +460,8 @@ class GroupVariableLookupCpuOp : public GroupLookupBaseCpuOp<TKey, TValue> {
       auto *unique = unique_tensor.flat<TKey>().data();
       auto *unique_idx = unique_idx_tensor.flat<int>().data();
 
-      std::vector<TValue> default_weights(nnz, 1.0);
+      std::vector<TValue> &default_weights = default_weights_list[i];
+      default_weights.assign(nnz, 1.0);
       TValue *sp_weights = default_weights.data();
       if (!this->m_ignore_weights) {
         const Tensor &sp_weights_tensor =
@@ -457,9 +470,8 @@ class GroupVariableLookupCpuOp : public GroupLookupBaseCpuOp<TKey, TValue> {
             const_cast<TValue *>(sp_weights_tensor.flat<TValue>().data());
       }
 
-      int slice_bytes = nnz / batch_size * m_dimension * 1000;
       if (this->m_combiner == "mean") {
-        auto do_var_mean = [this, &emb_vectors, batch_nums, unique_idx, unique,
+        auto do_var_mean = [this, emb_vectors, batch_nums, unique_idx, unique,
                             sp_weights,
                             embedding_variable](int64 start, int64 end) {
           for (int64 i = start; i < end; ++i) {
@@ -523,10 +535,9 @@ class GroupVariableLookupCpuOp : public GroupLookupBaseCpuOp<TKey, TValue> {
 #endif
           }
         };
-        Shard(worker_threads->num_threads, worker_threads->workers, batch_size,
-              slice_bytes /*cost*/, do_var_mean);
+        combiners[i] = do_var_mean;
       } else if (this->m_combiner == "sum") {
-        auto do_var_sum = [this, &emb_vectors, batch_nums, unique_idx, unique,
+        auto do_var_sum = [this, emb_vectors, batch_nums, unique_idx, unique,
                            sp_weights,
                            embedding_variable](int64 start, int64 end) {
           for (int64 i = start; i < end; ++i) {
@@ -579,10 +590,9 @@ class GroupVariableLookupCpuOp : public GroupLookupBaseCpuOp<TKey, TValue> {
 #endif
           }
         };
-        Shard(worker_threads->num_threads, worker_threads->workers, batch_size,
-              slice_bytes /*cost*/, do_var_sum);
+        combiners[i] = do_var_sum;
       } else {
-        auto do_var_sqrtn = [this, &emb_vectors, batch_nums, unique_idx, unique,
+        auto do_var_sqrtn = [this, emb_vectors, batch_nums, unique_idx, unique,
                              sp_weights,
                              embedding_variable](int64 start, int64 end) {
           for (int64 i = start; i < end; ++i) {
@@ -654,10 +664,12 @@ class GroupVariableLookupCpuOp : public GroupLookupBaseCpuOp<TKey, TValue> {
 #endif
           }
         };
-        Shard(worker_threads->num_threads, worker_threads->workers, batch_size,
-              slice_bytes /*cost*/, do_var_sqrtn);
+        combiners[i] = do_var_sqrtn;
       }
     }
+    // Stage 3 of all lookups runs on one work-stealing queue, so that
+    // threads done with a small table help with the larger ones.
+    this->RunCombiners(ctx, batch_nums_list, batch_sizes, combiners);
   }
 };
 
@@ -0,0 +1,228 @@
+/* Copyright 2022 The DeepRec Authors. All Rights Reserved.
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+    http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+=======================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_GROUP_EMBEDDING_GROUP_EMBEDDING_WORK_QUEUE_H_
+#define TENSORFLOW_CORE_KERNELS_GROUP_EMBEDDING_GROUP_EMBEDDING_WORK_QUEUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/device_base.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// A unit of work of a GroupEmbedding CPU kernel: rows [begin, end) of
+// lookup `table`. For the forward kernels a row is an output segment, for
+// the backward kernels a row is an unique key.
+struct GroupEmbeddingTask {
+  int table;
+  int64 begin;
+  int64 end;
+};
+
+// Splits the rows of every table into tasks of roughly `target_cost`.
+// `cum_cost(table, r)` returns the cost of rows [0, r) of a table and must
+// be non-decreasing in `r`, so that a table with 10x more ids per segment
+// is cut into 10x more tasks. The cuts are found by binary search, which
+// costs O(log(rows)) per task instead of a pass over every row.
+template <typename CumCost>
+void PartitionGroupEmbeddingTasks(const std::vector<int64>& num_rows,
+                                  const CumCost& cum_cost, int64 target_cost,
+                                  std::vector<GroupEmbeddingTask>* tasks) {
+  target_cost = std::max(target_cost, static_cast<int64>(1));
+  for (int t = 0; t < static_cast<int>(num_rows.size()); ++t) {
+    const int64 rows = num_rows[t];
+    int64 begin = 0;
+    while (begin < rows) {
+      const int64 target = cum_cost(t, begin) + target_cost;
+      // Smallest end in (begin, rows] with cum_cost(t, end) >= target.
+      int64 lo = begin + 1;
+      int64 hi = rows;
+      while (lo < hi) {
+        const int64 mid = lo + (hi - lo) / 2;
+        if (cum_cost(t, mid) >= target) {
+          hi = mid;
+        } else {
+          lo = mid + 1;
+        }
+      }
+      tasks->push_back({t, begin, lo});
+      begin = lo;
+    }
+  }
+}
+
+// Lock-free work-stealing queue over a fixed set of tasks. Every worker owns
+// a contiguous range of tasks, to keep the rows touched by one worker close
+// together, and takes tasks from the front of it. A worker whose range runs
+// dry steals the back half of the largest range of the other workers, so
+// that a worker stuck on expensive tasks hands over the rest of its range.
+//
+// A range [head, tail) is packed into one 64-bit word, so that the owner and
+// the thieves agree on it with a single compare-and-swap.
+class GroupEmbeddingWorkQueue {
+ public:
+  GroupEmbeddingWorkQueue(std::vector<GroupEmbeddingTask> tasks,
+                          int num_workers)
+      : tasks_(std::move(tasks)),
+        num_workers_(std::max(1, num_workers)),
+        ranges_(new Range[num_workers_]) {
+    const int64 num_tasks = tasks_.size();
+    const int64 block_size = (num_tasks + num_workers_ - 1) / num_workers_;
+    for (int w = 0; w < num_workers_; ++w) {
+      ranges_[w].bounds.store(Pack(std::min(num_tasks, w * block_size),
+                                   std::min(num_tasks, (w + 1) * block_size)),
+                              std::memory_order_relaxed);
+    }
+  }
+
+  // Returns false when no task is left in the queue.
+  bool Pop(int worker, GroupEmbeddingTask* task) {
+    std::atomic<uint64>& own = ranges_[worker].bounds;
+    uint64 bounds = own.load(std::memory_order_acquire);
+    while (Head(bounds) < Tail(bounds)) {
+      if (own.compare_exchange_weak(bounds,
+                                    Pack(Head(bounds) + 1, Tail(bounds)),
+                                    std::memory_order_acq_rel)) {
+        *task = tasks_[Head(bounds)];
+        return true;
+      }
+    }
+    return Steal(worker, task);
+  }
+
+  // Runs `fn` on every task with up to `max_workers` threads from
+  // `thread_pool`, the calling thread included, and waits for completion.
+  static void Run(std::vector<GroupEmbeddingTask> tasks,
+                  thread::ThreadPool* thread_pool, int max_workers,
+                  const std::function<void(const GroupEmbeddingTask&)>& fn) {
+    if (tasks.empty()) return;
+    const int num_workers =
+        std::max(1, std::min<int>(max_workers, tasks.size()));
+    GroupEmbeddingWorkQueue queue(std::move(tasks), num_workers);
+    auto work = [&queue, &fn](int worker) {
+      GroupEmbeddingTask task;
+      while (queue.Pop(worker, &task)) {
+        fn(task);
+      }
+    };
+    BlockingCounter counter(num_workers - 1);
+    for (int w = 1; w < num_workers; ++w) {
+      thread_pool->Schedule([&work, &counter, w]() {
+        work(w);
+        counter.DecrementCount();
+      });
+    }
+    // Run the first worker in current thread.
+    work(0);
+    counter.Wait();
+  }
+
+ private:
+  static uint64 Pack(int64 head, int64 tail) {
+    return (static_cast<uint64>(head) << 32) | static_cast<uint64>(tail);
+  }
+  static int64 Head(uint64 bounds) { return bounds >> 32; }
+  static int64 Tail(uint64 bounds) { return bounds & 0xffffffffu; }
+
+  // Moves the back half of the largest range of the other workers to the
+  // range of `worker`, and takes the first task of it. Only called when the
+  // range of `worker` is empty, so no thief touches it meanwhile.
+  bool Steal(int worker, GroupEmbeddingTask* task) {
+    while (true) {
+      int victim = -1;
+      uint64 victim_bounds = 0;
+      int64 victim_size = 0;
+      for (int i = 1; i < num_workers_; ++i) {
+        const int w = (worker + i) % num_workers_;
+        const uint64 bounds =
+            ranges_[w].bounds.load(std::memory_order_acquire);
+        const int64 size = Tail(bounds) - Head(bounds);
+        if (size > victim_size) {
+          victim = w;
+          victim_bounds = bounds;
+          victim_size = size;
+        }
+      }
+      if (victim < 0) {
+        // Tasks in flight between two ranges are run by their thief.
+        return false;
+      }
+      const int64 mid = Tail(victim_bounds) - (victim_size + 1) / 2;
+      if (!ranges_[victim].bounds.compare_exchange_strong(
+              victim_bounds, Pack(Head(victim_bounds), mid),
+              std::memory_order_acq_rel)) {
+        continue;
+      }
+      ranges_[worker].bounds.store(Pack(mid + 1, Tail(victim_bounds)),
+                                   std::memory_order_release);
+      *task = tasks_[mid];
+      return true;
+    }
+  }
+
+  // Padded to a cache line so that workers do not false share ranges.
+  struct Range {
+    std::atomic<uint64> bounds;
+    char padding[64 - sizeof(std::atomic<uint64>)];
+  };
+
+  const std::vector<GroupEmbeddingTask> tasks_;
+  const int num_workers_;
+  std::unique_ptr<Range[]> ranges_;
+};
+
+// Number of tasks each worker thread gets on average, the slack is what
+// lets fast workers steal from slow ones.
+constexpr int64 kGroupEmbeddingTasksPerWorker = 4;
+// Lower bound of the cost of a task, in number of embedding elements.
+constexpr int64 kGroupEmbeddingMinTaskCost = 8192;
+
+inline int64 GroupEmbeddingTargetTaskCost(int64 total_cost, int num_workers) {
+  return std::max(kGroupEmbeddingMinTaskCost,
+                  total_cost / (std::max(1, num_workers) *
+                                kGroupEmbeddingTasksPerWorker));
+}
+
+// Runs `fns[t](begin, end)` over the `num_rows[t]` rows of every table `t`
+// on the CPU worker threads. `cum_cost(t, r)` is the cost of rows [0, r) of
+// table `t`, see PartitionGroupEmbeddingTasks().
+template <typename CumCost>
+void RunGroupEmbeddingTasks(
+    const DeviceBase::CpuWorkerThreads* worker_threads,
+    const std::vector<int64>& num_rows, const CumCost& cum_cost,
+    const std::vector<std::function<void(int64, int64)>>& fns) {
+  int64 total_cost = 0;
+  for (int t = 0; t < static_cast<int>(num_rows.size()); ++t) {
+    total_cost += cum_cost(t, num_rows[t]);
+  }
+  std::vector<GroupEmbeddingTask> tasks;
+  PartitionGroupEmbeddingTasks(
+      num_rows, cum_cost,
+      GroupEmbeddingTargetTaskCost(total_cost, worker_threads->num_threads),
+      &tasks);
+  GroupEmbeddingWorkQueue::Run(
+      std::move(tasks), worker_threads->workers, worker_threads->num_threads,
+      [&fns](const GroupEmbeddingTask& task) {
+        fns[task.table](task.begin, task.end);
+      });
+}
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_GROUP_EMBEDDING_GROUP_EMBEDDING_WORK_QUEUE_H_
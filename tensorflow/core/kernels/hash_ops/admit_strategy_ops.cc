@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/function.h"
 #include "tensorflow/core/framework/hash_table/bloom_filter_strategy.h"
+#include "tensorflow/core/framework/hash_table/decayed_count_strategy.h"
 #include "tensorflow/core/framework/hash_table/status_collector.h"
 #include "tensorflow/core/framework/hash_table/hash_table.h"
 #include "tensorflow/core/framework/op_kernel.h"
@@ -75,6 +76,49 @@ class BloomFilterInitializeOp : public OpKernel {
   bool initialized_;
 };
 
+class DecayedCountInitializeOp : public OpKernel {
+ public:
+  explicit DecayedCountInitializeOp(OpKernelConstruction* context)
+    : OpKernel(context) {
+    OP_REQUIRES_OK(context, context->GetAttr("threshold", &threshold_));
+    OP_REQUIRES_OK(context, context->GetAttr("half_life", &half_life_));
+    OP_REQUIRES_OK(context, context->GetAttr("num_hash_func", &num_hash_func_));
+    OP_REQUIRES_OK(context, context->GetAttr("slice_offset", &slice_offset_));
+    OP_REQUIRES_OK(context, context->GetAttr("max_slice_size", &max_slice_size_));
+    OP_REQUIRES_OK(context, context->GetAttr("shape", &shape_));
+    OP_REQUIRES_OK(context, context->GetAttr("initialized", &initialized_));
+    OP_REQUIRES(context, shape_.dims() == 2,
+                errors::InvalidArgument("Invalid shape, must be 2-dimensional"));
+    OP_REQUIRES(context, num_hash_func_ > 0,
+                errors::InvalidArgument("num_hash_func must be positive"));
+  }
+  void Compute(OpKernelContext* ctx) override {
+    HashTableAdmitStrategyResource* resource;
+    OP_REQUIRES_OK(
+        ctx,
+        LookupOrCreateResource<HashTableAdmitStrategyResource>(
+          ctx, HandleFromInput(ctx, 0), &resource,
+          [this](HashTableAdmitStrategyResource** ptr) {
+            *ptr = new HashTableAdmitStrategyResource;
+            return Status::OK();
+          }));
+    core::ScopedUnref s(resource);
+    resource->CreateInternal(
+        new DecayedCountAdmitStrategy(
+          threshold_, half_life_, num_hash_func_, shape_,
+          slice_offset_, max_slice_size_));
+    resource->SetInitialized(initialized_);
+  }
+ private:
+  float threshold_;
+  float half_life_;
+  int64 num_hash_func_;
+  int64 slice_offset_;
+  int64 max_slice_size_;
+  TensorShape shape_;
+  bool initialized_;
+};
+
 class BloomFilterIsInitializedOp : public OpKernel {
  public:
   explicit BloomFilterIsInitializedOp(OpKernelConstruction* context)
@@ -117,24 +161,24 @@ class BloomFilterAdmitOp : public AsyncOpKernel {
         ctx, ctx->allocate_output(0, freqs_tensor.shape(), &output_tensor), done);
     auto keys = keys_tensor.flat<int64>();
     auto output = output_tensor->flat<bool>();
-    for (size_t i = 0; i < freqs_tensor.NumElements(); ++i) {
+    std::vector<int64> freqs(freqs_tensor.NumElements());
+    for (size_t i = 0; i < freqs.size(); ++i) {
       switch(freqs_tensor.dtype()) {
         case DT_UINT8:
-          output(i) = strategy->Admit(keys(i), static_cast<int64>(
-                  freqs_tensor.flat<uint8>()(i)));
+          freqs[i] = static_cast<int64>(freqs_tensor.flat<uint8>()(i));
           break;
         case DT_UINT16:
-          output(i) = strategy->Admit(keys(i), static_cast<int64>(
-                  freqs_tensor.flat<uint16>()(i)));
+          freqs[i] = static_cast<int64>(freqs_tensor.flat<uint16>()(i));
           break;
         case DT_UINT32:
-          output(i) = strategy->Admit(keys(i), static_cast<int64>(
-                  freqs_tensor.flat<uint32>()(i)));
+          freqs[i] = static_cast<int64>(freqs_tensor.flat<uint32>()(i));
           break;
         default:
           LOG(FATAL) << "Unknown data type " << freqs_tensor.dtype();
       }
     }
+    strategy->AdmitBatch(keys.data(), freqs.data(), freqs.size(),
+                         output.data());
     done();
   }
 };
@@ -145,6 +189,9 @@ REGISTER_KERNEL_BUILDER(Name("BloomFilterAdmitStrategyOp")                    \
 REGISTER_KERNEL_BUILDER(Name("BloomFilterInitializeOp")                       \
                             .Device(DEVICE_CPU),                              \
                         BloomFilterInitializeOp);
+REGISTER_KERNEL_BUILDER(Name("DecayedCountInitializeOp")                      \
+                            .Device(DEVICE_CPU),                              \
+                        DecayedCountInitializeOp);
 REGISTER_KERNEL_BUILDER(Name("BloomFilterIsInitializedOp")                    \
                             .Device(DEVICE_CPU),                              \
                         BloomFilterIsInitializedOp);
@@ -13,6 +13,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+#include <cmath>
+
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
@@ -340,6 +343,262 @@ class TensibleVariableGatherOp : public AsyncOpKernel {
   }
 };
 
+// Fetches the slice of every id into dst, the default value for ids which
+// were not admitted.
+template<typename T>
+Status GatherSlices(TensibleVariable* tensible_variable, const int64* ids,
+                    int64 size, int64 slice, T default_value, T* dst) {
+  tf_shared_lock rlock(*(tensible_variable->GetRWLock()));
+  int64 max_id = tensible_variable->Size();
+  for (int64 i = 0; i < size; i++) {
+    if (ids[i] != HashTable::kNotAdmitted) {
+      if (ids[i] < 0 || ids[i] >= max_id) {
+        return errors::InvalidArgument("Id Out of range ", ids[i]);
+      }
+      memcpy(dst, tensible_variable->GetSlice(ids[i]), slice * sizeof(T));
+    } else {
+      for (int j = 0; j < slice; j++) {
+        dst[j] = default_value;
+      }
+    }
+    dst += slice;
+  }
+  return Status::OK();
+}
+
+// Maps keys to ids with the HashTable and gathers their slices in the same
+// kernel, without handing the ids to a TensibleVariableGather.
+template<typename T>
+class HashTableLookupAndGatherOp : public AsyncOpKernel {
+ public:
+  explicit HashTableLookupAndGatherOp(OpKernelConstruction* c)
+      : AsyncOpKernel(c) {
+  }
+
+  void ComputeAsync(OpKernelContext* ctx, DoneCallback done) override {
+    TensibleVariableResource* resource;
+    OP_REQUIRES_OK_ASYNC(
+        ctx, LookupResource(ctx, HandleFromInput(ctx, 0), &resource), done);
+    core::ScopedUnref s(resource);
+    HashTableResource* table_resource;
+    OP_REQUIRES_OK_ASYNC(
+        ctx, LookupResource(ctx, HandleFromInput(ctx, 1), &table_resource),
+        done);
+    core::ScopedUnref s2(table_resource);
+    TensibleVariable* tensible_variable = resource->Internal();
+    OP_REQUIRES_ASYNC(
+        ctx, tensible_variable != nullptr,
+        errors::FailedPrecondition("TensibleVariable is not initialized"), done);
+    OP_REQUIRES_ASYNC(
+        ctx, DataTypeToEnum<T>::value == tensible_variable->dtype(),
+        errors::FailedPrecondition("TensibleVariable dtype mismatch"), done);
+    HashTable* table = table_resource->Internal();
+    OP_REQUIRES_ASYNC(
+        ctx, table != nullptr,
+        errors::FailedPrecondition("HashTable is not initialized"), done);
+    Tensor keys_tensor = ctx->input(2);
+    Tensor default_value_tensor = ctx->input(3);
+    OP_REQUIRES_ASYNC(ctx, default_value_tensor.shape().dims() == 0,
+        errors::InvalidArgument("default_value should be scalar"), done);
+    T default_value = default_value_tensor.scalar<T>()();
+    int64 size, slice;
+    TensorShape out_shape;
+    BuildGatherShape(tensible_variable->shape(), keys_tensor.shape(),
+                     &out_shape, &slice, &size);
+    Tensor* ids_tensor = nullptr;
+    OP_REQUIRES_OK_ASYNC(
+        ctx, ctx->allocate_output(0, keys_tensor.shape(), &ids_tensor), done);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK_ASYNC(ctx, ctx->allocate_output(1, out_shape, &output), done);
+    if (size == 0) {
+      done();
+      return;
+    }
+    int64* keys = reinterpret_cast<int64*>(const_cast<char*>(
+          keys_tensor.tensor_data().data()));
+    int64* ids = reinterpret_cast<int64*>(const_cast<char*>(
+          ids_tensor->tensor_data().data()));
+    T* dst = reinterpret_cast<T*>(const_cast<char*>(
+          output->tensor_data().data()));
+    resource->Ref();
+    table_resource->Ref();
+    auto done_fn = [done, ctx, resource, table_resource](Status st) {
+      resource->Unref();
+      table_resource->Unref();
+      OP_REQUIRES_OK_ASYNC(ctx, st, done);
+      done();
+    };
+    auto fn = [tensible_variable, ids, slice, dst, default_value]
+        (int64 offset, int64 size) -> Status {
+      return GatherSlices(tensible_variable, ids + offset, size, slice,
+                          default_value, dst + offset * slice);
+    };
+    table->GetIds(keys, nullptr, ids, size, nullptr, ctx->runner(),
+        [ctx, size, fn, done_fn] (Status st) {
+      if (!st.ok()) {
+        done_fn(st);
+        return;
+      }
+      ParrellRun(size, kIdBlockSize, *ctx->runner(), fn, done_fn);
+    });
+  }
+};
+
+enum class LookupCombiner { kSum, kMean, kSqrtN };
+
+// Like HashTableLookupAndGatherOp, but reduces the slices of each segment
+// while gathering them. segment_ids must be sorted.
+template<typename T, typename Tsegment>
+class HashTableLookupAndCombineOp : public AsyncOpKernel {
+ public:
+  explicit HashTableLookupAndCombineOp(OpKernelConstruction* c)
+      : AsyncOpKernel(c) {
+    string combiner;
+    OP_REQUIRES_OK(c, c->GetAttr("combiner", &combiner));
+    if (combiner == "sum") {
+      combiner_ = LookupCombiner::kSum;
+    } else if (combiner == "mean") {
+      combiner_ = LookupCombiner::kMean;
+    } else {
+      combiner_ = LookupCombiner::kSqrtN;
+    }
+  }
+
+  void ComputeAsync(OpKernelContext* ctx, DoneCallback done) override {
+    TensibleVariableResource* resource;
+    OP_REQUIRES_OK_ASYNC(
+        ctx, LookupResource(ctx, HandleFromInput(ctx, 0), &resource), done);
+    core::ScopedUnref s(resource);
+    HashTableResource* table_resource;
+    OP_REQUIRES_OK_ASYNC(
+        ctx, LookupResource(ctx, HandleFromInput(ctx, 1), &table_resource),
+        done);
+    core::ScopedUnref s2(table_resource);
+    TensibleVariable* tensible_variable = resource->Internal();
+    OP_REQUIRES_ASYNC(
+        ctx, tensible_variable != nullptr,
+        errors::FailedPrecondition("TensibleVariable is not initialized"), done);
+    OP_REQUIRES_ASYNC(
+        ctx, DataTypeToEnum<T>::value == tensible_variable->dtype(),
+        errors::FailedPrecondition("TensibleVariable dtype mismatch"), done);
+    HashTable* table = table_resource->Internal();
+    OP_REQUIRES_ASYNC(
+        ctx, table != nullptr,
+        errors::FailedPrecondition("HashTable is not initialized"), done);
+    Tensor keys_tensor = ctx->input(2);
+    Tensor segment_ids_tensor = ctx->input(3);
+    OP_REQUIRES_ASYNC(
+        ctx, keys_tensor.dims() == 1 &&
+             keys_tensor.shape() == segment_ids_tensor.shape(),
+        errors::InvalidArgument(
+            "keys and segment_ids should be vectors of the same size ",
+            keys_tensor.shape().DebugString(), " vs ",
+            segment_ids_tensor.shape().DebugString()), done);
+    int64 num_segments = ctx->input(4).scalar<int64>()();
+    OP_REQUIRES_ASYNC(ctx, num_segments >= 0,
+        errors::InvalidArgument("num_segments should be non-negative"), done);
+    Tensor default_value_tensor = ctx->input(5);
+    OP_REQUIRES_ASYNC(ctx, default_value_tensor.shape().dims() == 0,
+        errors::InvalidArgument("default_value should be scalar"), done);
+    T default_value = default_value_tensor.scalar<T>()();
+
+    int64 size = keys_tensor.NumElements();
+    const Tsegment* segment_ids = segment_ids_tensor.flat<Tsegment>().data();
+    for (int64 i = 0; i < size; i++) {
+      OP_REQUIRES_ASYNC(
+          ctx, segment_ids[i] >= 0 && segment_ids[i] < num_segments &&
+               (i == 0 || segment_ids[i - 1] <= segment_ids[i]),
+          errors::InvalidArgument(
+              "segment_ids should be sorted and in [0, ", num_segments,
+              "), got ", segment_ids[i], " at ", i), done);
+    }
+
+    int64 unused, slice;
+    TensorShape out_shape;
+    BuildGatherShape(tensible_variable->shape(), TensorShape({num_segments}),
+                     &out_shape, &slice, &unused);
+    Tensor* ids_tensor = nullptr;
+    OP_REQUIRES_OK_ASYNC(
+        ctx, ctx->allocate_output(0, keys_tensor.shape(), &ids_tensor), done);
+    Tensor* output = nullptr;
+    OP_REQUIRES_OK_ASYNC(ctx, ctx->allocate_output(1, out_shape, &output), done);
+    T* dst = reinterpret_cast<T*>(const_cast<char*>(
+          output->tensor_data().data()));
+    if (size == 0) {
+      std::fill(dst, dst + num_segments * slice, T(0));
+      done();
+      return;
+    }
+    int64* keys = reinterpret_cast<int64*>(const_cast<char*>(
+          keys_tensor.tensor_data().data()));
+    int64* ids = reinterpret_cast<int64*>(const_cast<char*>(
+          ids_tensor->tensor_data().data()));
+    resource->Ref();
+    table_resource->Ref();
+    auto done_fn = [done, ctx, resource, table_resource](Status st) {
+      resource->Unref();
+      table_resource->Unref();
+      OP_REQUIRES_OK_ASYNC(ctx, st, done);
+      done();
+    };
+    LookupCombiner combiner = combiner_;
+    // Every block owns a range of output segments and reduces the keys
+    // falling into it, so blocks never write the same row.
+    auto fn = [tensible_variable, ids, size, segment_ids, slice, dst,
+               default_value, combiner]
+        (int64 offset, int64 count) -> Status {
+      std::fill(dst + offset * slice, dst + (offset + count) * slice, T(0));
+      const Tsegment* begin = std::lower_bound(
+          segment_ids, segment_ids + size, offset);
+      const Tsegment* end = std::lower_bound(
+          begin, segment_ids + size, offset + count);
+      tf_shared_lock rlock(*(tensible_variable->GetRWLock()));
+      int64 max_id = tensible_variable->Size();
+      for (const Tsegment* seg = begin; seg < end; ) {
+        Tsegment segment = *seg;
+        T* row = dst + segment * slice;
+        int64 n = 0;
+        for (; seg < end && *seg == segment; ++seg, ++n) {
+          int64 id = ids[seg - segment_ids];
+          if (id == HashTable::kNotAdmitted) {
+            for (int64 j = 0; j < slice; j++) {
+              row[j] += default_value;
+            }
+            continue;
+          }
+          if (id < 0 || id >= max_id) {
+            return errors::InvalidArgument("Id Out of range ", id);
+          }
+          const T* src = tensible_variable->GetSlice<T>(id);
+          for (int64 j = 0; j < slice; j++) {
+            row[j] += src[j];
+          }
+        }
+        if (combiner == LookupCombiner::kSum || n <= 1) {
+          continue;
+        }
+        T scale = combiner == LookupCombiner::kMean ?
+            T(1) / n : T(1) / std::sqrt(static_cast<T>(n));
+        for (int64 j = 0; j < slice; j++) {
+          row[j] *= scale;
+        }
+      }
+      return Status::OK();
+    };
+    table->GetIds(keys, nullptr, ids, size, nullptr, ctx->runner(),
+        [ctx, num_segments, fn, done_fn] (Status st) {
+      if (!st.ok()) {
+        done_fn(st);
+        return;
+      }
+      ParrellRun(num_segments, kIdBlockSize, *ctx->runner(), fn, done_fn);
+    });
+  }
+
+ private:
+  LookupCombiner combiner_;
+};
+
 template <typename T, typename Functor>
 class TensibleVariableSimpleUpdaterOp : public AsyncOpKernel {
  public:
@@ -460,6 +719,26 @@ REGISTER_KERNEL_BUILDER(
 TF_CALL_NUMBER_TYPES(REGISTER_KERNELS);
 #undef REGISTER_KERNELS
 
+#define REGISTER_KERNELS(type)                                  \
+  REGISTER_KERNEL_BUILDER(Name("HashTableLookupAndGather")      \
+                              .Device(DEVICE_CPU)               \
+                              .TypeConstraint<type>("dtype"),   \
+                          HashTableLookupAndGatherOp<type>);
+TF_CALL_NUMBER_TYPES(REGISTER_KERNELS);
+#undef REGISTER_KERNELS
+
+#define REGISTER_KERNELS(type, index_type)                                  \
+  REGISTER_KERNEL_BUILDER(Name("HashTableLookupAndCombine")                 \
+                              .Device(DEVICE_CPU)                           \
+                              .TypeConstraint<type>("dtype")                \
+                              .TypeConstraint<index_type>("Tsegmentids"),   \
+                          HashTableLookupAndCombineOp<type, index_type>);
+REGISTER_KERNELS(float, int32);
+REGISTER_KERNELS(float, int64);
+REGISTER_KERNELS(double, int32);
+REGISTER_KERNELS(double, int64);
+#undef REGISTER_KERNELS
+
 #define REGISTER_KERNELS(type)                                  \
   REGISTER_KERNEL_BUILDER(Name("TensibleVariableScatterUpdate") \
                               .Device(DEVICE_CPU)               \
@@ -0,0 +1,189 @@
+/* Copyright 2023 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/lease_coordinator.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/lib/core/errors.h"
+
+namespace tensorflow {
+
+LocalLeaseCoordinator::LocalLeaseCoordinator(
+    const std::vector<RowRange>& ranges, int64 chunk_rows,
+    int64 max_lease_rows)
+    : chunk_rows_(std::max<int64>(chunk_rows, 1)),
+      max_lease_rows_(max_lease_rows) {
+  mutex_lock l(mu_);
+  Reset(ranges);
+}
+
+Status LocalLeaseCoordinator::GetNext(const string& consumer, RowRange* range,
+                                      bool* end_of_sequence) {
+  mutex_lock l(mu_);
+  RowRange& lease = leases_[consumer];
+  if (lease.empty()) {
+    if (!pending_.empty()) {
+      CutLease(&lease);
+    } else if (!SplitLease(consumer, &lease)) {
+      *end_of_sequence = true;
+      return Status::OK();
+    }
+  }
+  *end_of_sequence = false;
+  if (lease.end < 0) {
+    *range = std::move(lease);
+    lease = RowRange();
+    return Status::OK();
+  }
+  range->file = lease.file;
+  range->start = lease.start;
+  range->end = std::min(lease.start + chunk_rows_, lease.end);
+  lease.start = range->end;
+  return Status::OK();
+}
+
+Status LocalLeaseCoordinator::Save(std::vector<RowRange>* ranges) {
+  mutex_lock l(mu_);
+  ranges->clear();
+  for (const auto& it : leases_) {
+    if (!it.second.empty()) {
+      ranges->push_back(it.second);
+    }
+  }
+  ranges->insert(ranges->end(), pending_.begin(), pending_.end());
+  return Status::OK();
+}
+
+Status LocalLeaseCoordinator::Restore(const std::vector<RowRange>& ranges) {
+  for (const RowRange& r : ranges) {
+    if (r.end >= 0 && (r.start < 0 || r.start > r.end)) {
+      return errors::InvalidArgument("Invalid rows [", r.start, ", ", r.end,
+                                     ") of ", r.file);
+    }
+  }
+  mutex_lock l(mu_);
+  Reset(ranges);
+  return Status::OK();
+}
+
+Status LocalLeaseCoordinator::GetLease(const string& consumer,
+                                       RowRange* lease) {
+  mutex_lock l(mu_);
+  auto it = leases_.find(consumer);
+  *lease = it == leases_.end() ? RowRange() : it->second;
+  return Status::OK();
+}
+
+Status LocalLeaseCoordinator::Reacquire(const string& consumer,
+                                        const RowRange& lease) {
+  mutex_lock l(mu_);
+  RowRange& current = leases_[consumer];
+  if (!current.empty()) {
+    // Released rows are leased first.
+    num_pending_rows_ += current.end - current.start;
+    pending_.push_front(std::move(current));
+  }
+  current = RowRange();
+  if (lease.empty() || lease.end < 0) {
+    return Status::OK();
+  }
+  for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+    if (it->file != lease.file || it->end < 0 || it->start > lease.start ||
+        it->end < lease.end) {
+      continue;
+    }
+    // Cuts the lease out of the pending range.
+    RowRange tail;
+    tail.file = it->file;
+    tail.start = lease.end;
+    tail.end = it->end;
+    it->end = lease.start;
+    if (it->empty()) {
+      it = pending_.erase(it);
+    } else {
+      ++it;
+    }
+    if (!tail.empty()) {
+      pending_.insert(it, std::move(tail));
+    }
+    num_pending_rows_ -= lease.end - lease.start;
+    current = lease;
+    return Status::OK();
+  }
+  return Status::OK();
+}
+
+void LocalLeaseCoordinator::Reset(const std::vector<RowRange>& ranges) {
+  pending_.clear();
+  leases_.clear();
+  num_pending_rows_ = 0;
+  for (const RowRange& r : ranges) {
+    if (r.empty()) {
+      continue;
+    }
+    pending_.push_back(r);
+    if (r.end >= 0) {
+      num_pending_rows_ += r.end - r.start;
+    }
+  }
+}
+
+void LocalLeaseCoordinator::CutLease(RowRange* lease) {
+  RowRange& front = pending_.front();
+  if (front.end < 0) {
+    *lease = std::move(front);
+    pending_.pop_front();
+    return;
+  }
+  int64 size = num_pending_rows_ / (2 * leases_.size());
+  if (max_lease_rows_ > 0) {
+    size = std::min(size, max_lease_rows_);
+  }
+  size = std::min(std::max(size, chunk_rows_), front.end - front.start);
+  lease->file = front.file;
+  lease->start = front.start;
+  lease->end = front.start + size;
+  front.start += size;
+  num_pending_rows_ -= size;
+  if (front.empty()) {
+    pending_.pop_front();
+  }
+}
+
+bool LocalLeaseCoordinator::SplitLease(const string& consumer,
+                                       RowRange* lease) {
+  RowRange* victim = nullptr;
+  for (auto& it : leases_) {
+    RowRange& other = it.second;
+    if (it.first != consumer && other.end >= 0 &&
+        other.end - other.start > chunk_rows_ &&
+        (victim == nullptr ||
+         other.end - other.start > victim->end - victim->start)) {
+      victim = &other;
+    }
+  }
+  if (victim == nullptr) {
+    return false;
+  }
+  const int64 size = (victim->end - victim->start) / 2;
+  lease->file = victim->file;
+  lease->start = victim->end - size;
+  lease->end = victim->end;
+  victim->end = lease->start;
+  return true;
+}
+
+}  // namespace tensorflow
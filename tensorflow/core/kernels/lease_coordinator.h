@@ -0,0 +1,123 @@
+/* Copyright 2023 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_KERNELS_LEASE_COORDINATOR_H_
+#define TENSORFLOW_CORE_KERNELS_LEASE_COORDINATOR_H_
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+
+// Rows [start, end) of a file. If number of rows of the file is unknown, end
+// is -1 and the range covers the whole file.
+struct RowRange {
+  string file;
+  int64 start = 0;
+  int64 end = -1;
+
+  bool empty() const { return end < 0 ? file.empty() : start >= end; }
+};
+
+// Coordinates leases of row ranges among consumers, e.g. input pipelines of
+// workers.
+//
+// Each consumer holds a lease of rows, from which it takes a chunk of rows at
+// a time. A consumer without a lease gets a new one, or splits the largest
+// lease of the others once all rows are leased, so that a consumer falling
+// behind hands over its untaken rows and no consumer idles at the tail.
+// Every row is taken exactly once.
+//
+// Implementations may share leases with consumers in other processes.
+class LeaseCoordinator : public ResourceBase {
+ public:
+  // Takes next chunk of rows for consumer, or sets end_of_sequence once all
+  // rows are taken.
+  virtual Status GetNext(const string& consumer, RowRange* range,
+                         bool* end_of_sequence) = 0;
+
+  // Gets rows not taken yet, including untaken rows of leases.
+  virtual Status Save(std::vector<RowRange>* ranges) = 0;
+
+  // Replaces rows not taken yet, and revokes all leases.
+  virtual Status Restore(const std::vector<RowRange>& ranges) = 0;
+
+  // Gets untaken rows of the lease of consumer, which is empty if consumer
+  // holds no lease.
+  virtual Status GetLease(const string& consumer, RowRange* lease) = 0;
+
+  // Releases the lease of consumer, then leases the rows of `lease` to it
+  // again if none of them is taken or leased to others. Otherwise the rows
+  // are left to others.
+  virtual Status Reacquire(const string& consumer, const RowRange& lease) = 0;
+};
+
+// A lease coordinator shared by consumers in the same process.
+//
+// Leases are cut from the front of the untaken rows, and shrink as the rows
+// run out: each lease has 1 / (2 * number of consumers) of the untaken rows,
+// at most `max_lease_rows` and at least `chunk_rows`.
+class LocalLeaseCoordinator : public LeaseCoordinator {
+ public:
+  LocalLeaseCoordinator(const std::vector<RowRange>& ranges, int64 chunk_rows,
+                        int64 max_lease_rows);
+
+  string DebugString() const override { return "LocalLeaseCoordinator"; }
+
+  Status GetNext(const string& consumer, RowRange* range,
+                 bool* end_of_sequence) override;
+
+  Status Save(std::vector<RowRange>* ranges) override;
+
+  Status Restore(const std::vector<RowRange>& ranges) override;
+
+  Status GetLease(const string& consumer, RowRange* lease) override;
+
+  Status Reacquire(const string& consumer, const RowRange& lease) override;
+
+ private:
+  void Reset(const std::vector<RowRange>& ranges)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Cuts a lease from the front of pending ranges.
+  void CutLease(RowRange* lease) EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Moves the second half of the largest lease of the other consumers to
+  // lease, returns false if no lease can be split.
+  bool SplitLease(const string& consumer, RowRange* lease)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const int64 chunk_rows_;
+  const int64 max_lease_rows_;
+  mutex mu_;
+  // Ranges not leased yet.
+  std::deque<RowRange> pending_ GUARDED_BY(mu_);
+  // Number of rows in pending ranges of known sizes.
+  int64 num_pending_rows_ GUARDED_BY(mu_) = 0;
+  // Untaken rows of the lease of each consumer.
+  std::map<string, RowRange> leases_ GUARDED_BY(mu_);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_LEASE_COORDINATOR_H_
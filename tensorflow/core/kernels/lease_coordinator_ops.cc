@@ -0,0 +1,280 @@
+/* Copyright 2023 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/kernels/lease_coordinator.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/refcount.h"
+#include "tensorflow/core/lib/strings/strcat.h"
+
+namespace tensorflow {
+
+namespace {
+
+Status RangesFromInputs(OpKernelContext* ctx, std::vector<RowRange>* ranges) {
+  const Tensor* files;
+  const Tensor* starts;
+  const Tensor* ends;
+  TF_RETURN_IF_ERROR(ctx->input("files", &files));
+  TF_RETURN_IF_ERROR(ctx->input("starts", &starts));
+  TF_RETURN_IF_ERROR(ctx->input("ends", &ends));
+  if (!TensorShapeUtils::IsVector(files->shape()) ||
+      files->shape() != starts->shape() || files->shape() != ends->shape()) {
+    return errors::InvalidArgument(
+        "files, starts and ends must be vectors of same size, got ",
+        files->shape().DebugString(), ", ", starts->shape().DebugString(),
+        " and ", ends->shape().DebugString());
+  }
+  const int64 num_ranges = files->NumElements();
+  ranges->resize(num_ranges);
+  for (int64 i = 0; i < num_ranges; ++i) {
+    RowRange& r = (*ranges)[i];
+    r.file = files->vec<string>()(i);
+    r.start = starts->vec<int64>()(i);
+    r.end = ends->vec<int64>()(i);
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+REGISTER_RESOURCE_HANDLE_KERNEL(LeaseCoordinator);
+REGISTER_KERNEL_BUILDER(
+    Name("LeaseCoordinatorIsInitialized").Device(DEVICE_CPU),
+    IsResourceInitialized<LeaseCoordinator>);
+
+class LeaseCoordinatorCreateOp : public OpKernel {
+ public:
+  explicit LeaseCoordinatorCreateOp(OpKernelConstruction* ctx)
+      : OpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("chunk_rows", &chunk_rows_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("max_lease_rows", &max_lease_rows_));
+  }
+
+  void Compute(OpKernelContext* ctx) override {
+    std::vector<RowRange> ranges;
+    OP_REQUIRES_OK(ctx, RangesFromInputs(ctx, &ranges));
+    LocalLeaseCoordinator* coordinator =
+        new LocalLeaseCoordinator({}, chunk_rows_, max_lease_rows_);
+    Status s = coordinator->Restore(ranges);
+    if (!s.ok()) {
+      coordinator->Unref();
+      OP_REQUIRES_OK(ctx, s);
+    }
+    s = CreateResource<LeaseCoordinator>(ctx, HandleFromInput(ctx, 0),
+                                         coordinator);
+    if (!s.ok() && s.code() != error::ALREADY_EXISTS) {
+      OP_REQUIRES(ctx, false, s);
+    }
+  }
+
+ private:
+  int64 chunk_rows_;
+  int64 max_lease_rows_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("LeaseCoordinatorCreate").Device(DEVICE_CPU),
+                        LeaseCoordinatorCreateOp);
+
+class LeaseCoordinatorRestoreOp : public OpKernel {
+ public:
+  explicit LeaseCoordinatorRestoreOp(OpKernelConstruction* ctx)
+      : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext* ctx) override {
+    core::RefCountPtr<LeaseCoordinator> coordinator;
+    OP_REQUIRES_OK(ctx,
+                   LookupResource(ctx, HandleFromInput(ctx, 0), &coordinator));
+    std::vector<RowRange> ranges;
+    OP_REQUIRES_OK(ctx, RangesFromInputs(ctx, &ranges));
+    OP_REQUIRES_OK(ctx, coordinator->Restore(ranges));
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("LeaseCoordinatorRestore").Device(DEVICE_CPU),
+                        LeaseCoordinatorRestoreOp);
+
+class LeaseCoordinatorSaveOp : public OpKernel {
+ public:
+  explicit LeaseCoordinatorSaveOp(OpKernelConstruction* ctx)
+      : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext* ctx) override {
+    core::RefCountPtr<LeaseCoordinator> coordinator;
+    OP_REQUIRES_OK(ctx,
+                   LookupResource(ctx, HandleFromInput(ctx, 0), &coordinator));
+    std::vector<RowRange> ranges;
+    OP_REQUIRES_OK(ctx, coordinator->Save(&ranges));
+    const TensorShape shape({static_cast<int64>(ranges.size())});
+    Tensor* files;
+    Tensor* starts;
+    Tensor* ends;
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(0, shape, &files));
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(1, shape, &starts));
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(2, shape, &ends));
+    for (size_t i = 0; i < ranges.size(); ++i) {
+      files->vec<string>()(i) = std::move(ranges[i].file);
+      starts->vec<int64>()(i) = ranges[i].start;
+      ends->vec<int64>()(i) = ranges[i].end;
+    }
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("LeaseCoordinatorSave").Device(DEVICE_CPU),
+                        LeaseCoordinatorSaveOp);
+
+namespace data {
+namespace {
+
+class LeaseDatasetOp : public DatasetOpKernel {
+ public:
+  explicit LeaseDatasetOp(OpKernelConstruction* ctx) : DatasetOpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("consumer", &consumer_));
+  }
+
+  void MakeDataset(OpKernelContext* ctx, DatasetBase** output) override {
+    core::RefCountPtr<LeaseCoordinator> coordinator;
+    OP_REQUIRES_OK(ctx,
+                   LookupResource(ctx, HandleFromInput(ctx, 0), &coordinator));
+    *output = new Dataset(ctx, ctx->input(0), coordinator.get(), consumer_);
+  }
+
+ private:
+  class Dataset : public DatasetBase {
+   public:
+    Dataset(OpKernelContext* ctx, const Tensor& resource_handle,
+            LeaseCoordinator* coordinator, const string& consumer)
+        : DatasetBase(DatasetContext(ctx)),
+          resource_handle_(resource_handle),
+          coordinator_(coordinator),
+          consumer_(consumer) {
+      coordinator_->Ref();
+    }
+
+    ~Dataset() override { coordinator_->Unref(); }
+
+    std::unique_ptr<IteratorBase> MakeIteratorInternal(
+        const string& prefix) const override {
+      return absl::make_unique<Iterator>(
+          Iterator::Params{this, strings::StrCat(prefix, "::Lease")});
+    }
+
+    const DataTypeVector& output_dtypes() const override {
+      static DataTypeVector* dtypes =
+          new DataTypeVector({DT_STRING, DT_INT64, DT_INT64});
+      return *dtypes;
+    }
+
+    const std::vector<PartialTensorShape>& output_shapes() const override {
+      static std::vector<PartialTensorShape>* shapes =
+          new std::vector<PartialTensorShape>({{}, {}, {}});
+      return *shapes;
+    }
+
+    string DebugString() const override { return "LeaseDatasetOp::Dataset"; }
+
+    // Rows not taken yet are saved along with the lease coordinator.
+    Status CheckExternalState() const override { return Status::OK(); }
+
+   protected:
+    Status AsGraphDefInternal(SerializationContext* ctx,
+                              DatasetGraphDefBuilder* b,
+                              Node** output) const override {
+      Node* resource_handle_node = nullptr;
+      TF_RETURN_IF_ERROR(b->AddTensor(resource_handle_, &resource_handle_node));
+      AttrValue consumer;
+      b->BuildAttrValue(consumer_, &consumer);
+      TF_RETURN_IF_ERROR(b->AddDataset(this, {resource_handle_node},
+                                       {{"consumer", consumer}}, output));
+      return Status::OK();
+    }
+
+   private:
+    class Iterator : public DatasetIterator<Dataset> {
+     public:
+      explicit Iterator(const Params& params)
+          : DatasetIterator<Dataset>(params) {}
+
+      Status GetNextInternal(IteratorContext* ctx,
+                             std::vector<Tensor>* out_tensors,
+                             bool* end_of_sequence) override {
+        RowRange range;
+        TF_RETURN_IF_ERROR(dataset()->coordinator_->GetNext(
+            dataset()->consumer_, &range, end_of_sequence));
+        if (*end_of_sequence) {
+          return Status::OK();
+        }
+        out_tensors->emplace_back(std::move(range.file));
+        out_tensors->emplace_back(range.start);
+        out_tensors->emplace_back(range.end);
+        return Status::OK();
+      }
+
+     protected:
+      std::shared_ptr<model::Node> CreateNode(
+          IteratorContext* ctx, model::Node::Args args) const override {
+        return model::MakeSourceNode(std::move(args));
+      }
+
+      // Saves untaken rows of the lease held by the consumer, of which start
+      // is the cursor of next chunk.
+      Status SaveInternal(IteratorStateWriter* writer) override {
+        RowRange lease;
+        TF_RETURN_IF_ERROR(
+            dataset()->coordinator_->GetLease(dataset()->consumer_, &lease));
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(full_name("lease_file"), lease.file));
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(full_name("lease_start"), lease.start));
+        return writer->WriteScalar(full_name("lease_end"), lease.end);
+      }
+
+      // Leases the saved rows to the consumer again if they are still
+      // untaken, e.g. after the lease coordinator is restored from the same
+      // checkpoint. Otherwise the consumer gets a new lease.
+      Status RestoreInternal(IteratorContext* ctx,
+                             IteratorStateReader* reader) override {
+        RowRange lease;
+        TF_RETURN_IF_ERROR(
+            reader->ReadScalar(full_name("lease_file"), &lease.file));
+        TF_RETURN_IF_ERROR(
+            reader->ReadScalar(full_name("lease_start"), &lease.start));
+        TF_RETURN_IF_ERROR(
+            reader->ReadScalar(full_name("lease_end"), &lease.end));
+        return dataset()->coordinator_->Reacquire(dataset()->consumer_,
+                                                  lease);
+      }
+    };
+
+    const Tensor resource_handle_;
+    LeaseCoordinator* const coordinator_;
+    const string consumer_;
+  };
+
+  string consumer_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("LeaseDataset").Device(DEVICE_CPU),
+                        LeaseDatasetOp);
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
+#include "tensorflow/core/lib/core/blocking_counter.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/strings/str_util.h"
@@ -242,7 +243,7 @@ void RestoreTensor(OpKernelContext* context,
 }
 
 Status SaveBloomFilter(
-    BundleWriter* writer, BloomFilterAdmitStrategy* strategy,
+    BundleWriter* writer, SlicedAdmitStrategy* strategy,
     const string& name, int64 slice_beg, int64 slice_length, int64 slice_size) {
   LOG(INFO) << "Save BloomFilter" << ": name=" << name
       << ", slice_beg=" << slice_beg << ", slice_length=" << slice_length
@@ -268,9 +269,8 @@ Status SaveBloomFilter(
     SegmentBundleWriter segment_writer(
         writer, xname, TensorShape({(int64)snapshot.size()}), DataType::DT_INT8);
     TF_RETURN_IF_ERROR(segment_writer.Begin());
-    for (auto&& val : snapshot) {
-      TF_RETURN_IF_ERROR(segment_writer.WriteData(&val, sizeof(int8)));
-    }
+    TF_RETURN_IF_ERROR(segment_writer.WriteData(
+            snapshot.data(), snapshot.size() * sizeof(int8)));
     TF_RETURN_IF_ERROR(segment_writer.End());
   }
   LOG(INFO) << "Save BloomFilter Done";
@@ -278,7 +278,7 @@ Status SaveBloomFilter(
 }
 
 Status RestoreBloomFilter(
-    BundleReader* reader, BloomFilterAdmitStrategy* strategy,
+    BundleReader* reader, SlicedAdmitStrategy* strategy,
     const string& name, int64 slice_beg, int64 slice_length,
     int64 slice_size) {
   LOG(INFO) << "Restore BloomFilter" << ": name=" << name
@@ -311,11 +311,91 @@ Status RestoreBloomFilter(
   return Status::OK();
 }
 
+namespace {
+// Bytes handed to a SegmentBundleWriter or read from a SegmentBundleReader
+// at once when streaming a hash table.
+constexpr int64 kStreamChunkBytes = 4 << 20;
+// Rows gathered by one runner task when saving a tensible.
+constexpr int64 kGatherBlock = 4096;
+
+// Copies the slices of data[beg, beg + len) into buffer, kGatherBlock rows
+// per runner task. The returned counter reaches zero once buffer is filled.
+std::unique_ptr<BlockingCounter> GatherSlices(
+    const std::function<void(std::function<void()>)>& runner,
+    TensibleVariable* tensible,
+    const std::vector<std::pair<int64, int64>>& data,
+    int64 beg, int64 len, char* buffer) {
+  int64 blocks = (len + kGatherBlock - 1) / kGatherBlock;
+  std::unique_ptr<BlockingCounter> counter(new BlockingCounter(blocks));
+  BlockingCounter* counter_ptr = counter.get();
+  int64 row = tensible->SliceSize();
+  for (int64 i = 0; i < blocks; ++i) {
+    auto fn = [=, &data] {
+      int64 end = std::min(beg + len, beg + (i + 1) * kGatherBlock);
+      char* dst = buffer + i * kGatherBlock * row;
+      for (int64 j = beg + i * kGatherBlock; j < end; ++j, dst += row) {
+        memcpy(dst, tensible->GetSlice<void>(data[j].second), row);
+      }
+      counter_ptr->DecrementCount();
+    };
+    if (runner) {
+      runner(fn);
+    } else {
+      fn();
+    }
+  }
+  return counter;
+}
+
+// Streams the slices of all ids in data to segment_writer. The slices of
+// the next chunk are gathered on the runner while the current one is
+// written.
+Status WriteSlices(
+    const std::function<void(std::function<void()>)>& runner,
+    TensibleVariable* tensible,
+    const std::vector<std::pair<int64, int64>>& data,
+    SegmentBundleWriter* segment_writer) {
+  int64 size = data.size();
+  if (size == 0) {
+    return Status::OK();
+  }
+  int64 row = tensible->SliceSize();
+  int64 chunk = std::max<int64>(1, kStreamChunkBytes / row);
+  chunk = std::min(chunk, size);
+  std::vector<char> buffers[2];
+  buffers[0].resize(chunk * row);
+  if (size > chunk) {
+    buffers[1].resize(chunk * row);
+  }
+  std::unique_ptr<BlockingCounter> pending = GatherSlices(
+      runner, tensible, data, 0, chunk, buffers[0].data());
+  for (int64 beg = 0, k = 0; beg < size; beg += chunk, k ^= 1) {
+    int64 len = std::min(chunk, size - beg);
+    pending->Wait();
+    pending.reset();
+    if (beg + len < size) {
+      pending = GatherSlices(
+          runner, tensible, data, beg + len,
+          std::min(chunk, size - beg - len), buffers[k ^ 1].data());
+    }
+    Status st = segment_writer->WriteData(buffers[k].data(), len * row);
+    if (!st.ok()) {
+      if (pending) {
+        pending->Wait();
+      }
+      return st;
+    }
+  }
+  return Status::OK();
+}
+}  // namespace
+
 Status SaveHashTableHelper(
     BundleWriter* writer, const std::vector<std::pair<int64, int64>>& data,
     const std::vector<TensibleVariable*>& tensibles,
     const string& table_name, const std::vector<string>& tensibles_name,
-    int64 slice_beg, int64 slice_length, int64 slice_size) {
+    int64 slice_beg, int64 slice_length, int64 slice_size,
+    const std::function<void(std::function<void()>)>& runner) {
   if (tensibles.size() != tensibles_name.size()) {
     return errors::InvalidArgument("save tensor name error");
   }
@@ -343,8 +423,15 @@ Status SaveHashTableHelper(
         writer, xname,
         TensorShape({(int64)data.size()}), DataType::DT_INT64);
     TF_RETURN_IF_ERROR(segment_writer.Begin());
-    for (auto&& item : data) {
-      TF_RETURN_IF_ERROR(segment_writer.WriteData(&item.first, sizeof(int64)));
+    int64 chunk = kStreamChunkBytes / sizeof(int64);
+    std::vector<int64> keys(std::min<int64>(chunk, data.size()));
+    for (size_t beg = 0; beg < data.size(); beg += chunk) {
+      size_t end = std::min<size_t>(beg + chunk, data.size());
+      for (size_t j = beg; j < end; ++j) {
+        keys[j - beg] = data[j].first;
+      }
+      TF_RETURN_IF_ERROR(segment_writer.WriteData(
+              keys.data(), (end - beg) * sizeof(int64)));
     }
     TF_RETURN_IF_ERROR(segment_writer.End());
   }
@@ -369,11 +456,8 @@ Status SaveHashTableHelper(
     SegmentBundleWriter segment_writer(
         writer, xname, ts, tensibles[i]->dtype());
     TF_RETURN_IF_ERROR(segment_writer.Begin());
-    int64 slice_size = tensibles[i]->SliceSize();
-    for (auto&& item : data) {
-      TF_RETURN_IF_ERROR(segment_writer.WriteData(
-              tensibles[i]->GetSlice<void>(item.second), slice_size));
-    }
+    TF_RETURN_IF_ERROR(WriteSlices(
+            runner, tensibles[i], data, &segment_writer));
     TF_RETURN_IF_ERROR(segment_writer.End());
   }
   return Status::OK();
@@ -383,19 +467,23 @@ Status SaveHashTable(
     BundleWriter* writer, HashTable* table,
     const std::vector<TensibleVariable*>& tensibles,
     const string& table_name, const std::vector<string>& tensibles_name,
-    int64 slice_beg, int64 slice_length, int64 slice_size) {
+    int64 slice_beg, int64 slice_length, int64 slice_size,
+    const std::function<void(std::function<void()>)>& runner) {
   LOG(INFO) << "Save";
   std::vector<std::pair<int64, int64>> snapshot;
   CoalescedHashTable* coalesced_table =
       dynamic_cast<CoalescedHashTable*>(table);
   if (coalesced_table == nullptr) {
-    snapshot = table->Snapshot();
+    snapshot = runner ? table->Snapshot(runner) : table->Snapshot();
+  } else if (runner) {
+    TF_RETURN_IF_ERROR(
+        coalesced_table->ChildSnapshot(table_name, runner, &snapshot));
   } else {
     TF_RETURN_IF_ERROR(coalesced_table->ChildSnapshot(table_name, &snapshot));
   }
   TF_RETURN_IF_ERROR(SaveHashTableHelper(
       writer, snapshot, tensibles, table_name, tensibles_name,
-      slice_beg, slice_length, slice_size));
+      slice_beg, slice_length, slice_size, runner));
   LOG(INFO) << "Save Done";
   return Status::OK();
 }
@@ -463,11 +551,13 @@ Status LookupSliceInfo(
   return Status::OK();
 }
 
-void BuildRestoreSlice(
+// Returns the number of saved keys covered by out_slices.
+int64 BuildRestoreSlice(
     const std::vector<TensorSliceProto>& table_slices,
     int64 slice_beg, int64 slice_length,
     std::vector<RestoreHashTableSlice>* out_slices) {
   int64 kBlock = 1 << 20;
+  int64 total = 0;
   for (size_t i = 0; i < table_slices.size(); i++) {
     if (table_slices[i].hash_slice_begin() >= slice_beg + slice_length ||
         slice_beg >= table_slices[i].hash_slice_begin() +
@@ -475,6 +565,7 @@ void BuildRestoreSlice(
       continue;
     }
     int64 idx = table_slices[i].extent(0).length();
+    total += idx;
     for (int64 j = 0; j < idx; j += kBlock) {
       int64 len = std::min(idx - j, kBlock);
       out_slices->emplace_back();
@@ -483,6 +574,7 @@ void BuildRestoreSlice(
       out_slices->back().len = len;
     }
   }
+  return total;
 }
 
 Status InsertTable(
@@ -518,6 +610,7 @@ Status InsertTable(
   }
   int64 id_size = slice.len;
   constexpr int64 kSlice = 1 << 15;
+  std::vector<char> buffer;
   int64 slice_end = slice_beg + slice_length;
   while (id_size > 0) {
     int64 xid = std::min(id_size, kSlice);
@@ -542,23 +635,22 @@ Status InsertTable(
       tensibles[j]->ZeroCostResize(size);
     }
     real_offset.push_back(-1);
-    int64 idx = 0;
-    for (int64 j = 0; j < xid; j++) {
-      if (real_offset[idx] == j) {
-        for (size_t k = 0; k < tensibles.size(); k++) {
-          if (tensible_bundle_readers[k]) {
-            TF_RETURN_IF_ERROR(tensible_bundle_readers[k]->Read(
-                    tensibles[k]->GetSlice<void>(real_id[idx]),
-                    tensibles[k]->SliceSize()));
-          }
-        }
-        idx++;
-      } else {
-        for (size_t k = 0; k < tensibles.size(); k++) {
-          if (tensible_bundle_readers[k]) {
-            TF_RETURN_IF_ERROR(tensible_bundle_readers[k]->Skip(
-                    tensibles[k]->SliceSize()));
-          }
+    for (size_t k = 0; k < tensibles.size(); k++) {
+      if (!tensible_bundle_readers[k]) {
+        continue;
+      }
+      // read the rows in chunks and scatter the ones of this slice
+      int64 row = tensibles[k]->SliceSize();
+      int64 chunk = std::min(xid, std::max<int64>(1, kStreamChunkBytes / row));
+      buffer.resize(chunk * row);
+      int64 idx = 0;
+      for (int64 beg = 0; beg < xid; beg += chunk) {
+        int64 len = std::min(chunk, xid - beg);
+        TF_RETURN_IF_ERROR(tensible_bundle_readers[k]->Read(
+                buffer.data(), len * row));
+        for (; real_offset[idx] >= 0 && real_offset[idx] < beg + len; idx++) {
+          memcpy(tensibles[k]->GetSlice<void>(real_id[idx]),
+                 buffer.data() + (real_offset[idx] - beg) * row, row);
         }
       }
     }
@@ -594,7 +686,8 @@ void RestoreHashTable(
     }
 
     std::vector<RestoreHashTableSlice> slices;
-    BuildRestoreSlice(table_slices, slice_beg, slice_length, &slices);
+    table->Reserve(
+        BuildRestoreSlice(table_slices, slice_beg, slice_length, &slices));
 
     mutex* mu = new mutex;
     auto insert_table = std::bind(
@@ -665,6 +758,7 @@ void RestoreCoalescedHashTable(
       return;
     }
     std::vector<std::function<Status(void)>> insert_table_fns;
+    int64 saved_keys = 0;
     mutex* mu = new mutex;
     for (size_t i = 0; i < table_names.size(); ++i) {
       string table_name = table_names[i];
@@ -685,7 +779,8 @@ void RestoreCoalescedHashTable(
         continue;
       }
       std::vector<RestoreHashTableSlice> slices;
-      BuildRestoreSlice(table_slices, slice_beg, slice_length, &slices);
+      saved_keys += BuildRestoreSlice(
+          table_slices, slice_beg, slice_length, &slices);
       for (auto&& slice : slices) {
         insert_table_fns.push_back(std::bind(
                 InsertTable, reader, table, tensibles, table_name, 
@@ -714,6 +809,7 @@ void RestoreCoalescedHashTable(
       LOG(INFO) << "Restore CoalescedHashTable Done";
       stc->Start();
     };
+    table->Reserve(saved_keys);
     StatusCollector* stc = new StatusCollector(
         insert_table_fns.size(), after_add_table);
     for (auto&& fn : insert_table_fns) {
@@ -78,7 +78,8 @@ Status SaveHashTable(
     BundleWriter* writer, HashTable* table,
     const std::vector<TensibleVariable*>& tensibles,
     const string& table_name, const std::vector<string>& tensibles_name,
-    int64 slice_beg, int64 slice_length, int64 slice_size);
+    int64 slice_beg, int64 slice_length, int64 slice_size,
+    const std::function<void(std::function<void()>)>& runner = nullptr);
 
 void RestoreHashTable(
     std::function<void(std::function<void()>)> runner,
@@ -98,11 +99,11 @@ void RestoreCoalescedHashTable(
     bool clear, std::function<void(Status)> done);
 
 Status SaveBloomFilter(
-    BundleWriter* writer, BloomFilterAdmitStrategy* strategy,
+    BundleWriter* writer, SlicedAdmitStrategy* strategy,
     const string& name, int64 slice_beg, int64 slice_length, int64 slice_size);
 
 Status RestoreBloomFilter(
-    BundleReader* reader, BloomFilterAdmitStrategy* strategy,
+    BundleReader* reader, SlicedAdmitStrategy* strategy,
     const string& name, int64 slice_beg, int64 slice_length, int64 slice_size);
 
 template<class T>
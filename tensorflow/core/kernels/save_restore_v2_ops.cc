@@ -46,6 +46,17 @@ bool IsHandle(const ResourceHandle& handle) {
   return handle.hash_code() == MakeTypeIndex<T>().hash_code();
 }
 
+// Runs the per-table work of a hash table save on the intra-op pool, which
+// does not wait on the inter-op thread running the save op.
+std::function<void(std::function<void()>)> WorkerRunner(
+    OpKernelContext* context) {
+  thread::ThreadPool* workers =
+      context->device()->tensorflow_cpu_worker_threads()->workers;
+  return [workers](std::function<void()> fn) {
+    workers->Schedule(std::move(fn));
+  };
+}
+
 // Shared validations of the inputs to the SaveV2 and RestoreV2 ops.
 void ValidateInputs(bool is_save_op, OpKernelContext* context,
                     const Tensor& prefix, const Tensor& tensor_names,
@@ -213,7 +224,8 @@ class SaveV2 : public OpKernel {
                 tensor_name_x.begin() + 1, tensor_name_x.end());
             OP_REQUIRES_OK(context, SaveHashTable(
                   &writer, hashtable, tensibles, table_name, tensible_name,
-                  slice.start(0), slice.length(0), slice_shape.dim_size(0)));
+                  slice.start(0), slice.length(0), slice_shape.dim_size(0),
+                  WorkerRunner(context)));
           }
         } else if (IsHandle<HashTableAdmitStrategyResource>(handle)) {
           HashTableAdmitStrategyResource* resource;
@@ -221,9 +233,9 @@ class SaveV2 : public OpKernel {
               LookupResource(context,
                 HandleFromInput(context, i + kFixedInputs), &resource));
           HashTableAdmitStrategy* strategy = resource->Internal();
-          BloomFilterAdmitStrategy* bf =
-            dynamic_cast<BloomFilterAdmitStrategy*>(strategy);
-          CHECK(bf != nullptr) << "Cannot save Non-BloomFilterAdmitStrategy!";
+          SlicedAdmitStrategy* bf =
+            dynamic_cast<SlicedAdmitStrategy*>(strategy);
+          CHECK(bf != nullptr) << "Cannot save admit strategy without state!";
 
           string shape_spec = shape_and_slices_flat(i);
           TensorShape shape;
@@ -399,7 +411,8 @@ class SaveV3 : public OpKernel {
                 tensor_name_x.begin() + 1, tensor_name_x.end());
             OP_REQUIRES_OK(context, SaveHashTable(
                   &writer, hashtable, tensibles, table_name, tensible_name,
-                  slice.start(0), slice.length(0), slice_shape.dim_size(0)));
+                  slice.start(0), slice.length(0), slice_shape.dim_size(0),
+                  WorkerRunner(context)));
           }
         } else if (IsHandle<HashTableAdmitStrategyResource>(handle)) {
           HashTableAdmitStrategyResource* resource;
@@ -407,9 +420,9 @@ class SaveV3 : public OpKernel {
               LookupResource(context,
                 HandleFromInput(context, i + kFixedInputs), &resource));
           HashTableAdmitStrategy* strategy = resource->Internal();
-          BloomFilterAdmitStrategy* bf =
-            dynamic_cast<BloomFilterAdmitStrategy*>(strategy);
-          CHECK(bf != nullptr) << "Cannot save Non-BloomFilterAdmitStrategy!";
+          SlicedAdmitStrategy* bf =
+            dynamic_cast<SlicedAdmitStrategy*>(strategy);
+          CHECK(bf != nullptr) << "Cannot save admit strategy without state!";
 
           string shape_spec = shape_and_slices_flat(i);
           TensorShape shape;
@@ -584,11 +597,11 @@ class RestoreBloomFilterOp : public AsyncOpKernel {
     OP_REQUIRES_OK_ASYNC(context, checkpoint::ParseShapeAndSlice(
         shape_slice_string, &shape, &slice, &slice_shape), done);
     HashTableAdmitStrategyResource* resource = nullptr;
-    BloomFilterAdmitStrategy* strategy = nullptr;
+    SlicedAdmitStrategy* strategy = nullptr;
     {
       OP_REQUIRES_OK_ASYNC(
           context, LookupResource(context, handle_flat, &resource), done);
-      strategy = dynamic_cast<BloomFilterAdmitStrategy*>(resource->Internal());
+      strategy = dynamic_cast<SlicedAdmitStrategy*>(resource->Internal());
       CHECK(strategy != nullptr)
         << "Cannot restore BloomFilter from another strategy";
     }
@@ -135,6 +135,43 @@ TEST_F(SparseSegmentMeanTest, Normal_float32) {
   test::ExpectTensorEqual<float>(expected, *GetOutput(0));
 }
 
+TEST_F(SparseSegmentMeanTest, FixedDim_float32) {
+  // Rows of 16 elements take the fixed-width path, segments of 1 to 20 rows
+  // cover every remainder of its 8-row unrolling.
+  CreateOp(DT_FLOAT, DT_INT32);
+  TF_ASSERT_OK(InitOp());
+  const int kDim = 16;
+  const int kRows = 1000;
+  std::vector<float> input(kRows * kDim);
+  for (int i = 0; i < kRows * kDim; ++i) {
+    input[i] = static_cast<float>(i % 97) * 0.25f;
+  }
+  std::vector<int32> indices;
+  std::vector<int32> segment_ids;
+  std::vector<float> out;
+  for (int seg = 0; seg < 20; ++seg) {
+    std::vector<double> sum(kDim, 0.0);
+    for (int j = 0; j <= seg; ++j) {
+      const int32 index = (seg * 37 + j * 13) % kRows;
+      indices.push_back(index);
+      segment_ids.push_back(seg);
+      for (int d = 0; d < kDim; ++d) sum[d] += input[index * kDim + d];
+    }
+    for (int d = 0; d < kDim; ++d) out.push_back(sum[d] / (seg + 1));
+  }
+  const int64 num_indices = indices.size();
+
+  AddInputFromArray<float>(TensorShape({kRows, kDim}), input);
+  AddInputFromArray<int32>(TensorShape({num_indices}), indices);
+  AddInputFromArray<int32>(TensorShape({num_indices}), segment_ids);
+
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected(DT_FLOAT, TensorShape{20, kDim});
+  test::FillValues<float>(&expected, out);
+  test::ExpectTensorNear<float>(expected, *GetOutput(0), 1e-4);
+}
+
 TEST_F(SparseSegmentSqrtNTest, Normal_float32) {
   CreateOp(DT_FLOAT);
   TF_ASSERT_OK(InitOp());
@@ -699,4 +736,55 @@ BM_SparseSegmentMeanGrad(Low, 1.0, 8);
 BM_SparseSegmentMeanGrad(Med, 0.6, 8);
 BM_SparseSegmentMeanGrad(High, 0.01, 8);
 
-}  // namespace tensorflow
\ No newline at end of file
+static void SparseSegmentReductionHelper(int iters, const string& op,
+                                         int num_cols, int segment_size,
+                                         int nth) {
+  testing::StopTiming();
+  Graph* g = new Graph(OpRegistry::Global());
+
+  const int kNumRows = 1 << 20;
+  const int kNumIndices = 1 << 18;
+  Tensor input(DT_FLOAT, TensorShape({kNumRows, num_cols}));
+  input.flat<float>().setRandom();
+  Tensor indices(DT_INT32, TensorShape({kNumIndices}));
+  auto indices_flat = indices.flat<int32>();
+  Tensor segments(DT_INT32, TensorShape({kNumIndices}));
+  auto segments_flat = segments.flat<int32>();
+  for (int i = 0; i < kNumIndices; ++i) {
+    indices_flat(i) = (static_cast<int64>(i) * 7919) % kNumRows;
+    segments_flat(i) = i / segment_size;
+  }
+
+  Node* node;
+  TF_CHECK_OK(NodeBuilder(g->NewName("n"), op)
+                  .Input(test::graph::Constant(g, input))
+                  .Input(test::graph::Constant(g, indices))
+                  .Input(test::graph::Constant(g, segments))
+                  .Attr("T", DT_FLOAT)
+                  .Finalize(g, &node));
+
+  testing::UseRealTime();
+  testing::BytesProcessed(static_cast<int64>(iters) * kNumIndices * num_cols *
+                          sizeof(float));
+  SessionOptions opts;
+  opts.config.set_intra_op_parallelism_threads(nth);
+  testing::StartTiming();
+  test::Benchmark("cpu", g, &opts).Run(iters);
+}
+
+#define BM_SparseSegmentReduction(OP, COLS, SEG, NTH)                      \
+  static void BM_##OP##_##COLS##_##SEG##_##NTH(int iters) {               \
+    SparseSegmentReductionHelper(iters, #OP, COLS, SEG, NTH);             \
+  }                                                                       \
+  BENCHMARK(BM_##OP##_##COLS##_##SEG##_##NTH);
+
+BM_SparseSegmentReduction(SparseSegmentSum, 8, 20, 8);
+BM_SparseSegmentReduction(SparseSegmentSum, 16, 20, 8);
+BM_SparseSegmentReduction(SparseSegmentSum, 32, 20, 8);
+BM_SparseSegmentReduction(SparseSegmentSum, 48, 20, 8);
+BM_SparseSegmentReduction(SparseSegmentMean, 8, 20, 8);
+BM_SparseSegmentReduction(SparseSegmentMean, 16, 20, 8);
+BM_SparseSegmentReduction(SparseSegmentMean, 32, 20, 8);
+BM_SparseSegmentReduction(SparseSegmentMean, 48, 20, 8);
+
+}  // namespace tensorflow
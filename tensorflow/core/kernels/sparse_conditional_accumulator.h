@@ -350,6 +350,10 @@ class SparseConditionalAccumulator
     if (is_successful) is_successful = ReturnIdxTensor(ctx);
     if (is_successful) is_successful = ReturnValTensor(ctx);
     if (is_successful) is_successful = ReturnShapeTensor(ctx);
+    // Only SparseAccumulatorTakeGradientWithCounts has the counts output.
+    if (is_successful && ctx->num_outputs() > 3) {
+      is_successful = ReturnCountsTensor(ctx);
+    }
     return is_successful;
   }
 
@@ -454,6 +458,17 @@ class SparseConditionalAccumulator
     return true;
   }
 
+  inline bool ReturnCountsTensor(OpKernelContext* ctx) {
+    Tensor* counts_tensor;
+    const int64 nnz = count_element_->size();
+    OP_REQUIRES_OK_BOOLEAN(ctx, ctx->allocate_output(3, {nnz}, &counts_tensor));
+    auto counts_tensor_vec = counts_tensor->vec<int64>();
+    for (int i = 0; i < nnz; ++i) {
+      counts_tensor_vec(i) = count_element_->at(i);
+    }
+    return true;
+  }
+
   TF_DISALLOW_COPY_AND_ASSIGN(SparseConditionalAccumulator);
 };
 
@@ -23,6 +23,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/util/env_var.h"
+#include "tensorflow/core/util/work_sharder.h"
 
 #define unlikely(x) __builtin_expect(!!(x), 0)
 
@@ -342,6 +343,21 @@ class SparseConditionalAccumulatorMultiMap
       shape_tensor->flat<int64>()(i) = val_tensor->dim_size(i);
     }
 
+    // Only SparseAccumulatorTakeGradientWithCounts has the counts output.
+    if (ctx->num_outputs() > 3) {
+      Tensor* counts_tensor;
+      OP_REQUIRES_OK_BOOLEAN(ctx,
+                             ctx->allocate_output(3, {nnz}, &counts_tensor));
+      auto counts_vec = counts_tensor->vec<int64>();
+      for (size_t i = 0; i < num_maps_; ++i) {
+        int64 offset = map_offsets[i];
+        for (auto iter = accum_grads_[i].begin();
+             iter != accum_grads_[i].end(); ++iter) {
+          counts_vec(offset++) = std::get<2>(iter->second);
+        }
+      }
+    }
+
     for (auto &accum_grad : accum_grads_) {
       accum_grad.clear();
     }
@@ -353,6 +369,333 @@ class SparseConditionalAccumulatorMultiMap
   TF_DISALLOW_COPY_AND_ASSIGN(SparseConditionalAccumulatorMultiMap);
 };
 
+// "SortedMerge" keeps the grads of every worker as they are and merges them
+// when the grad is taken: the concatenated indices are radix-sorted and runs
+// of equal indices are reduced in one streaming pass. The output indices are
+// sorted, and the grads of an index are summed in the order they were
+// applied, which makes the result independent of any hashing and reads the
+// grad rows sequentially per index.
+template <typename Device, typename T>
+class SparseConditionalAccumulatorSortedMerge
+    : public TypedConditionalAccumulatorBase<
+          std::tuple<const Tensor*, const Tensor*, const Tensor*>> {
+ public:
+  SparseConditionalAccumulatorSortedMerge(const DataType& dtype,
+                                          const PartialTensorShape& shape,
+                                          const string& name,
+                                          const string& reduction_type)
+      : TypedConditionalAccumulatorBase<
+            std::tuple<const Tensor*, const Tensor*, const Tensor*>>(
+            dtype, shape, name, reduction_type) {
+    if (reduction_type == "MEAN") {
+      reduction_type_enum_ = GradReductionType::MEAN_BY_COUNT;
+    } else if (reduction_type_ == "CMEAN") {
+      reduction_type_enum_ = GradReductionType::MEAN_BY_WORKER_COUNT;
+    }
+  }
+
+  ~SparseConditionalAccumulatorSortedMerge() override {};
+
+ protected:
+  GradReductionType reduction_type_enum_ = GradReductionType::SUM;
+  // Indices and values of every grad applied since the last take.
+  std::vector<Tensor> idx_bufs_;
+  std::vector<Tensor> val_bufs_;
+  int64 num_elements_{0};
+
+  typedef Eigen::TensorMap<Eigen::Tensor<T, 1, Eigen::RowMajor>,
+                           Eigen::Unaligned>
+      SliceT;
+  typedef Eigen::TensorMap<Eigen::Tensor<const T, 1, Eigen::RowMajor>,
+                           Eigen::Unaligned>
+      SliceConstT;
+
+  void AllocateAndAssignToAccumGradFunction(
+      OpKernelContext* ctx,
+      std::tuple<const Tensor*, const Tensor*, const Tensor*>* grad) override {
+    AppendGrad(ctx, grad);
+  }
+
+  void AddToAccumGradFunction(
+      OpKernelContext* ctx,
+      std::tuple<const Tensor*, const Tensor*, const Tensor*>* grad) override {
+    AppendGrad(ctx, grad);
+  }
+
+  void DivideAccumGradByCounter(OpKernelContext* ctx) override
+      EXCLUSIVE_LOCKS_REQUIRED(this->mu_) {
+    return;
+  }
+
+  bool SetOutput(OpKernelContext* ctx) override {
+    return OutputGrads(ctx);
+  }
+
+  bool GetAndValidateTensorInputForApplyGrad(
+      OpKernelContext* ctx,
+      std::tuple<const Tensor*, const Tensor*, const Tensor*>** tensor) override
+      EXCLUSIVE_LOCKS_REQUIRED(this->mu_) {
+    bool has_known_shape = false;
+    OP_REQUIRES_OK_BOOLEAN(
+        ctx, GetNodeAttr(ctx->op_kernel().def(), "has_known_shape",
+                         &has_known_shape));
+
+    // Get input gradient tensors
+    const Tensor* grad_idx_tensor;
+    OP_REQUIRES_OK_BOOLEAN(ctx,
+                           ctx->input("gradient_indices", &grad_idx_tensor));
+    const Tensor* grad_val_tensor;
+    OP_REQUIRES_OK_BOOLEAN(ctx,
+                           ctx->input("gradient_values", &grad_val_tensor));
+    const Tensor* grad_shape_tensor = nullptr;
+    if (has_known_shape) {
+      OP_REQUIRES_OK_BOOLEAN(ctx,
+                             ctx->input("gradient_shape", &grad_shape_tensor));
+    }
+
+    // Checks
+    OP_REQUIRES_BOOLEAN(
+        ctx, TensorShapeUtils::IsVector(grad_idx_tensor->shape()),
+        errors::InvalidArgument(
+            "Input indices should be vector but received shape: ",
+            grad_idx_tensor->shape().DebugString()));
+    const int64 nnz = grad_idx_tensor->dim_size(0);
+    OP_REQUIRES_BOOLEAN(
+        ctx, grad_val_tensor->dims() > 0,
+        errors::InvalidArgument("Values cannot be 0-dimensional."));
+    OP_REQUIRES_BOOLEAN(ctx, grad_val_tensor->dim_size(0) == nnz,
+                        errors::InvalidArgument("Expected ", nnz,
+                                                " non-empty input values, got ",
+                                                grad_val_tensor->dim_size(0)));
+
+    *tensor = new std::tuple<const Tensor*, const Tensor*, const Tensor*>(
+        grad_idx_tensor, grad_val_tensor, grad_shape_tensor);
+
+    OP_REQUIRES_OK_BOOLEAN(ctx, ValidateShape(*tensor, has_known_shape));
+
+    return true;
+  }
+
+  void CleanUpGradTensor(std::tuple<const Tensor*, const Tensor*,
+                                    const Tensor*>* tensor) override {
+    if (tensor != nullptr) delete tensor;
+  }
+
+ private:
+  // Same checks as SparseConditionalAccumulator, with the first applied grad
+  // standing for the accumulated one.
+  Status ValidateShape(
+      std::tuple<const Tensor*, const Tensor*, const Tensor*>* tensor,
+      bool has_known_shape) EXCLUSIVE_LOCKS_REQUIRED(this->mu_) {
+    const Tensor* tensor_idx = std::get<0>(*tensor);
+    const Tensor* tensor_val = std::get<1>(*tensor);
+    const Tensor* tensor_shape = std::get<2>(*tensor);
+    int64 grad_val_dims = tensor_val->dims();
+
+    // Compare with provided shape
+    if (has_known_shape) {
+      if (shape_.dims() > tensor_shape->NumElements()) {
+        return errors::InvalidArgument(
+            "Shape mismatch: expected shape rank at least ", shape_.dims(),
+            ", got ", tensor_shape->NumElements());
+      }
+      const auto tensor_shape_flat = tensor_shape->flat<int64>();
+      for (int64 i = 0; i < shape_.dims(); i++) {
+        if (shape_.dim_size(i) != -1 &&
+            shape_.dim_size(i) != tensor_shape_flat(i)) {
+          return errors::InvalidArgument("Shape mismatch: expected shape dim ",
+                                         i, " to be ", shape_.dim_size(i),
+                                         ", got ", tensor_shape_flat(i));
+        }
+      }
+    }
+    // Check that indices are within limits
+    if (shape_.dims() > 0 && shape_.dim_size(0) != -1) {
+      const auto idx_vec = tensor_idx->vec<int64>();
+      for (int64 i = 0; i < idx_vec.size(); i++) {
+        if (idx_vec(i) >= shape_.dim_size(0)) {
+          return errors::InvalidArgument(
+              "Shape mismatch: index of slice ", i, " exceeded limits of shape",
+              "; index is ", idx_vec(i), " exceeded ", shape_.dim_size(0));
+        }
+      }
+    }
+
+    // Check values compatibility with accumulated grads if available
+    if (!val_bufs_.empty()) {
+      const Tensor& accum_val = val_bufs_[0];
+      if (accum_val.dims() != grad_val_dims) {
+        return errors::InvalidArgument("Shape mismatch: expected values rank ",
+                                       accum_val.dims(), ", got ",
+                                       grad_val_dims);
+      }
+      for (int64 i = 1; i < grad_val_dims; i++) {
+        if (accum_val.dim_size(i) != tensor_val->dim_size(i)) {
+          return errors::InvalidArgument("Shape mismatch: expected values dim ",
+                                         i, " to be ", accum_val.dim_size(i),
+                                         ", got ", tensor_val->dim_size(i));
+        }
+      }
+    } else {
+      // If there are no accumulated grads, check against shape_
+      if (shape_.dims() > grad_val_dims) {
+        return errors::InvalidArgument(
+            "Shape mismatch: expected values rank at least ", shape_.dims(),
+            ", got ", grad_val_dims);
+      }
+      for (int64 i = 1; i < shape_.dims(); i++) {
+        if (shape_.dim_size(i) != -1 &&
+            shape_.dim_size(i) != tensor_val->dim_size(i)) {
+          return errors::InvalidArgument("Shape mismatch: expected values dim ",
+                                         i, " to be ", shape_.dim_size(i),
+                                         ", got ", tensor_val->dim_size(i));
+        }
+      }
+    }
+
+    return Status::OK();
+  }
+
+  // The input tensors are immutable, holding a reference keeps their buffers
+  // alive until the grad is taken without copying them.
+  void AppendGrad(OpKernelContext* ctx,
+                  std::tuple<const Tensor*, const Tensor*, const Tensor*>* grad) {
+    idx_bufs_.emplace_back(*std::get<0>(*grad));
+    val_bufs_.emplace_back(*std::get<1>(*grad));
+    num_elements_ += std::get<0>(*grad)->dim_size(0);
+  }
+
+  // Stable LSD radix sort of `keys` along with `rows`, 8 bits per pass.
+  // Passes over bytes that are the same for every key are skipped, so small
+  // id spaces only pay for the bytes they use.
+  static void RadixSort(std::vector<uint64>* keys,
+                        std::vector<const T*>* rows) {
+    const int64 n = keys->size();
+    std::vector<int64> histograms(8 * 256, 0);
+    for (int64 i = 0; i < n; ++i) {
+      uint64 key = (*keys)[i];
+      for (int b = 0; b < 8; ++b) {
+        ++histograms[b * 256 + ((key >> (b * 8)) & 0xff)];
+      }
+    }
+    std::vector<uint64> tmp_keys(n);
+    std::vector<const T*> tmp_rows(n);
+    for (int b = 0; b < 8; ++b) {
+      int64* histogram = &histograms[b * 256];
+      if (histogram[((*keys)[0] >> (b * 8)) & 0xff] == n) continue;
+      int64 offset = 0;
+      for (int d = 0; d < 256; ++d) {
+        int64 count = histogram[d];
+        histogram[d] = offset;
+        offset += count;
+      }
+      for (int64 i = 0; i < n; ++i) {
+        int64 pos = histogram[((*keys)[i] >> (b * 8)) & 0xff]++;
+        tmp_keys[pos] = (*keys)[i];
+        tmp_rows[pos] = (*rows)[i];
+      }
+      keys->swap(tmp_keys);
+      rows->swap(tmp_rows);
+    }
+  }
+
+  bool OutputGrads(OpKernelContext* ctx) {
+    OP_REQUIRES_BOOLEAN(ctx, !val_bufs_.empty(),
+                        errors::Internal("No gradient has been accumulated."));
+    const int64 n = num_elements_;
+    // Every applied grad has the same dims after the first one, whatever
+    // its number of rows.
+    TensorShape row_shape = val_bufs_[0].shape();
+    row_shape.RemoveDim(0);
+    const int64 row_size = row_shape.num_elements();
+
+    // Flipping the sign bit makes the unsigned order of the keys the signed
+    // order of the indices.
+    const uint64 kSignBit = 1ULL << 63;
+    std::vector<uint64> keys(n);
+    std::vector<const T*> rows(n);
+    int64 pos = 0;
+    for (size_t b = 0; b < idx_bufs_.size(); ++b) {
+      auto idx_vec = idx_bufs_[b].vec<int64>();
+      const T* val = val_bufs_[b].flat<T>().data();
+      for (int64 i = 0; i < idx_vec.size(); ++i, ++pos) {
+        keys[pos] = static_cast<uint64>(idx_vec(i)) ^ kSignBit;
+        rows[pos] = val + i * row_size;
+      }
+    }
+    if (n > 0) RadixSort(&keys, &rows);
+
+    std::vector<int64> run_starts;
+    for (int64 i = 0; i < n; ++i) {
+      if (i == 0 || keys[i] != keys[i - 1]) run_starts.push_back(i);
+    }
+    const int64 nnz = run_starts.size();
+    run_starts.push_back(n);
+
+    Tensor* idx_tensor, *val_tensor;
+    TensorShape val_shape = val_bufs_[0].shape();
+    val_shape.set_dim(0, nnz);
+    OP_REQUIRES_OK_BOOLEAN(ctx, ctx->allocate_output(0, {nnz}, &idx_tensor));
+    OP_REQUIRES_OK_BOOLEAN(ctx, ctx->allocate_output(1, val_shape, &val_tensor));
+    Tensor* counts_tensor = nullptr;
+    // Only SparseAccumulatorTakeGradientWithCounts has the counts output.
+    if (ctx->num_outputs() > 3) {
+      OP_REQUIRES_OK_BOOLEAN(ctx,
+                             ctx->allocate_output(3, {nnz}, &counts_tensor));
+    }
+
+    auto idx_vec = idx_tensor->vec<int64>();
+    T* val = val_tensor->flat<T>().data();
+    int64* counts = counts_tensor ? counts_tensor->vec<int64>().data() : nullptr;
+    Eigen::DSizes<Eigen::DenseIndex, 1> slice_shape(row_size);
+    const T worker_count = static_cast<T>(counter_);
+    auto reduce_runs = [this, &keys, &rows, &run_starts, &idx_vec, val, counts,
+                        row_size, &slice_shape, kSignBit,
+                        worker_count](int64 start, int64 end) {
+      for (int64 r = start; r < end; ++r) {
+        const int64 begin = run_starts[r];
+        const int64 count = run_starts[r + 1] - begin;
+        SliceT out(val + r * row_size, slice_shape);
+        out = SliceConstT(rows[begin], slice_shape);
+        for (int64 i = begin + 1; i < begin + count; ++i) {
+          out += SliceConstT(rows[i], slice_shape);
+        }
+        if (reduction_type_enum_ == GradReductionType::MEAN_BY_COUNT) {
+          out = out / static_cast<T>(count);
+        } else if (reduction_type_enum_ ==
+                   GradReductionType::MEAN_BY_WORKER_COUNT) {
+          out = out / worker_count;
+        }
+        idx_vec(r) = static_cast<int64>(keys[begin] ^ kSignBit);
+        if (counts != nullptr) counts[r] = count;
+      }
+    };
+    auto worker_threads = ctx->device()->tensorflow_cpu_worker_threads();
+    Shard(worker_threads->num_threads, worker_threads->workers, nnz,
+          row_size * (n / std::max(nnz, static_cast<int64>(1)) + 1),
+          reduce_runs);
+
+    int64 accum_val_dims = val_tensor->dims();
+    Tensor* shape_tensor;
+    OP_REQUIRES_OK_BOOLEAN(
+        ctx, ctx->allocate_output(2, {accum_val_dims}, &shape_tensor));
+    // First dim of shape is defined by shape_, others by the values shape
+    shape_tensor->flat<int64>()(0) =
+        (shape_.dims() > 0) ? shape_.dim_size(0) : -1;
+    for (int64 i = 1; i < accum_val_dims; i++) {
+      shape_tensor->flat<int64>()(i) = val_tensor->dim_size(i);
+    }
+
+    idx_bufs_.clear();
+    val_bufs_.clear();
+    num_elements_ = 0;
+
+    return true;
+  }
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SparseConditionalAccumulatorSortedMerge);
+};
+
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_KERNELS_SPARSE_CONDITIONAL_ACCUMULATOR_ALI_H_
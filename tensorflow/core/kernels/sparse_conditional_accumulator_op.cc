@@ -117,6 +117,54 @@ TF_CALL_double(REGISTER_KERNELS_CPU);
 #undef REGISTER_KERNELS_CPU
 #undef REGISTER_KERNELS
 
+template <typename Device, typename T>
+class SparseConditionalAccumulatorSortedMergeOp
+    : public ConditionalAccumulatorBaseOp {
+ public:
+  explicit SparseConditionalAccumulatorSortedMergeOp(
+      OpKernelConstruction* context)
+      : ConditionalAccumulatorBaseOp(context) {}
+
+ protected:
+  Creator GetCreator() const override {
+    return [this](ConditionalAccumulatorBase** ret) {
+      SparseConditionalAccumulatorSortedMerge<Device, T>* accumulator =
+          new SparseConditionalAccumulatorSortedMerge<Device, T>(
+              dtype_, shape_, cinfo_.name(), reduction_type_);
+      *ret = accumulator;
+      return Status::OK();
+    };
+  }
+
+  Status CheckSignature(OpKernelContext* ctx) override {
+    TF_RETURN_IF_ERROR(ctx->MatchSignature({}, {DT_STRING_REF}));
+    return Status::OK();
+  }
+
+  void SetHandleToOutput(OpKernelContext* ctx)
+      SHARED_LOCKS_REQUIRED(mu_) override {
+    ctx->set_output_ref(0, &mu_, accumulator_handle_.AccessTensor(ctx));
+  }
+
+  TF_DISALLOW_COPY_AND_ASSIGN(SparseConditionalAccumulatorSortedMergeOp);
+};
+
+#define REGISTER_KERNELS(type, dev)                                       \
+  REGISTER_KERNEL_BUILDER(Name("SparseConditionalAccumulatorSortedMerge") \
+                              .Device(DEVICE_##dev)                       \
+                              .TypeConstraint<type>("dtype"),             \
+                          SparseConditionalAccumulatorSortedMergeOp<      \
+                              dev##Device, type>)
+
+#define REGISTER_KERNELS_CPU(type) REGISTER_KERNELS(type, CPU)
+
+TF_CALL_half(REGISTER_KERNELS_CPU);
+TF_CALL_float(REGISTER_KERNELS_CPU);
+TF_CALL_double(REGISTER_KERNELS_CPU);
+
+#undef REGISTER_KERNELS_CPU
+#undef REGISTER_KERNELS
+
 /**
  * Defines a SparseAccumulateGradientOp, the execution of which adds a gradient
  * to the given SparseConditionalAccumulator.
@@ -179,4 +227,42 @@ REGISTER_KERNEL_BUILDER(
     Name("SparseAccumulatorTakeGradient").Device(DEVICE_CPU),
     SparseAccumulatorTakeGradientOp);
 
+/**
+ * Defines a SparseAccumulatorTakeGradientWithCountsOp, which also returns how
+ * many grads were accumulated for each index, as consumed by the
+ * *WithCounts sparse apply ops.
+ */
+class SparseAccumulatorTakeGradientWithCountsOp
+    : public ConditionalAccumulatorBaseTakeGradientOp {
+ public:
+  explicit SparseAccumulatorTakeGradientWithCountsOp(
+      OpKernelConstruction* context)
+      : ConditionalAccumulatorBaseTakeGradientOp(context) {}
+
+ protected:
+  void CheckSignature(OpKernelContext* ctx,
+                      ConditionalAccumulatorBase* accumulator,
+                      DoneCallback callback) override {
+    // Check signature
+    OP_REQUIRES_OK_ASYNC(
+        ctx,
+        ctx->MatchSignature({DT_STRING_REF, DT_INT32},
+                            {DT_INT64, accumulator->dtype(), DT_INT64,
+                             DT_INT64}),
+        callback);
+  }
+
+  DataTypeVector GetExpectedInputs(
+      ConditionalAccumulatorBase* accumulator) override {
+    return {DT_STRING_REF, DT_INT32};
+  }
+
+ private:
+  TF_DISALLOW_COPY_AND_ASSIGN(SparseAccumulatorTakeGradientWithCountsOp);
+};
+
+REGISTER_KERNEL_BUILDER(
+    Name("SparseAccumulatorTakeGradientWithCounts").Device(DEVICE_CPU),
+    SparseAccumulatorTakeGradientWithCountsOp);
+
 }  // namespace tensorflow
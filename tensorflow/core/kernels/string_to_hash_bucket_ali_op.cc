@@ -31,4 +31,7 @@ REGISTER_KERNEL_BUILDER(Name("StringToHash64").Device(DEVICE_CPU),
 
 REGISTER_KERNEL_BUILDER(Name("StringToHash").Device(DEVICE_CPU),
                         StringToHashOp);
+
+REGISTER_KERNEL_BUILDER(Name("MultiStringToHash").Device(DEVICE_CPU),
+                        MultiStringToHashOp<Fingerprint64>);
 }  // namespace tensorflow
@@ -16,7 +16,9 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_STRING_TO_HASH_BUCKET_ALI_OP_H_
 #define TENSORFLOW_CORE_KERNELS_STRING_TO_HASH_BUCKET_ALI_OP_H_
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -295,6 +297,121 @@ class StringToHash64Op : public OpKernel {
   TF_DISALLOW_COPY_AND_ASSIGN(StringToHash64Op);
 };
 
+template <uint64 hash(StringPiece)>
+class MultiStringToHashOp : public OpKernel {
+ public:
+  explicit MultiStringToHashOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
+    int num_inputs;
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("N", &num_inputs));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("num_buckets", &num_buckets_));
+    OP_REQUIRES(ctx, static_cast<int>(num_buckets_.size()) == num_inputs,
+                errors::InvalidArgument("num_buckets must have ", num_inputs,
+                                        " elements, got ",
+                                        num_buckets_.size()));
+    for (const int64 num_buckets : num_buckets_) {
+      OP_REQUIRES(ctx, num_buckets >= 0,
+                  errors::InvalidArgument(
+                      "num_buckets must be non-negative, got ", num_buckets));
+    }
+  }
+
+  void Compute(OpKernelContext* context) override {
+    OpInputList inputs;
+    OP_REQUIRES_OK(context, context->input_list("inputs", &inputs));
+    OpOutputList outputs;
+    OP_REQUIRES_OK(context, context->output_list("outputs", &outputs));
+
+    // Strings of all inputs are hashed as one range, so that many small
+    // inputs, e.g. one per feature, are sharded together.
+    std::vector<int64> offsets(inputs.size() + 1, 0);
+    std::vector<const string*> input_data(inputs.size());
+    std::vector<int64*> output_data(inputs.size());
+    for (int i = 0; i < inputs.size(); ++i) {
+      Tensor* output_tensor = nullptr;
+      OP_REQUIRES_OK(context, outputs.allocate(i, inputs[i].shape(),
+                                               &output_tensor));
+      offsets[i + 1] = offsets[i] + inputs[i].NumElements();
+      input_data[i] = inputs[i].flat<string>().data();
+      output_data[i] = output_tensor->flat<int64>().data();
+    }
+
+    auto RunTask = [this, &offsets, &input_data, &output_data](int64 start,
+                                                               int64 end) {
+      size_t i = std::upper_bound(offsets.begin(), offsets.end(), start) -
+                 offsets.begin() - 1;
+      for (; start < end; ++i) {
+        const int64 input_end = std::min(end, offsets[i + 1]);
+        const string* input = input_data[i];
+        int64* output = output_data[i];
+        HashRange(input, start - offsets[i], input_end - offsets[i],
+                  num_buckets_[i], output);
+        start = input_end;
+      }
+    };
+
+    auto worker_threads = context->device()->tensorflow_cpu_worker_threads();
+#if defined (__AVX512F__)
+    const int64 element_cost = 25;  // for AVX512 batch-vectorized impl.
+#else
+    const int64 element_cost = 100;  // Estimated for 32 byte strings.
+#endif
+    // NOTE(zycao): Here we have to use 'num_threads - 1' to make sure no more
+    // task fractions should be created. The cost is also a coarse estimation.
+    Shard(worker_threads->num_threads - 1, worker_threads->workers,
+          offsets.back(), element_cost, RunTask);
+  }
+
+ private:
+  // Hashes input[start, end) of one input into output.
+  static void HashRange(const string* input, int64 start, const int64 end,
+                        const uint64 num_buckets, int64* output) {
+#if defined(__AVX512F__)
+    const char* batch_ptr[8];
+    uint64_t input_hash[8];
+    for (; start + 8 <= end; start += 8) {
+      // Hash64Farm_Batch512 hashes 8 strings having the same length.
+      bool enable_batch_hash = true;
+      const size_t size_0 = input[start].size();
+      batch_ptr[0] = input[start].data();
+      for (int j = 1; j < 8; j++) {
+        if (input[start + j].size() == size_0) {
+          batch_ptr[j] = input[start + j].data();
+        } else {
+          enable_batch_hash = false;
+          break;
+        }
+      }
+      if (enable_batch_hash) {
+        Hash64Farm_Batch512(batch_ptr, &input_hash[0], size_0);
+      } else {
+        // roll back to normal Hash64 function
+        for (int j = 0; j < 8; j++) {
+          input_hash[j] = (uint64_t)hash(input[start + j]);
+        }
+      }
+      for (int j = 0; j < 8; j++) {
+        output[start + j] = Bucketize(input_hash[j], num_buckets);
+      }
+    }
+#endif
+    // for remained iterations
+    for (; start < end; ++start) {
+      output[start] = Bucketize(hash(input[start]), num_buckets);
+    }
+  }
+
+  static int64 Bucketize(const uint64 input_hash, const uint64 num_buckets) {
+    // The number of buckets is always in the positive range of int64 so is
+    // the resulting bucket_id.
+    return num_buckets > 0 ? static_cast<int64>(input_hash % num_buckets)
+                           : static_cast<int64>(input_hash & kint64max);
+  }
+
+  std::vector<int64> num_buckets_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(MultiStringToHashOp);
+};
+
 class StringToHashOp : public OpKernel {
  public:
   explicit StringToHashOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
@@ -230,4 +230,45 @@ REGISTER_KERNEL_BUILDER(
     TensorBufferSizeOp);
 #endif  // TENSORFLOW_USE_SYCL
 
+class TensorBufferStatsOp : public TensorBufferOp {
+ public:
+  explicit TensorBufferStatsOp(OpKernelConstruction* ctx)
+      : TensorBufferOp(ctx) {}
+
+  void ComputeWithTensorBuf(OpKernelContext* ctx, TensorBuf* buf) override {
+    Tensor* size = nullptr;
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(0, TensorShape({}), &size));
+    Tensor* capacity = nullptr;
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(1, TensorShape({}), &capacity));
+    Tensor* num_takes = nullptr;
+    OP_REQUIRES_OK(ctx, ctx->allocate_output(2, TensorShape({}), &num_takes));
+    Tensor* take_wait_micros = nullptr;
+    OP_REQUIRES_OK(
+        ctx, ctx->allocate_output(3, TensorShape({}), &take_wait_micros));
+    OP_REQUIRES_OK(ctx,
+                   buf->GetStats(size, capacity, num_takes, take_wait_micros));
+  }
+};
+
+REGISTER_KERNEL_BUILDER(Name("TensorBufferStats").Device(DEVICE_CPU),
+                        TensorBufferStatsOp);
+#if GOOGLE_CUDA
+REGISTER_KERNEL_BUILDER(Name("TensorBufferStats")
+                            .HostMemory("size")
+                            .HostMemory("capacity")
+                            .HostMemory("num_takes")
+                            .HostMemory("take_wait_micros")
+                            .Device(DEVICE_GPU),
+                        TensorBufferStatsOp);
+#endif  // GOOGLE_CUDA
+#ifdef TENSORFLOW_USE_SYCL
+REGISTER_KERNEL_BUILDER(Name("TensorBufferStats")
+                            .HostMemory("size")
+                            .HostMemory("capacity")
+                            .HostMemory("num_takes")
+                            .HostMemory("take_wait_micros")
+                            .Device(DEVICE_SYCL),
+                        TensorBufferStatsOp);
+#endif  // TENSORFLOW_USE_SYCL
+
 }  // namespace tensorflow
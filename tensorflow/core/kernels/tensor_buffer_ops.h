@@ -34,97 +34,189 @@ limitations under the License.
 #include "third_party/eigen3/Eigen/Core"
 #include "third_party/eigen3/unsupported/Eigen/CXX11/Tensor"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstddef>
-#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 namespace tensorflow {
 
 #define TF_RESOURCE_DEBUG_STRING_CONST const
 
+// Bounded multi-producer multi-consumer ring (Vyukov). Every slot carries a
+// sequence number telling whether it is ready to be written or read at a
+// given position, so that producers and consumers only contend on a CAS of
+// their own cursor. The slot of position pos is writable at sequence 2 * pos
+// and readable at 2 * pos + 1, which keeps the two states apart even when
+// the next lap of a single slot ring starts at pos + 1.
+template <typename T>
+class MpmcRing {
+ public:
+  explicit MpmcRing(std::size_t capacity)
+      : capacity_(capacity), slots_(new Slot[capacity]) {
+    for (std::size_t i = 0; i < capacity_; ++i) {
+      slots_[i].seq.store(2 * i, std::memory_order_relaxed);
+    }
+  }
+
+  bool TryPush(T* value) {
+    std::size_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots_[pos % capacity_];
+      std::size_t seq = slot.seq.load(std::memory_order_acquire);
+      std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) -
+                            static_cast<std::ptrdiff_t>(2 * pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          slot.value = std::move(*value);
+          slot.seq.store(2 * pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // full
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool TryPop(T* value) {
+    std::size_t pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots_[pos % capacity_];
+      std::size_t seq = slot.seq.load(std::memory_order_acquire);
+      std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) -
+                            static_cast<std::ptrdiff_t>(2 * pos + 1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          *value = std::move(slot.value);
+          slot.value = T();
+          slot.seq.store(2 * (pos + capacity_), std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // empty
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Number of claimed slots, may include pushes and pops in flight.
+  std::size_t Size() const {
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    return tail > head ? std::min(tail - head, capacity_) : 0;
+  }
+
+ private:
+  struct Slot {
+    std::atomic<std::size_t> seq;
+    T value;
+  };
+  const std::size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  // Cursors live on their own cache lines so producers and consumers do
+  // not invalidate each other.
+  alignas(64) std::atomic<std::size_t> head_{0};
+  alignas(64) std::atomic<std::size_t> tail_{0};
+};
+
 class TensorBuf : public ResourceBase {
  public:
   explicit TensorBuf(int64 capacity)
-      : capacity_(capacity), is_cancelled_(false), is_closed_(false) {}
+      : capacity_(capacity), buffer_(capacity),
+        is_cancelled_(false), is_closed_(false),
+        num_takes_(0), take_wait_micros_(0) {}
 
   ~TensorBuf() { Cancel(); }
 
   Status Put(const std::vector<Tensor>& record, int64 timeout_millis) {
-    std::unique_lock<std::mutex> lock(mu_);
-
-    bool should_retry = !put_cv_.wait_for(
-        lock, std::chrono::milliseconds(timeout_millis),
-        [this]() { return buffer_.size() < capacity_ || is_cancelled_; });
+    std::vector<Tensor> value(record);
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(timeout_millis);
+    bool pushed = false;
+    bool should_retry = !Wait(&put_waiter_, [&]() {
+      if (is_cancelled_.load()) {
+        return true;
+      }
+      pushed = buffer_.TryPush(&value);
+      return pushed;
+    }, &deadline);
     if (should_retry) {
-      lock.unlock();
       LOG(WARNING) << "Prefetching was ignored since timeout.";
       return Status::OK();
     }
 
-    if (TF_PREDICT_FALSE(is_cancelled_)) {
-      lock.unlock();
+    if (TF_PREDICT_FALSE(!pushed)) {
       return Status(errors::Cancelled("Session was closed."));
     }
 
-    buffer_.push_back(std::move(record));
-
-    lock.unlock();
-    take_cv_.notify_all();
-
+    Notify(&take_waiter_);
     return Status::OK();
   }
 
   Status Take(std::vector<Tensor>* record) {
-    std::unique_lock<std::mutex> lock(mu_);
-
-    take_cv_.wait(lock, [this]() { return !buffer_.empty() || is_cancelled_; });
-
-    if (TF_PREDICT_FALSE(is_closed_ && buffer_.empty())) {
-      lock.unlock();
+    bool popped = false;
+    auto start = std::chrono::steady_clock::now();
+    Wait(&take_waiter_, [&]() {
+      popped = buffer_.TryPop(record);
+      return popped || is_cancelled_.load();
+    }, nullptr);
+    take_wait_micros_ += std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    ++num_takes_;
+
+    if (TF_PREDICT_FALSE(!popped)) {
+      // drain what was put before the buffer was cancelled
+      popped = buffer_.TryPop(record);
+    }
+    if (TF_PREDICT_FALSE(!popped && is_closed_.load())) {
       return Status(errors::OutOfRange("EOF reached."));
     }
-
-    if (TF_PREDICT_FALSE(is_cancelled_ && buffer_.empty())) {
-      lock.unlock();
+    if (TF_PREDICT_FALSE(!popped)) {
       return Status(errors::Cancelled("Session was closed."));
     }
 
-    *record = std::move(buffer_.front());
-    buffer_.pop_front();
-
-    lock.unlock();
-    put_cv_.notify_all();
-
+    Notify(&put_waiter_);
     return Status::OK();
   }
 
   Status Cancel(bool is_cancelled = true) {
-    std::unique_lock<std::mutex> lock(mu_);
-
     is_cancelled_ = is_cancelled;
-
-    lock.unlock();
-    put_cv_.notify_all();
-    take_cv_.notify_all();
+    NotifyAll(&put_waiter_);
+    NotifyAll(&take_waiter_);
     return Status::OK();
   }
 
   Status Close() {
-    std::unique_lock<std::mutex> lock(mu_);
-
-    is_cancelled_ = true;
     is_closed_ = true;
-
-    lock.unlock();
-    put_cv_.notify_all();
-    take_cv_.notify_all();
+    is_cancelled_ = true;
+    NotifyAll(&put_waiter_);
+    NotifyAll(&take_waiter_);
     return Status::OK();
   }
 
   Status GetSize(Tensor* size) {
-    std::unique_lock<std::mutex> lock(mu_);
-    size->scalar<int32>().setConstant(static_cast<int64>(buffer_.size()));
+    size->scalar<int32>().setConstant(static_cast<int64>(buffer_.Size()));
+    return Status::OK();
+  }
+
+  // Outputs size and capacity of the buffer, and cumulative number of takes
+  // and time spent by takes waiting for records.
+  Status GetStats(Tensor* size, Tensor* capacity, Tensor* num_takes,
+                  Tensor* take_wait_micros) {
+    size->scalar<int32>().setConstant(static_cast<int32>(buffer_.Size()));
+    capacity->scalar<int32>().setConstant(static_cast<int32>(capacity_));
+    num_takes->scalar<int64>().setConstant(num_takes_.load());
+    take_wait_micros->scalar<int64>().setConstant(take_wait_micros_.load());
     return Status::OK();
   }
 
@@ -151,13 +243,72 @@ class TensorBuf : public ResourceBase {
   }
 
  private:
-  std::deque<std::vector<Tensor> > buffer_;
+  // Threads parked on one side of the buffer.
+  struct Waiter {
+    std::mutex mu;
+    std::condition_variable cv;
+    std::atomic<int> num_waiting{0};
+  };
+
+  static constexpr int kSpinCount = 64;
+  static constexpr int kYieldCount = 16;
+
+  // Retries ready() spinning, then yielding, then parked on waiter until it
+  // holds or deadline passes. Returns the last result of ready().
+  template <typename Ready>
+  bool Wait(Waiter* waiter, Ready ready,
+            const std::chrono::steady_clock::time_point* deadline) {
+    for (int i = 0; i < kSpinCount + kYieldCount; ++i) {
+      if (ready()) {
+        return true;
+      }
+      if (i >= kSpinCount) {
+        std::this_thread::yield();
+      }
+    }
+    std::unique_lock<std::mutex> lock(waiter->mu);
+    waiter->num_waiting.fetch_add(1);
+    // pairs with the fence in Notify: either the notifier sees the waiter or
+    // the waiter sees the state the notifier published
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool result;
+    while (!(result = ready())) {
+      if (deadline == nullptr) {
+        waiter->cv.wait(lock);
+      } else if (waiter->cv.wait_until(lock, *deadline) ==
+                 std::cv_status::timeout) {
+        result = ready();
+        break;
+      }
+    }
+    waiter->num_waiting.fetch_sub(1);
+    return result;
+  }
+
+  // Wakes a single parked thread, if any.
+  void Notify(Waiter* waiter) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiter->num_waiting.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> lock(waiter->mu);
+      waiter->cv.notify_one();
+    }
+  }
+
+  void NotifyAll(Waiter* waiter) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::lock_guard<std::mutex> lock(waiter->mu);
+    waiter->cv.notify_all();
+  }
+
   std::size_t capacity_;
-  bool is_cancelled_;
-  bool is_closed_;
+  MpmcRing<std::vector<Tensor> > buffer_;
+  std::atomic<bool> is_cancelled_;
+  std::atomic<bool> is_closed_;
+  std::atomic<int64> num_takes_;
+  std::atomic<int64> take_wait_micros_;
+  Waiter put_waiter_;
+  Waiter take_waiter_;
   std::mutex mu_;
-  std::condition_variable take_cv_;
-  std::condition_variable put_cv_;
   std::shared_ptr<thread::ThreadPool> threads_;
 };
 }
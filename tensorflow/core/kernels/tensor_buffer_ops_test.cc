@@ -0,0 +1,152 @@
+/* Copyright 2022 The DeepRec Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/tensor_buffer_ops.h"
+
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+
+namespace {
+
+std::vector<Tensor> MakeRecord(int64 value) {
+  Tensor t(DT_INT64, TensorShape({}));
+  t.scalar<int64>()() = value;
+  return {t};
+}
+
+}  // namespace
+
+TEST(TensorBufTest, PutTakeInOrder) {
+  TensorBuf* buf = new TensorBuf(2);
+  core::ScopedUnref unref(buf);
+  TF_ASSERT_OK(buf->Put(MakeRecord(1), 1000));
+  TF_ASSERT_OK(buf->Put(MakeRecord(2), 1000));
+  Tensor size(DT_INT32, TensorShape({}));
+  TF_ASSERT_OK(buf->GetSize(&size));
+  EXPECT_EQ(2, size.scalar<int32>()());
+
+  std::vector<Tensor> record;
+  TF_ASSERT_OK(buf->Take(&record));
+  EXPECT_EQ(1, record[0].scalar<int64>()());
+  TF_ASSERT_OK(buf->Take(&record));
+  EXPECT_EQ(2, record[0].scalar<int64>()());
+}
+
+TEST(TensorBufTest, PutTimesOutWhenFull) {
+  TensorBuf* buf = new TensorBuf(1);
+  core::ScopedUnref unref(buf);
+  TF_ASSERT_OK(buf->Put(MakeRecord(1), 1000));
+  // dropped after the timeout
+  TF_ASSERT_OK(buf->Put(MakeRecord(2), 10));
+  Tensor size(DT_INT32, TensorShape({}));
+  TF_ASSERT_OK(buf->GetSize(&size));
+  EXPECT_EQ(1, size.scalar<int32>()());
+}
+
+TEST(TensorBufTest, CancelAndClose) {
+  TensorBuf* buf = new TensorBuf(4);
+  core::ScopedUnref unref(buf);
+  TF_ASSERT_OK(buf->Put(MakeRecord(1), 1000));
+  TF_ASSERT_OK(buf->Cancel());
+  EXPECT_TRUE(errors::IsCancelled(buf->Put(MakeRecord(2), 1000)));
+  // records put before cancellation are still taken
+  std::vector<Tensor> record;
+  TF_ASSERT_OK(buf->Take(&record));
+  EXPECT_EQ(1, record[0].scalar<int64>()());
+  EXPECT_TRUE(errors::IsCancelled(buf->Take(&record)));
+  TF_ASSERT_OK(buf->Close());
+  EXPECT_TRUE(errors::IsOutOfRange(buf->Take(&record)));
+}
+
+TEST(TensorBufTest, CloseWakesBlockedTake) {
+  TensorBuf* buf = new TensorBuf(1);
+  core::ScopedUnref unref(buf);
+  Status status;
+  std::unique_ptr<Thread> taker(Env::Default()->StartThread(
+      ThreadOptions(), "taker", [buf, &status] {
+        std::vector<Tensor> record;
+        status = buf->Take(&record);
+      }));
+  Env::Default()->SleepForMicroseconds(10000);
+  TF_ASSERT_OK(buf->Close());
+  taker.reset();
+  EXPECT_TRUE(errors::IsOutOfRange(status));
+}
+
+TEST(TensorBufTest, ManyProducersAndConsumers) {
+  constexpr int kThreads = 4;
+  constexpr int kRecords = 1000;
+  TensorBuf* buf = new TensorBuf(3);
+  core::ScopedUnref unref(buf);
+  std::atomic<int64> sum(0);
+  std::atomic<int64> taken(0);
+  {
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int i = 0; i < kThreads; ++i) {
+      threads.emplace_back(Env::Default()->StartThread(
+          ThreadOptions(), "producer", [buf] {
+            for (int j = 0; j < kRecords; ++j) {
+              TF_CHECK_OK(buf->Put(MakeRecord(j), 60000));
+            }
+          }));
+      threads.emplace_back(Env::Default()->StartThread(
+          ThreadOptions(), "consumer", [buf, &sum, &taken] {
+            for (int j = 0; j < kRecords; ++j) {
+              std::vector<Tensor> record;
+              TF_CHECK_OK(buf->Take(&record));
+              sum += record[0].scalar<int64>()();
+              ++taken;
+            }
+          }));
+    }
+  }
+  EXPECT_EQ(kThreads * kRecords, taken);
+  EXPECT_EQ(kThreads * kRecords * (kRecords - 1) / 2, sum);
+}
+
+static void BM_TensorBufContention(int iters, int num_threads) {
+  testing::StopTiming();
+  TensorBuf* buf = new TensorBuf(num_threads);
+  core::ScopedUnref unref(buf);
+  int64 per_thread = std::max(1, iters / num_threads);
+  std::vector<Tensor> record = MakeRecord(0);
+  testing::StartTiming();
+  {
+    std::vector<std::unique_ptr<Thread>> threads;
+    for (int i = 0; i < num_threads; ++i) {
+      threads.emplace_back(Env::Default()->StartThread(
+          ThreadOptions(), "producer", [buf, per_thread, &record] {
+            for (int64 j = 0; j < per_thread; ++j) {
+              TF_CHECK_OK(buf->Put(record, 60000));
+            }
+          }));
+      threads.emplace_back(Env::Default()->StartThread(
+          ThreadOptions(), "consumer", [buf, per_thread] {
+            std::vector<Tensor> out;
+            for (int64 j = 0; j < per_thread; ++j) {
+              TF_CHECK_OK(buf->Take(&out));
+            }
+          }));
+    }
+  }
+  testing::StopTiming();
+  testing::ItemsProcessed(per_thread * num_threads);
+}
+BENCHMARK(BM_TensorBufContention)->Arg(1)->Arg(4)->Arg(16);
+
+}  // namespace tensorflow
@@ -83,7 +83,8 @@ struct EmbeddingVariableInputLockHolder {
 
 template<typename K, typename V>
 EmbeddingVariableInputLockHolder<K, V> MaybeLockEmbeddingVariableInputMutexesInOrder(
-    OpKernelContext* ctx, bool do_lock, const std::vector<int>& input_ids) {
+    OpKernelContext* ctx, bool do_lock, const std::vector<int>& input_ids,
+    bool row_lock_supported = true) {
   if (!do_lock) {
     return EmbeddingVariableInputLockHolder<K, V>({}, {});
   }
@@ -94,6 +95,11 @@ EmbeddingVariableInputLockHolder<K, V> MaybeLockEmbeddingVariableInputMutexesInO
     EmbeddingVar<K, V>* var;
     mutex* mutex = GetTrainingEmbeddingVariableMutex(ctx, input, &var);
     if (var) vars.push_back(var);
+    // Rows of an EmbeddingVar in row lock mode are guarded one by one with
+    // EmbeddingRowWriteLock. Kernels that update rows without taking row
+    // locks (the GPU kernels) pass row_lock_supported=false and keep the
+    // variable mutex.
+    if (var && var->IsRowLock() && row_lock_supported) continue;
     // Only lock each mutex once if duplicates exist (n^2 but n is 2 or 3).
     if (std::find(mutexes.begin(), mutexes.end(), mutex) == mutexes.end()) {
       acquire_order.push_back(mutexes.size());
@@ -108,9 +114,7 @@ EmbeddingVariableInputLockHolder<K, V> MaybeLockEmbeddingVariableInputMutexesInO
   locks->reserve(acquire_order.size());
 
   for (auto input : acquire_order) {
-    EmbeddingVar<K, V>* var;
-    mutex* mu = GetTrainingEmbeddingVariableMutex(ctx, input, &var);
-    core::ScopedUnref scoped_unref(var);
+    mutex* mu = mutexes[input];
     if (mu != nullptr) {
       locks->emplace_back(*mu);
     }
@@ -118,6 +122,32 @@ EmbeddingVariableInputLockHolder<K, V> MaybeLockEmbeddingVariableInputMutexesInO
   return EmbeddingVariableInputLockHolder<K, V>(std::move(vars), std::move(locks));
 }
 
+// Guards the update of one row of an EmbeddingVar in row lock mode, the
+// gathers of the row running concurrently retry until the update is done.
+// Does nothing when the EmbeddingVar is not in row lock mode.
+template <class V>
+class EmbeddingRowWriteLock {
+ public:
+  template <class K>
+  EmbeddingRowWriteLock(EmbeddingVar<K, V>* var, ValuePtr<V>* value_ptr)
+      : value_ptr_(var->IsRowLock() ? value_ptr : nullptr) {
+    if (value_ptr_ != nullptr) {
+      value_ptr_->WriteBegin();
+    }
+  }
+
+  ~EmbeddingRowWriteLock() {
+    if (value_ptr_ != nullptr) {
+      value_ptr_->WriteEnd();
+    }
+  }
+
+ private:
+  ValuePtr<V>* value_ptr_;
+
+  TF_DISALLOW_COPY_AND_ASSIGN(EmbeddingRowWriteLock);
+};
+
 template<class K, class V, class Tstep>
 void LookupKeyAndSetVersion(
     OpKernelContext* ctx, EmbeddingVar<K, V>* var,
@@ -148,6 +148,7 @@ class KvSparseApplyAdagradOp : public OpKernel {
                            &is_filter, indices_as_pointer, count));
             var->UpdateVersion(value_ptr, gs);
             if (is_filter) {
+              EmbeddingRowWriteLock<T> row_lock(var, value_ptr);
               auto a = accum->flat(value_ptr, index);
               auto g = grad_flat.template chip<0>(i);
               auto v = var->flat(value_ptr, index);
@@ -250,7 +251,8 @@ class KvSparseApplyAdagradGPUOp : public OpKernel {
 
   void Compute(OpKernelContext* ctx) override NO_THREAD_SAFETY_ANALYSIS {
     auto locks =
-        MaybeLockEmbeddingVariableInputMutexesInOrder<TKey, T>(ctx, use_exclusive_lock_, {0, 1});
+        MaybeLockEmbeddingVariableInputMutexesInOrder<TKey, T>(
+            ctx, use_exclusive_lock_, {0, 1}, /*row_lock_supported=*/false);
 
     EmbeddingVar<TKey, T>* var = nullptr;
     OP_REQUIRES_OK(ctx, GetInputEmbeddingVar(ctx, 0, &var));
@@ -548,6 +550,7 @@ class KvSparseApplyFtrlOp : public OpKernel {
             OP_REQUIRES_OK(ctx, var_->LookupOrCreateKey(index, &value_ptr,
                            &is_filter, indices_as_pointer, count));
             if (is_filter) {
+              EmbeddingRowWriteLock<T> row_lock(var_, value_ptr);
               auto var = var_->flat(value_ptr, index);
               auto accum = accum_->flat(value_ptr, index);
               auto linear = linear_->flat(value_ptr, index);
@@ -1308,6 +1311,7 @@ class KvSparseApplyAdagradDecayOp : public OpKernel {
                            &is_filter, indices_as_pointer, count));
             var->UpdateVersion(value_ptr, gs);
             if (is_filter) {
+              EmbeddingRowWriteLock<T> row_lock(var, value_ptr);
               auto a = accum->flat(value_ptr, index);
 
               auto g = grad_flat.template chip<0>(i);
@@ -1515,6 +1519,7 @@ class KvSparseApplyAdamOp : public OpKernel {
                            &is_filter, indices_as_pointer, count));
             var->UpdateVersion(value_ptr, gs);
             if (is_filter) {
+              EmbeddingRowWriteLock<T> row_lock(var, value_ptr);
               auto var_i = var->flat(value_ptr, index);
               auto m_a = m->flat(value_ptr, index);
               auto v_a = v->flat(value_ptr, index);
@@ -1573,6 +1578,212 @@ TF_CALL_float(REGISTER_CPU_KERNELS);
 #undef REGISTER_CPU_KERNELS
 #undef REGISTER_KERNELS
 
+template <typename TKey, typename T, typename Tstep,
+          bool indices_as_pointer, bool has_counts>
+class KvSparseApplyLazyAdamOp : public OpKernel {
+ public:
+  explicit KvSparseApplyLazyAdamOp(OpKernelConstruction* ctx)
+      : OpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("use_locking", &use_exclusive_lock_));
+  }
+
+  void Compute(OpKernelContext* ctx) override NO_THREAD_SAFETY_ANALYSIS {
+    auto locks = MaybeLockEmbeddingVariableInputMutexesInOrder<TKey, T>(
+        ctx, use_exclusive_lock_, {0, 1, 2});
+    EmbeddingVar<TKey, T>* var = nullptr;
+    OP_REQUIRES_OK(ctx, GetInputEmbeddingVar(ctx, 0, &var));
+    core::ScopedUnref unref_var(var);
+
+    EmbeddingVar<TKey, T>* m = nullptr;
+    OP_REQUIRES_OK(ctx, GetInputEmbeddingVar(ctx, 1, &m));
+    core::ScopedUnref unref_m(m);
+
+    EmbeddingVar<TKey, T>* v = nullptr;
+    OP_REQUIRES_OK(ctx, GetInputEmbeddingVar(ctx, 2, &v));
+    core::ScopedUnref unref_v(v);
+
+    // The step of the last update of a row is kept in the global step field
+    // of its ValuePtr header, which has to exist and has to be saved along
+    // with the moments. The field is the version steps_to_live evicts by, a
+    // row evicted after steps_to_live idle steps restarts with zero moments.
+    OP_REQUIRES(
+        ctx, var->IsSaveVersion() &&
+             var->GetLayoutType() != LayoutType::LIGHT &&
+             var->GetLayoutType() != LayoutType::COMPACT,
+        errors::InvalidArgument(
+            "KvResourceSparseApplyLazyAdam needs the EmbeddingVariable to",
+            " record version, please set steps_to_live or",
+            " TF_RECORD_VERSION=1, and do not use 'light' or 'compact'",
+            " layout."));
+
+    const Tensor& lr = ctx->input(3);
+    const Tensor& beta1 = ctx->input(4);
+    const Tensor& beta2 = ctx->input(5);
+    const Tensor& epsilon = ctx->input(6);
+    const Tensor& grad = ctx->input(7);
+    const Tensor& indices = ctx->input(8);
+    const Tensor& global_step = ctx->input(9);
+
+    OP_REQUIRES(
+        ctx, TensorShapeUtils::IsScalar(lr.shape()),
+        errors::InvalidArgument("lr is not a scalar: ",
+                                lr.shape().DebugString()));
+    OP_REQUIRES(
+        ctx, TensorShapeUtils::IsScalar(beta1.shape()),
+        errors::InvalidArgument("beta1 is not a scalar: ",
+                                beta1.shape().DebugString()));
+    OP_REQUIRES(
+        ctx, TensorShapeUtils::IsScalar(beta2.shape()),
+        errors::InvalidArgument("beta2 is not a scalar: ",
+                                beta2.shape().DebugString()));
+    OP_REQUIRES(
+        ctx, TensorShapeUtils::IsScalar(epsilon.shape()),
+        errors::InvalidArgument("epsilon is not a scalar: ",
+                                epsilon.shape().DebugString()));
+    OP_REQUIRES(
+        ctx, TensorShapeUtils::IsVector(indices.shape()),
+        errors::InvalidArgument("indices must be one-dimensional"));
+    OP_REQUIRES(
+        ctx, IsLegacyScalar(global_step.shape()),
+        errors::InvalidArgument(
+            "global_step is not a scalar: ", global_step.shape().DebugString()));
+
+    int64 inner_dim = 1;
+    TensorShape var_shape({var->ValueLen()});
+    for (int d = 0; d < var_shape.dims(); d++) {
+      OP_REQUIRES(ctx, var_shape.dim_size(d) == grad.dim_size(d + 1),
+                  errors::InvalidArgument(strings::StrCat(
+                      "var and grad must match in dimension ", d + 1)));
+      inner_dim *= grad.dim_size(d + 1);
+    }
+    OP_REQUIRES(
+        ctx, inner_dim > 0,
+        errors::InvalidArgument(
+            "Inner dimension should be greater than zero."));
+
+    const int64 N = indices.dim_size(0);
+    OP_REQUIRES(
+        ctx, grad.dim_size(0) == N,
+        errors::InvalidArgument(
+            "grad must be the same size as indices in the first dimension."));
+    int64* indices_counts = nullptr;
+    std::function<int64(int64*, int64)> get_count_fn = 0;
+    if (has_counts) {
+      const Tensor& counts_tensor = ctx->input(10);
+      indices_counts = (int64*)counts_tensor.data();
+      get_count_fn = [](int64* counts, int64 index) {return counts[index];};
+    } else {
+      get_count_fn = [](int64* counts, int64 index) {return 1;};
+    }
+
+    if (N > 0) {
+      const T lr_scalar = lr.scalar<T>()();
+      const T beta1_scalar = beta1.scalar<T>()();
+      const T beta2_scalar = beta2.scalar<T>()();
+      const T epsilon_scalar = epsilon.scalar<T>()();
+      const int64 gs = global_step.scalar<Tstep>()();
+      // The bias correction of dense Adam at step gs + 1, the beta powers
+      // are derived from the global step instead of being kept as variables.
+      const T t = static_cast<T>(gs + 1);
+      const T alpha = lr_scalar *
+          Eigen::numext::sqrt(static_cast<T>(1) -
+                              Eigen::numext::pow(beta2_scalar, t)) /
+          (static_cast<T>(1) - Eigen::numext::pow(beta1_scalar, t));
+
+      auto DoWork = [ctx, var, m, v, &grad, &indices, gs, beta1_scalar,
+           beta2_scalar, epsilon_scalar, alpha, get_count_fn,
+           indices_counts] (int64 start_i, int64 limit_i) {
+        auto grad_flat = grad.flat_outer_dims<T>();
+        auto indices_vec = indices.vec<TKey>();
+        for (int64 i = start_i; i < limit_i; i++) {
+          const TKey index = indices_vec(i);
+          ValuePtr<T>* value_ptr = nullptr;
+          bool is_filter = false;
+          int64 count = get_count_fn(indices_counts, i);
+          OP_REQUIRES_OK(ctx, var->LookupOrCreateKey(index, &value_ptr,
+                         &is_filter, indices_as_pointer, count));
+          const int64 last_step = value_ptr->GetStep();
+          var->UpdateVersion(value_ptr, gs);
+          if (is_filter) {
+            EmbeddingRowWriteLock<T> row_lock(var, value_ptr);
+            // The row got zero gradients in steps (last_step, gs), decay
+            // its moments as dense Adam would have done in those steps.
+            const int64 skipped =
+                (last_step >= 0 && gs > last_step) ? gs - last_step - 1 : 0;
+            T beta1_decay = beta1_scalar;
+            T beta2_decay = beta2_scalar;
+            if (skipped > 0) {
+              const T exponent = static_cast<T>(skipped + 1);
+              beta1_decay = Eigen::numext::pow(beta1_scalar, exponent);
+              beta2_decay = Eigen::numext::pow(beta2_scalar, exponent);
+            }
+            auto var_i = var->flat(value_ptr, index);
+            auto m_a = m->flat(value_ptr, index);
+            auto v_a = v->flat(value_ptr, index);
+
+            auto g = grad_flat.template chip<0>(i);
+            m_a = m_a * beta1_decay + g * (static_cast<T>(1) - beta1_scalar);
+            v_a = v_a * beta2_decay +
+                  g.square() * (static_cast<T>(1) - beta2_scalar);
+            var_i -= (m_a * alpha) / (v_a.sqrt() + epsilon_scalar);
+          }
+        }
+      };
+
+      const int64 cost = 1000;
+      auto worker_threads = *(ctx->device()->tensorflow_cpu_worker_threads());
+      Shard(worker_threads.num_threads, worker_threads.workers, N, cost, DoWork);
+      if (has_counts && !indices_as_pointer) {
+        const Tensor& indices_counts = ctx->input(10);
+        var->UpdateCache(indices, indices_counts);
+      }
+    }
+  }
+
+ private:
+  bool use_exclusive_lock_;
+};
+
+#define REGISTER_KERNELS(Tindices, T, Tstep)                                 \
+  REGISTER_KERNEL_BUILDER(Name("KvResourceSparseApplyLazyAdam")              \
+                              .Device(DEVICE_CPU)                            \
+                              .TypeConstraint<T>("T")                        \
+                              .TypeConstraint<Tindices>("Tindices")          \
+                              .TypeConstraint<Tstep>("Tstep"),               \
+                          KvSparseApplyLazyAdamOp<Tindices, T, Tstep,        \
+                                                  false, false>);            \
+  REGISTER_KERNEL_BUILDER(Name("_OPT_KvResourceSparseApplyLazyAdam")         \
+                              .Device(DEVICE_CPU)                            \
+                              .TypeConstraint<T>("T")                        \
+                              .TypeConstraint<Tindices>("Tindices")          \
+                              .TypeConstraint<Tstep>("Tstep"),               \
+                          KvSparseApplyLazyAdamOp<Tindices, T, Tstep,        \
+                                                  true, false>);             \
+  REGISTER_KERNEL_BUILDER(Name("KvResourceSparseApplyLazyAdamWithCounts")    \
+                              .Device(DEVICE_CPU)                            \
+                              .TypeConstraint<T>("T")                        \
+                              .TypeConstraint<Tindices>("Tindices")          \
+                              .TypeConstraint<Tstep>("Tstep"),               \
+                          KvSparseApplyLazyAdamOp<Tindices, T, Tstep,        \
+                                                  false, true>);             \
+  REGISTER_KERNEL_BUILDER(Name("_OPT_KvResourceSparseApplyLazyAdamWithCounts")\
+                              .Device(DEVICE_CPU)                            \
+                              .TypeConstraint<T>("T")                        \
+                              .TypeConstraint<Tindices>("Tindices")          \
+                              .TypeConstraint<Tstep>("Tstep"),               \
+                          KvSparseApplyLazyAdamOp<Tindices, T, Tstep,        \
+                                                  true, true>);
+#define REGISTER_CPU_KERNELS(T)        \
+  REGISTER_KERNELS(int32, T, int32);   \
+  REGISTER_KERNELS(int64, T, int32);   \
+  REGISTER_KERNELS(int32, T, int64);   \
+  REGISTER_KERNELS(int64, T, int64);
+
+TF_CALL_float(REGISTER_CPU_KERNELS);
+
+#undef REGISTER_CPU_KERNELS
+#undef REGISTER_KERNELS
+
 #if GOOGLE_CUDA
 template <typename Device, typename T, typename Tindex,
           bool indices_as_pointer, bool has_counts>
@@ -1623,7 +1834,7 @@ class KvSparseApplyAdamGPUOp : public OpKernel {
 
   void Compute(OpKernelContext* ctx) override NO_THREAD_SAFETY_ANALYSIS {
     auto locks = MaybeLockEmbeddingVariableInputMutexesInOrder<Tindex, T>(ctx, use_exclusive_lock_,
-                                                      {0, 1, 2});
+                                                      {0, 1, 2}, /*row_lock_supported=*/false);
     EmbeddingVar<Tindex, T>* var = nullptr;
     OP_REQUIRES_OK(ctx, GetInputEmbeddingVar(ctx, 0, &var));
     core::ScopedUnref unref_var(var);
@@ -2419,6 +2630,7 @@ class KvSparseApplyAdamAsyncOp : public OpKernel {
                            &is_filter, indices_as_pointer, count));
             var->UpdateVersion(value_ptr, gs);
             if (is_filter) {
+              EmbeddingRowWriteLock<T> row_lock(var, value_ptr);
               auto v_ = v->flat(value_ptr, index);
               auto m_ = m->flat(value_ptr, index);
               auto grad_ = grad_flat.template chip<0>(i);
@@ -2468,6 +2680,7 @@ class KvSparseApplyAdamAsyncOp : public OpKernel {
                              &is_filter, indices_as_pointer, count));
               var->UpdateVersion(value_ptr, gs);
               if (is_filter) {
+                EmbeddingRowWriteLock<T> row_lock(var, value_ptr);
                 auto m_a = m->flat(value_ptr, index);
                 auto v_a = v->flat(value_ptr, index);
                 auto g = grad_flat.template chip<0>(i);
@@ -2608,7 +2821,7 @@ class KvSparseApplyAdamAsyncGPUOp : public OpKernel {
 
   void Compute(OpKernelContext* ctx) override NO_THREAD_SAFETY_ANALYSIS {
     auto locks = MaybeLockEmbeddingVariableInputMutexesInOrder<Tindex, T>(
-      ctx, use_exclusive_lock_, {0, 1, 2, 3, 4});
+      ctx, use_exclusive_lock_, {0, 1, 2, 3, 4}, /*row_lock_supported=*/false);
     EmbeddingVar<Tindex, T>* var = nullptr;
     OP_REQUIRES_OK(ctx, GetInputEmbeddingVar(ctx, 0, &var));
     core::ScopedUnref unref_var(var);
@@ -2946,6 +3159,7 @@ class KvResourceSparseApplyGradientDescentOp : public OpKernel {
                            &is_filter, indices_as_pointer, count));
             var->UpdateVersion(value_ptr, gs);
             if (is_filter) {
+              EmbeddingRowWriteLock<T> row_lock(var, value_ptr);
               auto g = grad_flat.template chip<0>(i);
               auto v = var->flat(value_ptr, index);
               v -= g.constant(lr_scalar) * g;
@@ -3143,6 +3357,7 @@ class KvSparseApplyAdamWOp : public OpKernel {
                            &is_filter, indices_as_pointer, count));
             var->UpdateVersion(value_ptr, gs);
             if (is_filter) {
+              EmbeddingRowWriteLock<T> row_lock(var, value_ptr);
               auto var_i = var->flat(value_ptr, index);
               auto m_a = m->flat(value_ptr, index);
               auto v_a = v->flat(value_ptr, index);
@@ -3252,7 +3467,7 @@ class KvSparseApplyAdamWGPUOp : public OpKernel {
 
   void Compute(OpKernelContext* ctx) override NO_THREAD_SAFETY_ANALYSIS {
     auto locks = MaybeLockEmbeddingVariableInputMutexesInOrder<Tindex, T>(ctx, use_exclusive_lock_,
-                                                      {0, 1, 2});
+                                                      {0, 1, 2}, /*row_lock_supported=*/false);
     EmbeddingVar<Tindex, T>* var = nullptr;
     OP_REQUIRES_OK(ctx, GetInputEmbeddingVar(ctx, 0, &var));
     core::ScopedUnref unref_var(var);
@@ -54,7 +54,13 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <limits>
 #include <vector>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "double-conversion/double-conversion.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
@@ -84,33 +90,128 @@ bool DelimSupported(const char delim) {
             illegal_delims.find(delim) == StringPiece::npos);
 }
 
-inline bool GetValueOnTheFly(const char* input, size_t input_size, size_t* pos, int64* value)
-{
-  // on-the-fly strtoi processing.
-  // No overflow check here due to performance reason.
-  int64 sign = 1;
-  if (input[*pos] == '-') {
-    sign = -1;
-    ++(*pos);
-  } else if (input[*pos] == '+') {
-    ++(*pos);
+// Scans a record for delimiters 64 bytes at a time and keeps their
+// positions in a bitmask, in the style of simdjson structural indexing.
+// Tokens are then cut from the bitmask without touching the bytes again.
+class DelimScanner {
+ public:
+  DelimScanner(const char* input, size_t input_size, const char delim)
+      : input_(input), input_size_(input_size), delim_(delim),
+        block_(0), mask_(input_size > 0 ? BlockMask(0) : 0), pos_(0) {}
+
+  // Number of tokens in the record, i.e. number of delimiters plus one.
+  size_t Count() const {
+    size_t count = 1;
+    for (size_t block = 0; block < input_size_; block += 64) {
+      count += __builtin_popcountll(BlockMask(block));
+    }
+    return count;
   }
-  *value = 0;
-  if (input[*pos] >= '0' && input[*pos] <= '9') {
-    while (*pos < input_size && input[*pos] >= '0' && input[*pos] <= '9') {
-      (*value) = (*value) * 10 + input[*pos] - '0';
-      ++(*pos);
+
+  // Gets [start, end) of the next token, returns false if no more tokens.
+  bool Next(size_t* start, size_t* end) {
+    if (pos_ > input_size_) {
+      return false;
     }
-    (*value) *= sign;
+    *start = pos_;
+    while (mask_ == 0) {
+      block_ += 64;
+      if (block_ >= input_size_) {
+        *end = input_size_;
+        pos_ = input_size_ + 1;
+        return true;
+      }
+      mask_ = BlockMask(block_);
+    }
+    *end = block_ + __builtin_ctzll(mask_);
+    mask_ &= mask_ - 1;
+    pos_ = *end + 1;
     return true;
   }
-  return false;
+
+ private:
+  uint64 BlockMask(const size_t block) const {
+    const char* p = input_ + block;
+    if (block + 64 > input_size_) {
+      uint64 mask = 0;
+      for (size_t i = 0; i < input_size_ - block; ++i) {
+        mask |= static_cast<uint64>(p[i] == delim_) << i;
+      }
+      return mask;
+    }
+#if defined(__AVX2__)
+    const __m256i delims = _mm256_set1_epi8(delim_);
+    const uint32 lo = _mm256_movemask_epi8(_mm256_cmpeq_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), delims));
+    const uint32 hi = _mm256_movemask_epi8(_mm256_cmpeq_epi8(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32)), delims));
+    return static_cast<uint64>(lo) | (static_cast<uint64>(hi) << 32);
+#elif defined(__SSE2__)
+    const __m128i delims = _mm_set1_epi8(delim_);
+    uint64 mask = 0;
+    for (int i = 0; i < 4; ++i) {
+      const uint32 bits = _mm_movemask_epi8(_mm_cmpeq_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i)),
+          delims));
+      mask |= static_cast<uint64>(bits) << (16 * i);
+    }
+    return mask;
+#else
+    uint64 mask = 0;
+    for (size_t i = 0; i < 64; ++i) {
+      mask |= static_cast<uint64>(p[i] == delim_) << i;
+    }
+    return mask;
+#endif
+  }
+
+  const char* input_;
+  const size_t input_size_;
+  const char delim_;
+  size_t block_;
+  uint64 mask_;
+  size_t pos_;
+};
+
+inline bool IsDigit(const char c) {
+  return static_cast<unsigned char>(c - '0') < 10;
+}
+
+// Strips spaces around a token.
+inline void TrimToken(const char* input, size_t* start, size_t* end) {
+  while (*start < *end && input[*start] == ' ') {
+    ++(*start);
+  }
+  while (*end > *start && input[*end - 1] == ' ') {
+    --(*end);
+  }
 }
 
-inline bool GetValueOnTheFly(const char* input, size_t input_size, size_t* pos, int32* value)
-{
+// Parses the whole token [p, end) as an integer.
+// No overflow check here due to performance reason.
+inline bool ParseToken(const char* p, const char* end, int64* value) {
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    ++p;
+  }
+  if (p == end) {
+    return false;
+  }
+  uint64 v = 0;
+  for (; p < end; ++p) {
+    if (!IsDigit(*p)) {
+      return false;
+    }
+    v = v * 10 + (*p - '0');
+  }
+  *value = negative ? -static_cast<int64>(v) : static_cast<int64>(v);
+  return true;
+}
+
+inline bool ParseToken(const char* p, const char* end, int32* value) {
   int64 v0;
-  if (GetValueOnTheFly(input, input_size, pos, &v0)) {
+  if (ParseToken(p, end, &v0)) {
     // No overflow check here due to performance reason.
     *value = static_cast<int32>(v0);
     return true;
@@ -118,163 +219,136 @@ inline bool GetValueOnTheFly(const char* input, size_t input_size, size_t* pos,
   return false;
 }
 
-inline bool GetValueOnTheFly(const char* input, size_t input_size, size_t* pos, float* value)
-{
-  // on-the-fly strtof processing.
-  // No overflow check here due to performance reason.
-  const float log2_10 = std::log2(10.0f);
-  if (*pos < input_size) {
-    float fsign = 1.0f;
-    float ftail = 0.1f;
-    bool gotvalue = false;
-    if (input[*pos] == '-') {
-      fsign = -1.0f;
-      ++(*pos);
-    } else if (input[*pos] == '+') {
-      ++(*pos);
-    }
-    *value = 0.0f;
-    if (input[*pos] >= '0' && input[*pos] <= '9') {
-      gotvalue = true;
+// Parses the whole token [p, end) as a float. Mantissas of no more than
+// 2^53 scaled by exact powers of ten are computed directly, which rounds
+// same as strtod, others fall back to double-conversion. Unlike
+// strings::safe_strtof, the fallback takes tokens of any length.
+inline bool ParseToken(const char* p, const char* end, float* value) {
+  static const double kPow10[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  const char* token = p;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    ++p;
+  }
+  uint64 mantissa = 0;
+  int num_digits = 0;
+  int64 exp10 = 0;
+  for (; p < end && IsDigit(*p); ++p, ++num_digits) {
+    mantissa = mantissa * 10 + (*p - '0');
+  }
+  if (p < end && *p == '.') {
+    for (++p; p < end && IsDigit(*p); ++p, ++num_digits, --exp10) {
+      mantissa = mantissa * 10 + (*p - '0');
     }
-    while (*pos < input_size && input[*pos] >= '0' && input[*pos] <= '9') {
-      (*value) = (*value) * 10.0f + static_cast<float>(input[*pos] - '0');
-      ++(*pos);
-    } // integer part
-    if (*pos < input_size && input[*pos] == '.') {
-      ++(*pos);
-      if (*pos < input_size && input[*pos] >= '0' && input[*pos] <= '9') {
-        gotvalue = true;
-      }
-      while (*pos < input_size && input[*pos] >= '0' && input[*pos] <= '9') {
-        (*value) += ftail * static_cast<float>(input[*pos] - '0');
-        ftail *= 0.1f;
-        ++(*pos);
-      }
-    } // fraction part
-    if (gotvalue) {
-      (*value) *= fsign;
-    } else {
+  }
+  if (num_digits == 0) {
+    return false;
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    int64 exp_value;
+    if (!ParseToken(p + 1, end, &exp_value)) {
       return false;
     }
-    if (*pos < input_size && (input[*pos] == 'E' || input[*pos] == 'e')) {
-      ++(*pos);
-      if (*pos < input_size) {
-        int64 fexp_int = 0;
-        if (!GetValueOnTheFly(input, input_size, pos, &fexp_int)) {
-          return false;
-        }
-        (*value) *= std::exp2(static_cast<float>(fexp_int) * log2_10);
-        return true;
-      }
-    } else {
-      return true;
-    } // exponent part
+    exp10 += exp_value;
+  } else if (p != end) {
+    return false;
   }
-  return false;
+
+  if (num_digits <= 19 && mantissa <= (1ULL << 53) && exp10 >= -22 &&
+      exp10 <= 22) {
+    double v = static_cast<double>(mantissa);
+    v = exp10 < 0 ? v / kPow10[-exp10] : v * kPow10[exp10];
+    *value = static_cast<float>(negative ? -v : v);
+    return true;
+  }
+  static const double_conversion::StringToDoubleConverter converter(
+      double_conversion::StringToDoubleConverter::NO_FLAGS, 0., 0., nullptr,
+      nullptr);
+  const size_t len = end - token;
+  if (len > static_cast<size_t>(std::numeric_limits<int>::max())) {
+    return false;
+  }
+  int processed = 0;
+  *value = converter.StringToFloat(token, static_cast<int>(len), &processed);
+  return processed == static_cast<int>(len);
 }
 
-template <typename T>
-bool SplitNum(StringPiece &record, const char delim, std::vector<T>& result) {
+// Cuts tokens from a record and parses them. Spaces around tokens are
+// ignored. An empty token is invalid unless the delim is ' ' or it follows
+// a trailing delim.
+template <typename T, typename ParseFn>
+bool SplitTokens(StringPiece &record, const char delim, std::vector<T>& result,
+                 ParseFn parse) {
   const char *input = record.data();
   size_t input_size = record.size();
   if (input_size && delim != '\0') {
-    // No more than this number.
-    result.reserve(input_size / 2 + 1);
+    DelimScanner scanner(input, input_size, delim);
+    result.reserve(scanner.Count());
 
-    size_t i = 0;
-    while(i < input_size) {
-      while (i < input_size && input[i] == ' ') {
-        ++i;
+    size_t start, end;
+    while (scanner.Next(&start, &end)) {
+      if (start == input_size) {
+        break;
       }
-      if (i < input_size) {
-        T value = static_cast<T>(0);
-        if (!GetValueOnTheFly(input, input_size, &i, &value)) {
-          return false;
-        }
-        result.push_back(value);
-        while (i < input_size && input[i] == ' ' && delim != ' ') {
-          ++i;
+      TrimToken(input, &start, &end);
+      if (start == end) {
+        if (delim == ' ') {
+          continue;
         }
-        if (i == input_size || input[i] == delim) {
-          ++i;
-        } else {
-          return false;
-        }
-      } else if (delim == ' ') {
-        // If delim is ' ', it is OK for redundant spaces at the end of line.
-        return true;
-      } else {
-        // If delim is not ' ', only spaces found after a delim is irregular.
         return false;
       }
+      T value;
+      if (!parse(input + start, input + end, &value)) {
+        return false;
+      }
+      result.push_back(value);
     }
   }
   return true;
 }
 
+template <typename T>
+bool SplitNum(StringPiece &record, const char delim, std::vector<T>& result) {
+  return SplitTokens(record, delim, result,
+                     [](const char* p, const char* end, T* value) {
+                       return ParseToken(p, end, value);
+                     });
+}
+
 template <typename T>
 bool SplitKv(StringPiece &record, const char delim,
              std::vector<std::pair<int64, T> >& result) {
-  const char *input = record.data();
-  size_t input_size = record.size();
-
-  if (input_size && delim != '\0') {
-    // No more than this amount of kv pairs.
-    result.reserve(input_size / 4 + 1);
-
-    std::pair<int64, T> kv(0, static_cast<T>(0));
-    int64& key = kv.first;
-    T& value = kv.second;
-
-    size_t i = 0;
-    while(i < input_size) {
-      // parsing key phase
-      key = 0;
-      while (i < input_size && input[i] == ' ') {
-        ++i;
-      }
-      if (i < input_size) {
-        if (!GetValueOnTheFly(input, input_size, &i, &key)) {
+  return SplitTokens(
+      record, delim, result,
+      [](const char* p, const char* end, std::pair<int64, T>* kv) {
+        const char* sep = static_cast<const char*>(memchr(p, ':', end - p));
+        if (sep == nullptr) {
           return false;
         }
-        while (i < input_size && input[i] == ' ' && delim != ' ') {
-          ++i;
-        }
-        if (input[i] == ':') {
-          ++i;
-        } else {
-          return false;
-        }
-      } else if (delim == ' ') {
-        // If delim is ' ', it is OK for redundant spaces at the end of line.
-        return true;
-      } else {
-        // If delim is not ' ', only spaces found after a delim is irregular.
-        return false;
-      } // key parsed, otherwise false returned.
-
-      // parsing value phase.
-      while (i < input_size && input[i] == ' ' && delim != ' ') {
-        ++i;
-      }
-      value = static_cast<T>(0);
-      if (!GetValueOnTheFly(input, input_size, &i, &value)) {
-        return false;
-      }
-      result.push_back(kv);
+        size_t key_start = 0, key_end = sep - p;
+        TrimToken(p, &key_start, &key_end);
+        size_t value_start = 0, value_end = end - sep - 1;
+        TrimToken(sep + 1, &value_start, &value_end);
+        return ParseToken(p + key_start, p + key_end, &kv->first) &&
+               ParseToken(sep + 1 + value_start, sep + 1 + value_end,
+                          &kv->second);
+      });
+}
 
-      while (i < input_size && input[i] == ' ' && delim != ' ') {
-        ++i;
-      }
-      if (i == input_size || input[i] == delim) {
-        ++i;
-      } else {
-        return false;
-      } // value parsed.
-    }
+// Cost of parsing a record for sharding, which is dominated by its length.
+int64 ParseCost(const TTypes<string>::ConstFlat& records) {
+  const int64 batch_size = records.size();
+  if (batch_size == 0) {
+    return 0;
   }
-  return true;
+  int64 total_bytes = 0;
+  for (int64 i = 0; i < batch_size; ++i) {
+    total_bytes += records(i).size();
+  }
+  return 100 + 10 * total_bytes / batch_size;
 }
 
 } // namespace
@@ -343,7 +417,7 @@ class TransCsvID2SparseOp : public OpKernel {
     };
 
     auto worker_threads = *(ctx->device()->tensorflow_cpu_worker_threads());
-    const int64 cost = 5000; //very unreliable estimate for cost per step.
+    const int64 cost = ParseCost(records_t);
     Shard(worker_threads.num_threads, worker_threads.workers, batch_size, cost, doScan);
     OP_REQUIRES_OK(ctx, status);
 
@@ -489,7 +563,7 @@ class TransCsvID2DenseOp : public OpKernel {
     };
 
     auto worker_threads = *(ctx->device()->tensorflow_cpu_worker_threads());
-    const int64 cost = 5000; //very unreliable estimate for cost per step.
+    const int64 cost = ParseCost(records_t);
     Shard(worker_threads.num_threads, worker_threads.workers, batch_size, cost, doScan);
     OP_REQUIRES_OK(ctx, status);
 
@@ -640,7 +714,7 @@ class TransCsvKV2SparseOp : public OpKernel {
     };
 
     auto worker_threads = *(ctx->device()->tensorflow_cpu_worker_threads());
-    const int64 cost = 5000; //very unreliable estimate for cost per step.
+    const int64 cost = ParseCost(records_t);
     Shard(worker_threads.num_threads, worker_threads.workers, batch_size, cost, doScan);
     OP_REQUIRES_OK(ctx, status);
 
@@ -780,7 +854,7 @@ class TransCsvKV2DenseOp : public OpKernel {
     };
 
     auto worker_threads = *(ctx->device()->tensorflow_cpu_worker_threads());
-    const int64 cost = 5000; //very unreliable estimate for cost per step.
+    const int64 cost = ParseCost(records_t);
     Shard(worker_threads.num_threads, worker_threads.workers, batch_size, cost, doScan);
     OP_REQUIRES_OK(ctx, status);
 
@@ -906,7 +980,7 @@ class TransCsvToDenseOp : public OpKernel {
     };
 
     auto worker_threads = *(ctx->device()->tensorflow_cpu_worker_threads());
-    const int64 cost = 5000; //very unreliable estimate for cost per step.
+    const int64 cost = ParseCost(records_t);
     Shard(worker_threads.num_threads, worker_threads.workers, batch_size, cost, doScan);
     OP_REQUIRES_OK(ctx, status);
 
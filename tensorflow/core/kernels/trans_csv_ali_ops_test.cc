@@ -18,6 +18,7 @@
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/kernels/ops_util.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
@@ -919,6 +920,73 @@ TEST_F(TransCsvToDenseTest, MaxIdNotBigEnough) {
   EXPECT_EQ(::tensorflow::error::INVALID_ARGUMENT, RunOpKernel().code());
 }
 
+TEST_F(TransCsvToDenseTest, LongRecord) {
+  CreateOp(DT_INT64, ",");
+  TF_ASSERT_OK(InitOp());
+
+  // delims span several 64 bytes blocks
+  string record;
+  std::vector<int64> expected;
+  for (int64 i = 0; i < 100; ++i) {
+    strings::StrAppend(&record, i * 997 - 5000, i % 3 == 1 ? " , " : ",");
+    expected.push_back(i * 997 - 5000);
+  }
+  // input records
+  AddInputFromArray<string>(TensorShape({2}), {record, "1"});
+  // max_id
+  AddInputFromArray<int64>(TensorShape({}), {-1048575});
+
+  TF_ASSERT_OK(RunOpKernel());
+
+  expected.push_back(1);
+  for (int64 i = 1; i < 100; ++i) {
+    expected.push_back(0);
+  }
+  Tensor expected_values(allocator(), DT_INT64, {2, 100});
+  test::FillValues<int64>(&expected_values, expected);
+  test::ExpectTensorEqual<int64>(expected_values, *GetOutput(0));
+}
+
+TEST_F(TransCsvToDenseTest, FloatFormats) {
+  CreateOp(DT_FLOAT, ",");
+  TF_ASSERT_OK(InitOp());
+
+  // input records
+  AddInputFromArray<string>(TensorShape({2}), {
+                            "1e3, -2.5E-3, 3., .25,",
+                            "0.1234567890123456789012, 1e-30, 7"});
+  // max_id
+  AddInputFromArray<int64>(TensorShape({}), {4});
+
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected_values(allocator(), DT_FLOAT, {2, 4});
+  test::FillValues<float>(&expected_values, {
+                             1e3, -2.5e-3, 3., .25,
+                             0.1234567890123456789012, 1e-30, 7., 0.});
+  test::ExpectTensorEqual<float>(expected_values, *GetOutput(0));
+}
+
+TEST_F(TransCsvToDenseTest, LongFloatTokens) {
+  CreateOp(DT_FLOAT, ",");
+  TF_ASSERT_OK(InitOp());
+
+  // tokens of 32 chars or more
+  AddInputFromArray<string>(TensorShape({2}), {
+                            "0.000000000000000000000000000000001, 2",
+                            "12345678901234567890123456789012345678, -1"});
+  // max_id
+  AddInputFromArray<int64>(TensorShape({}), {2});
+
+  TF_ASSERT_OK(RunOpKernel());
+
+  Tensor expected_values(allocator(), DT_FLOAT, {2, 2});
+  test::FillValues<float>(&expected_values, {
+                             1e-33, 2.,
+                             12345678901234567890123456789012345678., -1.});
+  test::ExpectTensorEqual<float>(expected_values, *GetOutput(0));
+}
+
 
 template <typename T>
 static Graph* CsvID2Sparse(Tensor& records_t) {
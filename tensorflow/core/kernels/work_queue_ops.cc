@@ -13,9 +13,14 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstddef>
 #include <deque>
+#include <iterator>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <numeric>
 #include <vector>
@@ -67,9 +72,18 @@ namespace tensorflow {
 
 using shape_inference::InferenceContext;
 
+// A queue of works shared by all consumers.
+//
+// Works are put into a global queue, from which every consumer refills its
+// own local queue in batches, preferring the works containing its locality.
+// A consumer whose local queue runs dry refills from the global queue, or
+// steals half of the largest local queue once the global queue is drained,
+// so that takes rarely contend on the global queue. Untaken works in local
+// queues are saved along with the global queue.
 class WorkQueue : public ResourceBase {
  public:
-  WorkQueue(const string& name) : name_(name), is_closed_(false) {}
+  WorkQueue(const string& name)
+      : name_(name), is_closed_(false), num_works_(0) {}
 
   ~WorkQueue() { Close(); }
 
@@ -78,7 +92,7 @@ class WorkQueue : public ResourceBase {
   }
 
   int64 MemoryUsed() const override {
-    return static_cast<int64>(queue_.size() * DataTypeSize(DT_STRING));
+    return static_cast<int64>(num_works_ * DataTypeSize(DT_STRING));
   }
 
   Status Put(const Tensor& inputs) {
@@ -96,6 +110,8 @@ class WorkQueue : public ResourceBase {
     for (int64 i = 0; i < num_puts; ++i) {
       queue_.push_back(inputs.flat<string>()(i));
     }
+    num_works_ += num_puts;
+    ++version_;
 
     lock.unlock();
     take_cv_.notify_all();
@@ -103,37 +119,67 @@ class WorkQueue : public ResourceBase {
     return Status::OK();
   }
 
-  Status Take(Tensor* output) {
-    std::unique_lock<std::mutex> lock(mu_);
-
-    take_cv_.wait(lock, [this]() { return !queue_.empty() || is_closed_; });
-
-    if (TF_PREDICT_FALSE(queue_.empty() && is_closed_)) {
-      return Status(errors::OutOfRange(
-          strings::StrCat("All works in work queue ", name_, " are taken.")));
+  // Takes at most num_works works for consumer. Blocks until a work is
+  // available, or returns OutOfRange once the queue is closed and drained.
+  Status TakeMany(int64 num_works, const string& consumer,
+                  const string& locality, std::vector<string>* works) {
+    LocalQueue* local = GetLocalQueue(consumer);
+    while (true) {
+      // Works made visible after this load bump version_, so that the wait
+      // below never misses them.
+      const uint64 version = version_;
+      {
+        tf_shared_lock state_lock(state_mu_);
+        if (local->size < num_works) {
+          Refill(local, num_works, locality);
+        }
+        if (local->size == 0) {
+          Steal(local);
+        }
+        if (TakeLocal(local, num_works, works)) {
+          if (num_works_ == 0) {
+            // Wake up the takes waiting for a closed queue to drain.
+            std::unique_lock<std::mutex> lock(mu_);
+            lock.unlock();
+            take_cv_.notify_all();
+          }
+          return Status::OK();
+        }
+      }
+
+      std::unique_lock<std::mutex> lock(mu_);
+      if (TF_PREDICT_FALSE(is_closed_ && num_works_ == 0)) {
+        return Status(errors::OutOfRange(
+            strings::StrCat("All works in work queue ", name_, " are taken.")));
+      }
+      // Remaining works are taken by others, or being moved to a local queue.
+      take_cv_.wait(lock, [this, version]() {
+        return version_ != version || (is_closed_ && num_works_ == 0);
+      });
     }
-
-    output->scalar<string>().setConstant(std::move(queue_.front()));
-    queue_.pop_front();
-
-    return Status::OK();
   }
 
   Status GetSize(Tensor* size) {
-    std::unique_lock<std::mutex> lock(mu_);
-    size->scalar<int64>().setConstant(static_cast<int64>(queue_.size()));
+    size->scalar<int64>().setConstant(static_cast<int64>(num_works_));
     return Status::OK();
   }
 
   Status Restore(const Tensor& restorable) {
     const int64 num_works = restorable.shape().dim_size(0);
 
+    mutex_lock state_lock(state_mu_);
     std::unique_lock<std::mutex> lock(mu_);
 
+    for (auto& it : local_queues_) {
+      it.second->works.clear();
+      it.second->size = 0;
+    }
     queue_.clear();
     for (int64 i = 0; i < num_works; ++i) {
       queue_.push_back(restorable.flat<string>()(i));
     }
+    num_works_ = num_works;
+    ++version_;
 
     lock.unlock();
     take_cv_.notify_all();
@@ -141,12 +187,20 @@ class WorkQueue : public ResourceBase {
   }
 
   Status Save(OpKernelContext* ctx, Tensor** saveable) {
+    mutex_lock state_lock(state_mu_);
     std::unique_lock<std::mutex> lock(mu_);
 
     TF_RETURN_IF_ERROR(ctx->allocate_output(
-        0, TensorShape({static_cast<int64>(queue_.size())}), saveable));
+        0, TensorShape({static_cast<int64>(num_works_)}), saveable));
+    auto saved = (*saveable)->flat<string>();
+    int64 index = 0;
+    for (auto& it : local_queues_) {
+      for (const string& work : it.second->works) {
+        saved(index++) = work;
+      }
+    }
     for (size_t i = 0; i < queue_.size(); ++i) {
-      (*saveable)->flat<string>()(i) = queue_[i];
+      saved(index++) = queue_[i];
     }
 
     return Status::OK();
@@ -184,6 +238,136 @@ class WorkQueue : public ResourceBase {
   }
 
  private:
+  struct LocalQueue {
+    std::mutex mu;
+    std::deque<string> works;
+    // Size of works, readable without mu.
+    std::atomic<int64> size{0};
+  };
+
+  // Max number of works moved to a local queue beyond the requested ones.
+  static constexpr int64 kMaxRefillSize = 16;
+  // Number of works at the front of the global queue searched for the works
+  // of a locality.
+  static constexpr int64 kLocalityWindow = 256;
+
+  LocalQueue* GetLocalQueue(const string& consumer) {
+    {
+      tf_shared_lock state_lock(state_mu_);
+      auto it = local_queues_.find(consumer);
+      if (it != local_queues_.end()) {
+        return it->second.get();
+      }
+    }
+    mutex_lock state_lock(state_mu_);
+    std::unique_ptr<LocalQueue>& local = local_queues_[consumer];
+    if (!local) {
+      local.reset(new LocalQueue);
+    }
+    return local.get();
+  }
+
+  void PushLocal(LocalQueue* local, std::vector<string>* works) {
+    if (works->empty()) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(local->mu);
+      for (string& work : *works) {
+        local->works.push_back(std::move(work));
+      }
+      local->size = local->works.size();
+    }
+    // Works in transit are visible again, wake up the takes waiting for them.
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      ++version_;
+    }
+    take_cv_.notify_all();
+  }
+
+  // Moves works from the global queue to local, so that it has num_works at
+  // least. Requires a shared lock on state_mu_.
+  void Refill(LocalQueue* local, int64 num_works, const string& locality) {
+    std::vector<string> refill;
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      if (queue_.empty()) {
+        return;
+      }
+      // Leave enough works to the other consumers.
+      int64 count = std::max(
+          num_works - local->size,
+          std::min<int64>(kMaxRefillSize,
+                          queue_.size() / (2 * local_queues_.size())));
+      if (!locality.empty()) {
+        int64 window = std::min<int64>(kLocalityWindow, queue_.size());
+        std::vector<string> others;
+        for (int64 i = 0; i < window; ++i) {
+          if (static_cast<int64>(refill.size()) < count &&
+              str_util::StrContains(queue_[i], locality)) {
+            refill.push_back(std::move(queue_[i]));
+          } else {
+            others.push_back(std::move(queue_[i]));
+          }
+        }
+        queue_.erase(queue_.begin(), queue_.begin() + window);
+        queue_.insert(queue_.begin(), std::make_move_iterator(others.begin()),
+                      std::make_move_iterator(others.end()));
+      }
+      while (static_cast<int64>(refill.size()) < count && !queue_.empty()) {
+        refill.push_back(std::move(queue_.front()));
+        queue_.pop_front();
+      }
+    }
+    PushLocal(local, &refill);
+  }
+
+  // Moves half of the largest other local queue to local. Requires a shared
+  // lock on state_mu_.
+  void Steal(LocalQueue* local) {
+    LocalQueue* victim = nullptr;
+    for (auto& it : local_queues_) {
+      LocalQueue* other = it.second.get();
+      if (other != local && other->size > 0 &&
+          (victim == nullptr || other->size > victim->size)) {
+        victim = other;
+      }
+    }
+    if (victim == nullptr) {
+      return;
+    }
+    std::vector<string> stolen;
+    {
+      std::lock_guard<std::mutex> lock(victim->mu);
+      size_t count = (victim->works.size() + 1) / 2;
+      stolen.reserve(count);
+      for (size_t i = victim->works.size() - count; i < victim->works.size();
+           ++i) {
+        stolen.push_back(std::move(victim->works[i]));
+      }
+      victim->works.resize(victim->works.size() - count);
+      victim->size = victim->works.size();
+    }
+    PushLocal(local, &stolen);
+  }
+
+  bool TakeLocal(LocalQueue* local, int64 num_works,
+                 std::vector<string>* works) {
+    std::lock_guard<std::mutex> lock(local->mu);
+    if (local->works.empty()) {
+      return false;
+    }
+    while (static_cast<int64>(works->size()) < num_works &&
+           !local->works.empty()) {
+      works->push_back(std::move(local->works.front()));
+      local->works.pop_front();
+    }
+    local->size = local->works.size();
+    num_works_ -= works->size();
+    return true;
+  }
+
   // TODO(yuanman.ym): Use memory efficient data structure, e.g. HAT-trie,
   // to implement the string queue. (See https://github.com/Tessil/hat-trie)
   std::deque<string> queue_;
@@ -192,6 +376,13 @@ class WorkQueue : public ResourceBase {
   std::mutex mu_;
   std::condition_variable take_cv_;
   std::shared_ptr<thread::ThreadPool> threads_;
+  // Number of works not taken yet, in the global and local queues.
+  std::atomic<int64> num_works_;
+  // Bumped under mu_ whenever works become takeable.
+  std::atomic<uint64> version_{0};
+  // Shared by takes, exclusive to save, restore and new consumers.
+  mutex state_mu_;
+  std::map<string, std::unique_ptr<LocalQueue>> local_queues_;
 };
 
 REGISTER_RESOURCE_HANDLE_KERNEL(WorkQueue);
@@ -305,6 +496,8 @@ class WorkQueueTakeOp : public AsyncOpKernel {
  public:
   explicit WorkQueueTakeOp(OpKernelConstruction* ctx) : AsyncOpKernel(ctx) {
     OP_REQUIRES_OK(ctx, ctx->GetAttr("num_clients", &num_clients_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("consumer", &consumer_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("locality", &locality_));
   }
 
   void ComputeAsync(OpKernelContext* ctx,
@@ -314,21 +507,71 @@ class WorkQueueTakeOp : public AsyncOpKernel {
                    LookupResource(ctx, HandleFromInput(ctx, 0), &work_queue));
     core::ScopedUnref scoped_list(work_queue);
     work_queue->Schedule(num_clients_, [this, ctx, done, work_queue]() {
+      std::vector<string> works;
+      OP_REQUIRES_OK_ASYNC(
+          ctx, work_queue->TakeMany(1, consumer_, locality_, &works), done);
       Tensor* work;
       OP_REQUIRES_OK_ASYNC(ctx, ctx->allocate_output(0, TensorShape({}), &work),
                            done);
-      OP_REQUIRES_OK_ASYNC(ctx, work_queue->Take(work), done);
+      work->scalar<string>()() = std::move(works[0]);
       done();
     });
   }
 
  private:
   int64 num_clients_;
+  string consumer_;
+  string locality_;
 };
 
 REGISTER_KERNEL_BUILDER(Name("WorkQueueTake").Device(DEVICE_CPU),
                         WorkQueueTakeOp);
 
+class WorkQueueTakeManyOp : public AsyncOpKernel {
+ public:
+  explicit WorkQueueTakeManyOp(OpKernelConstruction* ctx)
+      : AsyncOpKernel(ctx) {
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("num_works", &num_works_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("num_clients", &num_clients_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("consumer", &consumer_));
+    OP_REQUIRES_OK(ctx, ctx->GetAttr("locality", &locality_));
+  }
+
+  void ComputeAsync(OpKernelContext* ctx,
+                    AsyncOpKernel::DoneCallback done) override {
+    WorkQueue* work_queue;
+    OP_REQUIRES_OK_ASYNC(
+        ctx, LookupResource(ctx, HandleFromInput(ctx, 0), &work_queue), done);
+    core::ScopedUnref scoped_list(work_queue);
+    work_queue->Schedule(num_clients_, [this, ctx, done, work_queue]() {
+      std::vector<string> works;
+      OP_REQUIRES_OK_ASYNC(
+          ctx, work_queue->TakeMany(num_works_, consumer_, locality_, &works),
+          done);
+      Tensor* output;
+      OP_REQUIRES_OK_ASYNC(
+          ctx,
+          ctx->allocate_output(
+              0, TensorShape({static_cast<int64>(works.size())}), &output),
+          done);
+      auto output_flat = output->flat<string>();
+      for (size_t i = 0; i < works.size(); ++i) {
+        output_flat(i) = std::move(works[i]);
+      }
+      done();
+    });
+  }
+
+ private:
+  int64 num_works_;
+  int64 num_clients_;
+  string consumer_;
+  string locality_;
+};
+
+REGISTER_KERNEL_BUILDER(Name("WorkQueueTakeMany").Device(DEVICE_CPU),
+                        WorkQueueTakeManyOp);
+
 class SaveLocalWorkOp : public OpKernel {
  public:
   explicit SaveLocalWorkOp(OpKernelConstruction* ctx) : OpKernel(ctx) {
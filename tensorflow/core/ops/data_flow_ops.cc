@@ -602,6 +602,19 @@ REGISTER_OP("SparseConditionalAccumulatorMultiMap")
       return Status::OK();
     });
 
+REGISTER_OP("SparseConditionalAccumulatorSortedMerge")
+    .Output("handle: Ref(string)")
+    .Attr("dtype: numbertype")
+    .Attr("shape: shape")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .Attr("reduction_type: { 'CMEAN', 'MEAN', 'SUM'} = 'MEAN' ")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      c->set_output(0, c->Vector(2));
+      return Status::OK();
+    });
+
 REGISTER_OP("SparseAccumulatorApplyGradient")
     .Input("handle: Ref(string)")
     .Input("local_step: int64")
@@ -632,6 +645,23 @@ REGISTER_OP("SparseAccumulatorTakeGradient")
       return shape_inference::UnknownShape(c);
     });
 
+REGISTER_OP("SparseAccumulatorTakeGradientWithCounts")
+    .Input("handle: Ref(string)")
+    .Input("num_required: int32")
+    .Output("indices: int64")
+    .Output("values: dtype")
+    .Output("shape: int64")
+    .Output("counts: int64")
+    .Attr("dtype: numbertype")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &unused));
+      // Shape of output is the shape of the accumulator referenced
+      // by 'handle', but which is not available here, so we lose
+      // shape information.
+      return shape_inference::UnknownShape(c);
+    });
+
 // --------------------------------------------------------------------------
 
 REGISTER_OP("StackV2")
@@ -248,6 +248,71 @@ REGISTER_OP("TensibleVariableScatterDiv")
       return Status::OK();
     });
 
+REGISTER_OP("HashTableLookupAndGather")
+    .Input("resource: resource")
+    .Input("hashtable: resource")
+    .Input("keys: int64")
+    .Input("default_value: dtype")
+    .Output("ids: int64")
+    .Output("output: dtype")
+    .Attr("dtype: type")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeAndType handle_shape_and_type;
+      TF_RETURN_IF_ERROR(
+          ValidateVariableResourceHandle(c, &handle_shape_and_type));
+
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(
+          c->WithRankAtLeast(handle_shape_and_type.shape, 1, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 0, &unused));
+      ShapeHandle params_subshape;
+      TF_RETURN_IF_ERROR(
+          c->Subshape(handle_shape_and_type.shape, 1, &params_subshape));
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->Concatenate(c->input(2), params_subshape, &out));
+      c->set_output(0, c->input(2));
+      c->set_output(1, out);
+      return Status::OK();
+    });
+
+REGISTER_OP("HashTableLookupAndCombine")
+    .Input("resource: resource")
+    .Input("hashtable: resource")
+    .Input("keys: int64")
+    .Input("segment_ids: Tsegmentids")
+    .Input("num_segments: int64")
+    .Input("default_value: dtype")
+    .Output("ids: int64")
+    .Output("output: dtype")
+    .Attr("dtype: {float, double}")
+    .Attr("Tsegmentids: {int32, int64} = DT_INT64")
+    .Attr("combiner: {'sum', 'mean', 'sqrtn'} = 'mean'")
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeAndType handle_shape_and_type;
+      TF_RETURN_IF_ERROR(
+          ValidateVariableResourceHandle(c, &handle_shape_and_type));
+
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(
+          c->WithRankAtLeast(handle_shape_and_type.shape, 1, &unused));
+      ShapeHandle keys;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 1, &keys));
+      TF_RETURN_IF_ERROR(c->Merge(keys, c->input(3), &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(4), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(5), 0, &unused));
+      ShapeHandle params_subshape;
+      TF_RETURN_IF_ERROR(
+          c->Subshape(handle_shape_and_type.shape, 1, &params_subshape));
+      shape_inference::DimensionHandle num_segments;
+      TF_RETURN_IF_ERROR(c->MakeDimForScalarInput(4, &num_segments));
+      ShapeHandle out;
+      TF_RETURN_IF_ERROR(c->Concatenate(
+          c->Vector(num_segments), params_subshape, &out));
+      c->set_output(0, keys);
+      c->set_output(1, out);
+      return Status::OK();
+    });
+
 REGISTER_OP("TensibleVariableScatterUpdate")
     .Input("resource: resource")
     .Input("indices: Tindices")
@@ -388,6 +453,18 @@ REGISTER_OP("BloomFilterInitializeOp")
     .SetIsStateful()
     .SetShapeFn(shape_inference::NoOutputs);
 
+REGISTER_OP("DecayedCountInitializeOp")
+    .Input("admit_strategy: resource")
+    .Attr("threshold: float")
+    .Attr("half_life: float")
+    .Attr("num_hash_func: int")
+    .Attr("slice_offset: int = 0")
+    .Attr("max_slice_size: int = 1")
+    .Attr("shape: shape")
+    .Attr("initialized: bool")
+    .SetIsStateful()
+    .SetShapeFn(shape_inference::NoOutputs);
+
 REGISTER_OP("BloomFilterAdmitOp")
     .Input("admit_strategy: resource")
     .Input("keys: int64")
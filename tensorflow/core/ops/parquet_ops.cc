@@ -28,6 +28,9 @@ REGISTER_OP("ParquetTabularDatasetV1")
     .Attr("partition_count: int = 1")
     .Attr("partition_index: int = 0")
     .Attr("drop_remainder: bool = false")
+    .Attr("num_parallel_row_groups: int >= 0 = 0")
+    .Attr("pre_buffer: bool = false")
+    .Attr("row_group_filters: list(string) = []")
     .SetIsStateful()  // NOTE: Source dataset ops must be marked stateful to
                       // inhibit constant folding.
     .SetShapeFn([](shape_inference::InferenceContext* c) {
@@ -37,4 +40,30 @@ REGISTER_OP("ParquetTabularDatasetV1")
       return shape_inference::ScalarShape(c);
     });
 
+REGISTER_OP("ParquetTabularDatasetV2")
+    .Output("handle: variant")
+    .Input("filename: string")
+    .Input("batch_size: int64")
+    .Input("row_group_start: int64")
+    .Input("row_group_end: int64")
+    .Attr("field_names: list(string) >= 1")
+    .Attr("field_dtypes: list(type) >= 1")
+    .Attr("field_ragged_ranks: list(int) >= 1")
+    .Attr("partition_count: int = 1")
+    .Attr("partition_index: int = 0")
+    .Attr("drop_remainder: bool = false")
+    .Attr("num_parallel_row_groups: int >= 0 = 0")
+    .Attr("pre_buffer: bool = false")
+    .Attr("row_group_filters: list(string) = []")
+    .SetIsStateful()  // NOTE: Source dataset ops must be marked stateful to
+                      // inhibit constant folding.
+    .SetShapeFn([](shape_inference::InferenceContext* c) {
+      shape_inference::ShapeHandle unused;
+      // batch_size, row_group_start and row_group_end should be scalars.
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(1), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(2), 0, &unused));
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 0, &unused));
+      return shape_inference::ScalarShape(c);
+    });
+
 }  // namespace tensorflow
@@ -106,6 +106,18 @@ REGISTER_OP("StringToHash")
     .Output("output: int64")
     .SetShapeFn(shape_inference::UnchangedShape);
 
+REGISTER_OP("MultiStringToHash")
+    .Input("inputs: N * string")
+    .Output("outputs: N * int64")
+    .Attr("N: int >= 1")
+    .Attr("num_buckets: list(int)")
+    .SetShapeFn([](InferenceContext* c) {
+      for (int i = 0; i < c->num_inputs(); ++i) {
+        c->set_output(i, c->input(i));
+      }
+      return Status::OK();
+    });
+
 REGISTER_OP("StringSplitAndPad")
     .Input("input: string")
     .Input("delimiter: string")
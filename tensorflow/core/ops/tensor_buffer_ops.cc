@@ -68,4 +68,20 @@ REGISTER_OP("TensorBufferSize")
     .SetShapeFn(shape_inference::ScalarShape)
     .SetIsStateful();
 
+REGISTER_OP("TensorBufferStats")
+    .Output("size: int32")
+    .Output("capacity: int32")
+    .Output("num_takes: int64")
+    .Output("take_wait_micros: int64")
+    .Attr("container: string = ''")
+    .Attr("shared_name: string = ''")
+    .Attr("shared_capacity: int >= 1 = 1")
+    .SetShapeFn([](shape_inference::InferenceContext* c) {
+      for (int i = 0; i < c->num_outputs(); ++i) {
+        c->set_output(i, c->Scalar());
+      }
+      return Status::OK();
+    })
+    .SetIsStateful();
+
 }
@@ -586,6 +586,75 @@ REGISTER_OP_BY_NAME("KvResourceSparseApplyAdamWithCounts");
 REGISTER_OP_BY_NAME("_OPT_KvResourceSparseApplyAdamWithCounts");
 #undef REGISTER_OP_BY_NAME
 
+static Status KvResourceApplyLazyAdamShapeFn(InferenceContext* c,
+                                             bool sparse) {
+  ShapeHandle unused;
+  ShapeHandle s = ShapeOrHandleShape(c, 0);                       // var
+  TF_RETURN_IF_ERROR(c->Merge(s, ShapeOrHandleShape(c, 1), &s));  // m
+  TF_RETURN_IF_ERROR(c->Merge(s, ShapeOrHandleShape(c, 2), &s));  // v
+  TF_RETURN_IF_ERROR(c->WithRank(c->input(3), 0, &unused));       // lr
+  TF_RETURN_IF_ERROR(c->WithRank(c->input(4), 0, &unused));       // beta1
+  TF_RETURN_IF_ERROR(c->WithRank(c->input(5), 0, &unused));       // beta2
+  TF_RETURN_IF_ERROR(c->WithRank(c->input(6), 0, &unused));       // epsilon
+  TF_RETURN_IF_ERROR(
+      HandleKvGradAndIndicesInputs(c, sparse, 7 /* grad_idx */, &s));
+  if (c->num_outputs() > 0) {
+    c->set_output(0, s);
+  }
+  return Status::OK();
+}
+
+#define REGISTER_OP_BY_NAME(name)              \
+REGISTER_OP(name)                              \
+    .Input("var: resource")                    \
+    .Input("m: resource")                      \
+    .Input("v: resource")                      \
+    .Input("lr: T")                            \
+    .Input("beta1: T")                         \
+    .Input("beta2: T")                         \
+    .Input("epsilon: T")                       \
+    .Input("grad: T")                          \
+    .Input("indices: Tindices")                \
+    .Input("global_step: Tstep")               \
+    .Attr("T: numbertype")                     \
+    .Attr("Tindices: {int32, int64, string}")  \
+    .Attr("Tstep: {int32, int64}")             \
+    .Attr("use_locking: bool = false")         \
+    .Attr("indices_as_pointer: bool = false")  \
+    .SetShapeFn([](InferenceContext* c) {      \
+      return KvResourceApplyLazyAdamShapeFn(c, true /* sparse */);\
+    })                                         \
+    .Doc(R"doc()doc")
+REGISTER_OP_BY_NAME("KvResourceSparseApplyLazyAdam");
+REGISTER_OP_BY_NAME("_OPT_KvResourceSparseApplyLazyAdam");
+#undef REGISTER_OP_BY_NAME
+
+#define REGISTER_OP_BY_NAME(name)              \
+REGISTER_OP(name)                              \
+    .Input("var: resource")                    \
+    .Input("m: resource")                      \
+    .Input("v: resource")                      \
+    .Input("lr: T")                            \
+    .Input("beta1: T")                         \
+    .Input("beta2: T")                         \
+    .Input("epsilon: T")                       \
+    .Input("grad: T")                          \
+    .Input("indices: Tindices")                \
+    .Input("global_step: Tstep")               \
+    .Input("indices_counts: int64")            \
+    .Attr("T: numbertype")                     \
+    .Attr("Tindices: {int32, int64, string}")  \
+    .Attr("Tstep: {int32, int64}")             \
+    .Attr("use_locking: bool = false")         \
+    .Attr("indices_as_pointer: bool = false")  \
+    .SetShapeFn([](InferenceContext* c) {      \
+      return KvResourceApplyLazyAdamShapeFn(c, true /* sparse */);\
+    })                                         \
+    .Doc(R"doc()doc")
+REGISTER_OP_BY_NAME("KvResourceSparseApplyLazyAdamWithCounts");
+REGISTER_OP_BY_NAME("_OPT_KvResourceSparseApplyLazyAdamWithCounts");
+#undef REGISTER_OP_BY_NAME
+
 static Status KvApplyAdamAsyncShapeFn(InferenceContext* c, bool sparse) {
   ShapeHandle unused;
   ShapeHandle s = ShapeOrHandleShape(c, 0);                       // var
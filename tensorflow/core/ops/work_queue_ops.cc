@@ -109,6 +109,8 @@ REGISTER_OP("WorkQueueTake")
     .Input("handle: resource")
     .Output("work: string")
     .Attr("num_clients: int >= 1 = 1")
+    .Attr("consumer: string = ''")
+    .Attr("locality: string = ''")
     .SetShapeFn(shape_inference::ScalarShape)
     .SetIsStateful()
     .Doc(R"doc(
@@ -117,6 +119,34 @@ Take a work from the work queue.
 handle: Handle of a work queue.
 work: A tensor of taken work.
 num_clients:  Number of threads for taking works.
+consumer: Name of the local queue of the taker, works are stolen from other
+  local queues when it runs dry.
+locality: Works containing locality are preferred.
+)doc");
+
+REGISTER_OP("WorkQueueTakeMany")
+    .Input("handle: resource")
+    .Output("works: string")
+    .Attr("num_works: int >= 1")
+    .Attr("num_clients: int >= 1 = 1")
+    .Attr("consumer: string = ''")
+    .Attr("locality: string = ''")
+    .SetShapeFn([](InferenceContext* c) {
+      c->set_output(0, c->Vector(InferenceContext::kUnknownDim));
+      return Status::OK();
+    })
+    .SetIsStateful()
+    .Doc(R"doc(
+Take at most num_works works from the work queue.
+
+handle: Handle of a work queue.
+works: A non-empty vector of taken works. Raises OutOfRange once the queue
+  is closed and all works are taken.
+num_works: Max number of works to take.
+num_clients:  Number of threads for taking works.
+consumer: Name of the local queue of the taker, works are stolen from other
+  local queues when it runs dry.
+locality: Works containing locality are preferred.
 )doc");
 
 REGISTER_OP("SaveLocalWork")
@@ -142,6 +172,96 @@ task_index: index of current tf-worker.
 restore_works_dir: a directory that restore works for WorkQueue when failover.
 )doc");
 
+REGISTER_RESOURCE_HANDLE_OP(LeaseCoordinator);
+
+REGISTER_OP("LeaseCoordinatorIsInitialized")
+    .Output("is_initialized: bool")
+    .Input("handle: resource")
+    .SetShapeFn(tensorflow::shape_inference::ScalarShape)
+    .Doc(R"doc(
+Checks whether a lease coordinator has been initialized.
+
+is_initialized: True if the lease coordinator is initialized.
+handle: Handle of a lease coordinator.
+)doc");
+
+REGISTER_OP("LeaseCoordinatorCreate")
+    .Input("handle: resource")
+    .Input("files: string")
+    .Input("starts: int64")
+    .Input("ends: int64")
+    .Attr("shared_name: string")
+    .Attr("chunk_rows: int >= 1")
+    .Attr("max_lease_rows: int = 0")
+    .SetShapeFn(tensorflow::shape_inference::NoOutputs)
+    .SetIsStateful()
+    .Doc(R"doc(
+Creates a lease coordinator of row ranges if it does not exist.
+
+handle: Handle of a lease coordinator.
+files: A vector of files.
+starts: A vector of first rows of the ranges.
+ends: A vector of rows after the ranges, or -1 for whole files.
+shared_name: Name of the lease coordinator.
+chunk_rows: Max number of rows taken from a lease at a time.
+max_lease_rows: Max number of rows in a lease, 0 for no limit.
+)doc");
+
+REGISTER_OP("LeaseCoordinatorRestore")
+    .Input("handle: resource")
+    .Input("files: string")
+    .Input("starts: int64")
+    .Input("ends: int64")
+    .SetShapeFn(shape_inference::NoOutputs)
+    .SetIsStateful()
+    .Doc(R"doc(
+Recovers rows not taken yet of a lease coordinator, and revokes all leases.
+
+handle: Handle of a lease coordinator.
+files: A vector of files.
+starts: A vector of first rows of the ranges.
+ends: A vector of rows after the ranges, or -1 for whole files.
+)doc");
+
+REGISTER_OP("LeaseCoordinatorSave")
+    .Output("files: string")
+    .Output("starts: int64")
+    .Output("ends: int64")
+    .Input("handle: resource")
+    .SetShapeFn([](InferenceContext* c) {
+      for (int i = 0; i < 3; ++i) {
+        c->set_output(i, c->Vector(InferenceContext::kUnknownDim));
+      }
+      return Status::OK();
+    })
+    .SetIsStateful()
+    .Doc(R"doc(
+Saves rows not taken yet of a lease coordinator, including rows of leases.
+
+files: A vector of files.
+starts: A vector of first rows of the ranges.
+ends: A vector of rows after the ranges, or -1 for whole files.
+handle: Handle of a lease coordinator.
+)doc");
+
+REGISTER_OP("LeaseDataset")
+    .Input("handle: resource")
+    .Output("output: variant")
+    .Attr("consumer: string = ''")
+    .SetIsStateful()  // NOTE: Source dataset ops must be marked stateful to
+                      // inhibit constant folding.
+    .SetShapeFn(shape_inference::ScalarShape)
+    .Doc(R"doc(
+Creates a dataset of row ranges taken from a lease coordinator.
+
+Each element is a tuple of file, first row and the row after the range, which
+is -1 if the range covers the whole file.
+
+handle: Handle of a lease coordinator.
+output: Handle of the dataset.
+consumer: Name of the lease holder.
+)doc");
+
 WHITELIST_STATEFUL_OP_FOR_DATASET_FUNCTIONS("QueueDequeueV2");
 
 } // tensorflow
@@ -14,6 +14,8 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
+#include <algorithm>
+#include <numeric>
 #include <vector>
 
 #include "absl/base/casts.h"
@@ -29,11 +31,11 @@ limitations under the License.
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
+#include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/platform/byte_order.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
-#include "tensorflow/core/util/presized_cuckoo_map.h"
 #include "tensorflow/core/util/sparse/sparse_tensor.h"
 
 namespace tensorflow {
@@ -438,6 +440,163 @@ bool TestFastParse(const string& serialized, Example* example) {
 
 namespace {
 
+// Mixes hash of a feature name with displacement of its bucket.
+inline uint64 DisplaceHash(uint64 hash, uint32 displacement) {
+  uint64 x = hash + displacement * 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+uint64 NextPowerOfTwo(uint64 n) {
+  uint64 result = 1;
+  while (result < n) result <<= 1;
+  return result;
+}
+
+}  // namespace
+
+Status FeatureNameIndex::Build(const FastParseExampleConfig& config,
+                               std::shared_ptr<const FeatureNameIndex>* index) {
+  std::shared_ptr<FeatureNameIndex> result(new FeatureNameIndex);
+  for (auto& c : config.dense) {
+    result->dense_names_.push_back(c.feature_name);
+  }
+  for (auto& c : config.sparse) {
+    result->sparse_names_.push_back(c.feature_name);
+  }
+  auto name_of = [&result](const Entry& e) -> const string& {
+    return e.is_dense ? result->dense_names_[e.slot]
+                      : result->sparse_names_[e.slot];
+  };
+
+  // Hash and displace: names are grouped into buckets of 2 on average, and
+  // each bucket gets a displacement which moves all its names to free
+  // entries. Keeping at most half of entries occupied makes displacements
+  // found in a few tries.
+  const size_t num_names = config.dense.size() + config.sparse.size();
+  const uint64 num_buckets = NextPowerOfTwo(std::max<size_t>(num_names / 2, 1));
+  const uint64 num_entries = NextPowerOfTwo(std::max<size_t>(num_names * 2, 1));
+  result->bucket_mask_ = num_buckets - 1;
+  result->entry_mask_ = num_entries - 1;
+  constexpr uint64 kInitialSeed = 0xDECAFCAFFE;
+  constexpr uint64 kMaxSeeds = 16;
+  constexpr uint32 kMaxDisplacements = 1 << 16;
+
+  std::vector<Entry> keys(num_names);
+  for (uint64 seed = kInitialSeed; seed < kInitialSeed + kMaxSeeds; ++seed) {
+    for (size_t d = 0; d < config.dense.size(); ++d) {
+      const string& name = config.dense[d].feature_name;
+      keys[d].hash = Hash64(name.data(), name.size(), seed);
+      keys[d].slot = d;
+      keys[d].is_dense = true;
+    }
+    for (size_t d = 0; d < config.sparse.size(); ++d) {
+      const string& name = config.sparse[d].feature_name;
+      Entry& key = keys[config.dense.size() + d];
+      key.hash = Hash64(name.data(), name.size(), seed);
+      key.slot = d;
+      key.is_dense = false;
+    }
+
+    // Names of the same hash can never be displaced apart.
+    std::sort(keys.begin(), keys.end(), [](const Entry& a, const Entry& b) {
+      return a.hash < b.hash;
+    });
+    bool ok = true;
+    for (size_t i = 1; i < num_names && ok; ++i) {
+      if (keys[i - 1].hash != keys[i].hash) continue;
+      if (name_of(keys[i - 1]) == name_of(keys[i])) {
+        return errors::InvalidArgument("Duplicate feature name: ",
+                                       name_of(keys[i]));
+      }
+      ok = false;
+    }
+
+    std::vector<std::vector<const Entry*>> buckets(num_buckets);
+    for (size_t i = 0; i < num_names && ok; ++i) {
+      buckets[(keys[i].hash >> 32) & result->bucket_mask_].push_back(&keys[i]);
+    }
+    std::vector<size_t> bucket_order(num_buckets);
+    std::iota(bucket_order.begin(), bucket_order.end(), 0);
+    std::stable_sort(bucket_order.begin(), bucket_order.end(),
+                     [&buckets](size_t a, size_t b) {
+                       return buckets[a].size() > buckets[b].size();
+                     });
+
+    // Places all names of a bucket, or none of them.
+    auto place = [&result](const std::vector<const Entry*>& bucket,
+                           uint32 displacement) {
+      for (size_t i = 0; i < bucket.size(); ++i) {
+        Entry& e =
+            result->entries_[DisplaceHash(bucket[i]->hash, displacement) &
+                             result->entry_mask_];
+        if (e.slot >= 0) {
+          for (size_t j = 0; j < i; ++j) {
+            result->entries_[DisplaceHash(bucket[j]->hash, displacement) &
+                             result->entry_mask_] = Entry();
+          }
+          return false;
+        }
+        e = *bucket[i];
+      }
+      return true;
+    };
+
+    result->seed_ = seed;
+    result->displacements_.assign(num_buckets, 0);
+    result->entries_.assign(num_entries, Entry());
+    for (size_t b : bucket_order) {
+      if (!ok || buckets[b].empty()) break;
+      uint32 displacement = 0;
+      while (displacement < kMaxDisplacements &&
+             !place(buckets[b], displacement)) {
+        ++displacement;
+      }
+      ok = displacement < kMaxDisplacements;
+      result->displacements_[b] = displacement;
+    }
+    if (ok) {
+      *index = std::move(result);
+      return Status::OK();
+    }
+    LOG(WARNING) << "Collision found. This should happen only if you have "
+                    "around 2^32 entries in your config.";
+  }
+  return errors::Internal("Could not avoid collision. This should not happen.");
+}
+
+bool FeatureNameIndex::Matches(const FastParseExampleConfig& config) const {
+  if (config.dense.size() != dense_names_.size() ||
+      config.sparse.size() != sparse_names_.size()) {
+    return false;
+  }
+  for (size_t d = 0; d < dense_names_.size(); ++d) {
+    if (config.dense[d].feature_name != dense_names_[d]) return false;
+  }
+  for (size_t d = 0; d < sparse_names_.size(); ++d) {
+    if (config.sparse[d].feature_name != sparse_names_[d]) return false;
+  }
+  return true;
+}
+
+bool FeatureNameIndex::Find(StringPiece name, size_t* slot,
+                            bool* is_dense) const {
+  const uint64 hash = Hash64(name.data(), name.size(), seed_);
+  const Entry& e =
+      entries_[DisplaceHash(hash, displacements_[(hash >> 32) & bucket_mask_]) &
+               entry_mask_];
+  if (e.slot < 0 || e.hash != hash) return false;
+  if (name != (e.is_dense ? dense_names_[e.slot] : sparse_names_[e.slot])) {
+    return false;
+  }
+  *slot = e.slot;
+  *is_dense = e.is_dense;
+  return true;
+}
+
+namespace {
+
 using Config = FastParseExampleConfig;
 
 void ParallelFor(const std::function<void(size_t)>& f, size_t n,
@@ -460,8 +619,6 @@ void ParallelFor(const std::function<void(size_t)>& f, size_t n,
   }
 }
 
-enum class Type { Sparse, Dense };
-
 struct SparseBuffer {
   // Features are in one of the 3 vectors below depending on config's dtype.
   // Other 2 vectors remain empty.
@@ -475,13 +632,6 @@ struct SparseBuffer {
   std::vector<size_t> example_end_indices;
 };
 
-struct SeededHasher {
-  uint64 operator()(StringPiece s) const {
-    return Hash64(s.data(), s.size(), seed);
-  }
-  uint64 seed{0xDECAFCAFFE};
-};
-
 template <typename T>
 class LimitedArraySlice {
  public:
@@ -544,8 +694,7 @@ void LogSparseFeatureDataLoss(StringPiece feature_name) {
 Status FastParseSerializedExample(
     const string& serialized_example, const string& example_name,
     const size_t example_index, const Config& config,
-    const PresizedCuckooMap<std::pair<size_t, Type>>& config_index,
-    SeededHasher hasher, std::vector<Tensor>* output_dense,
+    const FeatureNameIndex& config_index, std::vector<Tensor>* output_dense,
     std::vector<SparseBuffer>* output_varlen_dense,
     std::vector<SparseBuffer>* output_sparse,
     PerExampleFeatureStats* output_stats) {
@@ -578,21 +727,9 @@ Status FastParseSerializedExample(
     const StringPiece feature_name = name_and_feature.first;
     parsed::Feature& feature = name_and_feature.second;
 
-    std::pair<size_t, Type> d_and_type;
-    uint64 h = hasher(feature_name);
-    if (!config_index.Find(h, &d_and_type)) continue;
-
-    size_t d = d_and_type.first;
-    bool is_dense = d_and_type.second == Type::Dense;
-
-    {
-      // Testing for PresizedCuckooMap collision.
-      // TODO(lew): Use dense_hash_map and avoid this and hasher creation.
-      const string& config_feature_name = is_dense
-                                              ? config.dense[d].feature_name
-                                              : config.sparse[d].feature_name;
-      if (feature_name != config_feature_name) continue;
-    }
+    size_t d;
+    bool is_dense;
+    if (!config_index.Find(feature_name, &d, &is_dense)) continue;
 
     auto example_error = [&](StringPiece suffix) {
       return errors::InvalidArgument("Name: ", example_name,
@@ -1018,31 +1155,11 @@ Status FastParseExample(const Config& config,
     result->feature_stats.resize(serialized.size());
   }
 
-  size_t config_size = config.dense.size() + config.sparse.size();
-  SeededHasher hasher;
-  // Build config index.
-  PresizedCuckooMap<std::pair<size_t, Type>> config_index(config_size);
-  bool ok = true;
-  for (size_t i = 0; i < 1000; ++i) {
-    for (size_t d = 0; d < config.dense.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.dense[d].feature_name),
-                                      {d, Type::Dense});
-    }
-    for (size_t d = 0; d < config.sparse.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.sparse[d].feature_name),
-                                      {d, Type::Sparse});
-    }
-    if (ok) break;
-    LOG(WARNING) << "Collision found. This should happen only if you have "
-                    "around 2^32 entries in your config.";
-    hasher.seed++;
-    config_index.Clear(config_size);
-    ok = true;
-  }
-  if (!ok) {
-    return errors::Internal(
-        "Could not avoid collision. This should not happen.");
+  std::shared_ptr<const FeatureNameIndex> config_index = config.index;
+  if (config_index == nullptr) {
+    TF_RETURN_IF_ERROR(FeatureNameIndex::Build(config, &config_index));
   }
+  DCHECK(config_index->Matches(config));
 
   // Allocate dense output for fixed length dense values
   // (variable-length dense and sparse have to be buffered).
@@ -1111,7 +1228,7 @@ Status FastParseExample(const Config& config,
       status_of_minibatch[minibatch] = FastParseSerializedExample(
           serialized[e],
           (!example_names.empty() ? example_names[e] : "<unknown>"), e, config,
-          config_index, hasher, &fixed_dense_values,
+          *config_index, &fixed_dense_values,
           &varlen_dense_buffers[minibatch], &sparse_buffers[minibatch], stats);
       if (!status_of_minibatch[minibatch].ok()) break;
     }
@@ -1146,16 +1263,16 @@ Status FastParseExample(const Config& config,
     TensorShape indices_shape;
     indices_shape.AddDim(total_num_features);
     indices_shape.AddDim(2);
-    result->sparse_indices.emplace_back(DT_INT64, indices_shape);
-    Tensor* indices = &result->sparse_indices.back();
+    result->sparse_indices[d] = Tensor(DT_INT64, indices_shape);
+    Tensor* indices = &result->sparse_indices[d];
 
     TensorShape values_shape;
     values_shape.AddDim(total_num_features);
-    result->sparse_values.emplace_back(config.sparse[d].dtype, values_shape);
-    Tensor* values = &result->sparse_values.back();
+    result->sparse_values[d] = Tensor(config.sparse[d].dtype, values_shape);
+    Tensor* values = &result->sparse_values[d];
 
-    result->sparse_shapes.emplace_back(DT_INT64, TensorShape({2}));
-    auto shapes_shape_t = result->sparse_shapes.back().vec<int64>();
+    result->sparse_shapes[d] = Tensor(DT_INT64, TensorShape({2}));
+    auto shapes_shape_t = result->sparse_shapes[d].vec<int64>();
     shapes_shape_t(0) = serialized.size();
     shapes_shape_t(1) = max_num_features;
 
@@ -1262,13 +1379,27 @@ Status FastParseExample(const Config& config,
     }
   };
 
-  for (size_t d = 0; d < config.dense.size(); ++d) {
-    MergeDenseVarLenMinibatches(d);
-  }
+  // Merges of features are independent, so they are sharded across threads
+  // like minibatches, which matters for configs of hundreds of features.
+  result->sparse_indices.resize(config.sparse.size());
+  result->sparse_values.resize(config.sparse.size());
+  result->sparse_shapes.resize(config.sparse.size());
+  const size_t num_merges = config.dense.size() + config.sparse.size();
+  const size_t num_merge_shards =
+      std::min(num_merges, std::max<size_t>(num_minibatches, 1));
+  auto MergeShard = [&](size_t shard) {
+    const size_t start = (num_merges * shard) / num_merge_shards;
+    const size_t end = (num_merges * (shard + 1)) / num_merge_shards;
+    for (size_t i = start; i < end; ++i) {
+      if (i < config.dense.size()) {
+        MergeDenseVarLenMinibatches(i);
+      } else {
+        MergeSparseMinibatches(i - config.dense.size());
+      }
+    }
+  };
 
-  for (size_t d = 0; d < config.sparse.size(); ++d) {
-    MergeSparseMinibatches(d);
-  }
+  ParallelFor(MergeShard, num_merge_shards, thread_pool);
 
   return Status::OK();
 }
@@ -1290,32 +1421,11 @@ Status FastParseSingleExample(const Config& config,
     stats = &result->feature_stats.back();
   }
 
-  // TODO(mrry): Cache the construction of this map at Op construction time.
-  size_t config_size = config.dense.size() + config.sparse.size();
-  SeededHasher hasher;
-  // Build config index.
-  PresizedCuckooMap<std::pair<size_t, Type>> config_index(config_size);
-  bool ok = true;
-  for (size_t i = 0; i < 1000; ++i) {
-    for (size_t d = 0; d < config.dense.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.dense[d].feature_name),
-                                      {d, Type::Dense});
-    }
-    for (size_t d = 0; d < config.sparse.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.sparse[d].feature_name),
-                                      {d, Type::Sparse});
-    }
-    if (ok) break;
-    LOG(WARNING) << "Collision found. This should happen only if you have "
-                    "around 2^32 entries in your config.";
-    hasher.seed++;
-    config_index.Clear(config_size);
-    ok = true;
-  }
-  if (!ok) {
-    return errors::Internal(
-        "Could not avoid collision. This should not happen.");
+  std::shared_ptr<const FeatureNameIndex> config_index = config.index;
+  if (config_index == nullptr) {
+    TF_RETURN_IF_ERROR(FeatureNameIndex::Build(config, &config_index));
   }
+  DCHECK(config_index->Matches(config));
 
   // Allocate dense output tensors.
   for (size_t d = 0; d < config.dense.size(); ++d) {
@@ -1367,21 +1477,9 @@ Status FastParseSingleExample(const Config& config,
     const StringPiece feature_name = name_and_feature.first;
     parsed::Feature& feature = name_and_feature.second;
 
-    std::pair<size_t, Type> d_and_type;
-    uint64 h = hasher(feature_name);
-    if (!config_index.Find(h, &d_and_type)) continue;
-
-    size_t d = d_and_type.first;
-    bool is_dense = d_and_type.second == Type::Dense;
-
-    {
-      // Testing for PresizedCuckooMap collision.
-      // TODO(lew): Use dense_hash_map and avoid this and hasher creation.
-      const string& config_feature_name = is_dense
-                                              ? config.dense[d].feature_name
-                                              : config.sparse[d].feature_name;
-      if (feature_name != config_feature_name) continue;
-    }
+    size_t d;
+    bool is_dense;
+    if (!config_index->Find(feature_name, &d, &is_dense)) continue;
 
     auto example_error = [feature_name](StringPiece suffix) {
       return errors::InvalidArgument("Key: ", feature_name, ".  ", suffix);
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_UTIL_EXAMPLE_PROTO_FAST_PARSING_H_
 #define TENSORFLOW_CORE_UTIL_EXAMPLE_PROTO_FAST_PARSING_H_
 
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -27,6 +28,8 @@ limitations under the License.
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/stringpiece.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow/core/util/sparse/sparse_tensor.h"
@@ -34,6 +37,8 @@ limitations under the License.
 namespace tensorflow {
 namespace example {
 
+class FeatureNameIndex;
+
 // FastParseExampleConfig defines how to parse features in Example.
 // Each sub-config is responsible for one feature identified with feautre_name.
 // FastParseExampleConfig can't have two sub-configs with the same feature_name.
@@ -63,6 +68,46 @@ struct FastParseExampleConfig {
   // If `true`, `Result::feature_stats` will contain one
   // `PerExampleFeatureStats` for each serialized example in the input.
   bool collect_feature_stats = false;
+
+  // Index of feature names built by `FeatureNameIndex::Build`, which could be
+  // shared by configs of the same feature names. If null, parsing builds an
+  // index for each call.
+  std::shared_ptr<const FeatureNameIndex> index;
+};
+
+// Perfect hash of feature names in a FastParseExampleConfig to their dense or
+// sparse output slots. A lookup costs one hash of the name, one probe and one
+// comparison, and building it once per set of feature names takes it out of
+// every parse call.
+class FeatureNameIndex {
+ public:
+  // Builds index of dense and sparse feature names in `config`.
+  static Status Build(const FastParseExampleConfig& config,
+                      std::shared_ptr<const FeatureNameIndex>* index);
+
+  // Returns true if the index was built for feature names in `config`.
+  bool Matches(const FastParseExampleConfig& config) const;
+
+  // Finds output slot of feature `name`, returns false if it is not in the
+  // config.
+  bool Find(StringPiece name, size_t* slot, bool* is_dense) const;
+
+ private:
+  struct Entry {
+    uint64 hash = 0;
+    int64 slot = -1;
+    bool is_dense = false;
+  };
+
+  FeatureNameIndex() = default;
+
+  uint64 seed_ = 0;
+  uint64 bucket_mask_ = 0;
+  uint64 entry_mask_ = 0;
+  std::vector<uint32> displacements_;
+  std::vector<Entry> entries_;
+  std::vector<string> dense_names_;
+  std::vector<string> sparse_names_;
 };
 
 // Statistics about the features in each example passed to
@@ -103,7 +148,6 @@ Status FastParseExample(const FastParseExampleConfig& config,
                         gtl::ArraySlice<tstring> example_names,
                         thread::ThreadPool* thread_pool, Result* result);
 
-// TODO(mrry): Move the hash table construction into the config object.
 typedef FastParseExampleConfig FastParseSingleExampleConfig;
 
 Status FastParseSingleExample(const FastParseSingleExampleConfig& config,
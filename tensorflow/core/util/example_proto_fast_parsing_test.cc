@@ -19,6 +19,8 @@ limitations under the License.
 
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/platform/protobuf.h"
@@ -413,6 +415,102 @@ TEST(FastParse, FuzzTest) {
   }
 }
 
+TEST(FeatureNameIndex, Find) {
+  FastParseExampleConfig config;
+  for (int i = 0; i < 500; ++i) {
+    const string name = strings::StrCat("feature_", i);
+    if (i % 5 == 0) {
+      AddDenseFeature(name.c_str(), DT_FLOAT, {1}, false, 1, &config);
+    } else {
+      AddSparseFeature(name.c_str(), DT_INT64, &config);
+    }
+  }
+  std::shared_ptr<const FeatureNameIndex> index;
+  TF_ASSERT_OK(FeatureNameIndex::Build(config, &index));
+  EXPECT_TRUE(index->Matches(config));
+
+  size_t slot;
+  bool is_dense;
+  for (size_t d = 0; d < config.dense.size(); ++d) {
+    ASSERT_TRUE(index->Find(config.dense[d].feature_name, &slot, &is_dense));
+    EXPECT_EQ(d, slot);
+    EXPECT_TRUE(is_dense);
+  }
+  for (size_t d = 0; d < config.sparse.size(); ++d) {
+    ASSERT_TRUE(index->Find(config.sparse[d].feature_name, &slot, &is_dense));
+    EXPECT_EQ(d, slot);
+    EXPECT_FALSE(is_dense);
+  }
+  for (int i = 500; i < 1000; ++i) {
+    EXPECT_FALSE(
+        index->Find(strings::StrCat("feature_", i), &slot, &is_dense));
+  }
+  EXPECT_FALSE(index->Find("", &slot, &is_dense));
+
+  config.sparse.pop_back();
+  EXPECT_FALSE(index->Matches(config));
+}
+
+TEST(FeatureNameIndex, DuplicateName) {
+  FastParseExampleConfig config;
+  AddDenseFeature("feature", DT_FLOAT, {1}, false, 1, &config);
+  AddSparseFeature("feature", DT_INT64, &config);
+  std::shared_ptr<const FeatureNameIndex> index;
+  EXPECT_TRUE(
+      errors::IsInvalidArgument(FeatureNameIndex::Build(config, &index)));
+}
+
+TEST(TestFastParseExample, SharedIndexWithThreadPool) {
+  const int kNumFeatures = 64;
+  const int kNumExamples = 100;
+  FastParseExampleConfig config;
+  AddDenseFeature("dense", DT_FLOAT, {1}, false, 1, &config);
+  AddDenseFeature("varlen", DT_INT64, {-1}, true, 1, &config);
+  for (int f = 0; f < kNumFeatures; ++f) {
+    AddSparseFeature(strings::StrCat("sparse_", f).c_str(), DT_INT64, &config);
+  }
+  std::vector<tstring> serialized;
+  for (int e = 0; e < kNumExamples; ++e) {
+    Example example;
+    auto& features = *example.mutable_features()->mutable_feature();
+    features["dense"].mutable_float_list()->add_value(e);
+    for (int i = 0; i < e % 3; ++i) {
+      features["varlen"].mutable_int64_list()->add_value(i);
+    }
+    for (int f = 0; f < kNumFeatures; ++f) {
+      auto* values =
+          features[strings::StrCat("sparse_", f)].mutable_int64_list();
+      for (int i = 0; i < (e + f) % 4; ++i) {
+        values->add_value(e * f + i);
+      }
+    }
+    serialized.push_back(Serialize(example));
+  }
+
+  Result expected;
+  TF_ASSERT_OK(FastParseExample(config, serialized, {}, nullptr, &expected));
+
+  TF_ASSERT_OK(FeatureNameIndex::Build(config, &config.index));
+  thread::ThreadPool thread_pool(Env::Default(), "fast_parse_test", 4);
+  Result result;
+  TF_ASSERT_OK(
+      FastParseExample(config, serialized, {}, &thread_pool, &result));
+
+  auto expect_equal = [](const std::vector<Tensor>& expected,
+                         const std::vector<Tensor>& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      EXPECT_EQ(expected[i].shape(), actual[i].shape());
+      EXPECT_EQ(expected[i].SummarizeValue(1 << 20),
+                actual[i].SummarizeValue(1 << 20));
+    }
+  };
+  expect_equal(expected.dense_values, result.dense_values);
+  expect_equal(expected.sparse_indices, result.sparse_indices);
+  expect_equal(expected.sparse_values, result.sparse_values);
+  expect_equal(expected.sparse_shapes, result.sparse_shapes);
+}
+
 TEST(TestFastParseExample, Empty) {
   Result result;
   FastParseExampleConfig config;
@@ -50,9 +50,11 @@ See [Importing Data](https://tensorflow.org/guide/datasets) for an overview.
 @@cardinality
 @@choose_from_datasets
 @@copy_to_device
+@@dedup_batch
 @@dense_to_sparse_batch
 @@enumerate_dataset
 @@from_variant
+@@get_deduped
 @@get_next_as_optional
 @@get_single_element
 @@get_structure
@@ -87,7 +89,9 @@ from __future__ import division
 from __future__ import print_function
 
 # pylint: disable=unused-import
+from tensorflow.python.data.experimental.ops.batching import dedup_batch
 from tensorflow.python.data.experimental.ops.batching import dense_to_sparse_batch
+from tensorflow.python.data.experimental.ops.batching import get_deduped
 from tensorflow.python.data.experimental.ops.batching import map_and_batch
 from tensorflow.python.data.experimental.ops.batching import map_and_batch_with_legacy_function
 from tensorflow.python.data.experimental.ops.batching import unbatch
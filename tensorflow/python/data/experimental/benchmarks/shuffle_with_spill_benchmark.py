@@ -0,0 +1,100 @@
+# Copyright 2023 The DeepRec Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Benchmarks for `shuffle_ops.shuffle_with_spill()`."""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import time
+
+import numpy as np
+
+from tensorflow.python.client import session
+from tensorflow.python.data.experimental.ops import shuffle_ops
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import errors
+from tensorflow.python.framework import ops
+from tensorflow.python.ops import array_ops
+from tensorflow.python.platform import test
+
+
+def _position_entropy(outputs, num_bins):
+  """Mean entropy in bits of output positions of elements in each input bin.
+
+  For a perfect shuffle, elements of each input bin are spread over all
+  output bins, and the entropy approaches log2(num_bins).
+  """
+  num_elements = len(outputs)
+  input_bins = np.asarray(outputs) * num_bins // num_elements
+  output_bins = np.arange(num_elements) * num_bins // num_elements
+  entropies = []
+  for b in range(num_bins):
+    counts = np.bincount(output_bins[input_bins == b], minlength=num_bins)
+    p = counts[counts > 0] / float(counts.sum())
+    entropies.append(-np.sum(p * np.log2(p)))
+  return np.mean(entropies)
+
+
+class ShuffleWithSpillBenchmark(test.Benchmark):
+  """Benchmarks for `shuffle_ops.shuffle_with_spill()`."""
+
+  def _run_benchmark(self, name, shuffle_fn, num_elements=100000,
+                     element_size=256, num_bins=100):
+    with ops.Graph().as_default():
+      dataset = dataset_ops.Dataset.range(num_elements).map(
+          lambda x: (x, array_ops.zeros([element_size // 4])))
+      dataset = shuffle_fn(dataset)
+      options = dataset_ops.Options()
+      options.experimental_optimization.apply_default_optimizations = False
+      dataset = dataset.with_options(options)
+      next_element = dataset_ops.make_one_shot_iterator(dataset).get_next()
+
+      outputs = []
+      with session.Session() as sess:
+        start = time.time()
+        try:
+          while True:
+            outputs.append(sess.run(next_element[0]))
+        except errors.OutOfRangeError:
+          pass
+        end = time.time()
+
+      self.report_benchmark(
+          iters=num_elements,
+          wall_time=(end - start) / num_elements,
+          extras={
+              "position_entropy": _position_entropy(outputs, num_bins),
+              "max_position_entropy": np.log2(num_bins),
+          },
+          name=name)
+
+  def benchmark_shuffle_in_memory(self):
+    for buffer_size in [1000, 10000, 100000]:
+      self._run_benchmark(
+          "shuffle_buffer_size_%d" % buffer_size,
+          lambda ds, b=buffer_size: ds.shuffle(b, seed=10))
+
+  def benchmark_shuffle_with_spill(self):
+    # Elements are about 264 bytes, the budget holds about 1000 elements.
+    for buffer_size in [1000, 10000, 100000]:
+      self._run_benchmark(
+          "shuffle_with_spill_buffer_size_%d" % buffer_size,
+          lambda ds, b=buffer_size: ds.apply(
+              shuffle_ops.shuffle_with_spill(
+                  b, memory_budget=256 * 1024, seed=10)))
+
+
+if __name__ == "__main__":
+  test.main()
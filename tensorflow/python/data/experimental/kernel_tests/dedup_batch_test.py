@@ -0,0 +1,123 @@
+# Copyright 2023 The DeepRec Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may not
+# use this file except in compliance with the License.  You may obtain a copy of
+# the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+# License for the specific language governing permissions and limitations under
+# the License.
+# ==============================================================================
+"""Tests for `dedup_batch`."""
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import numpy as np
+
+import tensorflow as tf
+from tensorflow.python.data.experimental.ops import batching
+from tensorflow.python.data.kernel_tests import test_base
+from tensorflow.python.ops import variable_scope
+from tensorflow.python.ops import variables
+from tensorflow.python.platform import test
+
+
+class DedupBatchTest(test_base.DatasetTestBase):
+
+  def _make_dataset(self, keys=None, num_parallel_calls=None):
+    # 4 batches of 4 samples, each having 8 ids.
+    ids = np.random.randint(0, 10, size=(16, 8), dtype=np.int64)
+    ds = tf.data.Dataset.from_tensor_slices(
+        {'ids': ids, 'dense': ids.astype(np.float32)})
+    ds = ds.map(lambda x: {
+        'ids': tf.sparse.from_dense(x['ids'] + 1),
+        'dense': x['dense']})
+    ds = ds.batch(4)
+    return ds.apply(batching.dedup_batch(keys, num_parallel_calls))
+
+  def test_dedup(self):
+    with tf.Graph().as_default() as graph:
+      ds = self._make_dataset(num_parallel_calls=2)
+      batch = tf.data.make_one_shot_iterator(ds).get_next()
+
+    self.assertEqual(
+        ['dense', 'ids', 'ids/unique_counts', 'ids/unique_ids',
+         'ids/unique_idx'],
+        sorted(batch.keys()))
+    with tf.Session(graph=graph) as sess:
+      for _ in range(4):
+        result = sess.run(batch)
+        self.assertEqual([4, 8], result['ids'].dense_shape.tolist())
+        ids, idx, counts = batching.get_deduped(result, 'ids')
+        values = result['ids'].values
+        self.assertEqual(len(set(values)), len(ids))
+        np.testing.assert_equal(ids[idx], values)
+        np.testing.assert_equal(
+            counts, [np.sum(values == i) for i in ids])
+      with self.assertRaises(tf.errors.OutOfRangeError):
+        sess.run(batch)
+
+  def test_dedup_keys(self):
+    with tf.Graph().as_default():
+      with self.assertRaises(TypeError):
+        self._make_dataset(keys=['dense'])
+      with self.assertRaises(TypeError):
+        tf.data.Dataset.range(4).apply(batching.dedup_batch())
+
+  def test_embedding_lookup_sparse(self):
+    with tf.Graph().as_default() as graph:
+      ds = self._make_dataset(keys=['ids'])
+      batch = tf.data.make_one_shot_iterator(ds).get_next()
+      params = tf.get_variable(
+          'params', shape=[11, 4], initializer=tf.random_normal_initializer())
+      expected = tf.nn.embedding_lookup_sparse(
+          params, batch['ids'], None, combiner='sum')
+      actual = tf.nn.embedding_lookup_sparse(
+          params, batch['ids'], None, combiner='sum',
+          unique=batching.get_deduped(batch, 'ids'))
+
+    with tf.Session(graph=graph) as sess:
+      sess.run(tf.global_variables_initializer())
+      for _ in range(4):
+        expected_result, actual_result = sess.run([expected, actual])
+        self.assertAllClose(expected_result, actual_result)
+
+  def test_embedding_variable_counts(self):
+    with tf.Graph().as_default() as graph:
+      ds = self._make_dataset(keys=['ids'])
+      batch = tf.data.make_one_shot_iterator(ds).get_next()
+      evs = []
+      for name in ['expected', 'actual']:
+        # Ids are admitted after 3 occurrences counted from the lookups.
+        evs.append(variable_scope.get_embedding_variable(
+            name, embedding_dim=4,
+            initializer=tf.ones_initializer(tf.float32),
+            ev_option=variables.EmbeddingVariableOption(
+                filter_option=variables.CounterFilter(filter_freq=3))))
+      self.assertTrue(evs[1].need_counts())
+      expected = tf.nn.embedding_lookup_sparse(
+          evs[0], batch['ids'], None, combiner='sum')
+      actual = tf.nn.embedding_lookup_sparse(
+          evs[1], batch['ids'], None, combiner='sum',
+          unique=batching.get_deduped(batch, 'ids'))
+      loss = tf.reduce_sum(expected) + tf.reduce_sum(actual)
+      train_op = tf.train.GradientDescentOptimizer(0.1).minimize(loss)
+
+    with tf.Session(graph=graph) as sess:
+      sess.run(tf.get_collection(tf.GraphKeys.EV_INIT_VAR_OPS))
+      sess.run(tf.get_collection(tf.GraphKeys.EV_INIT_SLOT_OPS))
+      sess.run(tf.global_variables_initializer())
+      for _ in range(4):
+        expected_result, actual_result, _ = sess.run(
+            [expected, actual, train_op])
+        self.assertAllClose(expected_result, actual_result)
+
+
+if __name__ == "__main__":
+  test.main()
@@ -0,0 +1,130 @@
+# Copyright 2023 The DeepRec Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may not
+# use this file except in compliance with the License.  You may obtain a copy of
+# the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+# License for the specific language governing permissions and limitations under
+# the License.
+# ==============================================================================
+"""Tests for FeatureBatchDataset and FeatureBatchWriter."""
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import numpy as np
+import os
+from six.moves import xrange  # pylint: disable=redefined-builtin
+import tempfile
+
+import tensorflow as tf
+from tensorflow.python.data.experimental.ops import feature_batch_dataset_ops
+from tensorflow.python.data.kernel_tests import test_base
+from tensorflow.python.platform import test
+
+
+class FeatureBatchDatasetTest(test_base.DatasetTestBase):
+  @classmethod
+  def setUpClass(self):
+    os.environ['CUDA_VISIBLE_DEVICES'] = ''
+    self._workspace = tempfile.mkdtemp()
+    self._filename = os.path.join(self._workspace, 'test.fb')
+    self._num_batches = 5
+    self._batch_size = 8
+    num_rows = self._num_batches * self._batch_size
+    self._a = np.random.randint(0, 100, size=num_rows, dtype=np.int64)
+    self._s = np.array(
+        ['s{}'.format('x' * (i % 7)) for i in xrange(num_rows)], dtype=object)
+    self._d = np.random.rand(num_rows, 3).astype(np.float32)
+    with tf.Graph().as_default() as graph:
+      ds = tf.data.Dataset.from_tensor_slices({
+          'A': self._a.reshape(self._num_batches, -1),
+          'S': self._s.reshape(self._num_batches, -1),
+          'D': self._d.reshape(self._num_batches, self._batch_size, 3)})
+      writer = feature_batch_dataset_ops.FeatureBatchWriter(self._filename)
+      write_op = writer.write(ds)
+    with tf.Session(graph=graph) as sess:
+      sess.run(write_op)
+
+  def _rows(self, i):
+    return slice(i * self._batch_size, (i + 1) * self._batch_size)
+
+  def test_read_schema(self):
+    fields = feature_batch_dataset_ops.FeatureBatchDataset.read_schema(
+        self._filename)
+    self.assertEqual(['A', 'D', 'S'], [f.name for f in fields])
+    self.assertEqual([tf.int64, tf.float32, tf.string],
+                     [f.dtype for f in fields])
+    self.assertEqual([0, 1, 0], [f.ragged_rank for f in fields])
+
+  def _test_read(self, use_mmap):
+    with tf.Graph().as_default() as graph:
+      ds = feature_batch_dataset_ops.FeatureBatchDataset(
+          self._filename, use_mmap=use_mmap)
+      batch = tf.data.make_one_shot_iterator(ds).get_next()
+
+    with tf.Session(graph=graph) as sess:
+      for i in xrange(self._num_batches):
+        result = sess.run(batch)
+        np.testing.assert_equal(result['A'], self._a[self._rows(i)])
+        np.testing.assert_equal(
+            result['S'], [s.encode() for s in self._s[self._rows(i)]])
+        np.testing.assert_equal(
+            result['D'].values, self._d[self._rows(i)].reshape(-1))
+        np.testing.assert_equal(
+            result['D'].nested_row_splits[0],
+            np.arange(0, 3 * self._batch_size + 1, 3))
+      with self.assertRaises(tf.errors.OutOfRangeError):
+        sess.run(batch)
+
+  def test_read(self):
+    self._test_read(use_mmap=False)
+
+  def test_read_mmap(self):
+    self._test_read(use_mmap=True)
+
+  def test_read_fields(self):
+    with tf.Graph().as_default() as graph:
+      ds = feature_batch_dataset_ops.FeatureBatchDataset(
+          self._filename, fields=['S'])
+      batch = tf.data.make_one_shot_iterator(ds).get_next()
+
+    self.assertEqual(['S'], list(batch.keys()))
+    with tf.Session(graph=graph) as sess:
+      result = sess.run(batch)
+      np.testing.assert_equal(
+          result['S'], [s.encode() for s in self._s[self._rows(0)]])
+
+  def _test_read_partition(self, use_mmap):
+    with tf.Graph().as_default() as graph:
+      ds = feature_batch_dataset_ops.FeatureBatchDataset(
+          [self._filename, self._filename],
+          fields=['A'],
+          partition_count=2,
+          partition_index=1,
+          use_mmap=use_mmap)
+      batch = tf.data.make_one_shot_iterator(ds).get_next()
+
+    with tf.Session(graph=graph) as sess:
+      for _ in xrange(2):
+        for i in xrange(1, self._num_batches, 2):
+          result = sess.run(batch)
+          np.testing.assert_equal(result['A'], self._a[self._rows(i)])
+      with self.assertRaises(tf.errors.OutOfRangeError):
+        sess.run(batch)
+
+  def test_read_partition(self):
+    self._test_read_partition(use_mmap=False)
+
+  def test_read_partition_mmap(self):
+    self._test_read_partition(use_mmap=True)
+
+
+if __name__ == "__main__":
+  test.main()
@@ -27,6 +27,8 @@ import tempfile
 import tensorflow as tf
 from tensorflow.python.data.experimental.ops import parquet_dataset_ops
 from tensorflow.python.data.kernel_tests import test_base
+from tensorflow.python.ops import resources
+from tensorflow.python.ops.work_queue import LeaseCoordinator
 from tensorflow.python.platform import test
 from tensorflow.python.data.ops.dataset_ops import AUTOTUNE
 
@@ -63,6 +65,119 @@ class ParquetDatasetTest(test_base.DatasetTestBase):
         np.testing.assert_equal(result['A'], a[start_row:end_row].to_numpy())
         np.testing.assert_equal(result['C'], c[start_row:end_row].to_numpy())
 
+  def _write_row_groups(self):
+    filename = os.path.join(self._workspace, 'test_row_groups.parquet')
+    df = pd.DataFrame({
+        'A': np.arange(200, dtype=np.int64),
+        'B': np.random.randint(0, 100, size=200, dtype=np.int64)})
+    df.to_parquet(filename, row_group_size=50)
+    return filename, df
+
+  def test_read_parallel_row_groups(self):
+    batch_size = 32
+    filename, df = self._write_row_groups()
+    with tf.Graph().as_default() as graph:
+      ds = parquet_dataset_ops.ParquetDataset(
+        filename,
+        batch_size=batch_size,
+        fields=[parquet_dataset_ops.DataFrame.Field('A', tf.int64),
+                parquet_dataset_ops.DataFrame.Field('B', tf.int64)],
+        num_parallel_row_groups=2,
+        pre_buffer=True)
+      batch = tf.data.make_one_shot_iterator(ds).get_next()
+
+    with tf.Session(graph=graph) as sess:
+      # Batches are merged across row groups of 50 rows.
+      for i in xrange(200 // batch_size):
+        result = sess.run(batch)
+        start_row = i * batch_size
+        end_row = (i + 1) * batch_size
+        np.testing.assert_equal(
+            result['A'], df['A'][start_row:end_row].to_numpy())
+        np.testing.assert_equal(
+            result['B'], df['B'][start_row:end_row].to_numpy())
+      result = sess.run(batch)
+      np.testing.assert_equal(
+          result['A'], df['A'][200 // batch_size * batch_size:].to_numpy())
+      with self.assertRaises(tf.errors.OutOfRangeError):
+        sess.run(batch)
+
+  def test_read_sliced_ragged_row_groups(self):
+    batch_size = 32
+    filename = os.path.join(self._workspace, 'test_ragged_row_groups.parquet')
+    lists = [list(range(i % 5)) for i in xrange(200)]
+    df = pd.DataFrame({
+        'A': np.arange(200, dtype=np.int64),
+        'L': [np.array(l, dtype=np.int64) for l in lists]})
+    df.to_parquet(filename, row_group_size=50)
+    with tf.Graph().as_default() as graph:
+      ds = parquet_dataset_ops.ParquetDataset(
+        filename,
+        batch_size=batch_size,
+        fields=[parquet_dataset_ops.DataFrame.Field('A', tf.int64),
+                parquet_dataset_ops.DataFrame.Field(
+                  'L', tf.int64, ragged_rank=1)],
+        num_parallel_row_groups=2)
+      batch = tf.data.make_one_shot_iterator(ds).get_next()
+
+    with tf.Session(graph=graph) as sess:
+      # Batches are slices of row groups, starting at nonzero offsets.
+      for i in xrange(200 // batch_size):
+        result = sess.run(batch)
+        rows = lists[i * batch_size:(i + 1) * batch_size]
+        np.testing.assert_equal(
+            result['A'], df['A'][i * batch_size:(i + 1) * batch_size])
+        np.testing.assert_equal(
+            result['L'].values, np.array(sum(rows, []), dtype=np.int64))
+        np.testing.assert_equal(
+            result['L'].nested_row_splits[0],
+            np.cumsum([0] + [len(r) for r in rows]))
+
+  def test_read_with_row_group_filters(self):
+    filename, df = self._write_row_groups()
+    with tf.Graph().as_default() as graph:
+      ds = parquet_dataset_ops.ParquetDataset(
+        filename,
+        batch_size=100,
+        fields=[parquet_dataset_ops.DataFrame.Field('A', tf.int64)],
+        row_group_filters=['A >= 120', 'A < 160'])
+      batch = tf.data.make_one_shot_iterator(ds).get_next()
+
+    with tf.Session(graph=graph) as sess:
+      # Only row groups [100, 150) and [150, 200) may match.
+      result = sess.run(batch)
+      np.testing.assert_equal(result['A'], df['A'][100:200].to_numpy())
+      with self.assertRaises(tf.errors.OutOfRangeError):
+        sess.run(batch)
+
+  def test_read_leased_row_groups(self):
+    filename, df = self._write_row_groups()
+    with tf.Graph().as_default() as graph:
+      coordinator = LeaseCoordinator([filename], num_rows=[4], chunk_rows=1)
+      iterators = []
+      for _ in xrange(2):
+        ds = coordinator.input_dataset().apply(
+          parquet_dataset_ops.read_parquet_row_groups(
+            32, fields=[parquet_dataset_ops.DataFrame.Field('A', tf.int64)]))
+        iterators.append(tf.data.make_initializable_iterator(ds))
+      batches = [it.get_next() for it in iterators]
+
+    with tf.Session(graph=graph) as sess:
+      sess.run(resources.initialize_resources(resources.shared_resources()))
+      sess.run([it.initializer for it in iterators])
+      rows = [[], []]
+      active = [0, 1]
+      while active:
+        for i in list(active):
+          try:
+            rows[i].extend(sess.run(batches[i])['A'].tolist())
+          except tf.errors.OutOfRangeError:
+            active.remove(i)
+    # Both consumers read rows, disjoint and covering the whole file.
+    self.assertTrue(rows[0] and rows[1])
+    self.assertFalse(set(rows[0]) & set(rows[1]))
+    self.assertEqual(df['A'].tolist(), sorted(rows[0] + rows[1]))
+
   def test_schema_auto_detection_read(self):
     batch_size = 32
     with tf.Graph().as_default() as graph:
@@ -0,0 +1,58 @@
+# Copyright 2023 The DeepRec Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Tests for `prefetching_ops.prefetch_with_arena()`."""
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+from absl.testing import parameterized
+import numpy as np
+
+from tensorflow.python.data.experimental.ops import prefetching_ops
+from tensorflow.python.data.kernel_tests import test_base
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import test_util
+from tensorflow.python.ops import array_ops
+from tensorflow.python.ops import math_ops
+from tensorflow.python.platform import test
+
+
+@test_util.run_all_in_graph_and_eager_modes
+class PrefetchWithArenaTest(test_base.DatasetTestBase, parameterized.TestCase):
+
+  @parameterized.parameters((-1,), (0,), (1,), (10,))
+  def testPrefetchBatches(self, buffer_size):
+    dataset = dataset_ops.Dataset.range(100).map(
+        lambda x: (x, math_ops.cast(x, "float32") * 0.5,
+                   array_ops.stack([x, x + 1]))).batch(7)
+    dataset = dataset.apply(prefetching_ops.prefetch_with_arena(buffer_size))
+    expected = []
+    for i in range(0, 100, 7):
+      x = np.arange(i, min(i + 7, 100))
+      expected.append((x, x * 0.5, np.stack([x, x + 1], axis=1)))
+    self.assertDatasetProduces(dataset, expected_output=expected)
+
+  def testPrefetchStrings(self):
+    words = [b"a", b"bb", b"ccc", b"dddd"] * 10
+    dataset = dataset_ops.Dataset.from_tensor_slices(words).batch(3)
+    dataset = dataset.apply(prefetching_ops.prefetch_with_arena(2))
+    self.assertDatasetProduces(
+        dataset,
+        expected_output=[words[i:i + 3] for i in range(0, len(words), 3)])
+
+
+if __name__ == "__main__":
+  test.main()
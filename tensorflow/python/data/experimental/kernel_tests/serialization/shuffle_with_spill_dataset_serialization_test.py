@@ -0,0 +1,43 @@
+# Copyright 2023 The DeepRec Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Tests for the ShuffleWithSpillDataset serialization."""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+from tensorflow.python.data.experimental.kernel_tests.serialization import dataset_serialization_test_base
+from tensorflow.python.data.experimental.ops import shuffle_ops
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.platform import test
+
+
+class ShuffleWithSpillSerializationTest(
+    dataset_serialization_test_base.DatasetSerializationTestBase):
+
+  def _build_ds(self, seed, memory_budget):
+    return dataset_ops.Dataset.range(50).apply(
+        shuffle_ops.shuffle_with_spill(
+            buffer_size=20, memory_budget=memory_budget, seed=seed)).repeat(2)
+
+  def testCore(self):
+    self.run_core_tests(lambda: self._build_ds(10, 1 << 20), 100)
+
+  def testCoreWithSpill(self):
+    # Elements are 8 bytes, so that every 6 elements are spilled as a run.
+    self.run_core_tests(lambda: self._build_ds(10, 64), 100)
+
+
+if __name__ == "__main__":
+  test.main()
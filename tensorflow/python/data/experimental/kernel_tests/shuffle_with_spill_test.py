@@ -0,0 +1,129 @@
+# Copyright 2023 The DeepRec Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Tests for `shuffle_ops.shuffle_with_spill()`."""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import os
+
+import numpy as np
+
+from tensorflow.python.data.experimental.ops import shuffle_ops
+from tensorflow.python.data.kernel_tests import test_base
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.framework import errors
+from tensorflow.python.framework import test_util
+from tensorflow.python.platform import test
+
+
+@test_util.run_all_in_graph_and_eager_modes
+class ShuffleWithSpillTest(test_base.DatasetTestBase):
+
+  def _build_ds(self, seed, memory_budget=1 << 20, num_elements=100,
+                spill_directory=None):
+    # Each element is a 8-byte scalar and a 64-byte vector.
+    return dataset_ops.Dataset.range(num_elements).map(
+        lambda x: (x, [x] * 8)).apply(
+            shuffle_ops.shuffle_with_spill(
+                buffer_size=50,
+                memory_budget=memory_budget,
+                spill_directory=spill_directory,
+                seed=seed))
+
+  def _gen_outputs(self, ds_fn, num_outputs):
+    get_next = self.getNext(ds_fn())
+    outputs = []
+    for _ in range(num_outputs):
+      x, v = self.evaluate(get_next())
+      self.assertAllEqual([x] * 8, v)
+      outputs.append(x)
+    with self.assertRaises(errors.OutOfRangeError):
+      self.evaluate(get_next())
+    return outputs
+
+  def _all_outputs(self, ds):
+    get_next = self.getNext(ds)
+    outputs = []
+    while True:
+      try:
+        outputs.append(self.evaluate(get_next()))
+      except errors.OutOfRangeError:
+        return outputs
+
+  def testCorrectOutputInMemory(self):
+    output = self._gen_outputs(lambda: self._build_ds(10), 100)
+    self.assertNotEqual(list(range(100)), output)
+    self.assertSequenceEqual(range(100), sorted(output))
+
+  def testCorrectOutputWithSpill(self):
+    spill_directory = self.get_temp_dir()
+    output = self._gen_outputs(
+        lambda: self._build_ds(
+            10, memory_budget=720, spill_directory=spill_directory), 100)
+    self.assertNotEqual(list(range(100)), output)
+    self.assertSequenceEqual(range(100), sorted(output))
+    self.assertEqual([], [f for f in os.listdir(spill_directory)
+                          if f.startswith("shuffle_spill_")])
+
+  def testSameOrderForSameSeeds(self):
+    output1 = self._gen_outputs(
+        lambda: self._build_ds(10, memory_budget=720), 100)
+    output2 = self._gen_outputs(
+        lambda: self._build_ds(10, memory_budget=720), 100)
+    self.assertEqual(output1, output2)
+
+  def testDifferentOrderForDifferentSeeds(self):
+    output1 = self._gen_outputs(
+        lambda: self._build_ds(10, memory_budget=720), 100)
+    output2 = self._gen_outputs(
+        lambda: self._build_ds(20, memory_budget=720), 100)
+    self.assertNotEqual(output1, output2)
+    self.assertEqual(sorted(output1), sorted(output2))
+
+  def testReshuffling(self):
+    ds = dataset_ops.Dataset.range(100).apply(
+        shuffle_ops.shuffle_with_spill(
+            buffer_size=50, memory_budget=64, seed=10)).repeat(2)
+    output = self._all_outputs(ds)
+    self.assertSequenceEqual(range(100), sorted(output[:100]))
+    self.assertSequenceEqual(range(100), sorted(output[100:]))
+    self.assertNotEqual(output[:100], output[100:])
+
+  def testSpreadsElements(self):
+    # Elements sampled from spilled runs come from the whole buffer rather
+    # than from the last elements in memory.
+    ds = dataset_ops.Dataset.range(1000).apply(
+        shuffle_ops.shuffle_with_spill(
+            buffer_size=1000, memory_budget=128, seed=10))
+    output = np.array(self._all_outputs(ds))
+    self.assertLess(np.mean(output[:100]), 700)
+    self.assertGreater(np.mean(output[:100]), 300)
+
+  def testInvalidArguments(self):
+    with self.assertRaises(errors.InvalidArgumentError):
+      self._all_outputs(
+          dataset_ops.Dataset.range(10).apply(
+              shuffle_ops.shuffle_with_spill(
+                  buffer_size=0, memory_budget=64)))
+    with self.assertRaises(errors.InvalidArgumentError):
+      self._all_outputs(
+          dataset_ops.Dataset.range(10).apply(
+              shuffle_ops.shuffle_with_spill(
+                  buffer_size=10, memory_budget=0)))
+
+
+if __name__ == "__main__":
+  test.main()
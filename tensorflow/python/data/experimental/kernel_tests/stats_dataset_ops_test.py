@@ -22,6 +22,7 @@ import numpy as np
 from tensorflow.python.data.experimental.kernel_tests import reader_dataset_ops_test_base
 from tensorflow.python.data.experimental.kernel_tests import stats_dataset_test_base
 from tensorflow.python.data.experimental.ops import batching
+from tensorflow.python.data.experimental.ops import shuffle_ops
 from tensorflow.python.data.experimental.ops import stats_aggregator
 from tensorflow.python.data.experimental.ops import stats_ops
 from tensorflow.python.data.ops import dataset_ops
@@ -167,6 +168,25 @@ class StatsDatasetTest(stats_dataset_test_base.StatsDatasetTestBase):
         handle, self.regexForNodeName("FilterDataset", "filtered_elements"),
         34.0)
 
+  def testShuffleWithSpillReadaheadBytes(self):
+    for memory_budget in [128, 1024]:
+      aggregator = stats_aggregator.StatsAggregator()
+      dataset = dataset_ops.Dataset.range(1000).apply(
+          shuffle_ops.shuffle_with_spill(
+              buffer_size=1000, memory_budget=memory_budget, seed=10))
+      dataset = self.datasetExperimentalStats(dataset, aggregator)
+      next_element = self.getNext(dataset, requires_initialization=True)
+      output = [self.evaluate(next_element()) for _ in range(1000)]
+      with self.assertRaises(errors.OutOfRangeError):
+        self.evaluate(next_element())
+      self.assertSequenceEqual(range(1000), sorted(output))
+      handle = self.getHandle(aggregator)
+      # Readahead of spilled runs stays within a quarter of the budget.
+      self.assertStatisticsHasRange(
+          handle,
+          self.regexForNodeName("ShuffleWithSpillDataset", "readahead_bytes"),
+          0, memory_budget / 4)
+
   def testReinitialize(self):
     aggregator = stats_aggregator.StatsAggregator()
     dataset = dataset_ops.Dataset.range(100).apply(
@@ -25,6 +25,7 @@ from tensorflow.python.framework import ops
 from tensorflow.python.framework import sparse_tensor
 from tensorflow.python.framework import tensor_shape
 from tensorflow.python.framework import tensor_util
+from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import gen_experimental_dataset_ops as ged_ops
 from tensorflow.python.util import deprecation
 from tensorflow.python.util.tf_export import tf_export
@@ -229,6 +230,99 @@ def unbatch():
   return _apply_fn
 
 
+DEDUP_IDS_SUFFIX = "/unique_ids"
+DEDUP_IDX_SUFFIX = "/unique_idx"
+DEDUP_COUNTS_SUFFIX = "/unique_counts"
+
+
+@tf_export("data.experimental.dedup_batch")
+def dedup_batch(keys=None, num_parallel_calls=None):
+  """A transformation that deduplicates values of sparse features in batches.
+
+  Elements of the dataset must be dicts of features, e.g. batches from
+  `tf.io.parse_example`. For each sparse feature `key`, unique values, int64
+  index of each value in unique values and int64 counts of unique values are
+  added to the element as `key + DEDUP_IDS_SUFFIX`, `key + DEDUP_IDX_SUFFIX`
+  and `key + DEDUP_COUNTS_SUFFIX`. They can be passed to
+  `tf.nn.embedding_lookup_sparse` as `unique`, so that no `Unique` op is run
+  in the training step:
+
+  ```python
+  dataset = dataset.batch(512).apply(
+      tf.data.experimental.dedup_batch(["user_id"]))
+  features = tf.data.make_one_shot_iterator(dataset).get_next()
+  emb = tf.nn.embedding_lookup_sparse(
+      ev, features["user_id"], None,
+      unique=tf.data.experimental.get_deduped(features, "user_id"))
+  ```
+
+  Args:
+    keys: (Optional.) A list of keys of `tf.SparseTensor` features to
+      deduplicate. Defaults to all sparse features of integer or string
+      values. Ragged features are not supported, since
+      `tf.nn.embedding_lookup_sparse` takes `tf.SparseTensor` ids only.
+    num_parallel_calls: (Optional.) A `tf.int32` scalar `tf.Tensor`,
+      representing the number of batches to deduplicate in parallel.
+      Defaults to deduplicating batches sequentially.
+
+  Returns:
+    A `Dataset` transformation function, which can be passed to
+    `tf.data.Dataset.apply`.
+
+  Raises:
+    TypeError: If elements are not dicts, or a feature of `keys` is not
+      sparse.
+  """
+
+  def _values(feature):
+    if isinstance(feature, sparse_tensor.SparseTensor):
+      return feature.values
+    return None
+
+  def _dedup(features):  # pylint: disable=missing-docstring
+    deduped = dict(features)
+    for key in keys or sorted(features):
+      values = _values(features[key])
+      if values is None or values.dtype not in (
+          dtypes.int32, dtypes.int64, dtypes.string):
+        if keys is None:
+          continue
+        raise TypeError(
+            "Feature {} must be sparse of integers or strings, "
+            "not {}".format(key, features[key]))
+      unique_ids, unique_idx, unique_counts = array_ops.unique_with_counts(
+          values, out_idx=dtypes.int64)
+      deduped[key + DEDUP_IDS_SUFFIX] = unique_ids
+      deduped[key + DEDUP_IDX_SUFFIX] = unique_idx
+      deduped[key + DEDUP_COUNTS_SUFFIX] = unique_counts
+    return deduped
+
+  def _apply_fn(dataset):
+    if not isinstance(dataset.element_spec, dict):
+      raise TypeError("Elements of `dataset` must be dicts of features.")
+    return dataset.map(_dedup, num_parallel_calls=num_parallel_calls)
+
+  return _apply_fn
+
+
+@tf_export("data.experimental.get_deduped")
+def get_deduped(features, key):
+  """Returns deduplicated values of a feature from `dedup_batch`.
+
+  Args:
+    features: A dict of features from a dataset transformed by `dedup_batch`.
+    key: Key of the feature.
+
+  Returns:
+    A tuple of unique values, index of each value in unique values and counts
+    of unique values, which can be passed to `tf.nn.embedding_lookup_sparse`
+    as `unique`.
+  """
+  return (features[key + DEDUP_IDS_SUFFIX],
+          features[key + DEDUP_IDX_SUFFIX],
+          features[key + DEDUP_COUNTS_SUFFIX])
+
+
 class _DenseToSparseBatchDataset(dataset_ops.UnaryDataset):
   """A `Dataset` that batches ragged dense elements into `tf.SparseTensor`s."""
 
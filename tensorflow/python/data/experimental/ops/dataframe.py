@@ -31,6 +31,7 @@ from tensorflow.python.framework import ops
 from tensorflow.python.framework import sparse_tensor
 from tensorflow.python.framework import tensor_shape
 from tensorflow.python.framework import tensor_spec
+from tensorflow.python.framework import type_spec
 from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import gen_ragged_conversion_ops
 from tensorflow.python.ops import math_ops
@@ -237,6 +238,60 @@ class DataFrame(object):  # pylint: disable=useless-object-inheritance
     raise ValueError(f'{features} not supported for transformation')
 
 
+class DataFrameValueSpec(type_spec.BatchableTypeSpec):
+  """A TypeSpec for reading batch of DataFrame.Value from dataset."""
+
+  def value_type(self):
+    return DataFrame.Value if self._ragged_rank > 0 else ops.Tensor
+
+  def __init__(self, field, batch_size=None):
+    """Constructs a type specification for a `tf.RaggedTensor`.
+
+    Args:
+      field: The field definition.
+      batch_size: The batch_size of DataFrame.
+    """
+    if field.incomplete:
+      raise ValueError(
+        f'Field {field} is incomplete, please specify dtype and ragged_rank')
+    self._field = field
+    self._batch_size = batch_size
+
+  def _serialize(self):
+    return (self._field.dtype, self._field.ragged_rank)
+
+  @property
+  def _component_specs(self):
+    return self._field.output_specs(self._batch_size)
+
+  def _to_components(self, value):
+    if isinstance(value, DataFrame.Value):
+      return [value.values] + list(value.nested_row_splits)
+    return [value]
+
+  def _from_components(self, tensor_list):
+    if len(tensor_list) < 1:
+      return None
+    if len(tensor_list) == 1:
+      return tensor_list[0]
+    return DataFrame.Value(tensor_list[0], tensor_list[1:])
+
+  def _batch(self, batch_size):
+    raise NotImplementedError('batching of a bacthed tensor not supported')
+
+  def _unbatch(self):
+    raise NotImplementedError('unbatching of a bacthed tensor not supported')
+
+  def _to_legacy_output_types(self):
+    return self._field.output_types
+
+  def _to_legacy_output_shapes(self):
+    return self._field.output_shapes(self._batch_size)
+
+  def _to_legacy_output_classes(self):
+    return self._field.output_classes
+
+
 def to_sparse(num_parallel_calls=None):
   """Convert values to tensors or sparse tensors from input dataset."""
   def _apply_fn(dataset):
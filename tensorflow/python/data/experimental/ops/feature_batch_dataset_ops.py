@@ -0,0 +1,298 @@
+# Copyright 2023 The DeepRec Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# =============================================================================
+"""Dataset that reads feature batch files, and writer of such files.
+
+A feature batch file stores batches of samples column by column, values and
+row splits of each feature are read back as tensors without parsing.
+"""
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import struct
+
+from six import string_types
+
+from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.data.ops import readers
+from tensorflow.python.framework import dtypes
+from tensorflow.python.framework import ops
+from tensorflow.python.framework import sparse_tensor
+from tensorflow.python.framework import tensor_spec
+from tensorflow.python.ops import array_ops
+from tensorflow.python.ops import gen_feature_batch_ops
+from tensorflow.python.ops import math_ops
+from tensorflow.python.ops.ragged import ragged_tensor
+from tensorflow.python.platform import gfile
+from tensorflow.python.util import nest
+
+from tensorflow.python.data.experimental.ops.dataframe import DataFrame
+from tensorflow.python.data.experimental.ops.dataframe import DataFrameValueSpec
+
+_MAGIC = b'DRFB'
+_VERSION = 1
+
+
+def read_feature_batch_schema(filename):
+  """Read field definitions from header of a feature batch file.
+
+  Args:
+    filename: Path of the feature batch file.
+
+  Returns:
+    Field definition list.
+  """
+  with gfile.GFile(filename, 'rb') as f:
+    magic, version, num_features = struct.unpack('<4sII', f.read(12))
+    if magic != _MAGIC:
+      raise ValueError(f'{filename} is not a feature batch file')
+    if version != _VERSION:
+      raise ValueError(f'Version {version} of {filename} not supported')
+    fields = []
+    for _ in range(num_features):
+      name_size, = struct.unpack('<I', f.read(4))
+      name = f.read(name_size).decode('utf-8')
+      dtype, ragged_rank = struct.unpack('<II', f.read(8))
+      fields.append(
+        DataFrame.Field(name, dtypes.as_dtype(dtype), ragged_rank=ragged_rank))
+    return fields
+
+
+def _select_fields(schema, fields):
+  """Select fields from schema by names or incomplete definitions."""
+  if fields is None:
+    return schema
+  if not isinstance(fields, (tuple, list)):
+    fields = [fields]
+  schema = {f.name: f for f in schema}
+  selected = []
+  for f in fields:
+    name = f if isinstance(f, string_types) else f.name
+    if name not in schema:
+      raise ValueError(f'Field {name} not found')
+    if isinstance(f, string_types) or f.incomplete:
+      selected.append(schema[name])
+    else:
+      selected.append(f)
+  return selected
+
+
+class _FeatureBatchDataset(dataset_ops.DatasetSource):  # pylint: disable=abstract-method
+  """A dataset that reads batches from a feature batch file."""
+
+  def __init__(
+      self, filename, fields,
+      partition_count=1,
+      partition_index=0,
+      use_mmap=False):
+    """Create a `FeatureBatchDataset`.
+
+    Args:
+      filename: A 0-D `tf.string` tensor containing one filename.
+      fields: List of DataFrame fields.
+      partition_count: (Optional.) Count of batch partitions.
+      partition_index: (Optional.) Index of batch partitions.
+      use_mmap: (Optional.) If True, the file is memory mapped and shared
+        with output tensors.
+    """
+    self._filename = ops.convert_to_tensor(
+      filename, dtype=dtypes.string, name='filename')
+    self._fields = fields
+    self._output_specs = {
+      f.name: (
+        DataFrameValueSpec(f) if f.ragged_rank > 0
+        else tensor_spec.TensorSpec(shape=[None], dtype=f.dtype))
+      for f in self._fields}
+    variant_tensor = gen_feature_batch_ops.feature_batch_dataset(
+      self._filename,
+      field_names=nest.flatten({f.name: f.name for f in self._fields}),
+      field_dtypes=nest.flatten({f.name: f.dtype for f in self._fields}),
+      field_ragged_ranks=nest.flatten(
+        {f.name: f.ragged_rank for f in self._fields}),
+      partition_count=partition_count,
+      partition_index=partition_index,
+      use_mmap=use_mmap)
+    super().__init__(variant_tensor)
+
+  @property
+  def element_spec(self):
+    return self._output_specs
+
+
+class FeatureBatchDataset(dataset_ops.DatasetV2):  # pylint: disable=abstract-method
+  """A dataset that reads batches from feature batch files."""
+
+  read_schema = staticmethod(read_feature_batch_schema)
+
+  def __init__(
+      self, filenames,
+      fields=None,
+      partition_count=1,
+      partition_index=0,
+      use_mmap=False,
+      num_parallel_reads=None):
+    """Create a `FeatureBatchDataset`.
+
+    Args:
+      filenames: A 0-D or 1-D `tf.string` tensor, a `string`, a `list` of
+        `string` or a `Dataset` containing one or more filenames.
+      fields: (Optional.) List of DataFrame fields or field names. Required
+        if `filenames` is a tensor or a dataset, otherwise defaults to all
+        fields in the first file.
+      partition_count: (Optional.) Count of batch partitions.
+      partition_index: (Optional.) Index of batch partitions.
+      use_mmap: (Optional.) If True, files are memory mapped and shared with
+        output tensors instead of being read.
+      num_parallel_reads: (Optional.) A `tf.int64` scalar representing the
+        number of files to read in parallel. Defaults to reading files
+        sequentially.
+    """
+    if isinstance(filenames, dataset_ops.DatasetV2) or ops.is_tensor(filenames):
+      if fields is None or any(
+          isinstance(f, string_types) or f.incomplete
+          for f in nest.flatten(fields)):
+        raise ValueError(
+          'Complete fields must be specified for filenames of tensors')
+      self._fields = list(nest.flatten(fields))
+    else:
+      if isinstance(filenames, string_types):
+        filenames = [filenames]
+      self._fields = _select_fields(
+        read_feature_batch_schema(filenames[0]), fields)
+    if not isinstance(filenames, dataset_ops.DatasetV2):
+      filenames = ops.convert_to_tensor(filenames, dtype=dtypes.string)
+      filenames = array_ops.reshape(filenames, [-1], name='flat_filenames')
+      filenames = dataset_ops.Dataset.from_tensor_slices(filenames)
+    self._partition_count = partition_count
+    self._partition_index = partition_index
+    self._use_mmap = use_mmap
+
+    def _create_dataset(f):
+      f = ops.convert_to_tensor(f, dtypes.string, name='filename')
+      return _FeatureBatchDataset(  # pylint: disable=abstract-class-instantiated
+        f, self._fields,
+        partition_count=self._partition_count,
+        partition_index=self._partition_index,
+        use_mmap=self._use_mmap)
+    if num_parallel_reads is None:
+      self._impl = filenames.flat_map(_create_dataset)
+    else:
+      self._impl = readers.ParallelInterleaveDataset(
+        filenames, _create_dataset,
+        cycle_length=num_parallel_reads,
+        block_length=1,
+        sloppy=True,
+        buffer_output_elements=None,
+        prefetch_input_elements=1)
+    super().__init__(self._impl._variant_tensor)  # pylint: disable=protected-access
+
+  @property
+  def fields(self):
+    return self._fields
+
+  def _inputs(self):
+    return self._impl._inputs()  # pylint: disable=protected-access
+
+  @property
+  def element_spec(self):
+    return self._impl.element_spec  # pylint: disable=protected-access
+
+
+def _field_and_components_fn(name, spec):
+  """Get field definition and function to flatten values of a spec."""
+  if isinstance(spec, DataFrameValueSpec):
+    return (
+      spec._field,  # pylint: disable=protected-access
+      lambda v: [v.values] + list(v.nested_row_splits)
+      if isinstance(v, DataFrame.Value) else [v])
+
+  def _ragged_components(v):
+    return [v.flat_values] + [
+      math_ops.cast(s, dtypes.int32) for s in v.nested_row_splits]
+
+  if isinstance(spec, ragged_tensor.RaggedTensorSpec):
+    ragged_rank = spec._ragged_rank  # pylint: disable=protected-access
+    if spec._shape.ndims != ragged_rank + 1:  # pylint: disable=protected-access
+      raise ValueError(f'Values of ragged feature {name} must be 1-D')
+    return (
+      DataFrame.Field(name, spec._dtype, ragged_rank=ragged_rank),  # pylint: disable=protected-access
+      _ragged_components)
+  if isinstance(spec, sparse_tensor.SparseTensorSpec):
+    if spec.shape.ndims != 2:
+      raise ValueError(f'Sparse feature {name} must be 2-D')
+    return (
+      DataFrame.Field(name, spec.dtype, ragged_rank=1),
+      lambda v: _ragged_components(
+        ragged_tensor.RaggedTensor.from_sparse(v)))
+  if isinstance(spec, tensor_spec.TensorSpec):
+    if spec.shape.ndims == 1:
+      return DataFrame.Field(name, spec.dtype, ragged_rank=0), lambda v: [v]
+    if spec.shape.ndims == 2:
+      return (
+        DataFrame.Field(name, spec.dtype, ragged_rank=1),
+        lambda v: _ragged_components(
+          ragged_tensor.RaggedTensor.from_tensor(v)))
+  raise ValueError(f'Feature {name} of {spec} not supported')
+
+
+class FeatureBatchWriter(object):  # pylint: disable=useless-object-inheritance
+  """Writes batches of a dataset to a feature batch file.
+
+  Each element of the dataset is a batch, which is a dict of 1-D or 2-D
+  tensors, 2-D sparse tensors, ragged tensors or DataFrame values, e.g.
+  batches from `ParquetDataset` or `parse_example`:
+
+  ```python
+  ds = parquet_dataset_ops.ParquetDataset(filenames, batch_size=1024)
+  writer = feature_batch_dataset_ops.FeatureBatchWriter('train.fb')
+  write_op = writer.write(ds)
+  ```
+  """
+
+  def __init__(self, filename):
+    self._filename = ops.convert_to_tensor(
+      filename, dtypes.string, name='filename')
+
+  def write(self, dataset):
+    """Returns a `tf.Operation` to write a dataset to a file.
+
+    Args:
+      dataset: a `tf.data.Dataset` whose elements are batches to be written.
+
+    Returns:
+      A `tf.Operation` that, when run, writes batches of `dataset` to a file.
+    """
+    if not isinstance(dataset, dataset_ops.DatasetV2):
+      raise TypeError('`dataset` must be a `tf.data.Dataset` object.')
+    specs = dataset.element_spec
+    if not isinstance(specs, dict):
+      raise TypeError('Elements of `dataset` must be dicts of features.')
+    names = sorted(specs)
+    fields_and_fns = [_field_and_components_fn(n, specs[n]) for n in names]
+    fields = [f for f, _ in fields_and_fns]
+
+    def _flatten(features):
+      components = []
+      for n, (_, fn) in zip(names, fields_and_fns):
+        components.extend(fn(features[n]))
+      return tuple(components)
+    dataset = dataset.map(_flatten)
+    return gen_feature_batch_ops.dataset_to_feature_batch(
+      dataset._variant_tensor,  # pylint: disable=protected-access
+      self._filename,
+      field_names=[f.name for f in fields],
+      field_dtypes=[f.dtype for f in fields],
+      field_ragged_ranks=[f.ragged_rank for f in fields])
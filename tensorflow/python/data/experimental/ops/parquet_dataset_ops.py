@@ -23,67 +23,13 @@ from tensorflow.python.data.ops import readers
 from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import ops
 from tensorflow.python.framework import tensor_spec
-from tensorflow.python.framework import type_spec
 from tensorflow.python.util import nest
 
 from tensorflow.python.ops import gen_parquet_ops
 from tensorflow.python.data.experimental.ops.parquet_pybind import parquet_fields
 from tensorflow.python.data.experimental.ops.parquet_pybind import parquet_filenames_and_fields
 from tensorflow.python.data.experimental.ops.dataframe import DataFrame
-
-
-class DataFrameValueSpec(type_spec.BatchableTypeSpec):
-  """A TypeSpec for reading batch of DataFrame.Value from dataset."""
-
-  def value_type(self):
-    return DataFrame.Value if self._ragged_rank > 0 else ops.Tensor
-
-  def __init__(self, field, batch_size=None):
-    """Constructs a type specification for a `tf.RaggedTensor`.
-
-    Args:
-      field: The field definition.
-      batch_size: The batch_size of DataFrame.
-    """
-    if field.incomplete:
-      raise ValueError(
-        f'Field {field} is incomplete, please specify dtype and ragged_rank')
-    self._field = field
-    self._batch_size = batch_size
-
-  def _serialize(self):
-    return (self._field.dtype, self._field.ragged_rank)
-
-  @property
-  def _component_specs(self):
-    return self._field.output_specs(self._batch_size)
-
-  def _to_components(self, value):
-    if isinstance(value, DataFrame.Value):
-      return [value.values] + list(value.nested_row_splits)
-    return [value]
-
-  def _from_components(self, tensor_list):
-    if len(tensor_list) < 1:
-      return None
-    if len(tensor_list) == 1:
-      return tensor_list[0]
-    return DataFrame.Value(tensor_list[0], tensor_list[1:])
-
-  def _batch(self, batch_size):
-    raise NotImplementedError('batching of a bacthed tensor not supported')
-
-  def _unbatch(self):
-    raise NotImplementedError('unbatching of a bacthed tensor not supported')
-
-  def _to_legacy_output_types(self):
-    return self._field.output_types
-
-  def _to_legacy_output_shapes(self):
-    return self._field.output_shapes(self._batch_size)
-
-  def _to_legacy_output_classes(self):
-    return self._field.output_classes
+from tensorflow.python.data.experimental.ops.dataframe import DataFrameValueSpec  # pylint: disable=unused-import
 
 
 class _ParquetDataset(dataset_ops.DatasetSource):  # pylint: disable=abstract-method
@@ -93,7 +39,11 @@ class _ParquetDataset(dataset_ops.DatasetSource):  # pylint: disable=abstract-me
       self, filename, batch_size, fields,
       partition_count=1,
       partition_index=0,
-      drop_remainder=False):
+      drop_remainder=False,
+      num_parallel_row_groups=0,
+      pre_buffer=False,
+      row_group_filters=None,
+      row_groups=None):
     """Create a `ParquetDataset`.
 
     Args:
@@ -104,6 +54,18 @@ class _ParquetDataset(dataset_ops.DatasetSource):  # pylint: disable=abstract-me
       partition_index: (Optional.) Index of row group partitions.
       drop_remainder: (Optional.) If True, only keep batches with exactly
         `batch_size` samples.
+      num_parallel_row_groups: (Optional.) Number of row groups decoded ahead
+        concurrently on the arrow CPU thread pool. Defaults to decoding row
+        groups sequentially.
+      pre_buffer: (Optional.) If True, column chunks of a row group are
+        coalesced and read ahead of decoding.
+      row_group_filters: (Optional.) List of predicates in format
+        `<column> <op> <value>` where op is one of `==`, `!=`, `<`, `<=`, `>`
+        or `>=`. Row groups whose statistics show no row satisfying all
+        predicates are skipped, other rows are not filtered.
+      row_groups: (Optional.) A tuple of 0-D `tf.int64` tensors `(start, end)`,
+        only row groups in `[start, end)` are read. `end` of -1 means the last
+        row group. Defaults to reading all row groups.
     """
     self._filename = ops.convert_to_tensor(
       filename, dtype=dtypes.string, name='filename')
@@ -124,16 +86,31 @@ class _ParquetDataset(dataset_ops.DatasetSource):  # pylint: disable=abstract-me
     self._partition_count = partition_count
     self._partition_index = partition_index
     self._drop_remainder = drop_remainder
+    self._num_parallel_row_groups = num_parallel_row_groups
+    self._pre_buffer = pre_buffer
+    self._row_group_filters = row_group_filters or []
 
-    variant_tensor = gen_parquet_ops.parquet_tabular_dataset_v1(
-      self._filename,
-      self._batch_size,
+    attrs = dict(
       field_names=self._field_names,
       field_dtypes=self._field_dtypes,
       field_ragged_ranks=self._field_ragged_ranks,
       partition_count=self._partition_count,
       partition_index=self._partition_index,
-      drop_remainder=self._drop_remainder)
+      drop_remainder=self._drop_remainder,
+      num_parallel_row_groups=self._num_parallel_row_groups,
+      pre_buffer=self._pre_buffer,
+      row_group_filters=self._row_group_filters)
+    if row_groups is None:
+      variant_tensor = gen_parquet_ops.parquet_tabular_dataset_v1(
+        self._filename, self._batch_size, **attrs)
+    else:
+      row_group_start = ops.convert_to_tensor(
+        row_groups[0], dtype=dtypes.int64, name='row_group_start')
+      row_group_end = ops.convert_to_tensor(
+        row_groups[1], dtype=dtypes.int64, name='row_group_end')
+      variant_tensor = gen_parquet_ops.parquet_tabular_dataset_v2(
+        self._filename, self._batch_size, row_group_start, row_group_end,
+        **attrs)
     super().__init__(variant_tensor)
 
   @property
@@ -168,7 +145,10 @@ class ParquetDataset(dataset_ops.DatasetV2):  # pylint: disable=abstract-method
       partition_index=0,
       drop_remainder=False,
       num_parallel_reads=None,
-      num_sequential_reads=1):
+      num_sequential_reads=1,
+      num_parallel_row_groups=0,
+      pre_buffer=False,
+      row_group_filters=None):
     """Create a `ParquetDataset`.
 
     Args:
@@ -185,11 +165,22 @@ class ParquetDataset(dataset_ops.DatasetV2):  # pylint: disable=abstract-method
         sequentially.
       num_sequential_reads: (Optional.) A `tf.int64` scalar representing the
         number of batches to read in sequential. Defaults to 1.
+      num_parallel_row_groups: (Optional.) Number of row groups decoded ahead
+        concurrently in each file. Defaults to decoding row groups
+        sequentially.
+      pre_buffer: (Optional.) If True, column chunks of a row group are
+        coalesced and read ahead of decoding.
+      row_group_filters: (Optional.) List of predicates in format
+        `<column> <op> <value>`, row groups whose statistics show no row
+        satisfying all predicates are skipped.
     """
     filenames, self._fields = parquet_filenames_and_fields(filenames, fields)
     self._partition_count = partition_count
     self._partition_index = partition_index
     self._drop_remainder = drop_remainder
+    self._num_parallel_row_groups = num_parallel_row_groups
+    self._pre_buffer = pre_buffer
+    self._row_group_filters = row_group_filters
 
     def _create_dataset(f):
       f = ops.convert_to_tensor(f, dtypes.string, name='filename')
@@ -198,7 +189,10 @@ class ParquetDataset(dataset_ops.DatasetV2):  # pylint: disable=abstract-method
         fields=self._fields,
         partition_count=self._partition_count,
         partition_index=self._partition_index,
-        drop_remainder=self._drop_remainder)
+        drop_remainder=self._drop_remainder,
+        num_parallel_row_groups=self._num_parallel_row_groups,
+        pre_buffer=self._pre_buffer,
+        row_group_filters=self._row_group_filters)
     self._impl = self._build_dataset(
       _create_dataset, filenames,
       num_parallel_reads=num_parallel_reads,
@@ -254,7 +248,10 @@ def read_parquet(
     partition_index=0,
     drop_remainder=False,
     num_parallel_reads=None,
-    num_sequential_reads=1):
+    num_sequential_reads=1,
+    num_parallel_row_groups=0,
+    pre_buffer=False,
+    row_group_filters=None):
   """Create a `ParquetDataset` from filenames dataset.
 
     Args:
@@ -269,6 +266,14 @@ def read_parquet(
         sequentially.
       num_sequential_reads: (Optional.) A `tf.int64` scalar representing the
         number of batches to read in sequential. Defaults to 1.
+      num_parallel_row_groups: (Optional.) Number of row groups decoded ahead
+        concurrently in each file. Defaults to decoding row groups
+        sequentially.
+      pre_buffer: (Optional.) If True, column chunks of a row group are
+        coalesced and read ahead of decoding.
+      row_group_filters: (Optional.) List of predicates in format
+        `<column> <op> <value>`, row groups whose statistics show no row
+        satisfying all predicates are skipped.
     """
   def _apply_fn(filenames):
     return ParquetDataset(
@@ -279,6 +284,53 @@ def read_parquet(
       partition_index=partition_index,
       drop_remainder=drop_remainder,
       num_parallel_reads=num_parallel_reads,
-      num_sequential_reads=num_sequential_reads)
+      num_sequential_reads=num_sequential_reads,
+      num_parallel_row_groups=num_parallel_row_groups,
+      pre_buffer=pre_buffer,
+      row_group_filters=row_group_filters)
+
+  return _apply_fn
+
+
+def read_parquet_row_groups(
+    batch_size,
+    fields,
+    drop_remainder=False,
+    num_parallel_row_groups=0,
+    pre_buffer=False,
+    row_group_filters=None):
+  """Create a `ParquetDataset` from a dataset of row group ranges.
+
+  Each element of the input dataset is a tuple of filename, first row group
+  and the row group after the range, which is -1 if the range covers the
+  rest of the file, e.g. an element of `LeaseCoordinator.input_dataset`
+  created with number of row groups of each file as `num_rows`.
+
+    Args:
+      batch_size: Maxium number of samples in an output batch.
+      fields: List of DataFrame fields.
+      drop_remainder: (Optional.) If True, only keep batches with exactly
+        `batch_size` samples.
+      num_parallel_row_groups: (Optional.) Number of row groups decoded ahead
+        concurrently in each range. Defaults to decoding row groups
+        sequentially.
+      pre_buffer: (Optional.) If True, column chunks of a row group are
+        coalesced and read ahead of decoding.
+      row_group_filters: (Optional.) List of predicates in format
+        `<column> <op> <value>`, row groups whose statistics show no row
+        satisfying all predicates are skipped.
+    """
+  def _create_dataset(filename, start, end):
+    return _ParquetDataset(  # pylint: disable=abstract-class-instantiated
+      filename, batch_size,
+      fields=fields,
+      drop_remainder=drop_remainder,
+      num_parallel_row_groups=num_parallel_row_groups,
+      pre_buffer=pre_buffer,
+      row_group_filters=row_group_filters,
+      row_groups=(start, end))
+
+  def _apply_fn(ranges):
+    return ranges.flat_map(_create_dataset)
 
   return _apply_fn
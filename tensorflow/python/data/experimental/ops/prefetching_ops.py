@@ -59,6 +59,31 @@ def prefetch_to_device(device, buffer_size=None):
   return _apply_fn
 
 
+def prefetch_with_arena(buffer_size=None):
+  """A transformation that prefetches elements into recycled memory slabs.
+
+  Like `tf.data.Dataset.prefetch`, except that buffers of elements produced
+  by the input, e.g. batches from `tf.data.Dataset.batch`, are allocated from
+  slabs of host memory owned by the iterator. A slab is recycled once all
+  tensors using it are released, so that a steady-state input pipeline does
+  not allocate new memory for each batch.
+
+  Args:
+    buffer_size: (Optional.) A `tf.int64` scalar `tf.Tensor`, representing the
+      maximum number of elements that will be buffered when prefetching.
+      Defaults to an automatically chosen value.
+
+  Returns:
+    A `Dataset` transformation function, which can be passed to
+    `tf.data.Dataset.apply`.
+  """
+
+  def _apply_fn(dataset):
+    return dataset_ops.PrefetchDataset(dataset, buffer_size, use_arena=True)
+
+  return _apply_fn
+
+
 @tf_export("data.experimental.copy_to_device")
 def copy_to_device(target_device, source_device="/cpu:0"):
   """A transformation that copies dataset elements to the given `target_device`.
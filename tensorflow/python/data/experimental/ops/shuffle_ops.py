@@ -23,6 +23,7 @@ from tensorflow.python.framework import constant_op
 from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import ops
 from tensorflow.python.ops import gen_dataset_ops
+from tensorflow.python.ops import gen_experimental_dataset_ops
 from tensorflow.python.util import deprecation
 from tensorflow.python.util.tf_export import tf_export
 
@@ -90,3 +91,65 @@ def shuffle_and_repeat(buffer_size, count=None, seed=None):
     return _ShuffleAndRepeatDataset(dataset, buffer_size, count, seed)
 
   return _apply_fn
+
+
+class _ShuffleWithSpillDataset(dataset_ops.UnaryUnchangedStructureDataset):
+  """A `Dataset` that shuffles elements within a memory budget."""
+
+  def __init__(self, input_dataset, buffer_size, memory_budget,
+               spill_directory=None, seed=None):
+    self._input_dataset = input_dataset
+    self._buffer_size = ops.convert_to_tensor(
+        buffer_size, dtype=dtypes.int64, name="buffer_size")
+    self._memory_budget = ops.convert_to_tensor(
+        memory_budget, dtype=dtypes.int64, name="memory_budget")
+    self._spill_directory = ops.convert_to_tensor(
+        "" if spill_directory is None else spill_directory,
+        dtype=dtypes.string, name="spill_directory")
+    self._seed, self._seed2 = random_seed.get_seed(seed)
+    variant_tensor = gen_experimental_dataset_ops.shuffle_with_spill_dataset(
+        self._input_dataset._variant_tensor,  # pylint: disable=protected-access
+        buffer_size=self._buffer_size,
+        memory_budget=self._memory_budget,
+        spill_directory=self._spill_directory,
+        seed=self._seed,
+        seed2=self._seed2,
+        **self._flat_structure)
+    super(_ShuffleWithSpillDataset, self).__init__(input_dataset,
+                                                   variant_tensor)
+
+
+def shuffle_with_spill(buffer_size, memory_budget, spill_directory=None,
+                       seed=None):
+  """Shuffles a Dataset with a buffer larger than memory allows.
+
+  Elements are shuffled like `tf.data.Dataset.shuffle(buffer_size, seed)`,
+  while at most `memory_budget` bytes of elements are held in memory. When
+  the budget is exceeded, buffered elements are shuffled and spilled to a file
+  in `spill_directory`. Each output is sampled uniformly from elements in
+  memory and elements spilled, and spilled elements are read ahead in the
+  background. A new permutation is produced for each epoch.
+
+  Args:
+    buffer_size: A `tf.int64` scalar `tf.Tensor`, representing the
+      number of elements from this dataset from which the new dataset will
+      sample.
+    memory_budget: A `tf.int64` scalar `tf.Tensor`, representing the maximum
+      number of bytes of elements held in memory.
+    spill_directory: (Optional.) A `tf.string` scalar `tf.Tensor`,
+      representing the local directory of spill files. Defaults to the
+      temporary directory.
+    seed: (Optional.) A `tf.int64` scalar `tf.Tensor`, representing the
+      random seed that will be used to create the distribution. See
+      `tf.compat.v1.set_random_seed` for behavior.
+
+  Returns:
+    A `Dataset` transformation function, which can be passed to
+    `tf.data.Dataset.apply`.
+  """
+
+  def _apply_fn(dataset):  # pylint: disable=missing-docstring
+    return _ShuffleWithSpillDataset(
+        dataset, buffer_size, memory_budget, spill_directory, seed)
+
+  return _apply_fn
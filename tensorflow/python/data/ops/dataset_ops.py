@@ -3737,7 +3737,8 @@ class FilterDataset(UnaryUnchangedStructureDataset):
 class PrefetchDataset(UnaryUnchangedStructureDataset):
   """A `Dataset` that asynchronously prefetches its input."""
 
-  def __init__(self, input_dataset, buffer_size, slack_period=None):
+  def __init__(self, input_dataset, buffer_size, slack_period=None,
+               use_arena=False):
     """See `Dataset.prefetch()` for details.
 
     Args:
@@ -3749,6 +3750,9 @@ class PrefetchDataset(UnaryUnchangedStructureDataset):
         user should not have to set this manually; enable this behavior
         automatically via `tf.data.Options.experimental_slack` instead. Defaults
         to None.
+      use_arena: (Optional.) If True, buffers of elements produced by the
+        input, e.g. batches, are allocated from slabs recycled by the iterator.
+        See `prefetching_ops.prefetch_with_arena()`. Defaults to False.
     """
     self._input_dataset = input_dataset
     if buffer_size is None:
@@ -3761,6 +3765,7 @@ class PrefetchDataset(UnaryUnchangedStructureDataset):
           input_dataset._variant_tensor,  # pylint: disable=protected-access
           buffer_size=self._buffer_size,
           slack_period=slack_period,
+          use_arena=use_arena,
           **self._flat_structure)
 
     super(PrefetchDataset, self).__init__(input_dataset, variant_tensor)
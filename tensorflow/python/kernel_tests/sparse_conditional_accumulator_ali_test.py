@@ -69,7 +69,7 @@ class IndexedSlicesConditionalAccumulatorTest(test.TestCase):
     S = 2000000
     D = 18
     K = 60
-    accumulator_types = ('raw', 'multi_map')
+    accumulator_types = ('raw', 'multi_map', 'sorted_merge')
     with self.cached_session() as sess:
       inputs = []
       for i in range(K):
@@ -111,6 +111,62 @@ class IndexedSlicesConditionalAccumulatorTest(test.TestCase):
 
         self._assertEqual_indexedslices(results[0], results[i]);
 
+  def testAccumulatorSortedMergeWithCounts(self):
+    with self.cached_session() as sess:
+      acc = data_flow_ops.SparseConditionalAccumulator(
+          dtypes_lib.float32, name="Q", shape=(),
+          reduction_type="MEAN",
+          accumulator_type="sorted_merge")
+      grads = [
+          ops.IndexedSlices(indices=[7, -3, 2],
+                            values=[[1.0, 2.0], [3.0, 4.0], [5.0, 6.0]],
+                            dense_shape=[10, 2]),
+          ops.IndexedSlices(indices=[2, 7],
+                            values=[[1.0, 1.0], [3.0, 4.0]],
+                            dense_shape=[10, 2]),
+      ]
+      for grad in grads:
+        sess.run(acc.apply_indexed_slices_grad(grad, local_step=0))
+      slices, counts = acc.take_indexed_slices_grad_with_counts(2)
+      slices_val, counts_val = sess.run([slices, counts])
+      self.assertAllEqual([-3, 2, 7], slices_val.indices)
+      self.assertAllClose([[3.0, 4.0], [3.0, 3.5], [2.0, 3.0]],
+                          slices_val.values)
+      self.assertAllEqual([1, 2, 2], counts_val)
+
+  def testAccumulatorSortedMergeWithEmptyFirstGrad(self):
+    with self.cached_session() as sess:
+      acc = data_flow_ops.SparseConditionalAccumulator(
+          dtypes_lib.float32, name="Q",
+          shape=tensor_shape.TensorShape([10, 2]),
+          accumulator_type="sorted_merge")
+      empty_grad = ops.IndexedSlices(
+          indices=constant_op.constant([], dtype=dtypes_lib.int64),
+          values=constant_op.constant([], shape=[0, 2],
+                                      dtype=dtypes_lib.float32),
+          dense_shape=[10, 2])
+      grad = ops.IndexedSlices(indices=[3, 1, 3],
+                               values=[[1.0, 2.0], [3.0, 4.0], [5.0, 6.0]],
+                               dense_shape=[10, 2])
+      sess.run(acc.apply_indexed_slices_grad(empty_grad, local_step=0))
+      sess.run(acc.apply_indexed_slices_grad(grad, local_step=0))
+      slices, counts = acc.take_indexed_slices_grad_with_counts(2)
+      slices_val, counts_val = sess.run([slices, counts])
+      self.assertAllEqual([1, 3], slices_val.indices)
+      self.assertAllClose([[3.0, 4.0], [6.0, 8.0]], slices_val.values)
+      self.assertAllEqual([1, 2], counts_val)
+
+  def testAccumulatorSortedMergeWithWrongShape(self):
+    with self.cached_session() as sess:
+      acc = data_flow_ops.SparseConditionalAccumulator(
+          dtypes_lib.float32, name="Q",
+          shape=tensor_shape.TensorShape([10, 2]),
+          accumulator_type="sorted_merge")
+      grad = ops.IndexedSlices(indices=[3], values=[[1.0, 2.0, 3.0]],
+                               dense_shape=[10, 3])
+      with self.assertRaisesOpError("Shape mismatch"):
+        sess.run(acc.apply_indexed_slices_grad(grad, local_step=0))
+
   def testAccumulatorMultiMapWithInvalidIndices(self):
     with self.cached_session() as sess:
       grad = ops.IndexedSlices(indices=[0, PreservedKey], values=[[1.0], [1.0]], dense_shape=[4, 1])
@@ -96,5 +96,29 @@ class StringToHashBucketOpTest(test.TestCase):
             input_string, 10, key=[98765]).eval()
 
 
+  def testMultiStringToHash(self):
+    with self.cached_session():
+      inputs = [
+          constant_op.constant(['a', 'b', 'c', 'd'] * 65536),
+          constant_op.constant([['a', 'b'], ['c', 'd']]),
+          constant_op.constant([], dtype=dtypes.string),
+          constant_op.constant(['a', 'b', 'c'])]
+      outputs = string_ops.multi_string_to_hash(inputs, [10, 1, 10, 0])
+      self.assertAllEqual([9, 2, 2, 5] * 65536, self.evaluate(outputs[0]))
+      self.assertAllEqual([[0, 0], [0, 0]], self.evaluate(outputs[1]))
+      self.assertAllEqual([], self.evaluate(outputs[2]))
+      # Without buckets, hashes are the same as StringToHash64.
+      self.assertAllEqual(
+          self.evaluate(string_ops.string_to_hash64(inputs[3])),
+          self.evaluate(outputs[3]))
+
+  def testMultiStringToHashInvalidBuckets(self):
+    with self.cached_session():
+      inputs = [constant_op.constant(['a']), constant_op.constant(['b'])]
+      with self.assertRaisesOpError('num_buckets must have 2 elements'):
+        self.evaluate(string_ops.multi_string_to_hash(inputs, [10]))
+      with self.assertRaisesOpError('num_buckets must be non-negative'):
+        self.evaluate(string_ops.multi_string_to_hash(inputs, [10, -1]))
+
 if __name__ == '__main__':
   test.main()
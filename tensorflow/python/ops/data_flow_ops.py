@@ -1378,6 +1378,11 @@ class SparseConditionalAccumulator(ConditionalAccumulatorBase):
       the given name across multiple sessions.
     name: Optional name for the accumulator.
     reduction_type: Reduction type to use when taking the gradient.
+    accumulator_type: "multi_map" merges grads into hash maps as they are
+      applied, "sorted_merge" keeps them and merges them by sorted indices
+      when the gradient is taken, which yields sorted indices and a
+      deterministic summation order. Any other value uses the generic
+      accumulator.
   """
 
   def __init__(self,
@@ -1394,6 +1399,14 @@ class SparseConditionalAccumulator(ConditionalAccumulatorBase):
           shared_name=shared_name,
           name=name,
           reduction_type=reduction_type)
+    elif accumulator_type == "sorted_merge":
+      accumulator_ref = (
+          gen_data_flow_ops.sparse_conditional_accumulator_sorted_merge(
+              dtype=dtype,
+              shape=shape,
+              shared_name=shared_name,
+              name=name,
+              reduction_type=reduction_type))
     else:
       accumulator_ref = gen_data_flow_ops.sparse_conditional_accumulator(
           dtype=dtype,
@@ -1528,6 +1541,31 @@ class SparseConditionalAccumulator(ConditionalAccumulatorBase):
         values=return_val.values,
         dense_shape=return_val.shape)
 
+  def take_indexed_slices_grad_with_counts(self, num_required, name=None):
+    """Attempts to extract the average gradient and its counts.
+
+    Same as `take_indexed_slices_grad`, and also returns the number of
+    gradients accumulated for each index, which can be fed to the
+    `indices_counts` input of the `*WithCounts` sparse apply ops.
+
+    Args:
+      num_required: Number of gradients that needs to have been aggregated
+      name: Optional name for the operation
+
+    Returns:
+      A tuple of an `IndexedSlices` holding the value of the average gradient
+      and an int64 `Tensor` of counts aligned with its indices.
+
+    Raises:
+      InvalidArgumentError: If `num_required` < 1
+    """
+    return_val = gen_data_flow_ops.sparse_accumulator_take_gradient_with_counts(
+        self._accumulator_ref, num_required, dtype=self._dtype, name=name)
+    return ops.IndexedSlices(
+        indices=return_val.indices,
+        values=return_val.values,
+        dense_shape=return_val.shape), return_val.counts
+
   # SparseConditionalAccumulator is not switched to resource. Use old kernels.
   def num_accumulated(self, name=None):
     """Number of gradients that have currently been aggregated in accumulator.
@@ -487,7 +487,8 @@ def embedding_lookup_sparse(params,
                             name=None,
                             combiner=None,
                             max_norm=None,
-                            blocknums=None):
+                            blocknums=None,
+                            unique=None):
   """Computes embeddings for the given ids and weights.
   This op assumes that there is at least one id for each row in the dense tensor
   represented by sp_ids (i.e. there are no rows with empty features), and that
@@ -516,6 +517,10 @@ def embedding_lookup_sparse(params,
       sum of the squares of the weights.
     max_norm: If not `None`, each embedding is clipped if its l2-norm is larger
       than this value, before combining.
+    unique: (Optional.) A tuple of unique values of `sp_ids`, int64 index of
+      each value of `sp_ids` in the unique values, and int64 counts of the
+      unique values, e.g. from `tf.data.experimental.dedup_batch`. If
+      specified, ids are not deduplicated again.
   Returns:
     A dense tensor representing the combined embeddings for the
     sparse ids. For each row in the dense tensor represented by `sp_ids`, the op
@@ -543,7 +548,8 @@ def embedding_lookup_sparse(params,
   Raises:
     TypeError: If `sp_ids` is not a `SparseTensor`, or if `sp_weights` is
       neither `None` nor `SparseTensor`.
-    ValueError: If `combiner` is not one of {"mean", "sqrtn", "sum"}.
+    ValueError: If `combiner` is not one of {"mean", "sqrtn", "sum"}, or
+      `unique` is not a tuple of 3 tensors.
   """
   if combiner is None:
     logging.warn("The default value of combiner will change from \"mean\" "
@@ -569,6 +575,9 @@ def embedding_lookup_sparse(params,
         sp_weights.dense_shape.get_shape())
     # TODO(yleon): Add enhanced node assertions to verify that sp_ids and
     # sp_weights have equal indices and shapes.
+  if unique is not None and len(unique) != 3:
+    raise ValueError("unique must be a tuple of unique values, index and "
+                     "counts")
 
   with ops.name_scope(name, "embedding_lookup_sparse",
                       params + [sp_ids]) as name:
@@ -576,8 +585,32 @@ def embedding_lookup_sparse(params,
     if segment_ids.dtype != dtypes.int32:
       segment_ids = math_ops.cast(segment_ids, dtypes.int32)
 
+    from tensorflow.python.ops.hash_table import hash_table
+    from tensorflow.python.ops.hash_table import embedding
+    if (ignore_weights and len(params) == 1 and
+        isinstance(params[0], hash_table.HashTable) and
+        params[0].dtype in (dtypes.float32, dtypes.float64) and
+        combiner in ("sum", "mean", "sqrtn") and
+        max_norm is None and blocknums is None):
+      # Lower to a single lookup-gather-combine op when no admit strategy
+      # is involved.
+      fused = embedding.get_embedding_lookup_scope(
+          ).embedding_lookup_combine_hash(
+              params[0], sp_ids.values, segment_ids, combiner, name=name)
+      if fused is not None:
+        embeddings = fused[0]
+        ops.add_to_collections(
+            ops.GraphKeys.ASYNC_EMBEDDING_OUTPUT_TENSORS, embeddings)
+        return embeddings
+
     ids = sp_ids.values
-    if isinstance(params[0], kv_variable_ops.EmbeddingVariable) and params[0].need_counts():
+    need_counts = (isinstance(params[0], kv_variable_ops.EmbeddingVariable)
+                   and params[0].need_counts())
+    if unique is not None:
+      ids, idx, counts = unique
+      if not need_counts:
+        counts = None
+    elif need_counts:
       ids, idx, counts = array_ops.unique_with_counts(ids, out_idx=dtypes.int64)
     else:
       ids, idx = array_ops.unique(ids)
@@ -41,6 +41,7 @@ from tensorflow.python.training import adagrad
 from tensorflow.python.training import adagrad_decay
 from tensorflow.python.training import adagrad_decay_v2
 from tensorflow.python.training import gradient_descent
+from tensorflow.python.training import adam_lazy_decay
 from tensorflow.python.training import weight_decay_optimizers
 from tensorflow.python.training import saver as saver_module
 from tensorflow.python.training import training_util
@@ -1101,6 +1102,46 @@ class EmbeddingVariableTest(test_util.TensorFlowTestCase):
     print("testEmbeddingVariableForAdamAsyncRecrodVersion")
     self._RecordFreqTestTemplate("AdamAsync")
 
+  def testEmbeddingVariableForAdamLazyDecay(self):
+    print("testEmbeddingVariableForAdamLazyDecay")
+    lr, beta1, beta2, epsilon = 0.1, 0.9, 0.999, 1e-8
+    with ops.device("/cpu:0"):
+      var = variable_scope.get_embedding_variable("var_1",
+              embedding_dim = 3,
+              initializer=init_ops.ones_initializer(dtypes.float32),
+              steps_to_live = 100)
+    ids = array_ops.placeholder(dtypes.int64, shape=[None])
+    emb = embedding_ops.embedding_lookup(var, ids)
+    fun = math_ops.multiply(emb, 2.0, name='multiply')
+    loss = math_ops.reduce_sum(fun, name='reduce_sum')
+    gs = training_util.get_or_create_global_step()
+    opt = adam_lazy_decay.AdamLazyDecayOptimizer(lr, beta1, beta2, epsilon)
+    g_v = opt.compute_gradients(loss)
+    train_op = opt.apply_gradients(g_v, global_step=gs)
+    init = variables.global_variables_initializer()
+    batches = [[1, 2], [1], [1, 2]]
+    with self.test_session() as sess:
+      sess.run([init])
+      for batch in batches:
+        sess.run(train_op, feed_dict={ids: batch})
+      emb_1, emb_2 = sess.run(emb, feed_dict={ids: [1, 2]})
+
+    # Dense Adam moments with zero gradients in the skipped steps, the
+    # variable only moves in the steps where the row is in the batch.
+    def lazy_adam_ref(row):
+      w, m, v = np.ones(3), np.zeros(3), np.zeros(3)
+      for t, batch in enumerate(batches, 1):
+        g = 2.0 if row in batch else 0.0
+        m = beta1 * m + (1 - beta1) * g
+        v = beta2 * v + (1 - beta2) * g * g
+        if row in batch:
+          alpha = lr * np.sqrt(1 - beta2 ** t) / (1 - beta1 ** t)
+          w = w - alpha * m / (np.sqrt(v) + epsilon)
+      return w
+
+    self.assertAllClose(lazy_adam_ref(1), emb_1)
+    self.assertAllClose(lazy_adam_ref(2), emb_2)
+
   def testEmbeddingVariableForGradientDescentRecrodVersion(self):
     print("testEmbeddingVariableForGradientDescentRecrodVersion")
     self._RecordFreqTestTemplate("GradientDescent")
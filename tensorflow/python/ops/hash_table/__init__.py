@@ -21,5 +21,5 @@
 """
 
 from .hash_table import HashTable, DistributedHashTable, SimpleHashTable, HashTableKeyMapperFactory
-from .embedding import embedding_lookup, embedding_lookup_sparse, EmbeddingLookupHook, BloomFilterLookupHook
-from .admit_strategy import BloomFilterAdmitStrategy, DistributedBloomFilterAdmitStrategy
+from .embedding import embedding_lookup, embedding_lookup_sparse, EmbeddingLookupHook, BloomFilterLookupHook, DecayedCountLookupHook
+from .admit_strategy import BloomFilterAdmitStrategy, DistributedBloomFilterAdmitStrategy, DecayedCountAdmitStrategy
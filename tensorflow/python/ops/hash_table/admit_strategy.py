@@ -19,6 +19,7 @@ HashTable AdmitStrategy.
 
 @@BloomFilterAdmitStrategy
 @@DistributedBloomFilterAdmitStrategy
+@@DecayedCountAdmitStrategy
 """
 
 # pylint: disable=g-bad-name
@@ -49,6 +50,7 @@ class BloomFilterAdmitStrategy(object):
   _DEFAULT_FALSE_POSITIVE_PROBABILITY = 0.01
   _DEFAULT_SLICE_OFFSET = 0
   _DEFAULT_SLICE_SIZE = 1
+  _DEFAULT_NAME = "BloomFilter"
   def __init__(self,
                minimum_frequency,
                max_element_size=None,
@@ -84,36 +86,42 @@ class BloomFilterAdmitStrategy(object):
     self._bucket_size = self._calc_bucket_size(size_per_slice,
         false_positive_probability)
     self._shape = tensor_shape.TensorShape([self._slice_size, self._bucket_size])
-    self._dtype = self._optimal_dtype(minimum_frequency)
+    self._dtype = self._sketch_dtype(minimum_frequency)
 
     self._num_hash_func = self._calc_hash_func_num(false_positive_probability)
 
-    with ops.name_scope(name, "BloomFilter") as name:
+    with ops.name_scope(name, self._DEFAULT_NAME) as name:
       handle_name = ops.name_from_scope_name(name)
       self._name = handle_name
       with ops.control_dependencies(None):
         with ops.device(None if hash_table is None else hash_table.device):
           self._handle = gen_hash_ops.bloom_filter_admit_strategy_op(
               shared_name=handle_name, name=name)
-          self._initializer = gen_hash_ops.bloom_filter_initialize_op(
-              self._handle, min_frequency=minimum_frequency,
-              num_hash_func=self._num_hash_func, slice_offset=self._slice_offset,
-              max_slice_size=self._max_slice_size, dtype=self._dtype,
-              shape=self._shape, initialized=True, name="Initializer")
-          self._false_initializer = gen_hash_ops.bloom_filter_initialize_op(
-              self._handle, min_frequency=minimum_frequency,
-              num_hash_func=self._num_hash_func, slice_offset=self._slice_offset,
-              max_slice_size=self._max_slice_size, dtype=self._dtype,
-              shape=self._shape, initialized=False, name="FalseInitializer")
+          self._initializer = self._initialize_op(True, "Initializer")
+          self._false_initializer = self._initialize_op(
+              False, "FalseInitializer")
 
     if collections is None:
       collections = [ops.GraphKeys.GLOBAL_VARIABLES]
     if not isinstance(collections, (list, tuple, set)):
       raise ValueError(
-          "collections argument to BloomFilterAdmitStrategy constructor must be "
-          "a list, tuple, or set. Got % s type %s" % (collections, type(collections)))
+          "collections argument to %s constructor must be "
+          "a list, tuple, or set. Got % s type %s" % (
+              type(self).__name__, collections, type(collections)))
     ops.add_to_collections(collections, self)
 
+  def _sketch_dtype(self, minimum_frequency):
+    """Returns the dtype of the sketch counters."""
+    return self._optimal_dtype(minimum_frequency)
+
+  def _initialize_op(self, initialized, name):
+    """Returns an op initializing the sketch of `self._handle`."""
+    return gen_hash_ops.bloom_filter_initialize_op(
+        self._handle, min_frequency=self._minimum_frequency,
+        num_hash_func=self._num_hash_func, slice_offset=self._slice_offset,
+        max_slice_size=self._max_slice_size, dtype=self._dtype,
+        shape=self._shape, initialized=initialized, name=name)
+
   def _calc_hash_func_num(self, false_positive_probability):
     log_fpp = abs(math.log(false_positive_probability, 2))
     return int(math.ceil(log_fpp))
@@ -225,6 +233,61 @@ class BloomFilterAdmitStrategy(object):
           self._handle, keys, frequency)
 
 
+@tf_export("hash_table.DecayedCountAdmitStrategy")
+class DecayedCountAdmitStrategy(BloomFilterAdmitStrategy):
+  """Admits ids whose exponentially decayed frequency reaches a threshold.
+
+  Frequencies are kept in a count-min sketch of float counters which lose
+  half of their value every `half_life` seconds, so that ids which stop
+  showing up are forgotten instead of saturating the filter. The sketch is
+  sized like the one of `BloomFilterAdmitStrategy`, and is saved and
+  restored with the hash table in the same way.
+  """
+  _DEFAULT_NAME = "DecayedCount"
+  def __init__(self,
+               threshold,
+               half_life,
+               max_element_size=None,
+               false_positive_probability=None,
+               slicer=None,
+               hash_table=None,
+               distributed_name=None,
+               collections=None,
+               name=None):
+    if half_life <= 0:
+      raise ValueError("half_life must be positive, got %s" % half_life)
+    self._threshold = threshold
+    self._half_life = half_life
+    super(DecayedCountAdmitStrategy, self).__init__(
+        threshold,
+        max_element_size=max_element_size,
+        false_positive_probability=false_positive_probability,
+        slicer=slicer,
+        hash_table=hash_table,
+        distributed_name=distributed_name,
+        collections=collections,
+        name=name)
+
+  def _sketch_dtype(self, minimum_frequency):
+    # Decayed counts are fractional.
+    return dtypes.float32
+
+  def _initialize_op(self, initialized, name):
+    return gen_hash_ops.decayed_count_initialize_op(
+        self._handle, threshold=self._threshold, half_life=self._half_life,
+        num_hash_func=self._num_hash_func, slice_offset=self._slice_offset,
+        max_slice_size=self._max_slice_size, shape=self._shape,
+        initialized=initialized, name=name)
+
+  @property
+  def threshold(self):
+    return self._threshold
+
+  @property
+  def half_life(self):
+    return self._half_life
+
+
 @tf_export("hash_table.DistributedBloomFilterAdmitStrategy")
 class DistributedBloomFilterAdmitStrategy(object):
   """TODO: Add DocString"""
@@ -32,6 +32,10 @@ def admit_strategy_factory(hash_table):
   return admit_strategy.BloomFilterAdmitStrategy(
       10, slicer=hash_table.slicer, hash_table=hash_table).handle
 
+def decayed_count_strategy_factory(hash_table):
+  return admit_strategy.DecayedCountAdmitStrategy(
+      10, 3600, slicer=hash_table.slicer, hash_table=hash_table).handle
+
 
 class AdmitStrategyTest(test.TestCase):
   def testBloomFilterLookup(self):
@@ -58,5 +62,30 @@ class AdmitStrategyTest(test.TestCase):
       expect_result = np.array([[1.0, 1.0], [1.0, 1.0], [0.0, 0.0]], dtype='float32')
       self.assertTrue(np.allclose(result, expect_result))
 
+  def testDecayedCountLookup(self):
+    with self.test_session(graph=ops_lib.Graph()) as sess:
+      ht = hash_table.DistributedHashTable(
+          [2], dtypes.float32,
+          partitioner=hash_table.FixedSizeHashTablePartitioner(5),
+          initializer=init_ops.ones_initializer(dtypes.float32))
+      p_keys = array_ops.placeholder(dtypes.int64, shape=[None], name="keys")
+      p_counts = array_ops.placeholder(dtypes.int32, shape=[None], name="counts")
+      lookup = ht.lookup(p_keys, decayed_count_strategy_factory, p_counts)
+      sess.run(variables.global_variables_initializer())
+
+      keys = np.array([0, 1, 2, -10000, 50000], dtype='int64')
+      counts = np.array([6, 10, 2, 2, 3], dtype='int32')
+      result = sess.run(lookup, feed_dict={p_keys: keys, p_counts: counts})
+      expect_result = np.array([[0.0, 0.0], [1.0, 1.0], [0.0, 0.0], [0.0, 0.0],
+          [0.0, 0.0]], dtype='float32')
+      self.assertTrue(np.allclose(result, expect_result))
+
+      keys = np.array([2, 0, -10000], dtype='int64')
+      # key 2 has decayed a little since the first run
+      counts = np.array([9, 10000, 7], dtype='int32')
+      result = sess.run(lookup, feed_dict={p_keys: keys, p_counts: counts})
+      expect_result = np.array([[1.0, 1.0], [1.0, 1.0], [0.0, 0.0]], dtype='float32')
+      self.assertTrue(np.allclose(result, expect_result))
+
 if __name__ == '__main__':
   test.main()
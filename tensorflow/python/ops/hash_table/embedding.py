@@ -161,6 +161,39 @@ class BloomFilterLookupHook(EmbeddingLookupHook):
   def on_embedding_lookup(self, ctx):
     return
 
+@tf_export("hash_table.DecayedCountLookupHook")
+class DecayedCountLookupHook(EmbeddingLookupHook):
+  def __init__(self, threshold, half_life, max_element_size=None,
+      false_positive_probability=None, name=None):
+    super(DecayedCountLookupHook, self).__init__()
+    self._threshold = threshold
+    self._half_life = half_life
+    self._max_element_size = max_element_size
+    self._false_positive_probability = false_positive_probability
+    self._name = name
+
+  def get_config(self):
+    return {
+      'threshold': self._threshold,
+      'half_life': self._half_life,
+      'max_element_size': self._max_element_size,
+      'false_positive_probability': self._false_positive_probability,
+      'name': self._name
+      }
+
+  def get_admit_strategy_factory(self, distributed_hash_table):
+    def wrapper(hash_table):
+      return admit_strategy.DecayedCountAdmitStrategy(self._threshold,
+          self._half_life, self._max_element_size,
+          self._false_positive_probability,
+          slicer=hash_table.slicer, hash_table=hash_table,
+          distributed_name=hash_table.distributed_name + '_DecayedCount',
+          name=self._name).handle
+    return wrapper
+
+  def on_embedding_lookup(self, ctx):
+    return
+
 class EmbeddingLookupScope(object):
   def __init__(self):
     self._hooks = []
@@ -207,12 +240,11 @@ class EmbeddingLookupScope(object):
             raise RuntimeError("Only one embedding hook should set admit strategy")
           admit_strategy_factory = admit_strategy_factory_x
       if admit_strategy_factory is None:
-        admit_strategy = lambda ht: None
+        ids, result = hash_table.lookup_and_gather(origin_keys, default_value)
       else:
-        admit_strategy = admit_strategy_factory
-      ids = hash_table.gen_ids(origin_keys,
-          admit_strategy(hash_table), counts)
-      result = hash_table.lookup_by_id(ids, default_value)
+        ids = hash_table.gen_ids(origin_keys,
+            admit_strategy_factory(hash_table), counts)
+        result = hash_table.lookup_by_id(ids, default_value)
       filtered_key = None
       if admit_strategy_factory is not None:
         mask = math_ops.not_equal(ids, -1)
@@ -222,6 +254,32 @@ class EmbeddingLookupScope(object):
         hook.on_embedding_lookup(ctx)
       return result, ctx.result()
 
+  def embedding_lookup_combine_hash(self, hash_table, origin_keys, segment_ids,
+                                    combiner, default_value=0, name=None):
+    """Looks up and combines `origin_keys` with one fused op.
+
+    Returns None when a hook sets an admit strategy, which the fused op does
+    not support.
+    """
+    for hook in self._hooks:
+      if hook.get_admit_strategy_factory(hash_table) is not None:
+        return None
+    with ops.name_scope(name, "EmbeddingLookupScope_EmbeddingLookupCombine"):
+      num_segments = math_ops.maximum(
+          math_ops.cast(math_ops.reduce_max(segment_ids), dtypes.int64) + 1, 0)
+      ids, result = hash_table.lookup_and_combine(
+          origin_keys, segment_ids, num_segments, combiner, default_value)
+      # Hooks count and filter by key, so they get every key once with its
+      # id, as on the unfused path which looks up unique keys.
+      keys, idx = array_ops.unique(origin_keys)
+      first = math_ops.unsorted_segment_min(
+          math_ops.range(array_ops.size(idx)), idx, array_ops.size(keys))
+      ids = array_ops.gather(ids, first)
+      ctx = EmbeddingLookupContext(hash_table, origin_keys, [keys], [None], [ids])
+      for hook in self._hooks:
+        hook.on_embedding_lookup(ctx)
+      return result, ctx.result()
+
 _EMBEDDINGSCOPE_KEY = "embedding_lookup_scope_key"
 
 def get_embedding_lookup_scope():
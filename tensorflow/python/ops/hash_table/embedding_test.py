@@ -19,14 +19,39 @@ from __future__ import print_function
 
 import numpy as np
 
+from tensorflow.python.ops.hash_table import embedding
 from tensorflow.python.ops.hash_table import hash_table
+from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import embedding_ops
+from tensorflow.python.ops import gen_hash_ops
 from tensorflow.python.ops import init_ops
+from tensorflow.python.ops import math_ops
+from tensorflow.python.training import gradient_descent
 from tensorflow.python.training.monitored_session import MonitoredTrainingSession
 from tensorflow.python.framework import dtypes
+from tensorflow.python.framework import ops
 from tensorflow.python.framework import sparse_tensor
 from tensorflow.python.platform import test
 
+class _CountLookupHook(embedding.EmbeddingLookupHook):
+  """Counts lookups of every key in a slot of the hash table."""
+
+  def __init__(self):
+    self.update_ops = []
+
+  def get_config(self):
+    return {}
+
+  def on_embedding_lookup(self, ctx):
+    for ht, ids in zip(ctx.partitions(), ctx.ids()):
+      slot = ht.get_or_create_slot(
+          [1], dtypes.int64, 'lookup_count',
+          initializer=init_ops.zeros_initializer(dtypes.int64))
+      self.update_ops.append(gen_hash_ops.tensible_variable_scatter_add(
+          slot.handle, ids,
+          array_ops.ones([array_ops.size(ids), 1], dtype=dtypes.int64)))
+
+
 class HashTableEmbeddingTest(test.TestCase):
   def testEmbeddingLookup(self):
     ht = hash_table.DistributedHashTable(
@@ -78,6 +103,65 @@ class HashTableEmbeddingTest(test.TestCase):
                            [0.,0.,0.,0.,0.,0.,0.,0.,0.,0.,0.,0.],
                            [1.,1.,1.,1.,0.,0.,0.,0.,0.,0.,0.,0.]])
 
+  def testFusedEmbeddingLookupSparse(self):
+    ht = hash_table.HashTable(
+      [4], dtypes.float32, "fused_ht",
+      initializer=init_ops.ones_initializer(dtypes.float32))
+    input_sparse = sparse_tensor.SparseTensor(
+        indices=((0, 0), (0, 1), (1, 0), (3, 0)),
+        values=np.array((0, 1, 2, 0)),
+        dense_shape=(4, 3))
+    emb1 = embedding_ops.embedding_lookup_sparse(ht, input_sparse, None, combiner='mean')
+    emb2 = embedding_ops.embedding_lookup_sparse(ht, input_sparse, None, combiner='sum')
+    emb3 = embedding_ops.embedding_lookup_sparse(ht, input_sparse, None, combiner='sqrtn')
+    self.assertEqual(emb1.op.type, "HashTableLookupAndCombine")
+    train = gradient_descent.GradientDescentOptimizer(0.5).minimize(
+        math_ops.reduce_sum(emb1))
+    lookup = ht.lookup([0, 1, 2])
+    with MonitoredTrainingSession('') as sess:
+      emb_result1, emb_result2, emb_result3 = sess.run([emb1, emb2, emb3])
+      self.assertAllEqual(emb_result1,
+                          [[1.,1.,1.,1.],
+                           [1.,1.,1.,1.],
+                           [0.,0.,0.,0.],
+                           [1.,1.,1.,1.]])
+      self.assertAllEqual(emb_result2,
+                          [[2.,2.,2.,2.],
+                           [1.,1.,1.,1.],
+                           [0.,0.,0.,0.],
+                           [1.,1.,1.,1.]])
+      self.assertAllClose(emb_result3,
+                          [[1.4142135,1.4142135,1.4142135,1.4142135],
+                           [1.,1.,1.,1.],
+                           [0.,0.,0.,0.],
+                           [1.,1.,1.,1.]])
+      sess.run(train)
+      # key 0 gets 0.5 from row 0 and 1.0 from row 3
+      self.assertAllClose(sess.run(lookup),
+                          [[0.25] * 4, [0.75] * 4, [0.5] * 4])
+
+  def testFusedEmbeddingLookupSparseHookCounts(self):
+    ht = hash_table.HashTable(
+      [4], dtypes.float32, "fused_count_ht",
+      initializer=init_ops.ones_initializer(dtypes.float32))
+    input_sparse = sparse_tensor.SparseTensor(
+        indices=((0, 0), (0, 1), (1, 0), (1, 1), (3, 0)),
+        values=np.array((7, 8, 7, 7, 9)),
+        dense_shape=(4, 3))
+    hook = _CountLookupHook()
+    with hook:
+      emb = embedding_ops.embedding_lookup_sparse(
+          ht, input_sparse, None, combiner='sum')
+    self.assertEqual(emb.op.type, "HashTableLookupAndCombine")
+    count = ht.get_slot('lookup_count')
+    ids = ht.gen_ids([7, 8, 9])
+    counts = gen_hash_ops.tensible_variable_gather(
+        count.handle, ids, ops.convert_to_tensor(0, dtype=dtypes.int64))
+    with MonitoredTrainingSession('') as sess:
+      sess.run(hook.update_ops)
+      # key 7 occurs three times but is looked up once per batch
+      self.assertAllEqual(sess.run(counts), [[1], [1], [1]])
+
   def testEmbeddingLookupSparseWithWeight(self):
     ht = hash_table.DistributedHashTable(
       [4], dtypes.float32,
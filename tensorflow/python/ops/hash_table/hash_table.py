@@ -39,6 +39,7 @@ from tensorflow.python.ops import control_flow_ops
 from tensorflow.python.ops import data_flow_ops
 from tensorflow.python.ops import gen_hash_ops
 from tensorflow.python.ops import math_ops
+from tensorflow.python.util import compat
 from tensorflow.python.util import tf_contextlib
 from tensorflow.python.util.tf_export import tf_export
 
@@ -303,6 +304,29 @@ class HashTable(object):
       return gen_hash_ops.tensible_variable_gather(
           self._handle, ids, default_value, name=name)
 
+  def lookup_and_gather(self, keys, default_value=0, name=None):
+    """Returns the ids of `keys` and their values, computed by one fused op."""
+    default_value = ops.convert_to_tensor(default_value, dtype=self._dtype)
+    with ops.colocate_with(self._handle):
+      return gen_hash_ops.hash_table_lookup_and_gather(
+          self._handle, self._hash_table.handle,
+          ops.convert_to_tensor(keys, dtype=dtypes.int64),
+          default_value, name=name)
+
+  def lookup_and_combine(self, keys, segment_ids, num_segments,
+                         combiner="mean", default_value=0, name=None):
+    """Like `lookup_and_gather`, but reduces the values of every segment.
+
+    `segment_ids` must be sorted, the result has `num_segments` rows.
+    """
+    default_value = ops.convert_to_tensor(default_value, dtype=self._dtype)
+    with ops.colocate_with(self._handle):
+      return gen_hash_ops.hash_table_lookup_and_combine(
+          self._handle, self._hash_table.handle,
+          ops.convert_to_tensor(keys, dtype=dtypes.int64),
+          segment_ids, math_ops.cast(num_segments, dtypes.int64),
+          default_value, combiner=combiner, name=name)
+
   def size(self, name=None):
     return self._hash_table.size(name)
 
@@ -569,6 +593,37 @@ def _GatherGrad(op, grad):
   params_shape = handle.get_shape()
   return (ops.IndexedSlices(grad, indices, params_shape), None, None)
 
+@ops.RegisterGradient("HashTableLookupAndGather")
+def _LookupAndGatherGrad(op, unused_ids_grad, grad):
+  """Gradient for fused lookup and gather op."""
+  handle = op.inputs[0]
+  ids = op.outputs[0]
+  params_shape = handle.get_shape()
+  return (ops.IndexedSlices(grad, ids, params_shape), None, None, None)
+
+@ops.RegisterGradient("HashTableLookupAndCombine")
+def _LookupAndCombineGrad(op, unused_ids_grad, grad):
+  """Gradient for fused lookup and combine op."""
+  handle = op.inputs[0]
+  segment_ids = op.inputs[3]
+  ids = op.outputs[0]
+  params_shape = handle.get_shape()
+  values = array_ops.gather(grad, segment_ids)
+  combiner = compat.as_str(op.get_attr("combiner"))
+  if combiner != "sum":
+    counts = math_ops.unsorted_segment_sum(
+        array_ops.ones_like(segment_ids, dtype=grad.dtype),
+        segment_ids, array_ops.shape(grad)[0])
+    if combiner == "sqrtn":
+      counts = math_ops.sqrt(counts)
+    scale = array_ops.gather(math_ops.reciprocal(counts), segment_ids)
+    values *= array_ops.reshape(
+        scale, array_ops.concat(
+            [array_ops.shape(scale), array_ops.ones(
+                [array_ops.rank(values) - 1], dtype=dtypes.int32)], 0))
+  return (ops.IndexedSlices(values, ids, params_shape),
+          None, None, None, None, None)
+
 @tf_export("hash_table.HashTableKeyMapperFactory")
 class HashTableKeyMapperFactory(object):
   # user should override this function
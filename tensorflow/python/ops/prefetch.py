@@ -36,6 +36,7 @@ from tensorflow.python.util.tf_export import tf_export
 ops.NotDifferentiable('TensorBufferPut')
 ops.NotDifferentiable('TensorBufferTake')
 ops.NotDifferentiable('TensorBufferCancel')
+ops.NotDifferentiable('TensorBufferStats')
 
 PREFETCH = "prefetch"
 
@@ -57,7 +58,9 @@ def fill_prefetch_runner_options(options,
                                  closed_exception_types=(errors.OUT_OF_RANGE,),
                                  ignored_exception_types=(),
                                  use_stage_subgraph_thread_pool=False,
-                                 stage_subgraph_thread_pool_id=0):
+                                 stage_subgraph_thread_pool_id=0,
+                                 buffer_stats=None,
+                                 min_threads=None):
   def _feed_fn(feed, feed_val):
     for tensor_type, _, feed_fn, _ in _REGISTERED_EXPANSIONS:
       if isinstance(feed, tensor_type):
@@ -72,6 +75,9 @@ def fill_prefetch_runner_options(options,
   options.cancel_op = cancel_fetching.name
   options.resume_op = resume_fetching.name
   options.close_op = close_fetching.name
+  if buffer_stats is not None and min_threads is not None:
+    options.stats_op = buffer_stats[0].op.name
+    options.min_threads = min_threads
 
   feed_dict = nest.flatten_dict_items(feed_dict)
   for feed, feed_val in feed_dict.items():
@@ -101,6 +107,7 @@ def staged(
     use_stage_subgraph_thread_pool=False,
     stage_subgraph_thread_pool_id = 0,
     stage_subgraph_stream_id = 0,
+    min_threads=None,
     name=None):
   """Prefetch samples.
 
@@ -131,6 +138,9 @@ def staged(
       thread pool to use when enable use_stage_subgraph_thread_pool. 0 by default.
     stage_subgraph_stream_id: (Optional.) Specifies which stream to use for the
       Stage subgraph. The default value is 0.
+    min_threads: (Optional.) If set, number of running threads is autotuned
+      between `min_threads` and `num_threads` by occupancy of the buffer and
+      time spent waiting for samples.
     name: (Optional.) Name of prefetching operations.
 
   Returns:
@@ -138,6 +148,8 @@ def staged(
   """
   if num_threads < 1:
     raise ValueError('num_threads must >= 1')
+  if min_threads is not None and (min_threads < 1 or min_threads > num_threads):
+    raise ValueError('min_threads must be in [1, num_threads]')
 
   if name is None:
     name = ops.get_default_graph().unique_name(PREFETCH)
@@ -192,6 +204,11 @@ def staged(
       close_fetching = gen_tensor_buffer_ops.tensor_buffer_close(
           shared_name=name,
           shared_capacity=capacity)
+      buffer_stats = None
+      if min_threads is not None:
+        buffer_stats = gen_tensor_buffer_ops.tensor_buffer_stats(
+            shared_name=name,
+            shared_capacity=capacity)
       next_tensors = gen_tensor_buffer_ops.tensor_buffer_take(
           dtypes=tensor_dtypes,
           shared_name=name,
@@ -229,7 +246,8 @@ def staged(
                                close_fetching, feed_dict,
                                closed_exception_types, ignored_exception_types,
                                use_stage_subgraph_thread_pool,
-                               stage_subgraph_thread_pool_id)
+                               stage_subgraph_thread_pool_id,
+                               buffer_stats, min_threads)
 
   graph_key = ops.get_default_graph()._graph_key
   prefetch_runner.TF_RegisterPrefetchRunner(graph_key, name+"_prefetch_runner",
@@ -25,6 +25,7 @@ from tensorflow.python.framework import errors
 from tensorflow.python.framework import ops
 from tensorflow.python.framework import sparse_tensor
 from tensorflow.python.ops import array_ops
+from tensorflow.python.ops import gen_tensor_buffer_ops
 from tensorflow.python.ops import parsing_ops
 from tensorflow.python.platform import test
 from tensorflow.python.training import coordinator
@@ -54,6 +55,31 @@ class PrefetchTest(test.TestCase):
         self.assertAllClose(value, sess.run(y), rtol=1e-6)
       coord.request_stop()
 
+  def test_autotune_threads(self):
+    capacity = 2
+    value = 42.0
+    with ops.Graph().as_default() as graph:
+      with ops.device('/cpu:0'):
+        x = array_ops.constant(value, dtype=dtypes.float32, shape=[])
+      with ops.device(test.gpu_device_name()):
+        y = prefetch.staged(
+            x, capacity=capacity, num_threads=4, min_threads=1,
+            timeout_millis=1000, name='autotuned')
+      stats = gen_tensor_buffer_ops.tensor_buffer_stats(
+          shared_name='autotuned', shared_capacity=capacity)
+
+    graph.finalize()
+
+    with self.test_session(use_gpu=True, graph=graph) as sess:
+      coord = coordinator.Coordinator()
+      prefetch.make_prefetch_hook().after_create_session(sess, coord)
+      for _ in xrange(capacity * 3):
+        self.assertAllClose(value, sess.run(y), rtol=1e-6)
+      _, buffer_capacity, num_takes, _ = sess.run(stats)
+      self.assertEqual(capacity, buffer_capacity)
+      self.assertEqual(capacity * 3, num_takes)
+      coord.request_stop()
+
   def test_string(self):
     capacity = 3
     value = "'The quick brown fox jumps over the lazy dog!'"
@@ -29,6 +29,7 @@ from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.framework import dtypes
 from tensorflow.python.framework import ops
 from tensorflow.python.framework import tensor_shape
+from tensorflow.python.framework import tensor_spec
 from tensorflow.python.ops import control_flow_ops
 from tensorflow.python.ops import array_ops
 from tensorflow.python.ops import data_flow_ops
@@ -54,9 +55,16 @@ ops.NotDifferentiable('WorkQueueRestore')
 ops.NotDifferentiable('WorkQueueIsInitialized')
 ops.NotDifferentiable('WorkQueuePut')
 ops.NotDifferentiable('WorkQueueTake')
+ops.NotDifferentiable('WorkQueueTakeMany')
 ops.NotDifferentiable('WorkQueueSize')
 ops.NotDifferentiable('WorkQueueClose')
 ops.NotDifferentiable('SaveLocalWork')
+ops.NotDifferentiable('LeaseCoordinatorHandleOp')
+ops.NotDifferentiable('LeaseCoordinatorIsInitialized')
+ops.NotDifferentiable('LeaseCoordinatorCreate')
+ops.NotDifferentiable('LeaseCoordinatorRestore')
+ops.NotDifferentiable('LeaseCoordinatorSave')
+ops.NotDifferentiable('LeaseDataset')
 
 
 class Work(object): # pylint: disable=useless-object-inheritance
@@ -154,7 +162,8 @@ class WorkQueue(saver.BaseSaverBuilder.SaveableObject):
       num_slices=None,
       num_clients=1,
       name=None,
-      local_work_mgr=None):
+      local_work_mgr=None,
+      locality=None):
     """Constructs a work queue.
 
     Args:
@@ -169,6 +178,9 @@ class WorkQueue(saver.BaseSaverBuilder.SaveableObject):
       num_slices: (Optional.) Total number of slices on all workers.
       num_clients: (Optional.) Number of threads for taking works.
       name: (Optional.) Name of the work queue.
+      local_work_mgr: (Optional.) LocalWorkMgr for restoring local works.
+      locality: (Optional.) Works containing `locality`, e.g. host name of
+        local disk, are preferred by this worker.
 
     Raises:
       ValueError: If one of the arguments is invalid.
@@ -198,6 +210,7 @@ class WorkQueue(saver.BaseSaverBuilder.SaveableObject):
     self._prefix = prefix
     self._num_clients = num_clients
     self._local_work_mgr = local_work_mgr
+    self._locality = locality or ''
 
     if num_epochs <= 0:
       raise ValueError("num_epochs must be > 0 not {}.".format(num_epochs))
@@ -365,7 +378,9 @@ class WorkQueue(saver.BaseSaverBuilder.SaveableObject):
         with ops.device(self._remote_device):
           taken = gen_work_queue_ops.work_queue_take(
               self._handle,
-              num_clients=self.num_clients)
+              num_clients=self.num_clients,
+              consumer=self._local_device,
+              locality=self._locality)
 
           work_bak = control_flow_ops.no_op()
           if self._local_work_mgr:
@@ -398,6 +413,43 @@ class WorkQueue(saver.BaseSaverBuilder.SaveableObject):
       return local_work
     return string_ops.string_join([self._prefix, local_work])
 
+  def take_many(self, num_works):
+    """Take at most `num_works` works from the work queue.
+
+    Works are taken from a queue local to this worker, which is refilled from
+    the work queue in batches or stolen from other workers.
+
+    Works saved by `local_work_mgr` are taken one at a time, use `take` when
+    it is set.
+
+    Args:
+      num_works: Max number of works to take.
+
+    Returns:
+      A non-empty vector of taken works. Running it raises `OutOfRangeError`
+      once the work queue is closed and all works are taken.
+
+    Raises:
+      ValueError: If `local_work_mgr` is set.
+    """
+    if self._local_work_mgr:
+      raise ValueError(
+          'take_many does not back up works to local_work_mgr, use take.')
+    with ops.name_scope(self.name):
+      with ops.device(self._remote_device):
+        taken = gen_work_queue_ops.work_queue_take_many(
+            self._handle,
+            num_works=num_works,
+            num_clients=self.num_clients,
+            consumer=self._local_device,
+            locality=self._locality)
+      with ops.device(self._local_device):
+        local_works = array_ops.identity(taken)
+
+    if self._prefix is None:
+      return local_works
+    return string_ops.string_join([self._prefix, local_works])
+
   def input_producer(self):
     """Returns a FIFOQueue as input producer.
 
@@ -451,6 +503,218 @@ class WorkQueue(saver.BaseSaverBuilder.SaveableObject):
         math_ops.to_float(size) * (1. / self._capacity))
 
 
+class _LeaseDataset(dataset_ops.DatasetSource):  # pylint: disable=abstract-method
+  """A dataset of row ranges taken from a lease coordinator."""
+
+  def __init__(self, handle, consumer):
+    variant_tensor = gen_work_queue_ops.lease_dataset(
+        handle, consumer=consumer)
+    super(_LeaseDataset, self).__init__(variant_tensor)
+
+  @property
+  def element_spec(self):
+    return (
+        tensor_spec.TensorSpec([], dtypes.string),
+        tensor_spec.TensorSpec([], dtypes.int64),
+        tensor_spec.TensorSpec([], dtypes.int64))
+
+
+class LeaseCoordinator(saver.BaseSaverBuilder.SaveableObject):
+  """Coordinates leases of row ranges among input pipelines.
+
+  Each input pipeline holds a lease of rows, and takes `chunk_rows` rows from
+  its lease at a time. Leases shrink as rows run out, and once all rows are
+  leased, a pipeline without a lease takes over half of the untaken rows of
+  the largest lease, so that a pipeline falling behind does not leave others
+  idle at the tail. Every row is taken once per epoch, and rows not taken yet
+  are saved into checkpoints.
+
+  Leases are coordinated among input pipelines of the same process, e.g.
+  pipelines of multiple towers.
+  """
+  Resource = WorkQueue.Resource
+
+  def __init__(
+      self,
+      files,
+      num_rows=None,
+      chunk_rows=1024,
+      max_lease_rows=None,
+      num_epochs=1,
+      shuffle=False,
+      seed=None,
+      name=None):
+    """Constructs a lease coordinator.
+
+    Args:
+      files: A list of input paths.
+      num_rows: (Optional.) A list of number of rows in each file. Files of
+        unknown number of rows are leased as a whole, which is the default.
+      chunk_rows: (Optional.) Max number of rows taken at a time.
+      max_lease_rows: (Optional.) Max number of rows in a lease.
+      num_epochs: (Optional.) An integer. Number of times each row is taken.
+      shuffle: (Optional.) Boolean. If true, files are randomly shuffled
+        within each epoch.
+      seed: (Optional.) An integer. Seed used if shuffle == True.
+      name: (Optional.) Name of the lease coordinator.
+
+    Raises:
+      ValueError: If one of the arguments is invalid.
+    """
+    name = ops.get_default_graph().unique_name(name or 'lease_coordinator')
+    if not isinstance(files, list) or not files:
+      raise ValueError(
+          "LeaseCoordinator requires files as a list of strings")
+    self._files = [
+        f.encode() if isinstance(f, string_types) else f for f in files]
+    if num_rows is None:
+      num_rows = [-1] * len(self._files)
+    if len(num_rows) != len(self._files):
+      raise ValueError(
+          "num_rows must have {} elements not {}".format(
+              len(self._files), len(num_rows)))
+    self._num_rows = [
+        -1 if n is None or n < 0 else int(n) for n in num_rows]
+    if chunk_rows < 1:
+      raise ValueError("chunk_rows must be > 0 not {}.".format(chunk_rows))
+    if num_epochs <= 0:
+      raise ValueError("num_epochs must be > 0 not {}.".format(num_epochs))
+    self._num_consumers = 0
+
+    with ops.name_scope(name):
+      self._device = control_flow_ops.no_op().device
+      with ops.device(self._device):
+        self._handle = gen_work_queue_ops.lease_coordinator_handle_op(
+            shared_name=name)
+        self._digest_op = ops.convert_to_tensor(
+            self.digest, dtype=dtypes.string)
+        files_tensor = ops.convert_to_tensor(self._files, dtype=dtypes.string)
+        ends_tensor = ops.convert_to_tensor(self._num_rows, dtype=dtypes.int64)
+        epochs = []
+        for epoch_index in xrange(num_epochs):
+          with ops.name_scope('epochs/{}'.format(epoch_index)):
+            indices = math_ops.range(len(self._files))
+            if shuffle:
+              indices = random_ops.random_shuffle(indices, seed=seed)
+            epochs.append(indices)
+        indices = array_ops.concat(epochs, 0)
+        files_tensor = array_ops.gather(files_tensor, indices)
+        ends_tensor = array_ops.gather(ends_tensor, indices)
+        self._create = gen_work_queue_ops.lease_coordinator_create(
+            self._handle,
+            files_tensor,
+            array_ops.zeros_like(ends_tensor),
+            ends_tensor,
+            shared_name=name,
+            chunk_rows=chunk_rows,
+            max_lease_rows=max_lease_rows or 0)
+        self._is_initialized = (
+            gen_work_queue_ops.lease_coordinator_is_initialized(self._handle))
+        saved = gen_work_queue_ops.lease_coordinator_save(self._handle)
+        specs = [
+            saver.BaseSaverBuilder.SaveSpec(
+                self._digest_op, "", name + "_digest"),
+            saver.BaseSaverBuilder.SaveSpec(saved[0], "", name + "_files"),
+            saver.BaseSaverBuilder.SaveSpec(saved[1], "", name + "_starts"),
+            saver.BaseSaverBuilder.SaveSpec(saved[2], "", name + "_ends")]
+
+    ops.add_to_collection(ops.GraphKeys.SAVEABLE_OBJECTS, self)
+    ops.add_to_collection(
+        ops.GraphKeys.RESOURCES, LeaseCoordinator.Resource(name, self))
+    logging.info("%s placed at %s.", name, self._device)
+    super(LeaseCoordinator, self).__init__(self, specs, name)
+
+  @property
+  def files(self):
+    """The files in the lease coordinator."""
+    return self._files
+
+  @property
+  def digest(self):
+    """The digest of files and their number of rows."""
+    return b','.join(
+        f + b':' + str(n).encode() for f, n in zip(self._files, self._num_rows))
+
+  def load_from_checkpoint(
+      self, ckpt_dir_or_file, filename_tensor, preferred_shard):
+    """Loads tensors from the checkpoint.
+    """
+    del preferred_shard
+
+    ckpt_ready = False
+    try:
+      ckpt_reader = checkpoint_utils.load_checkpoint(ckpt_dir_or_file)
+      tensors_in_ckpt = ckpt_reader.get_variable_to_shape_map()
+      ckpt_ready = all([spec.name in tensors_in_ckpt for spec in self.specs])
+      del tensors_in_ckpt
+      del ckpt_reader
+    except:  # pylint: disable=bare-except
+      pass
+
+    if ckpt_ready:
+      return [
+          io_ops.restore_v2(
+              filename_tensor,
+              [spec.name],
+              [spec.slice_spec],
+              [spec.dtype])[0]
+          for spec in self.specs]
+    return [None] * len(self.specs)
+
+  def restore(self, restored_tensors, _):
+    """Restores rows not taken yet from restored_tensors.
+
+    Args:
+      restored_tensors: Tensor tuple (digest, files, starts, ends).
+    """
+    if len(restored_tensors) != 4:
+      raise ValueError('LeaseCoordinator requires 4 tensors to restore')
+    if any(t is None for t in restored_tensors):
+      logging.info("Lease coordinator %s not found in checkpoint.", self.name)
+      with ops.name_scope("{}_restore".format(self.name)):
+        return self._create
+    logging.info("Restore lease coordinator %s.", self.name)
+    same_files_again = math_ops.equal(
+        ops.convert_to_tensor(restored_tensors[0], dtype=dtypes.string),
+        ops.convert_to_tensor(self.digest, dtype=dtypes.string))
+    def restore_rows():
+      with ops.control_dependencies([self._create]):
+        return gen_work_queue_ops.lease_coordinator_restore(
+            self._handle, *restored_tensors[1:])
+    with ops.control_dependencies([self._create]):
+      create_with_prompt = logging_ops.print_v2(
+          "Lease coordinator {} abandoned in checkpoint.".format(self.name))
+    with ops.name_scope("{}/restore".format(self.name)):
+      return control_flow_ops.cond(
+          same_files_again, restore_rows, lambda: create_with_prompt)
+
+  def input_dataset(self, consumer=None):
+    """Returns a dataset of row ranges taken from the lease coordinator.
+
+    Each element is a tuple of file, first row and the row after the range,
+    which is -1 if the range covers the whole file. Use
+    `parquet_dataset_ops.read_parquet_row_groups` to read Parquet files whose
+    rows are counted in row groups.
+
+    Saving an iterator of the dataset saves the lease of the consumer, which
+    is leased to it again on restore if the rows are still untaken, e.g.
+    when the iterator is restored after the lease coordinator.
+
+    Args:
+      consumer: (Optional.) Name of the lease holder, unique to each input
+        pipeline by default.
+
+    Returns:
+      A dataset of `(file, start, end)` tuples.
+    """
+    if consumer is None:
+      consumer = 'consumer_{}'.format(self._num_consumers)
+      self._num_consumers += 1
+    with ops.name_scope(self.name):
+      with ops.device(self._device):
+        return _LeaseDataset(self._handle, consumer)
+
+
 class LocalWorkMgr(object):
   """A local work manager for inference job."""
   def __init__(self, job_name, task_index, restore_works_dir, name=None):
@@ -25,6 +25,8 @@ from six import string_types
 import portpicker
 
 from tensorflow.core.protobuf import config_pb2
+from tensorflow.python.data.experimental.ops import iterator_ops
+from tensorflow.python.data.ops import dataset_ops
 from tensorflow.python.framework import errors_impl
 from tensorflow.python.framework import ops
 from tensorflow.python.framework import test_util
@@ -41,6 +43,7 @@ from tensorflow.python.training import saver
 from tensorflow.python.training import server_lib
 from tensorflow.python.training import training_util
 
+from tensorflow.python.ops.work_queue import LeaseCoordinator
 from tensorflow.python.ops.work_queue import WorkQueue
 from tensorflow.python.ops.work_queue import LocalWorkMgr
 from tensorflow.python.training import saver
@@ -109,6 +112,58 @@ class WorkQueueTest(test_lib.TestCase):
       for thread in threads:
         thread.join()
 
+  def test_take_many(self):
+    with self.test_session():
+      works = [b"to", b"be", b"or", b"not", b"to", b"be"]
+      num_epochs = 2
+      work_queue = WorkQueue(works, num_epochs=num_epochs, shuffle=False)
+      take_many = work_queue.take_many(4)
+
+      resources.initialize_resources(resources.shared_resources()).run()
+      variables.global_variables_initializer().run()
+      variables.local_variables_initializer().run()
+
+      taken = []
+      for _ in range(3):
+        taken.extend(take_many.eval().tolist())
+      self.assertEqual(works * num_epochs, taken)
+
+      # Reached the limit.
+      with self.assertRaises(errors_impl.OutOfRangeError):
+        take_many.eval()
+
+  def test_take_many_with_local_work_mgr(self):
+    with self.test_session():
+      local_work_mgr = LocalWorkMgr('worker', 0, self.get_temp_dir())
+      work_queue = WorkQueue(
+          [b"to", b"be"], num_epochs=1, shuffle=False,
+          local_work_mgr=local_work_mgr)
+      with self.assertRaises(ValueError):
+        work_queue.take_many(2)
+
+  def test_take_with_locality(self):
+    with self.test_session():
+      works = [
+          b"hdfs://host1/a", b"hdfs://host2/b",
+          b"hdfs://host1/c", b"hdfs://host2/d"]
+      work_queue = WorkQueue(
+          works, num_epochs=1, shuffle=False, locality="host2")
+      take = work_queue.take()
+
+      resources.initialize_resources(resources.shared_resources()).run()
+      variables.global_variables_initializer().run()
+      variables.local_variables_initializer().run()
+
+      taken = [take.eval() for _ in works]
+      self.assertEqual(
+          [b"hdfs://host2/b", b"hdfs://host2/d",
+           b"hdfs://host1/a", b"hdfs://host1/c"],
+          taken)
+
+      # Reached the limit.
+      with self.assertRaises(errors_impl.OutOfRangeError):
+        take.eval()
+
   def test_slices(self):
     with self.test_session():
       works = [
@@ -512,6 +567,131 @@ class WorkQueueTest(test_lib.TestCase):
       sess[0].run(train_ops[0])
 
 
+class LeaseCoordinatorTest(test_lib.TestCase):
+  def _take_all(self, sess, next_ranges):
+    taken = [[] for _ in next_ranges]
+    active = list(range(len(next_ranges)))
+    while active:
+      for i in list(active):
+        try:
+          taken[i].append(sess.run(next_ranges[i]))
+        except errors_impl.OutOfRangeError:
+          active.remove(i)
+    return taken
+
+  def _get_next(self, coordinator):
+    iterator = dataset_ops.make_initializable_iterator(
+        coordinator.input_dataset())
+    ops.add_to_collection('iterator_initializers', iterator.initializer)
+    return iterator.get_next()
+
+  def _rows(self, ranges):
+    return sorted(
+        (f, r) for f, start, end in ranges for r in range(start, end))
+
+  def test_simple(self):
+    with ops.Graph().as_default(), self.session() as sess:
+      coordinator = LeaseCoordinator(
+          [b"a", b"b"], num_rows=[10, 5], chunk_rows=3)
+      next_range = self._get_next(coordinator)
+      resources.initialize_resources(resources.shared_resources()).run()
+      sess.run(ops.get_collection('iterator_initializers'))
+      taken, = self._take_all(sess, [next_range])
+    self.assertTrue(all(e - s <= 3 for _, s, e in taken))
+    self.assertEqual(
+        [(b"a", r) for r in range(10)] + [(b"b", r) for r in range(5)],
+        [(f, r) for f, s, e in taken for r in range(s, e)])
+
+  def test_unknown_num_rows(self):
+    with ops.Graph().as_default(), self.session() as sess:
+      coordinator = LeaseCoordinator([b"a", b"b"], num_epochs=2)
+      next_range = self._get_next(coordinator)
+      resources.initialize_resources(resources.shared_resources()).run()
+      sess.run(ops.get_collection('iterator_initializers'))
+      taken, = self._take_all(sess, [next_range])
+    self.assertEqual(
+        [(b"a", 0, -1), (b"b", 0, -1)] * 2, [tuple(t) for t in taken])
+
+  def test_split_leases(self):
+    num_rows = [100, 37, 64]
+    with ops.Graph().as_default(), self.session() as sess:
+      coordinator = LeaseCoordinator(
+          [b"a", b"b", b"c"], num_rows=num_rows, chunk_rows=4,
+          max_lease_rows=32)
+      next_ranges = [self._get_next(coordinator) for _ in range(3)]
+      resources.initialize_resources(resources.shared_resources()).run()
+      sess.run(ops.get_collection('iterator_initializers'))
+      # The first consumer falls behind.
+      sess.run(next_ranges[0])
+      taken = self._take_all(sess, next_ranges[1:])
+      taken.append(self._take_all(sess, next_ranges[:1])[0])
+    self.assertTrue(all(e - s <= 4 for t in taken for _, s, e in t))
+    self.assertEqual(
+        [(f, r) for f, n in zip([b"a", b"b", b"c"], num_rows)
+         for r in range(n)][4:],
+        self._rows(r for t in taken for r in t))
+
+  def test_save_restore(self):
+    save_path = os.path.join(self.get_temp_dir(), 'lease_coordinator')
+    with ops.Graph().as_default(), self.session() as sess:
+      coordinator = LeaseCoordinator(
+          [b"a", b"b"], num_rows=[10, 6], chunk_rows=2, name='leases')
+      next_range = self._get_next(coordinator)
+      resources.initialize_resources(resources.shared_resources()).run()
+      sess.run(ops.get_collection('iterator_initializers'))
+      taken = [sess.run(next_range) for _ in range(3)]
+      saver.Saver().save(sess, save_path)
+      sess.run(next_range)
+    with ops.Graph().as_default(), self.session() as sess:
+      coordinator = LeaseCoordinator(
+          [b"a", b"b"], num_rows=[10, 6], chunk_rows=2, name='leases')
+      next_range = self._get_next(coordinator)
+      saver.Saver().restore(sess, save_path)
+      sess.run(ops.get_collection('iterator_initializers'))
+      taken += self._take_all(sess, [next_range])[0]
+    self.assertEqual(
+        [(b"a", r) for r in range(10)] + [(b"b", r) for r in range(6)],
+        self._rows(taken))
+
+  def test_save_restore_iterator(self):
+    save_path = os.path.join(self.get_temp_dir(), 'lease_coordinator')
+    save_iterators_path = os.path.join(self.get_temp_dir(), 'lease_iterators')
+
+    def build():
+      coordinator = LeaseCoordinator(
+          [b"a"], num_rows=[20], chunk_rows=2, name='leases')
+      iterators = [
+          dataset_ops.make_initializable_iterator(coordinator.input_dataset())
+          for _ in range(2)]
+      iterators_saver = saver.Saver(
+          [iterator_ops.make_saveable_from_iterator(it) for it in iterators])
+      next_ranges = [it.get_next() for it in iterators]
+      initializers = [it.initializer for it in iterators]
+      return (saver.Saver([coordinator]), iterators_saver, next_ranges,
+              initializers)
+
+    with ops.Graph().as_default(), self.session() as sess:
+      coordinator_saver, iterators_saver, next_ranges, initializers = build()
+      resources.initialize_resources(resources.shared_resources()).run()
+      sess.run(initializers)
+      taken = [sess.run(next_ranges[0]), sess.run(next_ranges[1])]
+      coordinator_saver.save(sess, save_path)
+      iterators_saver.save(sess, save_iterators_path)
+      sess.run(next_ranges[0])
+    with ops.Graph().as_default(), self.session() as sess:
+      coordinator_saver, iterators_saver, next_ranges, initializers = build()
+      coordinator_saver.restore(sess, save_path)
+      sess.run(initializers)
+      iterators_saver.restore(sess, save_iterators_path)
+      # The first consumer resumes its lease after the taken chunk.
+      resumed = sess.run(next_ranges[0])
+      self.assertEqual((b"a", taken[0][2], taken[0][2] + 2), tuple(resumed))
+      taken.append(resumed)
+      for t in self._take_all(sess, next_ranges):
+        taken += t
+    self.assertEqual([(b"a", r) for r in range(20)], self._rows(taken))
+
+
 if __name__ == "__main__":
   logging.set_verbosity(logging.INFO)
   test_lib.main()
@@ -0,0 +1,181 @@
+# Copyright 2022 The DeepRec Authors. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# ==============================================================================
+"""Lazy Adam for EmbeddingVariable."""
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+from tensorflow.python.framework import ops
+from tensorflow.python.ops import kv_variable_ops
+from tensorflow.python.ops import math_ops
+from tensorflow.python.training import optimizer
+from tensorflow.python.training import slot_creator
+from tensorflow.python.training import training_ops
+from tensorflow.python.training import training_util
+from tensorflow.python.util.tf_export import tf_export
+
+
+@tf_export(v1=["train.AdamLazyDecayOptimizer"])
+class AdamLazyDecayOptimizer(optimizer.Optimizer):
+  """Optimizer that implements the Adam algorithm with lazy sparse updates.
+
+  See [Kingma et al., 2014](http://arxiv.org/abs/1412.6980)
+  ([pdf](http://arxiv.org/pdf/1412.6980.pdf)).
+  """
+
+  def __init__(self,
+               learning_rate=0.001,
+               beta1=0.9,
+               beta2=0.999,
+               epsilon=1e-8,
+               use_locking=False,
+               name="AdamLazyDecay"):
+    r"""Construct a new Adam optimizer with lazily decayed moments.
+
+    The update rule is the one of `AdamOptimizer`, but the beta powers are
+    derived from the global step instead of being kept in variables:
+
+    $$t := global\_step + 1$$
+    $$lr_t := \text{learning\_rate} * \sqrt{1 - beta_2^t} / (1 - beta_1^t)$$
+
+    For an EmbeddingVariable only the rows in the batch are touched. The step
+    of the last update of every row is kept in the row itself, and the moments
+    of a row that was not updated for `k` steps are decayed by `beta_1^k` and
+    `beta_2^k` before the update. The moments and the bias correction are
+    thus the ones of dense Adam, without any per-step op on the beta powers.
+    The EmbeddingVariable has to record versions, i.e. it has to be created
+    with `steps_to_live` or with `TF_RECORD_VERSION=1`. The step of a row is
+    its version, so a row evicted by `steps_to_live` restarts with zero
+    moments.
+
+    The global step has to be incremented once per training step, e.g. by
+    passing it to `minimize` or `apply_gradients`.
+
+    Args:
+      learning_rate: A Tensor or a floating point value.  The learning rate.
+      beta1: A float value or a constant float tensor. The exponential decay
+        rate for the 1st moment estimates.
+      beta2: A float value or a constant float tensor. The exponential decay
+        rate for the 2nd moment estimates.
+      epsilon: A small constant for numerical stability. This epsilon is
+        "epsilon hat" in the Kingma and Ba paper (in the formula just before
+        Section 2.1), not the epsilon in Algorithm 1 of the paper.
+      use_locking: If True use locks for update operations.
+      name: Optional name for the operations created when applying gradients.
+        Defaults to "AdamLazyDecay".
+    """
+    super(AdamLazyDecayOptimizer, self).__init__(use_locking, name)
+    self._lr = learning_rate
+    self._beta1 = beta1
+    self._beta2 = beta2
+    self._epsilon = epsilon
+
+    # Tensor versions of the constructor arguments, created in _prepare().
+    self._lr_t = None
+    self._beta1_t = None
+    self._beta2_t = None
+    self._epsilon_t = None
+    self._global_step = None
+
+  def _create_slots(self, var_list):
+    # Create slots for the first and second moments.
+    for v in var_list:
+      self._zeros_slot(v, "m", self._name, slot_config=slot_creator.SlotConfig(slot_index=1, slot_num=2))
+      self._zeros_slot(v, "v", self._name, slot_config=slot_creator.SlotConfig(slot_index=2, slot_num=2))
+
+  def _prepare(self):
+    lr = self._call_if_callable(self._lr)
+    beta1 = self._call_if_callable(self._beta1)
+    beta2 = self._call_if_callable(self._beta2)
+    epsilon = self._call_if_callable(self._epsilon)
+
+    self._lr_t = ops.convert_to_tensor(lr, name="learning_rate")
+    self._beta1_t = ops.convert_to_tensor(beta1, name="beta1")
+    self._beta2_t = ops.convert_to_tensor(beta2, name="beta2")
+    self._epsilon_t = ops.convert_to_tensor(epsilon, name="epsilon")
+    self._global_step = training_util.get_or_create_global_step()
+
+  def _get_beta_powers(self, dtype):
+    t = math_ops.cast(self._global_step + 1, dtype)
+    return (math_ops.pow(math_ops.cast(self._beta1_t, dtype), t),
+            math_ops.pow(math_ops.cast(self._beta2_t, dtype), t))
+
+  def _apply_dense(self, grad, var):
+    m = self.get_slot(var, "m")
+    v = self.get_slot(var, "v")
+    beta1_power, beta2_power = self._get_beta_powers(var.dtype.base_dtype)
+    return training_ops.apply_adam(
+        var, m, v, beta1_power, beta2_power,
+        math_ops.cast(self._lr_t, var.dtype.base_dtype),
+        math_ops.cast(self._beta1_t, var.dtype.base_dtype),
+        math_ops.cast(self._beta2_t, var.dtype.base_dtype),
+        math_ops.cast(self._epsilon_t, var.dtype.base_dtype),
+        grad, use_locking=self._use_locking).op
+
+  def _resource_apply_dense(self, grad, var):
+    m = self.get_slot(var, "m")
+    v = self.get_slot(var, "v")
+    beta1_power, beta2_power = self._get_beta_powers(grad.dtype.base_dtype)
+    return training_ops.resource_apply_adam(
+        var.handle, m.handle, v.handle, beta1_power, beta2_power,
+        math_ops.cast(self._lr_t, grad.dtype.base_dtype),
+        math_ops.cast(self._beta1_t, grad.dtype.base_dtype),
+        math_ops.cast(self._beta2_t, grad.dtype.base_dtype),
+        math_ops.cast(self._epsilon_t, grad.dtype.base_dtype),
+        grad, use_locking=self._use_locking)
+
+  def _apply_sparse(self, grad, var):
+    m = self.get_slot(var, "m")
+    v = self.get_slot(var, "v")
+    beta1_power, beta2_power = self._get_beta_powers(var.dtype.base_dtype)
+    return training_ops.sparse_apply_adam(
+        var, m, v, beta1_power, beta2_power,
+        math_ops.cast(self._lr_t, var.dtype.base_dtype),
+        math_ops.cast(self._beta1_t, var.dtype.base_dtype),
+        math_ops.cast(self._beta2_t, var.dtype.base_dtype),
+        math_ops.cast(self._epsilon_t, var.dtype.base_dtype),
+        grad.values, grad.indices, use_locking=self._use_locking)
+
+  def _resource_apply_sparse(self, grad, var, indices, indices_counts = None):
+    m = self.get_slot(var, "m")
+    v = self.get_slot(var, "v")
+    if isinstance(var, kv_variable_ops.EmbeddingVariable):
+      if indices_counts != None:
+        return training_ops.kv_resource_sparse_apply_lazy_adam_with_counts(
+          var.handle, m.handle, v.handle,
+          math_ops.cast(self._lr_t, grad.dtype),
+          math_ops.cast(self._beta1_t, grad.dtype),
+          math_ops.cast(self._beta2_t, grad.dtype),
+          math_ops.cast(self._epsilon_t, grad.dtype),
+          grad, indices, self._global_step, indices_counts,
+          use_locking=self._use_locking)
+      else:
+        return training_ops.kv_resource_sparse_apply_lazy_adam(
+          var.handle, m.handle, v.handle,
+          math_ops.cast(self._lr_t, grad.dtype),
+          math_ops.cast(self._beta1_t, grad.dtype),
+          math_ops.cast(self._beta2_t, grad.dtype),
+          math_ops.cast(self._epsilon_t, grad.dtype),
+          grad, indices, self._global_step,
+          use_locking=self._use_locking)
+    else:
+      beta1_power, beta2_power = self._get_beta_powers(grad.dtype)
+      return training_ops.resource_sparse_apply_adam(
+          var.handle, m.handle, v.handle, beta1_power, beta2_power,
+          math_ops.cast(self._lr_t, grad.dtype),
+          math_ops.cast(self._beta1_t, grad.dtype),
+          math_ops.cast(self._beta2_t, grad.dtype),
+          math_ops.cast(self._epsilon_t, grad.dtype),
+          grad, indices, use_locking=self._use_locking)
@@ -22,6 +22,8 @@ from tensorflow.python.ops import variables
 from tensorflow.python.ops import math_ops
 from tensorflow.python.ops import array_ops
 from tensorflow.python.data.ops import dataset_ops
+from tensorflow.python.ops import prefetch_runner_hook
+from tensorflow.python.training import monitored_session
 from tensorflow.python.framework import ops
 from tensorflow.python.framework import dtypes
 from tensorflow.core.protobuf import config_pb2
@@ -72,7 +74,70 @@ class AsyncEmbeddingStageTest(test.TestCase):
 
         self.assertEqual(stage_put_num, 2)
         self.assertEqual(stage_take_num, 2)
-        
-        
+
+    def _buildGraphPassModel(self):
+        dataset = dataset_ops.Dataset.from_tensor_slices(({'a': [1, 2, 3]}))
+        dataset = dataset.batch(3).repeat()
+        iterator = dataset.make_one_shot_iterator()
+        next_element = iterator.get_next()
+
+        next_element = prefetch.staged(next_element)
+
+        features = next_element
+        a = feature_column._categorical_column_with_identity('a', num_buckets=5, default_value=0)
+        a_one_hot = feature_column._indicator_column(a)
+        a_one_hot_dense = feature_column.input_layer(features, a_one_hot)
+
+        b = variables.Variable(array_ops.ones([5, 10]))
+        return math_ops.matmul(a_one_hot_dense, b)
+
+    def testAsyncEmbeddingGraphPass(self):
+        config = config_pb2.ConfigProto()
+        optimizer_options = config.graph_options.optimizer_options
+        optimizer_options.do_async_embedding = True
+        optimizer_options.async_embedding_options.threads_num = 1
+        optimizer_options.async_embedding_options.capacity = 2
+        optimizer_options.async_embedding_options.use_graph_pass = True
+        # the same config serves sessions of two graphs in one process
+        for _ in range(2):
+            with ops.Graph().as_default():
+                c = self._buildGraphPassModel()
+                hooks = [prefetch_runner_hook.PrefetchRunnerHook()]
+                with monitored_session.MonitoredTrainingSession(
+                    config=config, hooks=hooks) as sess:
+                    for _ in range(3):
+                        self.assertAllEqual([[1.0] * 10] * 3, sess.run(c))
+                    run_options = config_pb2.RunOptions(
+                        output_partition_graphs=True)
+                    run_metadata = config_pb2.RunMetadata()
+                    sess.run(c, options=run_options,
+                             run_metadata=run_metadata)
+
+                # the step takes the lookups from the buffer the pass added,
+                # next to the one of the IO stage
+                take_nodes = [
+                    node.name
+                    for partition_graph in run_metadata.partition_graphs
+                    for node in partition_graph.node
+                    if node.op == 'TensorBufferTake']
+                self.assertEqual(2, len(take_nodes))
+                self.assertEqual(1, len([
+                    name for name in take_nodes
+                    if name.startswith('async_embedding_stage')]))
+
+                # the graph is rewritten at session creation only
+                stage_put_num = 0
+                for node in ops.get_default_graph().get_operations():
+                    if node.type == 'TensorBufferPut':
+                        stage_put_num += 1
+                self.assertEqual(stage_put_num, 1)
+
+            # the caller's config is left untouched
+            self.assertEqual(
+                '', optimizer_options.async_embedding_options.graph_key)
+            self.assertEqual(
+                [], list(optimizer_options.async_embedding_options.boundary_nodes))
+
+
 if __name__ == "__main__":
     test.main()
@@ -584,8 +584,27 @@ def MonitoredTrainingSession(
   if config != None:
     # Get async_embedding parameters from config
     optimizer_options = config.graph_options.optimizer_options
-    scaffold.set_enable_async_embedding(optimizer_options.do_async_embedding)
-    scaffold.set_async_embedding_options(optimizer_options.async_embedding_options)
+    async_embedding_options = optimizer_options.async_embedding_options
+    if optimizer_options.do_async_embedding and \
+       async_embedding_options.use_graph_pass:
+      # embedding lookups are staged by the graph pass in session creation,
+      # the options are filled in on a copy so that the caller's config can
+      # be reused by sessions of other graphs
+      config_copy = config_pb2.ConfigProto()
+      config_copy.CopyFrom(config)
+      config = config_copy
+      optimizer_options = config.graph_options.optimizer_options
+      async_embedding_options = optimizer_options.async_embedding_options
+      async_embedding_options.graph_key = ops.get_default_graph()._graph_key
+      del async_embedding_options.boundary_nodes[:]
+      for tensor in ops.get_collection(
+          ops.GraphKeys.ASYNC_EMBEDDING_OUTPUT_TENSORS):
+        if tensor.op.name not in async_embedding_options.boundary_nodes:
+          async_embedding_options.boundary_nodes.append(tensor.op.name)
+      scaffold.set_enable_async_embedding(False)
+    else:
+      scaffold.set_enable_async_embedding(optimizer_options.do_async_embedding)
+    scaffold.set_async_embedding_options(async_embedding_options)
   scaffold.set_async_embedding_checkpoint_dir(checkpoint_dir)
 
   if worker_context:
@@ -35,6 +35,9 @@ def SmartStageOptions(
     use_stage_subgraph_thread_pool=False,
     stage_subgraph_thread_pool_id=0,
     stage_subgraph_stream_id=0,
+    num_stages=1,
+    stage_capacities=None,
+    cost_profile=None,
     graph=None,
     name=None):
   """Generate SmartStageOptions.
@@ -58,6 +61,14 @@ def SmartStageOptions(
       thread pool to use when enable use_stage_subgraph_thread_pool. 0 by default.
     stage_subgraph_stream_id: (Optional.) Specifies which stream to use for the
       Stage subgraph. The default value is 0.
+    num_stages: (Optional.) Number of pipeline stages the stage subgraph is
+      split into, each running on its own prefetch threads. 1 by default.
+    stage_capacities: (Optional.) Buffer capacity of each stage boundary,
+      `capacity` is used for missing ones.
+    cost_profile: (Optional.) Path of a serialized `RunMetadata` collected
+      during warm-up steps, with `build_cost_model` or `FULL_TRACE`. Stage
+      boundaries split the measured cost evenly, or the number of ops when
+      not specified.
     graph: (Optional.) Specify the graph for SmartStage, which is the graph
       passed to the Session.
     name: (Optional.) Name of prefetching operations.
@@ -100,6 +111,21 @@ def SmartStageOptions(
     raise ValueError('stage_subgraph_stream_id >= 0')
   options.stage_subgraph_stream_id = stage_subgraph_stream_id
 
+  if num_stages < 1:
+    raise ValueError('num_stages must >= 1')
+  options.num_stages = num_stages
+
+  if stage_capacities is not None:
+    if len(stage_capacities) > num_stages:
+      raise ValueError('stage_capacities must not be longer than num_stages')
+    for stage_capacity in stage_capacities:
+      if stage_capacity < 1:
+        raise ValueError('stage_capacities must >= 1')
+      options.stage_capacities.append(stage_capacity)
+
+  if cost_profile is not None:
+    options.cost_profile = cost_profile
+
   if graph is None:
     graph = ops.get_default_graph()
   options.graph_key = graph._graph_key